@@ -46,7 +46,7 @@
 /** Module version
 The lower significant byte is equal 0 for released version only
 */
-#define     PERSIST_CUSTOMER_INTERFACE_VERSION            (0x01060000U)
+#define     PERSIST_CUSTOMER_INTERFACE_VERSION            (0x01070000U)
 
 /** \} */ /* End of Errors */
 
@@ -333,6 +333,45 @@ typedef struct _plugin_info_s
  */
 int plugin_get_info(plugin_info_s* pInfo_out);
 
+/**
+ * @brief entry of a batch request, see ::plugin_get_data_batch and ::plugin_set_data_batch
+ */
+typedef struct _plugin_batch_entry_s
+{
+    const char* path ;           /*!< the path to the data, as passed to plugin_get_data/plugin_set_data */
+    char*       buffer ;         /*!< the buffer for the data (get) or the data to write (set) */
+    int         size ;           /*!< the size of the buffer (get) or the number of bytes to write (set) */
+    int         result ;         /*!< set by the plugin: size of data read/written; negative value: error code (\ref PCCL_RETURNS) */
+}plugin_batch_entry_s ;
+
+/**
+ * @brief get the data of several paths with one call
+ *
+ * @param entries the batch entries, the plugin sets the result of each entry
+ * @param num_entries the number of entries
+ *
+ * @return positive value (0 or greater): the number of entries read successfully;
+ *         negative value: error code (\ref PCCL_RETURNS), no entry has been processed
+ *
+ * @note
+ *       - Optional, if not provided or if the call fails the data is read with ::plugin_get_data
+ */
+int plugin_get_data_batch(plugin_batch_entry_s* entries, int num_entries);
+
+/**
+ * @brief set the data of several paths with one call
+ *
+ * @param entries the batch entries, the plugin sets the result of each entry
+ * @param num_entries the number of entries
+ *
+ * @return positive value (0 or greater): the number of entries written successfully;
+ *         negative value: error code (\ref PCCL_RETURNS), no entry has been processed
+ *
+ * @note
+ *       - Optional, if not provided or if the call fails the data is written with ::plugin_set_data
+ */
+int plugin_set_data_batch(plugin_batch_entry_s* entries, int num_entries);
+
 /** \} */
 /** \} */
 
@@ -72,6 +72,33 @@ typedef struct _pclNotification_s
 } pclNotification_s;
 
 
+/**
+* entry of a multi key read or write batch, see ::pclKeyReadDataBatch and ::pclKeyWriteDataBatch
+*/
+typedef struct _pclKeyBatchEntry_s
+{
+   unsigned int ldbid;                       /// logical db id
+   const char * resource_id;                 /// resource id
+   unsigned int user_no;                     /// user id
+   unsigned int seat_no;                     /// seat id
+   unsigned char* buffer;                    /// buffer for the data
+   int buffer_size;                          /// size of the buffer
+   int result;                               /// result of this entry: bytes read/written or a negative error code
+} pclKeyBatchEntry_s;
+
+
+/**
+* resource descriptor, generated from a resource configuration table with
+* "persistence_rct_compiler -g <header>", see ::pclKeyReadDataById and ::pclKeyWriteDataById
+*/
+typedef struct _pclResourceId_s
+{
+   const char * resource_id;                 /// resource id
+   unsigned int hash;                        /// hash value of the resource id
+   unsigned int slot;                        /// slot of the resource in the compiled resource configuration table
+} pclResourceId_s;
+
+
 
 /** \} */
 
@@ -86,6 +113,20 @@ typedef struct _pclNotification_s
 typedef int(* pclChangeNotifyCallback_t)(pclNotification_s * notifyStruct);
 
 
+/**
+* entry of a change notification registration list, see ::pclKeyRegisterNotifyOnChangeList
+*/
+typedef struct _pclNotifyRegEntry_s
+{
+   unsigned int ldbid;                       /// logical db id
+   const char * resource_id;                 /// resource id
+   unsigned int user_no;                     /// user id
+   unsigned int seat_no;                     /// seat id
+   pclChangeNotifyCallback_t callback;       /// notification callback
+   int result;                               /// result of this entry: 0 on success or a negative error code
+} pclNotifyRegEntry_s;
+
+
 /** \defgroup PCL_KEYVALUE functions Key-Value access
  * \{
  */
@@ -179,12 +220,35 @@ int pclKeyHandleReadData(int key_handle, unsigned char* buffer, int buffer_size)
 
 
 
+/**
+ * @brief reads persistent data identified by key handle into a buffer allocated by the library,
+ *        see ::pclKeyReadDataAlloc for the buffer handling
+ *
+ * @param key_handle key value handle return by key_handle_open()
+ * @param buffer pointer to the buffer for the persistent data
+ * @param buffer_size pointer to the size of the buffer, returns the new size if the buffer has been grown
+ *
+ * @return positive value (0 or greater): the bytes read;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_NOT_INITIALIZED ::EPERS_NOPLUGINFUNCT ::EPERS_MAXHANDLE ::EPERS_COMMON
+ */
+int pclKeyHandleReadDataAlloc(int key_handle, unsigned char** buffer, int* buffer_size);
+
+
+
 /**
  * @brief register a change notification for persistent data
  *
- * @warning It is only possible to register one callback at the time, not multiple ones.
- *          If you need to change the callback, call ::pclKeyHandleUnRegisterNotifyOnChange
- *          and then register a callback again.
+ * @warning It is only possible to register one callback per resource at the time, not multiple ones.
+ *          If you need to change the callback of a resource, call ::pclKeyHandleUnRegisterNotifyOnChange
+ *          and then register a callback again. Different resources can have different callbacks.
+ *
+ * @note The callback is not called on the thread of the caller, but on a notification thread
+ *       of the library (the number of threads can be set with the environment variable
+ *       PERS_CLIENT_NOTIFY_THREADS). The notifications of a resource are delivered in order.
+ *
+ * @note See ::pclKeyRegisterNotifyOnChange for the compatibility of the batched notification
+ *       signal (PERS_CLIENT_NOTIFY_BATCH) with older receivers.
  *
  * @param key_handle key value handle return by key_handle_open()
  * @param callback notification callback
@@ -246,12 +310,98 @@ int pclKeyReadData(unsigned int ldbid, const char* resource_id, unsigned int use
 
 
 
+/**
+ * @brief reads persistent data identified by ldbid and resource_id into a buffer
+ *        allocated by the library, no size request with ::pclKeyGetSize is needed.
+ *
+ * If *buffer is NULL a new buffer is allocated. Otherwise *buffer must have been
+ * allocated with malloc and *buffer_size must hold its size; the buffer is reused
+ * and grown with realloc if the data does not fit. The buffer may be larger than
+ * the data; if the data is written while it is read, the read is repeated with a
+ * larger buffer, the data is not truncated. The buffer must be freed by the
+ * caller with free(), also if the function failed.
+ *
+ * @param ldbid logical database ID
+ * @param resource_id the resource ID
+ * @param user_no  the user ID; user_no=0 can not be used as user-ID because ‘0’ is defined as System/node
+ * @param seat_no  the seat number
+ * @param buffer pointer to the buffer for the persistent data
+ * @param buffer_size pointer to the size of the buffer, returns the new size if the buffer has been grown
+ *
+ * @return positive value (0 or greater): the bytes read;
+ * On error a negative value will be returned with th following error codes:
+ * ::EPERS_LOCKFS ::EPERS_NOT_INITIALIZED ::EPERS_BADPOL ::EPERS_NOPLUGINFUNCT ::EPERS_COMMON
+ */
+int pclKeyReadDataAlloc(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no,
+                        unsigned char** buffer, int* buffer_size);
+
+
+
+/**
+ * @brief reads persistent data identified by a generated resource descriptor
+ *
+ * The resource configuration is taken directly from the slot of the compiled
+ * resource configuration table, no resource id lookup is done.
+ * If the compiled table is not available or has been generated from another
+ * resource configuration table, the resource is looked up like in ::pclKeyReadData.
+ *
+ * @param ldbid logical database ID
+ * @param resource the resource descriptor
+ * @param user_no  the user ID; user_no=0 can not be used as user-ID because '0' is defined as System/node
+ * @param seat_no  the seat number
+ * @param buffer the buffer for persistent data
+ * @param buffer_size size of buffer for reading
+ *
+ * @return positive value (0 or greater): the bytes read;
+ * On error a negative value will be returned with th following error codes:
+ * ::EPERS_LOCKFS ::EPERS_NOT_INITIALIZED ::EPERS_BADPOL ::EPERS_NOPLUGINFUNCT
+ */
+int pclKeyReadDataById(unsigned int ldbid, const pclResourceId_s* resource, unsigned int user_no, unsigned int seat_no,
+                       unsigned char* buffer, int buffer_size);
+
+
+
+/**
+ * @brief reads persistent data of several resources with one call
+ *
+ * The access lock is checked once for the whole batch, the entries are grouped
+ * by the database they are stored in and each database is looked up only once.
+ * A failing entry does not abort the batch, the result of each entry is
+ * stored in the result member of the entry (bytes read or a negative error code
+ * as returned by ::pclKeyReadData).
+ *
+ * @param entries array of batch entries, ldbid, resource_id, user_no, seat_no, buffer and buffer_size must be set
+ * @param num_entries number of entries in the array
+ *
+ * @return positive value (0 or greater): the number of entries read successfully;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_LOCKFS ::EPERS_NOT_INITIALIZED ::EPERS_COMMON
+ */
+int pclKeyReadDataBatch(pclKeyBatchEntry_s* entries, unsigned int num_entries);
+
+
+
 /**
  * @brief register a change notification for persistent data
  *
- * @warning It is only possible to register one callback at the time, not multiple ones.
- *          If you need to change the callback, call ::pclKeyUnRegisterNotifyOnChange
- *          and then register a callback again.
+ * @warning It is only possible to register one callback per resource at the time, not multiple ones.
+ *          If you need to change the callback of a resource, call ::pclKeyUnRegisterNotifyOnChange
+ *          and then register a callback again. Different resources can have different callbacks.
+ *
+ * @note The callback is not called on the thread of the caller, but on a notification thread
+ *       of the library (the number of threads can be set with the environment variable
+ *       PERS_CLIENT_NOTIFY_THREADS). The notifications of a resource are delivered in order.
+ *
+ * @note If the environment variable PERS_CLIENT_NOTIFY_COALESCE_WINDOW is set to a value greater than 0
+ *       in the writing application, repeated change or delete notifications of a resource within
+ *       PERS_CLIENT_NOTIFY_COALESCE_WINDOW ms are delivered as one notification with the latest status.
+ *
+ * @note If the environment variable PERS_CLIENT_NOTIFY_BATCH is set to 1 in the writing application,
+ *       the change notifications are sent as one "PersistenceResBatch" D-Bus signal per mainloop cycle
+ *       instead of one "PersistenceResChange", "PersistenceResDelete" or "PersistenceResCreate" signal
+ *       per resource. Only receivers using a library version with batch support get these notifications,
+ *       older library versions and applications listening to the single signals directly do not get
+ *       any notification. Enable the batched signal only if all receivers support it.
  *
  * @param ldbid logical database ID of the resource to monitor
  * @param resource_id the resource ID
@@ -267,6 +417,30 @@ int pclKeyRegisterNotifyOnChange(unsigned int ldbid, const char* resource_id, un
 
 
 
+
+/**
+ * @brief register change notifications for a list of resources with one call
+ *
+ * Each entry is checked and registered like with ::pclKeyRegisterNotifyOnChange, but all entries
+ * are passed to the bus daemon in one request. A failing entry does not abort the registration,
+ * the result of each entry is stored in the result member of the entry.
+ *
+ * @note If the environment variable PERS_CLIENT_NOTIFY_LOCAL_FILTER is set to 1, one match rule
+ *       is registered at the bus daemon for all change notifications of the application instead
+ *       of one match rule per resource and the received notifications are filtered by the library.
+ *       Use it for applications registering many resources.
+ *
+ * @param entries array of entries, ldbid, resource_id, user_no, seat_no and callback must be set
+ * @param num_entries number of entries in the array
+ *
+ * @return positive value (0 or greater): the number of entries registered successfully;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_NOT_INITIALIZED ::EPERS_COMMON
+ */
+int pclKeyRegisterNotifyOnChangeList(pclNotifyRegEntry_s* entries, unsigned int num_entries);
+
+
+
 /**
  * @brief unregister a change notification for persistent data
  *
@@ -284,6 +458,22 @@ int pclKeyUnRegisterNotifyOnChange( unsigned int  ldbid, const char *  resource_
 
 
 
+
+/**
+ * @brief unregister change notifications for a list of resources with one call,
+ *        see ::pclKeyRegisterNotifyOnChangeList
+ *
+ * @param entries array of entries, ldbid, resource_id, user_no and seat_no must be set
+ * @param num_entries number of entries in the array
+ *
+ * @return positive value (0 or greater): the number of entries unregistered successfully;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_NOT_INITIALIZED ::EPERS_COMMON
+ */
+int pclKeyUnRegisterNotifyOnChangeList(pclNotifyRegEntry_s* entries, unsigned int num_entries);
+
+
+
 /**
  * @brief writes persistent data identified by ldbid and resource_id
  *
@@ -295,6 +485,11 @@ int pclKeyUnRegisterNotifyOnChange( unsigned int  ldbid, const char *  resource_
  * @param buffer_size the number of bytes to write (default max size is set to 16kB)
  *                    use environment variable PERS_MAX_KEY_VAL_DATA_SIZE to modify default size in bytes
  *
+ * @note If the environment variable PERS_CLIENT_WRITE_CACHE_INTERVAL is set to a value greater than 0,
+ *       the data of local write cached resources is kept in memory and written to the database
+ *       every PERS_CLIENT_WRITE_CACHE_INTERVAL ms, on a write back request of the persistence
+ *       administration service and on shutdown.
+ *
  * @return positive value (0 or greater): the bytes written;
  * On error a negative value will be returned with the following error codes:
  * ::EPERS_LOCKFS ::EPERS_BADPOL ::EPERS_BUFLIMIT ::EPERS_DB_VALUE_SIZE ::EPERS_DB_KEY_SIZE
@@ -303,6 +498,56 @@ int pclKeyUnRegisterNotifyOnChange( unsigned int  ldbid, const char *  resource_
 int pclKeyWriteData(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no, unsigned char* buffer, int buffer_size);
 
 
+
+/**
+ * @brief writes persistent data identified by a generated resource descriptor,
+ *        see ::pclKeyReadDataById for the resource lookup
+ *
+ * @param ldbid logical database ID
+ * @param resource the resource descriptor
+ * @param user_no  the user ID; user_no=0 can not be used as user-ID because '0' is defined as System/node
+ * @param seat_no  the seat number
+ * @param buffer the buffer containing the persistent data to write
+ * @param buffer_size the number of bytes to write
+ *
+ * @return positive value (0 or greater): the bytes written;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_LOCKFS ::EPERS_BADPOL ::EPERS_BUFLIMIT ::EPERS_DB_VALUE_SIZE ::EPERS_DB_KEY_SIZE
+ * ::EPERS_NOTIFY_SIG ::EPERS_RESOURCE_READ_ONLY
+ */
+int pclKeyWriteDataById(unsigned int ldbid, const pclResourceId_s* resource, unsigned int user_no, unsigned int seat_no,
+                        unsigned char* buffer, int buffer_size);
+
+
+
+/**
+ * @brief writes persistent data of several resources with one call
+ *
+ * All entries are validated (resource configuration, data size, permission) before
+ * anything is written; if one entry is invalid, no entry is written at all and the
+ * valid entries report ::EPERS_SETDTAFAILED. The writes are grouped by the database
+ * they are stored in. The current values are kept before a database is written;
+ * if writing an entry fails (e.g. database or plugin error), the entries already
+ * written are restored to the value they had before the batch and the batch
+ * returns ::EPERS_SETDTAFAILED.
+ * The result of each entry is stored in the result member of the entry
+ * (bytes written or a negative error code as returned by ::pclKeyWriteData).
+ *
+ * @note The change notifications of all written shared and custom resources are sent
+ *       as one "PersistenceResBatch" D-Bus signal for the whole batch. Only receivers
+ *       using a library version with batch support get these notifications, see
+ *       ::pclKeyRegisterNotifyOnChange.
+ *
+ * @param entries array of batch entries, ldbid, resource_id, user_no, seat_no, buffer and buffer_size must be set
+ * @param num_entries number of entries in the array
+ *
+ * @return positive value (0 or greater): the number of entries written successfully;
+ * On error a negative value will be returned with the following error codes:
+ * ::EPERS_LOCKFS ::EPERS_NOT_INITIALIZED ::EPERS_SETDTAFAILED ::EPERS_COMMON
+ */
+int pclKeyWriteDataBatch(pclKeyBatchEntry_s* entries, unsigned int num_entries);
+
+
 /** \} */
 
 #ifdef __cplusplus
@@ -0,0 +1,612 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_rct_compiler.c
+ * @ingroup        Persistence client library tools
+ * @author         Ingo Huerner
+ * @brief          Compiles a resource configuration table into a perfect hash
+ *                 file (see persistence_client_library_rct_hash.h), the file
+ *                 is mapped by the persistence client library at runtime.
+ * @see
+ */
+
+
+#include "persistence_client_library_rct_hash.h"
+
+#include <persComRct.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define PRCTC_VERSION "0.2"
+
+/// max number of seeds tried for a bucket before the number of slots is increased
+#define PRCTC_MAX_SEED_TRIES  (1 << 16)
+
+
+/// resource read from the resource configuration table
+typedef struct _PrctcResource_s
+{
+   /// the resource id
+   const char* resource_id;
+   /// bucket of the resource
+   unsigned int bucket;
+   /// the resource configuration
+   PersistenceConfigurationKey_s config;
+} PrctcResource_s;
+
+
+/// bucket of the hash table
+typedef struct _PrctcBucket_s
+{
+   /// the bucket number
+   unsigned int bucket;
+   /// number of resources in the bucket
+   unsigned int numEntries;
+} PrctcBucket_s;
+
+
+/// print statistics
+static int gVerbose = 0;
+
+
+void printHelp();
+
+
+
+static int compare_bucket_size(const void* a, const void* b)
+{
+   const PrctcBucket_s* bucketA = a;
+   const PrctcBucket_s* bucketB = b;
+
+   if(bucketA->numEntries != bucketB->numEntries)
+   {
+      return (bucketA->numEntries > bucketB->numEntries) ? -1 : 1;
+   }
+
+   return (bucketA->bucket < bucketB->bucket) ? -1 : 1;
+}
+
+
+
+/// try to place all resources of a bucket with the given seed, returns 1 if placed
+static int place_bucket(const PrctcResource_s* resources, unsigned int numResources, unsigned int bucket,
+                        unsigned int seed, unsigned int numSlots, int* slotEntry, unsigned int* placed)
+{
+   unsigned int i = 0, numPlaced = 0;
+   int rval = 1;
+
+   for(i=0; i<numResources; i++)
+   {
+      if(resources[i].bucket == bucket)
+      {
+         unsigned int slot = pers_rct_hash(seed, resources[i].resource_id) % numSlots;
+
+         if(slotEntry[slot] != -1)
+         {
+            rval = 0;
+            break;
+         }
+         slotEntry[slot] = i;
+         placed[numPlaced++] = slot;
+      }
+   }
+
+   if(rval == 0)
+   {
+      // undo
+      for(i=0; i<numPlaced; i++)
+      {
+         slotEntry[placed[i]] = -1;
+      }
+   }
+
+   return rval;
+}
+
+
+
+/// find a seed for each bucket so that all resources have a slot of their own, returns 0 on success
+static int build_table(const PrctcResource_s* resources, unsigned int numResources, unsigned int numBuckets,
+                       unsigned int numSlots, uint32_t* seeds, int* slotEntry)
+{
+   PrctcBucket_s* buckets = calloc(numBuckets, sizeof(PrctcBucket_s));
+   unsigned int* placed = calloc(numResources + 1, sizeof(unsigned int));
+   unsigned int i = 0;
+   int rval = 0;
+
+   if((buckets == NULL) || (placed == NULL))
+   {
+      free(buckets);
+      free(placed);
+      return -1;
+   }
+
+   for(i=0; i<numSlots; i++)
+   {
+      slotEntry[i] = -1;
+   }
+
+   for(i=0; i<numBuckets; i++)
+   {
+      buckets[i].bucket = i;
+      seeds[i] = 0;
+   }
+   for(i=0; i<numResources; i++)
+   {
+      buckets[resources[i].bucket].numEntries++;
+   }
+
+   // place the largest buckets first, they are the hardest to place
+   qsort(buckets, numBuckets, sizeof(PrctcBucket_s), compare_bucket_size);
+
+   for(i=0; (i<numBuckets) && (buckets[i].numEntries > 0) && (rval == 0); i++)
+   {
+      unsigned int seed = 0;
+
+      for(seed=1; seed<PRCTC_MAX_SEED_TRIES; seed++)
+      {
+         if(place_bucket(resources, numResources, buckets[i].bucket, seed, numSlots, slotEntry, placed) == 1)
+         {
+            seeds[buckets[i].bucket] = seed;
+            break;
+         }
+      }
+
+      if(seed == PRCTC_MAX_SEED_TRIES)
+      {
+         rval = -1;
+      }
+   }
+
+   free(buckets);
+   free(placed);
+
+   return rval;
+}
+
+
+
+static int write_table(const char* outFile, const char* inFile, const PrctcResource_s* resources, unsigned int numResources,
+                       unsigned int numBuckets, unsigned int numSlots, const uint32_t* seeds, const int* slotEntry)
+{
+   char tmpFile[1024] = {0};
+   PersRctHashHeader_s header;
+   PersRctHashSlot_s* slots = calloc(numSlots, sizeof(PersRctHashSlot_s));
+   unsigned int i = 0;
+   uint32_t strOffset = 0;
+   FILE* file = NULL;
+   int rval = 0;
+
+   if(slots == NULL)
+   {
+      return -1;
+   }
+
+   memset(&header, 0, sizeof(header));
+
+   // the library only uses the file if the table has not been changed since
+   if(pers_rct_checksum(inFile, &header.rctSize, &header.rctChecksum) != 0)
+   {
+      free(slots);
+      return -1;
+   }
+
+   header.magic        = PersRctHashMagic;
+   header.version      = PersRctHashVersion;
+   header.configSize   = sizeof(PersistenceConfigurationKey_s);
+   header.numEntries   = numResources;
+   header.numBuckets   = numBuckets;
+   header.numSlots     = numSlots;
+   header.bucketOffset = sizeof(PersRctHashHeader_s);
+   header.slotOffset   = (header.bucketOffset + numBuckets * sizeof(uint32_t) + 7) & ~7u;
+
+   // resource ids are stored behind the slots
+   strOffset = header.slotOffset + numSlots * sizeof(PersRctHashSlot_s);
+   for(i=0; i<numSlots; i++)
+   {
+      if(slotEntry[i] != -1)
+      {
+         const PrctcResource_s* resource = &resources[slotEntry[i]];
+
+         slots[i].resIdOffset = strOffset;
+         slots[i].hash        = pers_rct_hash(0, resource->resource_id);
+         memcpy(&slots[i].config, &resource->config, sizeof(PersistenceConfigurationKey_s));
+         strOffset += strlen(resource->resource_id) + 1;
+      }
+   }
+
+   snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", outFile);
+
+   file = fopen(tmpFile, "w");
+   if(file != NULL)
+   {
+      static const unsigned char padding[8] = {0};
+      unsigned int pos = header.bucketOffset + numBuckets * sizeof(uint32_t);
+
+      if(   (fwrite(&header, sizeof(header), 1, file) != 1)
+         || (fwrite(seeds, sizeof(uint32_t), numBuckets, file) != numBuckets)
+         || (fwrite(padding, 1, header.slotOffset - pos, file) != header.slotOffset - pos)
+         || (fwrite(slots, sizeof(PersRctHashSlot_s), numSlots, file) != numSlots) )
+      {
+         rval = -1;
+      }
+
+      for(i=0; (i<numSlots) && (rval == 0); i++)
+      {
+         if(slotEntry[i] != -1)
+         {
+            const char* resource_id = resources[slotEntry[i]].resource_id;
+
+            if(fwrite(resource_id, strlen(resource_id) + 1, 1, file) != 1)
+            {
+               rval = -1;
+            }
+         }
+      }
+
+      // the file always ends with '\0', checked by the library
+      if((rval == 0) && (fwrite(padding, 1, 1, file) != 1))
+      {
+         rval = -1;
+      }
+
+      if(fclose(file) != 0)
+      {
+         rval = -1;
+      }
+
+      if(rval == 0)
+      {
+         rval = rename(tmpFile, outFile);
+      }
+      else
+      {
+         unlink(tmpFile);
+      }
+   }
+   else
+   {
+      rval = -1;
+   }
+
+   free(slots);
+
+   return rval;
+}
+
+
+
+/// create the constant name of a resource: PCL_RES_ + resource id in upper case, other characters replaced by '_'
+static void create_constant_name(const char* resource_id, char* name, size_t nameSize)
+{
+   size_t len = snprintf(name, nameSize, "PCL_RES_");
+
+   for(; (*resource_id != '\0') && (len < nameSize-1); resource_id++)
+   {
+      name[len++] = isalnum((unsigned char)*resource_id) ? toupper((unsigned char)*resource_id) : '_';
+   }
+   name[len] = '\0';
+}
+
+
+
+/// print a string escaped for a C string literal; in a comment "*/" is broken up as well
+static void print_escaped(FILE* file, const char* str, int comment)
+{
+   for(; *str != '\0'; str++)
+   {
+      unsigned char c = (unsigned char)*str;
+
+      if((c == '"') || (c == '\\') || (c == '?'))      // '?' avoids trigraphs
+      {
+         fprintf(file, "\\%c", c);
+      }
+      else if((comment == 1) && (c == '*') && (str[1] == '/'))
+      {
+         fprintf(file, "*\\");
+      }
+      else if(isprint(c))
+      {
+         fputc(c, file);
+      }
+      else
+      {
+         fprintf(file, "\\%03o", c);
+      }
+   }
+}
+
+
+
+/// write the header with the resource descriptors (see pclResourceId_s)
+static int write_header(const char* headerFile, const char* inFile, const PrctcResource_s* resources,
+                        unsigned int numSlots, const int* slotEntry)
+{
+   char tmpFile[1024] = {0};
+   char guard[256] = {0};
+   const char* baseName = strrchr(headerFile, '/');
+   unsigned int i = 0, j = 0;
+   FILE* file = NULL;
+   int rval = 0;
+
+   baseName = (baseName != NULL) ? baseName+1 : headerFile;
+   for(i=0; (baseName[i] != '\0') && (i < sizeof(guard)-1); i++)
+   {
+      guard[i] = isalnum((unsigned char)baseName[i]) ? toupper((unsigned char)baseName[i]) : '_';
+   }
+
+   snprintf(tmpFile, sizeof(tmpFile), "%s.tmp", headerFile);
+
+   file = fopen(tmpFile, "w");
+   if(file == NULL)
+   {
+      return -1;
+   }
+
+   fprintf(file, "#ifndef %s\n#define %s\n\n", guard, guard);
+   fprintf(file, "/* generated by persistence_rct_compiler from ");
+   print_escaped(file, inFile, 1);
+   fprintf(file, " - do not edit */\n\n");
+   fprintf(file, "#include <persistence_client_library_key.h>\n\n");
+
+   for(i=0; i<numSlots; i++)
+   {
+      if(slotEntry[i] != -1)
+      {
+         const char* resource_id = resources[slotEntry[i]].resource_id;
+         char name[256] = {0};
+         int unique = 1;
+
+         create_constant_name(resource_id, name, sizeof(name));
+
+         // different resource ids can map to the same name, the slot is appended then
+         for(j=0; (j<i) && (unique == 1); j++)
+         {
+            char otherName[256] = {0};
+
+            if(slotEntry[j] != -1)
+            {
+               create_constant_name(resources[slotEntry[j]].resource_id, otherName, sizeof(otherName));
+               unique = (strcmp(name, otherName) != 0);
+            }
+         }
+         if(unique == 0)
+         {
+            snprintf(name + strlen(name), sizeof(name) - strlen(name), "_%u", i);
+         }
+
+         // resource ids are escaped, they may contain any character
+         fprintf(file, "/// resource \"");
+         print_escaped(file, resource_id, 1);
+         fprintf(file, "\"\n");
+         fprintf(file, "static const pclResourceId_s %s = { \"", name);
+         print_escaped(file, resource_id, 0);
+         fprintf(file, "\", 0x%08xu, %uu };\n", pers_rct_hash(0, resource_id), i);
+      }
+   }
+
+   fprintf(file, "\n#endif /* %s */\n", guard);
+
+   if(ferror(file) != 0)
+   {
+      rval = -1;
+   }
+
+   if(fclose(file) != 0)
+   {
+      rval = -1;
+   }
+
+   if(rval == 0)
+   {
+      rval = rename(tmpFile, headerFile);
+   }
+   else
+   {
+      unlink(tmpFile);
+   }
+
+   return rval;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+   int opt = 0;
+   const char* inFile = NULL;
+   const char* headerFile = NULL;
+   char outFile[1024] = {0};
+   int handleRCT = -1;
+   int listSize = 0;
+   char* resourceList = NULL;
+   PrctcResource_s* resources = NULL;
+   unsigned int numResources = 0, numBuckets = 0, numSlots = 0;
+   uint32_t* seeds = NULL;
+   int* slotEntry = NULL;
+   int pos = 0;
+   int rval = EXIT_FAILURE;
+
+   while ((opt = getopt(argc, argv, "i:o:g:vhV")) != -1)
+   {
+      switch (opt)
+      {
+      case 'i':
+         inFile = optarg;
+         break;
+      case 'o':
+         snprintf(outFile, sizeof(outFile), "%s", optarg);
+         break;
+      case 'g':
+         headerFile = optarg;
+         break;
+      case 'v':
+         gVerbose = 1;
+         break;
+      case 'h':
+         printHelp();
+         return EXIT_SUCCESS;
+      case 'V':
+         printf("Version: %s\n", PRCTC_VERSION);
+         return EXIT_SUCCESS;
+      default: /* '?' */
+         printHelp();
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   if(inFile == NULL)
+   {
+      printHelp();
+      exit(EXIT_FAILURE);
+   }
+
+   if(outFile[0] == '\0')
+   {
+      snprintf(outFile, sizeof(outFile), "%s%s", inFile, PERS_RCT_HASH_EXT);
+   }
+
+   handleRCT = persComRctOpen(inFile, 0x00);
+   if(handleRCT < 0)
+   {
+      fprintf(stderr, "Failed to open resource configuration table %s: %d\n", inFile, handleRCT);
+      exit(EXIT_FAILURE);
+   }
+
+   listSize = persComRctGetSizeResourcesList(handleRCT);
+   if(listSize > 0)
+   {
+      resourceList = malloc(listSize);
+      if((resourceList != NULL) && (persComRctGetResourcesList(handleRCT, resourceList, listSize) < 0))
+      {
+         free(resourceList);
+         resourceList = NULL;
+      }
+   }
+
+   if((listSize < 0) || ((listSize > 0) && (resourceList == NULL)))
+   {
+      fprintf(stderr, "Failed to read the resource list of %s\n", inFile);
+      (void)persComRctClose(handleRCT);
+      exit(EXIT_FAILURE);
+   }
+
+   for(pos=0; pos<listSize; pos += strlen(resourceList+pos) + 1)
+   {
+      numResources++;
+   }
+
+   resources = calloc(numResources + 1, sizeof(PrctcResource_s));
+   numResources = 0;
+
+   for(pos=0; (resources != NULL) && (pos<listSize); pos += strlen(resourceList+pos) + 1)
+   {
+      PrctcResource_s* resource = &resources[numResources];
+
+      resource->resource_id = resourceList+pos;
+      if(persComRctRead(handleRCT, resource->resource_id, &resource->config) == sizeof(PersistenceConfigurationKey_s))
+      {
+         numResources++;
+      }
+      else
+      {
+         fprintf(stderr, "Failed to read resource %s, skipped\n", resource->resource_id);
+      }
+   }
+
+   (void)persComRctClose(handleRCT);
+
+   if(resources != NULL)
+   {
+      unsigned int i = 0;
+
+      numBuckets = numResources / 4 + 1;
+      numSlots   = numResources + numResources / 4 + 1;
+
+      for(i=0; i<numResources; i++)
+      {
+         resources[i].bucket = pers_rct_hash(0, resources[i].resource_id) % numBuckets;
+      }
+
+      seeds = calloc(numBuckets, sizeof(uint32_t));
+      while(seeds != NULL)
+      {
+         free(slotEntry);
+         slotEntry = calloc(numSlots, sizeof(int));
+
+         if(slotEntry == NULL)
+         {
+            break;
+         }
+
+         if(build_table(resources, numResources, numBuckets, numSlots, seeds, slotEntry) == 0)
+         {
+            if(write_table(outFile, inFile, resources, numResources, numBuckets, numSlots, seeds, slotEntry) != 0)
+            {
+               fprintf(stderr, "Failed to write %s\n", outFile);
+            }
+            else if((headerFile != NULL) && (write_header(headerFile, inFile, resources, numSlots, slotEntry) != 0))
+            {
+               fprintf(stderr, "Failed to write %s\n", headerFile);
+            }
+            else
+            {
+               rval = EXIT_SUCCESS;
+            }
+            break;
+         }
+
+         // no seed found for a bucket, retry with more slots
+         numSlots += numSlots / 8 + 1;
+      }
+   }
+
+   if(rval == EXIT_SUCCESS)
+   {
+      if(gVerbose == 1)
+      {
+         printf("%s: %u resources, %u buckets, %u slots\n", outFile, numResources, numBuckets, numSlots);
+      }
+   }
+   else
+   {
+      fprintf(stderr, "Failed to compile %s\n", inFile);
+   }
+
+   free(slotEntry);
+   free(seeds);
+   free(resources);
+   free(resourceList);
+
+   return rval;
+}
+
+
+
+void printHelp()
+{
+   printf("Usage: persistence_rct_compiler -i <resource configuration table> [-o <output file>] [-g <header>] [-v] [-h] [-V]\n");
+
+   printf("\n");
+   printf("-i <file>    The resource configuration table to compile\n");
+   printf("-o <file>    The compiled table. If not specified '<resource configuration table>%s' is used,\n", PERS_RCT_HASH_EXT);
+   printf("             the persistence client library picks up the compiled table from there\n");
+   printf("-g <file>    Generate a C header with a resource descriptor (pclResourceId_s) for each resource,\n");
+   printf("             to be used with pclKeyReadDataById and pclKeyWriteDataById\n");
+   printf("-v           Print statistics of the compiled table\n");
+   printf("-h           Print help message\n");
+   printf("-V           Print program version\n");
+}
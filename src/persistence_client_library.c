@@ -27,6 +27,9 @@
 #include "persistence_client_library_backup_filelist.h"
 #include "persistence_client_library_db_access.h"
 #include "persistence_client_library_dbus_cmd.h"
+#include "persistence_client_library_write_cache.h"
+#include "persistence_client_library_prct_access.h"
+#include "persistence_client_library_notify_exec.h"
 
 #if USE_FILECACHE
    #include <persistence_file_cache.h>
@@ -36,6 +39,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <time.h>
 #include <dbus/dbus.h>
 
 /// debug log and trace (DLT) setup
@@ -126,15 +130,30 @@ int pclInitLibrary(const char* appName, int shutdownMode)
       DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("PAS interface is not enabled, enable with \"./configure --enable-pasinterface\""));
 #endif
 
+      // start the change notification executor when the D-Bus setup can't fail anymore,
+      // no callback can be registered before the library is initialized
+      if(notify_exec_init() == -1)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("pclInitLibrary - Failed to start notification executor, no change notifications will be delivered"));
+      }
+
       // load custom plugins
       if(load_custom_plugins(customAsyncInitClbk) < 0)
       {
       	DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("Failed to load custom plugins"));
       }
+      // resolved resources hold the index of their plugin, the plugin registry has been filled again
+      invalidate_db_context_cache();
 
       // initialize keyHandle array
       init_key_handle_array();
 
+      // start the write-behind cache (if enabled)
+      if(write_cache_init() < 0)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("pclInitLibrary - Failed to start write-behind cache, data is written directly"));
+      }
+
       pers_unlock_access();
 
       // assign application name
@@ -157,7 +176,7 @@ int pclInitLibrary(const char* appName, int shutdownMode)
 
 int pclDeinitLibrary(void)
 {
-   int i = 0, rval = 1;
+   int rval = 1;
 
    if(gPclInitialized == PCLinitialized)
    {
@@ -185,27 +204,44 @@ int pclDeinitLibrary(void)
       }
 #endif
 
-      // unload custom client libraries
-      for(i=0; i<PersCustomLib_LastEntry; i++)
+      // sync and unload custom client libraries
+      (void)deinit_custom_plugins();
+
+      // write back the cached data and stop the write-behind cache
+      write_cache_deinit();
+
+      process_prepare_shutdown(Shutdown_Full);	// close all db's and fd's and block access
+
+      // send quit command to dbus mainloop and wait until the dbus mainloop has ended
+      if(deliverToMainloop_NM(&data) == 0)
       {
-         if(gPersCustomFuncs[i].custom_plugin_deinit != NULL)
+         pthread_join(gMainLoopThread, (void**)&retval);
+      }
+      else
+      {
+         // the mainloop is not running anymore, the thread is ending
+         struct timespec ts;
+
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("pclDeinitLibrary - failed to send quit command to mainloop"));
+
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_sec  += MainLoopQuitTimeout / 1000;
+         ts.tv_nsec += (MainLoopQuitTimeout % 1000) * 1000000;
+         if(ts.tv_nsec >= 1000000000)
          {
-            // deinitialize plugin
-            gPersCustomFuncs[i].custom_plugin_deinit();
-            // close library handle
-            dlclose(gPersCustomFuncs[i].handle);
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+         }
 
-            invalidate_custom_plugin(i);
+         if(pthread_timedjoin_np(gMainLoopThread, (void**)&retval, &ts) != 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclDeinitLibrary - mainloop did not end, thread detached"));
+            (void)pthread_detach(gMainLoopThread);
          }
       }
 
-      process_prepare_shutdown(Shutdown_Full);	// close all db's and fd's and block access
-
-      // send quit command to dbus mainloop
-      deliverToMainloop_NM(&data);
-
-      // wait until the dbus mainloop has ended
-      pthread_join(gMainLoopThread, (void**)&retval);
+      // no notifications are received anymore
+      notify_exec_deinit();
 
       pthread_mutex_unlock(&gDbusPendingRegMtx);
       pthread_mutex_unlock(&gDbusInitializedMtx);
@@ -0,0 +1,449 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_custom_cache.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the read cache for custom storage plugins
+ * @see
+ */
+
+#include "persistence_client_library_custom_cache.h"
+#include "persistence_client_library_custom_loader.h"
+#include "persistence_client_library_data_organization.h"
+#include "crc32.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/// read cache entry
+typedef struct _PersCustomCacheEntry_s
+{
+   /// next entry in the hash bucket
+   struct _PersCustomCacheEntry_s* next;
+   /// hash value of the path
+   unsigned int hash;
+   /// time the entry has been created [ms]
+   unsigned int time;
+   /// size of the data returned by the plugin, -1 if not known
+   int size;
+   /// number of cached data bytes
+   unsigned int dataLen;
+   /// the cached data holds the complete data (1) or possibly only the beginning (0)
+   int complete;
+   /// the cached data, NULL if only the size is known
+   unsigned char* data;
+   /// the path passed to the plugin
+   char path[CustomPathMaxLen];
+} PersCustomCacheEntry_s;
+
+
+/// read cache of a plugin
+typedef struct _PersCustomCache_s
+{
+   /// hash buckets
+   PersCustomCacheEntry_s* buckets[CustomCacheHashSize];
+   /// number of entries
+   unsigned int numEntries;
+   /// number of lookups served by the cache
+   unsigned int hits;
+   /// number of lookups not served by the cache
+   unsigned int misses;
+   /// incremented with every invalidation, data read before cannot be added anymore
+   unsigned int generation;
+   /// mutex to protect the cache
+   pthread_mutex_t mutex;
+} PersCustomCache_s;
+
+
+/// read caches of the plugins, same index as the plugin registry
+static PersCustomCache_s* gCustomCache = NULL;
+/// number of read caches
+static int gNumCustomCaches = 0;
+
+
+
+static unsigned int custom_cache_time_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+/// check if the plugin has a cache policy
+static int custom_cache_enabled(int idx)
+{
+   return (idx >= 0) && (idx < gNumCustomCaches) && (getCustomCachePolicy(idx) != CachePolicy_None);
+}
+
+
+
+/// check if an entry is still valid according to the cache policy of the plugin
+static int custom_cache_is_valid(int idx, const PersCustomCacheEntry_s* entry, unsigned int now)
+{
+   return    (getCustomCachePolicy(idx) == CachePolicy_Immutable)
+          || ((getCustomCachePolicy(idx) == CachePolicy_Ttl) && (now - entry->time < getCustomCacheTtl(idx)));
+}
+
+
+
+/// find an entry, the cache mutex must be locked
+static PersCustomCacheEntry_s* custom_cache_lookup(int idx, const char* path, unsigned int hash)
+{
+   PersCustomCacheEntry_s* entry = gCustomCache[idx].buckets[hash & (CustomCacheHashSize-1)];
+
+   while((entry != NULL) && ((entry->hash != hash) || (strcmp(entry->path, path) != 0)))
+   {
+      entry = entry->next;
+   }
+
+   return entry;
+}
+
+
+
+/// find an entry or create a new one, expired entries are reset; the cache mutex must be locked
+static PersCustomCacheEntry_s* custom_cache_get_entry(int idx, const char* path)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)path, strlen(path));
+   unsigned int now = custom_cache_time_ms();
+   PersCustomCacheEntry_s* entry = custom_cache_lookup(idx, path, hash);
+
+   if(entry != NULL)
+   {
+      if(custom_cache_is_valid(idx, entry, now) == 0)
+      {
+         free(entry->data);
+         entry->data     = NULL;
+         entry->dataLen  = 0;
+         entry->complete = 0;
+         entry->size     = -1;
+         entry->time     = now;
+      }
+   }
+   else if(   (gCustomCache[idx].numEntries < CustomCacheMaxEntries)
+           && (strlen(path) < CustomPathMaxLen) )
+   {
+      entry = calloc(1, sizeof(PersCustomCacheEntry_s));
+      if(entry != NULL)
+      {
+         PersCustomCacheEntry_s** bucket = &gCustomCache[idx].buckets[hash & (CustomCacheHashSize-1)];
+
+         strcpy(entry->path, path);
+         entry->hash = hash;
+         entry->time = now;
+         entry->size = -1;
+         entry->next = *bucket;
+         *bucket = entry;
+         gCustomCache[idx].numEntries++;
+      }
+   }
+
+   return entry;
+}
+
+
+
+int custom_cache_get_data(int idx, const char* path, unsigned char* buffer, unsigned int buffer_size)
+{
+   int rval = -1;
+
+   if(custom_cache_enabled(idx))
+   {
+      PersCustomCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      entry = custom_cache_lookup(idx, path, pclCrc32(0, (const unsigned char*)path, strlen(path)));
+
+      // possibly truncated data can only serve reads of the same or smaller size
+      if(   (entry != NULL)
+         && (entry->data != NULL)
+         && ((entry->complete == 1) || (buffer_size <= entry->dataLen))
+         && (custom_cache_is_valid(idx, entry, custom_cache_time_ms()) == 1) )
+      {
+         rval = (buffer_size < entry->dataLen) ? (int)buffer_size : (int)entry->dataLen;
+         memcpy(buffer, entry->data, rval);
+         gCustomCache[idx].hits++;
+      }
+      else
+      {
+         gCustomCache[idx].misses++;
+      }
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+
+   return rval;
+}
+
+
+
+int custom_cache_get_size(int idx, const char* path)
+{
+   int rval = -1;
+
+   if(custom_cache_enabled(idx))
+   {
+      PersCustomCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      entry = custom_cache_lookup(idx, path, pclCrc32(0, (const unsigned char*)path, strlen(path)));
+
+      if(   (entry != NULL)
+         && (entry->size >= 0)
+         && (custom_cache_is_valid(idx, entry, custom_cache_time_ms()) == 1) )
+      {
+         rval = entry->size;
+         gCustomCache[idx].hits++;
+      }
+      else
+      {
+         gCustomCache[idx].misses++;
+      }
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+
+   return rval;
+}
+
+
+
+unsigned int custom_cache_generation(int idx)
+{
+   unsigned int generation = 0;
+
+   if(custom_cache_enabled(idx))
+   {
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+      generation = gCustomCache[idx].generation;
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+
+   return generation;
+}
+
+
+
+void custom_cache_add_data(int idx, const char* path, unsigned int generation,
+                           const unsigned char* buffer, int read_size, unsigned int buffer_size)
+{
+   if(custom_cache_enabled(idx) && (read_size > 0))
+   {
+      PersCustomCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      // the data may have been changed while it has been read from the plugin
+      if(generation == gCustomCache[idx].generation)
+      {
+         entry = custom_cache_get_entry(idx, path);
+      }
+
+      // keep complete data, don't replace it with a shorter beginning of the data
+      if(   (entry != NULL)
+         && (entry->complete == 0)
+         && (((unsigned int)read_size >= entry->dataLen) || ((unsigned int)read_size < buffer_size)) )
+      {
+         unsigned char* data = malloc(read_size);
+
+         if(data != NULL)
+         {
+            memcpy(data, buffer, read_size);
+            free(entry->data);
+            entry->data     = data;
+            entry->dataLen  = read_size;
+            entry->complete = ((unsigned int)read_size < buffer_size) || (entry->size == read_size);
+            if(entry->complete == 1)
+            {
+               entry->size = read_size;
+            }
+         }
+      }
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+}
+
+
+
+void custom_cache_add_size(int idx, const char* path, unsigned int generation, int size)
+{
+   if(custom_cache_enabled(idx) && (size >= 0))
+   {
+      PersCustomCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      // the data may have been changed while the size has been read from the plugin
+      if(generation == gCustomCache[idx].generation)
+      {
+         entry = custom_cache_get_entry(idx, path);
+      }
+
+      if(entry != NULL)
+      {
+         entry->size = size;
+
+         if(entry->data != NULL)
+         {
+            if((unsigned int)size == entry->dataLen)
+            {
+               entry->complete = 1;
+            }
+            else if((entry->complete == 1) || ((unsigned int)size < entry->dataLen))
+            {
+               // size does not match the cached data
+               free(entry->data);
+               entry->data     = NULL;
+               entry->dataLen  = 0;
+               entry->complete = 0;
+            }
+         }
+      }
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+}
+
+
+
+void custom_cache_remove(int idx, const char* path)
+{
+   if(custom_cache_enabled(idx))
+   {
+      unsigned int hash = pclCrc32(0, (const unsigned char*)path, strlen(path));
+      PersCustomCacheEntry_s** pEntry = &gCustomCache[idx].buckets[hash & (CustomCacheHashSize-1)];
+
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      gCustomCache[idx].generation++;
+
+      while(*pEntry != NULL)
+      {
+         PersCustomCacheEntry_s* entry = *pEntry;
+
+         if((entry->hash == hash) && (strcmp(entry->path, path) == 0))
+         {
+            *pEntry = entry->next;
+            free(entry->data);
+            free(entry);
+            gCustomCache[idx].numEntries--;
+            break;
+         }
+         pEntry = &entry->next;
+      }
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+}
+
+
+
+/// remove all entries from the cache of a plugin, the cache mutex must be locked
+static void custom_cache_remove_all(int idx)
+{
+   int i = 0;
+
+   for(i=0; i<CustomCacheHashSize; i++)
+   {
+      while(gCustomCache[idx].buckets[i] != NULL)
+      {
+         PersCustomCacheEntry_s* entry = gCustomCache[idx].buckets[i];
+         gCustomCache[idx].buckets[i] = entry->next;
+         free(entry->data);
+         free(entry);
+      }
+   }
+   gCustomCache[idx].numEntries = 0;
+}
+
+
+
+void custom_cache_clear(int idx)
+{
+   if(custom_cache_enabled(idx))
+   {
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+      gCustomCache[idx].generation++;
+      custom_cache_remove_all(idx);
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+}
+
+
+
+void custom_cache_destroy(int idx)
+{
+   if((idx >= 0) && (idx < gNumCustomCaches))
+   {
+      pthread_mutex_lock(&gCustomCache[idx].mutex);
+
+      if((gCustomCache[idx].hits + gCustomCache[idx].misses) > 0)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("custom_cache_destroy - plugin:"), DLT_STRING(get_custom_client_lib_name(idx)),
+                                               DLT_STRING("entries:"), DLT_UINT(gCustomCache[idx].numEntries),
+                                               DLT_STRING("hits:"), DLT_UINT(gCustomCache[idx].hits),
+                                               DLT_STRING("misses:"), DLT_UINT(gCustomCache[idx].misses));
+      }
+
+      custom_cache_remove_all(idx);
+      gCustomCache[idx].generation++;
+      gCustomCache[idx].hits   = 0;
+      gCustomCache[idx].misses = 0;
+
+      pthread_mutex_unlock(&gCustomCache[idx].mutex);
+   }
+}
+
+
+
+int custom_cache_init(int num_plugins)
+{
+   int rval = 0, i = 0;
+
+   for(i=0; i<gNumCustomCaches; i++)
+   {
+      custom_cache_destroy(i);
+      pthread_mutex_destroy(&gCustomCache[i].mutex);
+   }
+   free(gCustomCache);
+   gCustomCache = NULL;
+   gNumCustomCaches = 0;
+
+   if(num_plugins > 0)
+   {
+      gCustomCache = calloc(num_plugins, sizeof(PersCustomCache_s));
+      if(gCustomCache != NULL)
+      {
+         for(i=0; i<num_plugins; i++)
+         {
+            pthread_mutex_init(&gCustomCache[i].mutex, NULL);
+         }
+         gNumCustomCaches = num_plugins;
+      }
+      else
+      {
+         rval = -1;
+      }
+   }
+
+   return rval;
+}
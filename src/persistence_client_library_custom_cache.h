@@ -0,0 +1,135 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_CUSTOM_CACHE_H
+#define PERSISTENCE_CLIENT_LIBRARY_CUSTOM_CACHE_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_custom_cache.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the read cache for custom storage plugins.
+ *                 Data and sizes returned by a plugin are kept in memory
+ *                 according to the cache policy of the plugin, configured in
+ *                 the custom library configuration file (5th column):
+ *                 "none" (default), "immutable" (cached until the plugin is
+ *                 unloaded) or "ttl:<ms>" (cached for the given time).
+ *                 Writes and deletions through the library remove the cached entry
+ *                 after the plugin has been called. Each removal increments the
+ *                 generation of the cache, data read from the plugin is only added
+ *                 if the generation did not change in the meantime.
+ * @see
+ */
+
+
+/**
+ * @brief create the read caches of the plugins, existing caches are removed.
+ *        Must be called when the plugin registry has been filled, before the plugins are used.
+ *
+ * @param num_plugins the number of plugins of the plugin registry
+ *
+ * @return 0 on success or -1 if no memory is available (no data will be cached then)
+ */
+int custom_cache_init(int num_plugins);
+
+
+/**
+ * @brief read data from the cache of a plugin
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ * @param path the path passed to the plugin
+ * @param buffer the buffer for the data
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes read or -1 if the data is not in the cache
+ */
+int custom_cache_get_data(int idx, const char* path, unsigned char* buffer, unsigned int buffer_size);
+
+
+/**
+ * @brief read the data size from the cache of a plugin
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ * @param path the path passed to the plugin
+ *
+ * @return the size of the data or -1 if the size is not in the cache
+ */
+int custom_cache_get_size(int idx, const char* path);
+
+
+/**
+ * @brief get the generation of the cache of a plugin, must be read before
+ *        the plugin is called to get data to be added to the cache
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ *
+ * @return the generation of the cache
+ */
+unsigned int custom_cache_generation(int idx);
+
+
+/**
+ * @brief add data read from a plugin to the cache of the plugin.
+ *        Nothing is cached if the plugin has no cache policy, the read failed
+ *        or the cache has been invalidated since the generation has been read.
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ * @param path the path passed to the plugin
+ * @param generation the generation of the cache before the plugin has been called, see ::custom_cache_generation
+ * @param buffer the data returned by the plugin
+ * @param read_size the number of bytes returned by the plugin
+ * @param buffer_size the size of the buffer passed to the plugin,
+ *        if the buffer has been filled completely the data may be truncated
+ */
+void custom_cache_add_data(int idx, const char* path, unsigned int generation,
+                           const unsigned char* buffer, int read_size, unsigned int buffer_size);
+
+
+/**
+ * @brief add the data size returned by a plugin to the cache of the plugin.
+ *        Nothing is cached if the plugin has no cache policy, the call failed
+ *        or the cache has been invalidated since the generation has been read.
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ * @param path the path passed to the plugin
+ * @param generation the generation of the cache before the plugin has been called, see ::custom_cache_generation
+ * @param size the size returned by the plugin
+ */
+void custom_cache_add_size(int idx, const char* path, unsigned int generation, int size);
+
+
+/**
+ * @brief remove an entry from the cache of a plugin, must be called after data has been written or deleted
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ * @param path the path passed to the plugin
+ */
+void custom_cache_remove(int idx, const char* path);
+
+
+/**
+ * @brief remove all entries from the cache of a plugin,
+ *        must be called after data has been written by a plugin handle
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ */
+void custom_cache_clear(int idx);
+
+
+/**
+ * @brief remove all entries and reset the statistics of the cache of a plugin,
+ *        must be called when the plugin is unloaded
+ *
+ * @param idx the plugin index, see ::custom_client_name_to_id
+ */
+void custom_cache_destroy(int idx);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_CUSTOM_CACHE_H */
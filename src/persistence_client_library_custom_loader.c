@@ -18,6 +18,9 @@
 
 #include "persistence_client_library_custom_loader.h"
 #include "persistence_client_library_data_organization.h"
+#include "persistence_client_library_custom_cache.h"
+#include "persistence_client_library_handle.h"
+#include "crc32.h"
 
 #include <stdio.h>
 #include <errno.h>
@@ -28,54 +31,177 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 
 
 /// type definition of persistence custom library information
 typedef struct sPersCustomLibInfo
 {
+   /// plugin name (custom name used in the resource configuration table)
+   char                 name[CustLibMaxLen];
+   /// hash value of the plugin name
+   unsigned int         hash;
+   /// next plugin in the same bucket of the name table, -1 if last
+   int                  nextHash;
    char 						libname[CustLibMaxLen];
    int 						valid;
    PersInitType_e  		initFunction;
    PersLoadingType_e 	loadingType;
+   PersCachePolicy_e    cachePolicy;
+   unsigned int         cacheTtl;
+   /// plugin is being loaded by a loader thread (1) or not (0)
+   int                  loading;
+   /// a loader thread has been started and must be joined
+   int                  loaderStarted;
+   /// the loader thread is running
+   int                  loaderRunning;
+   /// the loader thread
+   pthread_t            loader;
+   /// incremented when the plugin instance is invalidated, plugin handles of another generation are not valid
+   unsigned int         generation;
 } PersCustomLibInfo;
 
 
-/// array with custom client library names
-static PersCustomLibInfo gCustomLibArray[PersCustomLib_LastEntry];
-static char* gpCustomTokenArray[TOKENARRAYSIZE];
+/// the plugin registry, filled from the custom library configuration file in pclInitLibrary
+static PersCustomLibInfo* gCustomLibArray = NULL;
+/// number of registered plugins
+static int gNumCustomLibs = 0;
+/// number of allocated registry entries
+static int gCustomLibArraySize = 0;
+/// hashed plugin name table, index of the first plugin in the bucket or -1
+static int gCustomLibHash[CustomLibHashSize] = { [0 ... CustomLibHashSize-1] = -1 };
+
+/// custom library functions array, same index as the plugin registry
+Pers_custom_functs_s* gPersCustomFuncs = NULL;
 
 int(* gPlugin_callback_async_t)(int errcode);
 
-static void fillCustomCharTokenArray(unsigned int customConfigFileSize, char* fileMap)
+/// mutex to protect the loading state
+static pthread_mutex_t gPluginLoadMtx = PTHREAD_MUTEX_INITIALIZER;
+/// signaled when a plugin has been loaded or a loader thread has finished
+static pthread_cond_t gPluginLoadCond;
+/// the load condition uses the monotonic clock, the loaders are waited for with the plugin shutdown deadline
+static pthread_once_t gPluginLoadCondOnce = PTHREAD_ONCE_INIT;
+
+// function prototype
+static int custom_plugin_wait_shutdown(const char* libname);
+
+
+
+static void custom_plugin_load_cond_init(void)
 {
-   unsigned int i=0;
-   int   customTokenCounter = 0;
-   int blankCount=0;
-   char* tmpPointer = fileMap;
+   pthread_condattr_t attr;
 
-   // set the first pointer to the start of the file
-   gpCustomTokenArray[blankCount] = tmpPointer;
-   blankCount++;
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&gPluginLoadCond, &attr);
+   pthread_condattr_destroy(&attr);
+}
 
-   while(i < customConfigFileSize)
+
+
+/// mark a plugin as loaded and wake up the threads waiting for it
+static void custom_plugin_loaded(int idx)
+{
+   pthread_once(&gPluginLoadCondOnce, custom_plugin_load_cond_init);
+
+   pthread_mutex_lock(&gPluginLoadMtx);
+   __atomic_store_n(&gCustomLibArray[idx].loading, 0, __ATOMIC_RELEASE);
+   pthread_cond_broadcast(&gPluginLoadCond);
+   pthread_mutex_unlock(&gPluginLoadMtx);
+}
+
+
+
+/// init completion callback of a plugin with asynchronous init type, passed on to the application callback
+static int custom_plugin_init_done(int idx, int errcode)
+{
+   int rval = 0;
+
+   if((idx >= 0) && (idx < gNumCustomLibs))
    {
-      if(1 != gCharLookup[(int)*tmpPointer])
-      {
-         *tmpPointer = 0;
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("custom_plugin_init_done - plugin:"), DLT_STRING(get_custom_client_lib_name(idx)),
+                                            DLT_STRING("error code:"), DLT_INT(errcode));
+      custom_plugin_loaded(idx);
+   }
+
+   if(gPlugin_callback_async_t != NULL)
+   {
+      rval = gPlugin_callback_async_t(errcode);
+   }
 
-         // check if we are at the end of the token array
-         if(blankCount >= TOKENARRAYSIZE)
+   return rval;
+}
+
+
+// plugin_callback_async_t has no user data, the plugin is identified by a separate callback per plugin index
+#define CUSTOM_PLUGIN_INIT_DONE(idx) \
+   static int custom_plugin_init_done_##idx(int errcode) { return custom_plugin_init_done(idx, errcode); }
+
+CUSTOM_PLUGIN_INIT_DONE(0)  CUSTOM_PLUGIN_INIT_DONE(1)  CUSTOM_PLUGIN_INIT_DONE(2)  CUSTOM_PLUGIN_INIT_DONE(3)
+CUSTOM_PLUGIN_INIT_DONE(4)  CUSTOM_PLUGIN_INIT_DONE(5)  CUSTOM_PLUGIN_INIT_DONE(6)  CUSTOM_PLUGIN_INIT_DONE(7)
+CUSTOM_PLUGIN_INIT_DONE(8)  CUSTOM_PLUGIN_INIT_DONE(9)  CUSTOM_PLUGIN_INIT_DONE(10) CUSTOM_PLUGIN_INIT_DONE(11)
+CUSTOM_PLUGIN_INIT_DONE(12) CUSTOM_PLUGIN_INIT_DONE(13) CUSTOM_PLUGIN_INIT_DONE(14) CUSTOM_PLUGIN_INIT_DONE(15)
+
+/// init completion callbacks of the plugins, plugins with a higher index are marked as loaded when plugin_init_async returns
+static const plugin_callback_async_t gPluginInitDoneCallbacks[] =
+{
+   custom_plugin_init_done_0,  custom_plugin_init_done_1,  custom_plugin_init_done_2,  custom_plugin_init_done_3,
+   custom_plugin_init_done_4,  custom_plugin_init_done_5,  custom_plugin_init_done_6,  custom_plugin_init_done_7,
+   custom_plugin_init_done_8,  custom_plugin_init_done_9,  custom_plugin_init_done_10, custom_plugin_init_done_11,
+   custom_plugin_init_done_12, custom_plugin_init_done_13, custom_plugin_init_done_14, custom_plugin_init_done_15
+};
+
+/// number of plugins with an own init completion callback
+#define CUSTOM_PLUGIN_NUM_INIT_DONE ((int)(sizeof(gPluginInitDoneCallbacks) / sizeof(gPluginInitDoneCallbacks[0])))
+
+/**
+ * @brief get the tokens of a configuration file line
+ *
+ * @param line the line
+ * @param lineSize the size of the line (without line end)
+ * @param tokens the token buffers
+ * @param maxTokens the max number of tokens
+ *
+ * @return the number of tokens of the line
+ */
+static int getCustomLineTokens(const char* line, unsigned int lineSize, char tokens[][CustLibMaxLen], int maxTokens)
+{
+   unsigned int i = 0;
+   int numTokens = 0;
+   int tokenLen = -1;   // -1: not in a token
+
+   for(i=0; i <= lineSize; i++)
+   {
+      unsigned char c = (i < lineSize) ? (unsigned char)line[i] : 0;
+
+      if((c < 0x7F) && (1 == gCharLookup[c]))
+      {
+         if(tokenLen == -1)
          {
-            break;
+            if(numTokens >= maxTokens)
+            {
+               numTokens++;   // too many tokens
+               break;
+            }
+            tokenLen = 0;
          }
-         gpCustomTokenArray[blankCount] = tmpPointer+1;
-         blankCount++;
-         customTokenCounter++;
-
+         if(tokenLen < CustLibMaxLen-1)
+         {
+            tokens[numTokens][tokenLen++] = c;
+         }
+      }
+      else if(tokenLen != -1)
+      {
+         tokens[numTokens][tokenLen] = '\0';
+         numTokens++;
+         tokenLen = -1;
       }
-      tmpPointer++;
-      i++;
    }
+
+   return numTokens;
 }
 
 
@@ -113,6 +239,40 @@ static PersInitType_e getInitType(const char* policy)
 }
 
 
+static PersCachePolicy_e getCachePolicy(const char* policy, unsigned int* ttl)
+{
+	PersCachePolicy_e persCachePolicy = CachePolicy_None;
+
+   *ttl = 0;
+
+   if(0 == strcmp(policy, "immutable"))
+   {
+   	persCachePolicy = CachePolicy_Immutable;
+   }
+   else if(0 == strncmp(policy, "ttl:", 4))
+   {
+   	char* end = NULL;
+   	unsigned long time = strtoul(policy + 4, &end, 10);
+
+   	if((end != policy + 4) && (*end == '\0') && (time > 0))
+   	{
+   		persCachePolicy = CachePolicy_Ttl;
+   		*ttl = (unsigned int)time;
+   	}
+   	else
+   	{
+   		DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("getCachePolicy - invalid cache time, data not cached:"), DLT_STRING(policy));
+   	}
+   }
+   else if(0 != strcmp(policy, "none"))
+   {
+   	DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("getCachePolicy - unknown cache policy, data not cached:"), DLT_STRING(policy));
+   }
+
+   return persCachePolicy;
+}
+
+
 PersLoadingType_e getCustomLoadingType(int i)
 {
 	return gCustomLibArray[i].loadingType;
@@ -125,85 +285,109 @@ PersInitType_e getCustomInitType(int i)
 }
 
 
-PersistenceCustomLibs_e custom_client_name_to_id(const char* lib_name, int substring)
+PersCachePolicy_e getCustomCachePolicy(int i)
+{
+	return gCustomLibArray[i].cachePolicy;
+}
+
+
+unsigned int getCustomCacheTtl(int i)
 {
-   PersistenceCustomLibs_e libId = PersCustomLib_LastEntry;
+	return gCustomLibArray[i].cacheTtl;
+}
+
 
-   if(substring == 0)
+/// find a plugin in the hashed name table, returns the plugin index or -1
+static int custom_client_lookup(const char* lib_name, unsigned int hash)
+{
+   int idx = gCustomLibHash[hash & (CustomLibHashSize-1)];
+
+   while((idx != -1) && ((gCustomLibArray[idx].hash != hash) || (strcmp(gCustomLibArray[idx].name, lib_name) != 0)))
    {
-      if(0 == strncmp(lib_name, "early", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_early;
-      }
-      else if (0 == strncmp(lib_name, "secure", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_secure;
-      }
-      else if (0 == strncmp(lib_name, "emergency", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_emergency;
-      }
-      else if (0 == strncmp(lib_name, "hwinfo", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_HWinfo;
-      }
-      else if (0 == strncmp(lib_name, "custom1", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_Custom1;
-      }
-      else if (0 == strncmp(lib_name, "custom2", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_Custom2;
-      }
-      else if (0 == strncmp(lib_name, "custom3", PersCustomPathSize) )
-      {
-         libId = PersCustomLib_Custom3;
-      }
-      else
-      {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("custom_client_name_to_id - id not found for lib:"), DLT_STRING(lib_name));
-      }
+      idx = gCustomLibArray[idx].nextHash;
    }
-   else
+
+   return idx;
+}
+
+
+/// add a plugin to the registry or get the index of an already registered plugin, returns -1 if no memory is available
+static int custom_client_register(const char* lib_name)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)lib_name, strlen(lib_name));
+   int idx = custom_client_lookup(lib_name, hash);
+
+   if(idx == -1)
    {
-      if(NULL != strstr(lib_name, "early") )
-      {
-         libId = PersCustomLib_early;
-      }
-      else if (NULL != strstr(lib_name, "secure") )
-      {
-         libId = PersCustomLib_secure;
-      }
-      else if (NULL != strstr(lib_name, "emergency") )
-      {
-         libId = PersCustomLib_emergency;
-      }
-      else if (NULL != strstr(lib_name, "hwinfo") )
-      {
-         libId = PersCustomLib_HWinfo;
-      }
-      else if (NULL != strstr(lib_name, "custom1") )
+      if(gNumCustomLibs == gCustomLibArraySize)
       {
-         libId = PersCustomLib_Custom1;
-      }
-      else if (NULL != strstr(lib_name, "custom2") )
-      {
-         libId = PersCustomLib_Custom2;
-      }
-      else if (NULL != strstr(lib_name, "custom3") )
-      {
-         libId = PersCustomLib_Custom3;
+         int size = (gCustomLibArraySize > 0) ? 2 * gCustomLibArraySize : 8;
+         PersCustomLibInfo* libArray = realloc(gCustomLibArray, size * sizeof(PersCustomLibInfo));
+         Pers_custom_functs_s* funcs = NULL;
+
+         if(libArray != NULL)
+         {
+            gCustomLibArray = libArray;
+            funcs = realloc(gPersCustomFuncs, size * sizeof(Pers_custom_functs_s));
+         }
+         if(funcs == NULL)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("custom_client_register - failed to allocate memory"));
+            return -1;
+         }
+         gPersCustomFuncs = funcs;
+         gCustomLibArraySize = size;
       }
-      else
+
+      idx = gNumCustomLibs++;
+      memset(&gCustomLibArray[idx], 0, sizeof(PersCustomLibInfo));
+      memset(&gPersCustomFuncs[idx], 0, sizeof(Pers_custom_functs_s));
+      strncpy(gCustomLibArray[idx].name, lib_name, CustLibMaxLen);
+      gCustomLibArray[idx].name[CustLibMaxLen-1] = '\0';
+      gCustomLibArray[idx].hash     = hash;
+      gCustomLibArray[idx].valid    = -1;
+      gCustomLibArray[idx].nextHash = gCustomLibHash[hash & (CustomLibHashSize-1)];
+      gCustomLibHash[hash & (CustomLibHashSize-1)] = idx;
+   }
+
+   return idx;
+}
+
+
+int custom_client_name_to_id(const char* lib_name, int substring)
+{
+   int libId = custom_client_lookup(lib_name, pclCrc32(0, (const unsigned char*)lib_name, strlen(lib_name)));
+
+   if((libId == -1) && (substring != 0))
+   {
+      int i = 0;
+
+      // the name contains the name of a plugin
+      for(i=0; i<gNumCustomLibs; i++)
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("custom_client_name_to_id - id not found for lib:"), DLT_STRING(lib_name));
+         if(NULL != strstr(lib_name, gCustomLibArray[i].name))
+         {
+            libId = i;
+            break;
+         }
       }
+   }
 
+   if(libId == -1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("custom_client_name_to_id - id not found for lib:"), DLT_STRING(lib_name));
    }
+
    return libId;
 }
 
 
+int get_num_custom_libraries(void)
+{
+   return gNumCustomLibs;
+}
+
+
 
 int get_custom_libraries()
 {
@@ -216,9 +400,11 @@ int get_custom_libraries()
 		filename = "/etc/pclCustomLibConfigFile.cfg";  // use default filename
 	}
 
-   for(j=0; j<PersCustomLib_LastEntry; j++)
+   // the registry is filled again from the configuration file
+   gNumCustomLibs = 0;
+   for(j=0; j<CustomLibHashSize; j++)
    {
-      gCustomLibArray[j].valid = -1;	// init pos to -1
+      gCustomLibHash[j] = -1;
    }
 
    memset(&buffer, 0, sizeof(buffer));
@@ -227,7 +413,7 @@ int get_custom_libraries()
 		if(buffer.st_size > 0)	// check for empty file
 		{
 			char* customConfFileMap = NULL;
-			int i = 0;
+			unsigned int pos = 0;
 			int fd = open(filename, O_RDONLY);
 
 			DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("get_custom_libraries - load config - "), DLT_STRING(filename));
@@ -240,7 +426,7 @@ int get_custom_libraries()
 			}
 
 			// map the config file into memory
-			customConfFileMap = (char*)mmap(0, buffer.st_size, PROT_WRITE, MAP_PRIVATE, fd, 0);
+			customConfFileMap = (char*)mmap(0, buffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
 			if (customConfFileMap == MAP_FAILED)
 			{
@@ -249,35 +435,40 @@ int get_custom_libraries()
 				return EPERS_COMMON;
 			}
 
-			fillCustomCharTokenArray(buffer.st_size, customConfFileMap);
-
-			while( i < TOKENARRAYSIZE )
+			// one plugin per line: <name> <library> <loading type> <init type> [<cache policy>]
+			while(pos < (unsigned int)buffer.st_size)
 			{
-				if(gpCustomTokenArray[i] != 0 && gpCustomTokenArray[i+1] != 0 && gpCustomTokenArray[i+2] != 0 &&gpCustomTokenArray[i+3] != 0 )
+				char tokens[5][CustLibMaxLen];
+				const char* line = customConfFileMap + pos;
+				const char* lineEnd = memchr(line, '\n', buffer.st_size - pos);
+				unsigned int lineSize = (lineEnd != NULL) ? (unsigned int)(lineEnd - line) : (unsigned int)(buffer.st_size - pos);
+				int numTokens = getCustomLineTokens(line, lineSize, tokens, 5);
+
+				pos += lineSize + 1;
+
+				if(numTokens == 4 || numTokens == 5)
 				{
-					int libId = custom_client_name_to_id(gpCustomTokenArray[i], 0);	// get the custom libID
-
-					// assign the libraryname
-					strncpy(gCustomLibArray[libId].libname, gpCustomTokenArray[i+1], CustLibMaxLen);
-					gCustomLibArray[libId].libname[CustLibMaxLen-1] = '\0'; // Ensures 0-Termination
-
-					gCustomLibArray[libId].loadingType  = getLoadingType(gpCustomTokenArray[i+2]);
-					gCustomLibArray[libId].initFunction = getInitType(gpCustomTokenArray[i+3]);
-					gCustomLibArray[libId].valid        = 1;	// marks as valid;
-	#if 0
-					// debug
-					printf("     1. => %s => %d \n",   gpCustomTokenArray[i],   libId);
-					printf("     2. => %s => %s \n",   gpCustomTokenArray[i+1], gCustomLibArray[libId].libname);
-					printf("     3. => %s => %d \n",   gpCustomTokenArray[i+2], (int)gCustomLibArray[libId].initFunction);
-					printf("     4. => %s => %d \n\n", gpCustomTokenArray[i+3], (int)gCustomLibArray[libId].loadingType);
-	#endif
+					int libId = custom_client_register(tokens[0]);	// get the custom libID
+
+					if(libId != -1)
+					{
+						// assign the libraryname
+						strncpy(gCustomLibArray[libId].libname, tokens[1], CustLibMaxLen);
+						gCustomLibArray[libId].libname[CustLibMaxLen-1] = '\0'; // Ensures 0-Termination
+
+						gCustomLibArray[libId].loadingType  = getLoadingType(tokens[2]);
+						gCustomLibArray[libId].initFunction = getInitType(tokens[3]);
+						gCustomLibArray[libId].cachePolicy  = (numTokens == 5) ? getCachePolicy(tokens[4], &gCustomLibArray[libId].cacheTtl)
+						                                                       : CachePolicy_None;
+						gCustomLibArray[libId].valid        = 1;	// marks as valid;
+					}
 				}
-				else
+				else if(numTokens != 0)
 				{
-					break;
+					DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("get_custom_libraries - invalid config line, number of entries:"), DLT_INT(numTokens));
 				}
-				i+=4;       // move to the next configuration file entry
 			}
+			munmap(customConfFileMap, buffer.st_size);
 			close(fd);
 		}
 		else
@@ -296,12 +487,19 @@ int get_custom_libraries()
 
 
 
-int load_custom_library(PersistenceCustomLibs_e customLib, Pers_custom_functs_s *customFuncts)
+int load_custom_library(int customLib, Pers_custom_functs_s *customFuncts)
 {
    int rval = 1;
    char *error = NULL;
 
-   if(customLib < PersCustomLib_LastEntry)
+   if(   (customLib >= 0) && (customLib < gNumCustomLibs)
+      && (custom_plugin_wait_shutdown(gCustomLibArray[customLib].libname) == 0) )
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("load_custom_library - deinit of the last shutdown still running, not loaded:"),
+                                             DLT_STRING(gCustomLibArray[customLib].libname));
+      rval = EPERS_DLOPENERROR;
+   }
+   else if((customLib >= 0) && (customLib < gNumCustomLibs))
    {
    	PersInitType_e initType = getCustomInitType(customLib);
       void* handle = dlopen(gCustomLibArray[customLib].libname, RTLD_LAZY);
@@ -424,6 +622,11 @@ int load_custom_library(PersistenceCustomLibs_e customLib, Pers_custom_functs_s
               DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("load_custom_library - error:"), DLT_STRING(error));
          }
 
+         // batch functions, optional - plugins without batch functions are accessed key by key
+         *(void **) (&customFuncts->custom_plugin_get_data_batch) = dlsym(handle, "plugin_get_data_batch");
+         *(void **) (&customFuncts->custom_plugin_set_data_batch) = dlsym(handle, "plugin_set_data_batch");
+         dlerror();    // reset error
+
          //
          // initialize the library
          //
@@ -448,7 +651,21 @@ int load_custom_library(PersistenceCustomLibs_e customLib, Pers_custom_functs_s
 					DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("load_custom_library => (async) : "),
 							                  DLT_STRING(get_custom_client_lib_name(customLib)));
 
-					gPersCustomFuncs[customLib].custom_plugin_init_async(gPlugin_callback_async_t);
+					if(customLib < CUSTOM_PLUGIN_NUM_INIT_DONE)
+					{
+						// the plugin is marked as loaded when it reports the init completion
+						if(gPersCustomFuncs[customLib].custom_plugin_init_async(gPluginInitDoneCallbacks[customLib]) < 0)
+						{
+							// init failed, the completion is not reported
+							DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("load_custom_library - plugin_init_async failed: "),
+							                                       DLT_STRING(get_custom_client_lib_name(customLib)));
+							custom_plugin_loaded(customLib);
+						}
+					}
+					else
+					{
+						gPersCustomFuncs[customLib].custom_plugin_init_async(gPlugin_callback_async_t);
+					}
 				}
 				else
 				{
@@ -483,7 +700,7 @@ int load_custom_library(PersistenceCustomLibs_e customLib, Pers_custom_functs_s
 
 char* get_custom_client_lib_name(int idx)
 {
-   if(idx < PersCustomLib_LastEntry)
+   if((idx >= 0) && (idx < gNumCustomLibs))
    {
       return gCustomLibArray[idx].libname;
    }
@@ -498,7 +715,7 @@ int check_valid_idx(int idx)
 {
    int rval = -1;
 
-   if(idx < PersCustomLib_LastEntry)
+   if((idx >= 0) && (idx < gNumCustomLibs))
    {
       rval = gCustomLibArray[idx].valid;
    }
@@ -507,6 +724,96 @@ int check_valid_idx(int idx)
 }
 
 
+/// loader thread of a plugin with asynchronous init type
+static void* custom_plugin_loader(void* arg)
+{
+   int idx = (int)(intptr_t)arg;
+
+   if(load_custom_library(idx, &gPersCustomFuncs[idx]) <= 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("custom_plugin_loader - could not load plugin: "),
+                                             DLT_STRING(get_custom_client_lib_name(idx)));
+      custom_plugin_loaded(idx);
+   }
+   else if(idx >= CUSTOM_PLUGIN_NUM_INIT_DONE)
+   {
+      // no own init completion callback, the plugin is used as soon as plugin_init_async has returned
+      custom_plugin_loaded(idx);
+   }
+
+   pthread_mutex_lock(&gPluginLoadMtx);
+   gCustomLibArray[idx].loaderRunning = 0;
+   pthread_cond_broadcast(&gPluginLoadCond);
+   pthread_mutex_unlock(&gPluginLoadMtx);
+
+   return NULL;
+}
+
+
+
+void wait_custom_plugin_loaded(int idx)
+{
+   if(   (idx >= 0) && (idx < gNumCustomLibs)
+      && (__atomic_load_n(&gCustomLibArray[idx].loading, __ATOMIC_ACQUIRE) == 1) )
+   {
+      pthread_mutex_lock(&gPluginLoadMtx);
+      while(gCustomLibArray[idx].loading == 1)
+      {
+         pthread_cond_wait(&gPluginLoadCond, &gPluginLoadMtx);
+      }
+      pthread_mutex_unlock(&gPluginLoadMtx);
+   }
+}
+
+
+
+int wait_custom_plugins_loaded(const struct timespec* deadline)
+{
+   int i = 0, numLoading = 0;
+
+   pthread_once(&gPluginLoadCondOnce, custom_plugin_load_cond_init);
+
+   for(i=0; i < gNumCustomLibs; i++)
+   {
+      int started = 0, running = 0;
+
+      pthread_mutex_lock(&gPluginLoadMtx);
+      while((gCustomLibArray[i].loading == 1) || (gCustomLibArray[i].loaderRunning == 1))
+      {
+         if(pthread_cond_timedwait(&gPluginLoadCond, &gPluginLoadMtx, deadline) == ETIMEDOUT)
+         {
+            break;
+         }
+      }
+      started = gCustomLibArray[i].loaderStarted;
+      running = gCustomLibArray[i].loaderRunning;
+      gCustomLibArray[i].loaderStarted = 0;
+      if(gCustomLibArray[i].loading == 1)
+      {
+         numLoading++;
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("wait_custom_plugins_loaded - plugin not loaded in time: "),
+                                                DLT_STRING(get_custom_client_lib_name(i)));
+      }
+      pthread_mutex_unlock(&gPluginLoadMtx);
+
+      if(started == 1)
+      {
+         if(running == 0)
+         {
+            pthread_join(gCustomLibArray[i].loader, NULL);
+         }
+         else
+         {
+            pthread_detach(gCustomLibArray[i].loader);
+         }
+      }
+   }
+
+   return numLoading;
+}
+
+
+
 int load_custom_plugins(plugin_callback_async_t pfInitCompletedCB)
 {
 	int rval = 0, i = 0;
@@ -516,18 +823,50 @@ int load_custom_plugins(plugin_callback_async_t pfInitCompletedCB)
 	{
 		gPlugin_callback_async_t = pfInitCompletedCB;		// assign init callback
 
+		if(custom_cache_init(gNumCustomLibs) < 0)
+		{
+			DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("load_custom_plugins - failed to create plugin read caches"));
+		}
+
 		// initialize custom library structure
-		for(i = 0; i < PersCustomLib_LastEntry; i++)
+		for(i = 0; i < gNumCustomLibs; i++)
 		{
 			invalidate_custom_plugin(i);
 		}
 
-		for(i=0; i < PersCustomLib_LastEntry; i++ )
+		for(i=0; i < gNumCustomLibs; i++ )
 		{
 			if(check_valid_idx(i) != -1)
 			{
 				if(getCustomLoadingType(i) == LoadType_PclInit)	// check if the plugin must be loaded on plc init
 				{
+					// plugins with asynchronous init are loaded in parallel by a loader thread,
+					// accesses to the plugin wait until it has been loaded (see wait_custom_plugin_loaded)
+					if(getCustomInitType(i) == Init_Asynchronous)
+					{
+						pthread_once(&gPluginLoadCondOnce, custom_plugin_load_cond_init);
+						pthread_mutex_lock(&gPluginLoadMtx);
+						gCustomLibArray[i].loading = 1;
+						gCustomLibArray[i].loaderRunning = 1;
+						if(pthread_create(&gCustomLibArray[i].loader, NULL, custom_plugin_loader, (void*)(intptr_t)i) == 0)
+						{
+							gCustomLibArray[i].loaderStarted = 1;
+						}
+						else
+						{
+							gCustomLibArray[i].loading = 0;
+							gCustomLibArray[i].loaderRunning = 0;
+						}
+						pthread_mutex_unlock(&gPluginLoadMtx);
+
+						if(gCustomLibArray[i].loaderStarted == 1)
+						{
+							continue;
+						}
+						DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("load_custom_plugins - failed to start loader thread, load plugin: "),
+						                                      DLT_STRING(get_custom_client_lib_name(i)));
+					}
+
 					if(load_custom_library(i, &gPersCustomFuncs[i] ) <= 0)
 					{
 						DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("load_custom_plugins - could not load plugin: "),
@@ -552,8 +891,348 @@ int load_custom_plugins(plugin_callback_async_t pfInitCompletedCB)
 }
 
 
+/// shutdown job of a plugin
+typedef struct _PersPluginShutdown_s
+{
+   /// the plugin index
+   int idx;
+   /// the plugin functions, copied because the plugin is invalidated when the job times out
+   int (*sync)(void);
+   /// the plugin deinit function
+   int (*deinit)();
+   /// result of plugin_sync
+   int syncResult;
+   /// time needed by plugin_sync [ms]
+   unsigned int syncTime;
+   /// time needed by plugin_deinit [ms]
+   unsigned int deinitTime;
+   /// the job has finished
+   int done;
+   /// the job has timed out, the shutdown thread unloads the plugin and frees the job when done
+   int abandoned;
+   /// handle of the plugin, unloaded by the shutdown thread if the job has timed out
+   void* handle;
+   /// library name of the plugin, the library is not loaded again before an abandoned job has finished
+   char libname[CustLibMaxLen];
+   /// next abandoned job
+   struct _PersPluginShutdown_s* next;
+} PersPluginShutdown_s;
+
+
+/// mutex to protect the shutdown jobs
+static pthread_mutex_t gPluginShutdownMtx = PTHREAD_MUTEX_INITIALIZER;
+/// signaled when a shutdown job has finished
+static pthread_cond_t gPluginShutdownCond;
+/// the shutdown condition uses the monotonic clock
+static pthread_once_t gPluginShutdownCondOnce = PTHREAD_ONCE_INIT;
+/// jobs which did not finish in time, the plugins are still running plugin_sync or plugin_deinit
+static PersPluginShutdown_s* gPluginShutdownAbandoned = NULL;
+
+
+
+static void custom_plugin_shutdown_cond_init(void)
+{
+   pthread_condattr_t attr;
+
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(&gPluginShutdownCond, &attr);
+   pthread_condattr_destroy(&attr);
+}
+
+
+
+static unsigned int custom_plugin_time_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+/// get the shutdown deadline of the plugins, returns the shutdown timeout [ms]
+static unsigned int custom_plugin_shutdown_deadline(struct timespec* deadline)
+{
+   unsigned int timeout = PluginShutdownTimeout;
+   const char* pTimeout = getenv("PERS_CLIENT_PLUGIN_SHUTDOWN_TIMEOUT");
+
+   if((pTimeout != NULL) && (atoi(pTimeout) > 0))
+   {
+      timeout = (unsigned int)atoi(pTimeout);
+   }
+
+   pthread_once(&gPluginShutdownCondOnce, custom_plugin_shutdown_cond_init);
+
+   clock_gettime(CLOCK_MONOTONIC, deadline);
+   deadline->tv_sec  += timeout / 1000;
+   deadline->tv_nsec += (timeout % 1000) * 1000000;
+   if(deadline->tv_nsec >= 1000000000)
+   {
+      deadline->tv_sec++;
+      deadline->tv_nsec -= 1000000000;
+   }
+
+   return timeout;
+}
+
+
+
+/// find the abandoned shutdown job of a library, the shutdown mutex must be locked
+static PersPluginShutdown_s* custom_plugin_find_abandoned(const char* libname)
+{
+   PersPluginShutdown_s* job = gPluginShutdownAbandoned;
+
+   while((job != NULL) && (strncmp(job->libname, libname, CustLibMaxLen) != 0))
+   {
+      job = job->next;
+   }
+
+   return job;
+}
+
+
+
+/**
+ * @brief wait until the plugin_deinit of a library, which did not finish in time on the last shutdown,
+ *        has finished and the library has been unloaded. Waits at most the plugin shutdown timeout.
+ *
+ * @return 1 if the library can be loaded, 0 if the last deinit of the library is still running
+ */
+static int custom_plugin_wait_shutdown(const char* libname)
+{
+   int rval = 1;
+
+   if(__atomic_load_n(&gPluginShutdownAbandoned, __ATOMIC_ACQUIRE) != NULL)
+   {
+      struct timespec deadline;
+
+      (void)custom_plugin_shutdown_deadline(&deadline);
+
+      pthread_mutex_lock(&gPluginShutdownMtx);
+      while(custom_plugin_find_abandoned(libname) != NULL)
+      {
+         if(pthread_cond_timedwait(&gPluginShutdownCond, &gPluginShutdownMtx, &deadline) == ETIMEDOUT)
+         {
+            break;
+         }
+      }
+      rval = (custom_plugin_find_abandoned(libname) == NULL) ? 1 : 0;
+      pthread_mutex_unlock(&gPluginShutdownMtx);
+   }
+
+   return rval;
+}
+
+
+
+/// shutdown thread of a plugin: sync the data and deinitialize the plugin
+static void* custom_plugin_shutdown(void* arg)
+{
+   PersPluginShutdown_s* job = (PersPluginShutdown_s*)arg;
+   unsigned int start = custom_plugin_time_ms();
+   int abandoned = 0;
+
+   if(job->sync != NULL)
+   {
+      job->syncResult = job->sync();
+   }
+   job->syncTime = custom_plugin_time_ms() - start;
+
+   start = custom_plugin_time_ms();
+   job->deinit();
+   job->deinitTime = custom_plugin_time_ms() - start;
+
+   pthread_mutex_lock(&gPluginShutdownMtx);
+   job->done = 1;
+   abandoned = job->abandoned;
+   pthread_cond_broadcast(&gPluginShutdownCond);
+   pthread_mutex_unlock(&gPluginShutdownMtx);
+
+   if(abandoned == 1)
+   {
+      PersPluginShutdown_s** link = &gPluginShutdownAbandoned;
+
+      // the plugin has finished after the deadline, unload it before the library can be loaded again
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("custom_plugin_shutdown - plugin finished after the deadline, unload:"), DLT_STRING(job->libname),
+                                            DLT_STRING("sync [ms]:"), DLT_UINT(job->syncTime),
+                                            DLT_STRING("deinit [ms]:"), DLT_UINT(job->deinitTime));
+      dlclose(job->handle);
+
+      pthread_mutex_lock(&gPluginShutdownMtx);
+      while((*link != NULL) && (*link != job))
+      {
+         link = &(*link)->next;
+      }
+      if(*link != NULL)
+      {
+         __atomic_store_n(link, job->next, __ATOMIC_RELEASE);
+      }
+      pthread_cond_broadcast(&gPluginShutdownCond);
+      pthread_mutex_unlock(&gPluginShutdownMtx);
+
+      free(job);
+   }
+
+   return NULL;
+}
+
+
+
+int deinit_custom_plugins(void)
+{
+   int rval = 0, i = 0, numPlugins = get_num_custom_libraries();
+   unsigned int timeout = 0;
+   PersPluginShutdown_s** jobs = NULL;
+   pthread_t* threads = NULL;
+   struct timespec deadline;
+
+   timeout = custom_plugin_shutdown_deadline(&deadline);
+
+   // plugins still being loaded are deinitialized when loaded, loading and shutdown share the deadline
+   if(wait_custom_plugins_loaded(&deadline) > 0)
+   {
+      rval = EPERS_COMMON;
+   }
+
+   if(numPlugins > 0)
+   {
+      jobs    = calloc(numPlugins, sizeof(PersPluginShutdown_s*));
+      threads = calloc(numPlugins, sizeof(pthread_t));
+   }
+
+   // the plugin handles of open key handles are closed before the plugin is deinitialized
+   for(i=0; i<numPlugins; i++)
+   {
+      if(gPersCustomFuncs[i].custom_plugin_handle_close != NULL)
+      {
+         close_key_handle_custom_data(i, gPersCustomFuncs[i].custom_plugin_handle_close);
+      }
+   }
+
+   // sync and deinitialize all loaded plugins in parallel
+   for(i=0; i<numPlugins; i++)
+   {
+      if(__atomic_load_n(&gCustomLibArray[i].loading, __ATOMIC_ACQUIRE) == 1)
+      {
+         // the plugin has not finished its init, it must not be deinitialized or unloaded
+         continue;
+      }
+
+      if(gPersCustomFuncs[i].custom_plugin_deinit != NULL)
+      {
+         PersPluginShutdown_s* job = calloc(1, sizeof(PersPluginShutdown_s));
+
+         if(job != NULL)
+         {
+            job->idx    = i;
+            job->sync   = gPersCustomFuncs[i].custom_plugin_sync;
+            job->deinit = gPersCustomFuncs[i].custom_plugin_deinit;
+            job->handle = gPersCustomFuncs[i].handle;
+            snprintf(job->libname, CustLibMaxLen, "%s", gCustomLibArray[i].libname);
+         }
+
+         if((jobs != NULL) && (threads != NULL) && (job != NULL)
+            && (pthread_create(&threads[i], NULL, custom_plugin_shutdown, job) == 0))
+         {
+            jobs[i] = job;
+         }
+         else
+         {
+            // no shutdown thread, sync and deinitialize the plugin here
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("deinit_custom_plugins - no shutdown thread, deinit plugin:"),
+                                                  DLT_STRING(get_custom_client_lib_name(i)));
+            if(gPersCustomFuncs[i].custom_plugin_sync != NULL)
+            {
+               (void)gPersCustomFuncs[i].custom_plugin_sync();
+            }
+            gPersCustomFuncs[i].custom_plugin_deinit();
+            dlclose(gPersCustomFuncs[i].handle);
+            invalidate_custom_plugin(i);
+            free(job);
+         }
+      }
+   }
+
+   // wait until all plugins are done or the deadline has passed
+   for(i=0; (jobs != NULL) && (i<numPlugins); i++)
+   {
+      if(jobs[i] != NULL)
+      {
+         int done = 0;
+
+         pthread_mutex_lock(&gPluginShutdownMtx);
+         while(jobs[i]->done == 0)
+         {
+            if(pthread_cond_timedwait(&gPluginShutdownCond, &gPluginShutdownMtx, &deadline) == ETIMEDOUT)
+            {
+               break;
+            }
+         }
+         done = jobs[i]->done;
+         if(done == 0)
+         {
+            // the shutdown thread unloads the plugin when done, the library is not loaded again before
+            jobs[i]->abandoned = 1;
+            jobs[i]->next = gPluginShutdownAbandoned;
+            __atomic_store_n(&gPluginShutdownAbandoned, jobs[i], __ATOMIC_RELEASE);
+         }
+         pthread_mutex_unlock(&gPluginShutdownMtx);
+
+         if(done == 1)
+         {
+            pthread_join(threads[i], NULL);
+
+            DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("deinit_custom_plugins - plugin:"), DLT_STRING(get_custom_client_lib_name(i)),
+                                                  DLT_STRING("sync [ms]:"), DLT_UINT(jobs[i]->syncTime),
+                                                  DLT_STRING("sync result:"), DLT_INT(jobs[i]->syncResult),
+                                                  DLT_STRING("deinit [ms]:"), DLT_UINT(jobs[i]->deinitTime));
+            dlclose(gPersCustomFuncs[i].handle);
+            free(jobs[i]);
+         }
+         else
+         {
+            // the plugin is still running, it must not be unloaded here
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("deinit_custom_plugins - plugin did not finish in time [ms]:"), DLT_UINT(timeout),
+                                                   DLT_STRING(get_custom_client_lib_name(i)));
+            pthread_detach(threads[i]);
+            rval = EPERS_COMMON;
+         }
+         invalidate_custom_plugin(i);
+      }
+   }
+
+   free(jobs);
+   free(threads);
+
+   return rval;
+}
+
+
+
+unsigned int custom_plugin_generation(int idx)
+{
+   unsigned int generation = 0;
+
+   if((idx >= 0) && (idx < gNumCustomLibs))
+   {
+      generation = __atomic_load_n(&gCustomLibArray[idx].generation, __ATOMIC_ACQUIRE);
+   }
+
+   return generation;
+}
+
+
+
 void invalidate_custom_plugin(int idx)
 {
+   custom_cache_destroy(idx);   // cached data is only valid while the plugin is loaded
+
+   // plugin handles opened by this plugin instance are not passed to the next instance
+   __atomic_add_fetch(&gCustomLibArray[idx].generation, 1, __ATOMIC_RELEASE);
+
    gPersCustomFuncs[idx].handle  = NULL;
    gPersCustomFuncs[idx].custom_plugin_init = NULL;
    gPersCustomFuncs[idx].custom_plugin_deinit = NULL;
@@ -570,4 +1249,6 @@ void invalidate_custom_plugin(int idx)
    gPersCustomFuncs[idx].custom_plugin_create_backup = NULL;
    gPersCustomFuncs[idx].custom_plugin_get_backup = NULL;
    gPersCustomFuncs[idx].custom_plugin_restore_backup = NULL;
+   gPersCustomFuncs[idx].custom_plugin_get_data_batch = NULL;
+   gPersCustomFuncs[idx].custom_plugin_set_data_batch = NULL;
 }
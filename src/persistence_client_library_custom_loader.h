@@ -21,31 +21,7 @@
 
 #include "../include/persistence_client_custom.h"
 
-
-/// enumerator used to identify the policy to manage the data
-typedef enum _PersistenceCustomLibs_e
-{
-	/// predefined custom library for early persistence
-   PersCustomLib_early       = 0,
-   /// predefined custom library for secure persistence
-   PersCustomLib_secure      = 1,
-   /// predefined custom library for emengency persistence
-   PersCustomLib_emergency   = 2,
-   /// predefined custom library for hw information
-   PersCustomLib_HWinfo      = 3,
-   /// custom library 1
-   PersCustomLib_Custom1     = 4,
-   /// custom library 2
-   PersCustomLib_Custom2     = 5,
-   /// custom library 3
-   PersCustomLib_Custom3     = 6,
-
-   // insert new entries here ...
-
-   /// last entry
-   PersCustomLib_LastEntry
-
-} PersistenceCustomLibs_e;
+#include <time.h>
 
 
 /// enumerator fo custom library defines
@@ -81,6 +57,18 @@ typedef enum PersLoadingType_e_
 } PersLoadingType_e;
 
 
+/// indicates the cache policy of the data read from the plugin
+typedef enum PersCachePolicy_e_
+{
+	/// data is not cached
+	CachePolicy_None      = 0,
+	/// data is cached until the plugin is unloaded
+	CachePolicy_Immutable = 1,
+	/// data is cached for a configured time
+	CachePolicy_Ttl       = 2
+} PersCachePolicy_e;
+
+
 /**
  * @brief definition of async init callback function.
  *        This function will be called when the asynchronous
@@ -150,26 +138,43 @@ typedef struct _Pers_custom_functs_s
    /// sync all data
    int (*custom_plugin_sync)(void);
 
+   /// get data of several paths (optional)
+   int (*custom_plugin_get_data_batch)(plugin_batch_entry_s* entries, int num_entries);
+
+   /// set data of several paths (optional)
+   int (*custom_plugin_set_data_batch)(plugin_batch_entry_s* entries, int num_entries);
+
 
 }Pers_custom_functs_s;
 
 
-/// custom library functions array
-Pers_custom_functs_s gPersCustomFuncs[PersCustomLib_LastEntry];
+/// custom library functions array, one entry per plugin of the plugin registry
+extern Pers_custom_functs_s* gPersCustomFuncs;
 
 
 /**
- * @brief Translate a client library name into a id
+ * @brief Translate a client library name into a id.
+ *        The plugins are registered in the custom library configuration file,
+ *        the id is the index of the plugin in the registry.
  *
  * @param lib_name the library name
  * @param substring indicator if a substring search is neccessary
+ *        (if no plugin has the name, find a plugin whose name is contained in lib_name)
  *
- * @return the library id or PersCustomLib_LastEntry if nothing found
+ * @return the library id or -1 if nothing found
  */
-PersistenceCustomLibs_e custom_client_name_to_id(const char* lib_name, int substring);
+int custom_client_name_to_id(const char* lib_name, int substring);
+
 
 /**
- * @brief get the names of the custom libraries to load
+ * @brief get the number of plugins of the plugin registry
+ *
+ * @return the number of plugins, the plugin ids are 0 ... number - 1
+ */
+int get_num_custom_libraries(void);
+
+/**
+ * @brief get the names of the custom libraries to load and fill the plugin registry
  *
  * @return 0 for success or a negative value with the following errors:
  * EPERS_OUTOFBOUNDS
@@ -181,13 +186,17 @@ int get_custom_libraries();
 /**
  * @brief get the names of the custom libraries to load
  *
- * @param customLib the enumerator id identifying the custom library
+ * @note if the plugin_deinit of the library did not finish in time on the last shutdown,
+ *       the function waits until it has finished (at most the plugin shutdown timeout),
+ *       EPERS_DLOPENERROR is returned if it is still running
+ *
+ * @param customLib the id identifying the custom library
  * @param customFuncts function pointer array of loaded custom library functions
  *
  * @return 0 for success or a negative value with one of the following errors:
  *  EPERS_NOPLUGINFCNT   EPERS_DLOPENERROR
  */
-int load_custom_library(PersistenceCustomLibs_e customLib, Pers_custom_functs_s *customFuncts);
+int load_custom_library(int customLib, Pers_custom_functs_s *customFuncts);
 
 
 /**
@@ -211,6 +220,45 @@ int check_valid_idx(int idx);
 char* get_custom_client_lib_name(int idx);
 
 
+/**
+ * @brief wait until a plugin loaded by a loader thread is available.
+ *        Plugins with loading type "init" and init type "async" are loaded in
+ *        parallel to the library initialization, the plugin functions must not be
+ *        used before this function returned. A plugin is loaded when it has reported
+ *        the completion of plugin_init_async. Returns immediately if the plugin is
+ *        not being loaded.
+ *
+ * @param idx the plugin index
+ */
+void wait_custom_plugin_loaded(int idx);
+
+
+/**
+ * @brief wait until all plugins have been loaded and the loader threads have finished,
+ *        must be called before the plugins are unloaded. Loader threads still running
+ *        at the deadline are detached.
+ *
+ * @param deadline the deadline (CLOCK_MONOTONIC)
+ *
+ * @return the number of plugins which have not been loaded until the deadline
+ */
+int wait_custom_plugins_loaded(const struct timespec* deadline);
+
+
+/**
+ * @brief sync, deinitialize and unload all loaded plugins.
+ *        The plugins are processed in parallel, plugin_sync (if exported) and
+ *        plugin_deinit are called by one thread per plugin. Plugins not finished
+ *        when the deadline has passed are unloaded by their thread when done,
+ *        ::load_custom_library does not load such a plugin again before.
+ *        The deadline is PluginShutdownTimeout, use the environment variable
+ *        PERS_CLIENT_PLUGIN_SHUTDOWN_TIMEOUT (ms) to modify.
+ *
+ * @return 0 if all plugins have been unloaded or EPERS_COMMON if a plugin did not finish in time
+ */
+int deinit_custom_plugins(void);
+
+
 /**
  * @brief invalidate customer plugin function
  *
@@ -219,6 +267,16 @@ char* get_custom_client_lib_name(int idx);
 void invalidate_custom_plugin(int idx);
 
 
+/**
+ * @brief get the generation of a plugin, the generation changes when the plugin instance is invalidated
+ *
+ * @param idx the plugin index
+ *
+ * @return the generation of the plugin
+ */
+unsigned int custom_plugin_generation(int idx);
+
+
 /**
  * @brief load the custom plugins.
  *        The custom library configuration file will be loaded to see
@@ -237,7 +295,7 @@ int load_custom_plugins(plugin_callback_async_t pfInitCompletedCB);
  *        The loading type is
  *        ::LoadType_PclInit or ::LoadType_OnDemand
  *
- * @param i the custom id, see ::PersistenceCustomLibs_e
+ * @param i the custom id, see ::custom_client_name_to_id
  */
 PersLoadingType_e getCustomLoadingType(int i);
 
@@ -247,9 +305,29 @@ PersLoadingType_e getCustomLoadingType(int i);
  *        The init type is
  *        ::Init_Synchronous or ::Init_Asynchronous
  *
- * @param i the custom id, see ::PersistenceCustomLibs_e
+ * @param i the custom id, see ::custom_client_name_to_id
  */
 PersInitType_e getCustomInitType(int i);
 
 
+/**
+ * @brief Get the custom cache policy.
+ *        The cache policy is
+ *        ::CachePolicy_None, ::CachePolicy_Immutable or ::CachePolicy_Ttl
+ *
+ * @param i the custom id, see ::custom_client_name_to_id
+ */
+PersCachePolicy_e getCustomCachePolicy(int i);
+
+
+/**
+ * @brief Get the time data of a plugin with cache policy ::CachePolicy_Ttl is cached
+ *
+ * @param i the custom id, see ::custom_client_name_to_id
+ *
+ * @return the time [ms]
+ */
+unsigned int getCustomCacheTtl(int i);
+
+
 #endif /* PERSISTENCE_CLIENT_LIBRARY_CUSTOM_LOADER_H */
@@ -71,6 +71,7 @@ const char* gBackupFilename = "BackupFileList.info";
 const char* gChangeSignal = "PersistenceResChange";
 const char* gDeleteSignal = "PersistenceResDelete";
 const char* gCreateSignal = "PersistenceResCreate";
+const char* gBatchSignal  = "PersistenceResBatch";
 
 int gTimeoutMs = 5000;
 
@@ -90,7 +91,6 @@ unsigned int gPclInitialized = PCLnotInitialized;
 
 DltContext gPclDLTContext;
 
-int(* gChangeNotifyCallback)(pclNotification_s * notifyStruct);
 
 
 const char gCharLookup[] =
@@ -59,6 +59,8 @@ typedef struct _PersistenceInfo_s
    PersistenceDbContext_s           context;
    /// Persistence resource configuration key
    PersistenceConfigurationKey_s    configKey;
+   /// index of the custom storage plugin (resolved from configKey.custom_name), -1 if not custom storage
+   int                              customIdx;
 
 } PersistenceInfo_s;
 
@@ -85,6 +87,8 @@ typedef enum PersGetDefault_e_
    PersGetDefault_Data = 0,
    /// get the data from factory defaults
    PersGetDefault_Size,
+   /// get the data, the buffer is allocated or grown as needed
+   PersGetDefault_DataAlloc,
 
    /** insert new entries here ... */
 
@@ -151,14 +155,66 @@ enum _PersistenceConstantDef
    PrctValueSize           = sizeof(PersistenceConfigurationKey_s),
    /// number of persistence resource config tables to store
    PrctDbTableSize         = 1024,
+   /// number of entries of the resolved database context cache (must be a power of two)
+   PrctCtxCacheSize        = 256,
+   /// interval of the mainloop check if an indexed or compiled resource configuration table has been modified [ms]
+   RctIndexCheckInterval   = 1000,
+   /// number of entries of the command queue into the dbus mainloop (must be a power of two)
+   MainLoopCmdQueueSize    = 256,
+   /// max time a sender waits for the mainloop when the command queue is full before checking again [ms]
+   MainLoopCmdQueueWaitTime = 10,
+   /// max time to wait for the dbus mainloop to end if the quit command could not be delivered [ms]
+   MainLoopQuitTimeout     = 1000,
+   /// max number of events the dbus mainloop handles per wakeup (further events are handled in the next cycle)
+   MainLoopMaxEvents       = 16,
+   /// max number of coalesced change notification signals waiting to be sent
+   NotifyPendingMaxEntries = 64,
+   /// max number of notifications in one batched notification signal
+   NotifyBatchMaxEntries   = 64,
+   /// number of hash buckets of the registered change notifications (must be a power of two)
+   NotifyRegHashSize       = 64,
+   /// number of hash buckets of the change notification callbacks (must be a power of two)
+   NotifyCallbackHashSize  = 64,
+   /// default number of change notification executor threads, use environment variable PERS_CLIENT_NOTIFY_THREADS to modify
+   NotifyExecThreads       = 2,
+   /// max number of change notification executor threads
+   NotifyExecMaxThreads    = 8,
+   /// initial number of queued change notifications per executor thread, the queue is grown when full
+   NotifyExecQueueSize     = 128,
+   /// change notification callbacks running longer are logged [ms]
+   NotifyCallbackWarnTime  = 100,
    /// write buffer size
    RDRWBufferSize          = 1024,
    /// database max key size
    DbKeySize               = PERS_DB_MAX_LENGTH_KEY_NAME,
    /// database max value size
    DbValueSize             = PERS_DB_MAX_SIZE_KEY_DATA,
-   /// database table size
-   DbTableSize             = 1024,
+   /// number of hash buckets of the database handle table (must be a power of two)
+   DbHandleHashSize        = 64,
+   /// default max number of open databases, use environment variable PERS_CLIENT_MAX_OPEN_DB to modify
+   DbHandleMaxOpen         = 64,
+   /// number of hash buckets of the write-behind cache (must be a power of two)
+   WriteCacheHashSize      = 64,
+   /// max number of keys in the write-behind cache, further keys are written directly
+   WriteCacheMaxEntries    = 256,
+   /// max number of reads of a key growing while it is read into an allocated buffer
+   AllocReadMaxTries       = 4,
+   /// number of bloom filter bits per key of a default database
+   DefaultFilterBitsPerKey = 10,
+   /// number of bloom filter hash functions
+   DefaultFilterNumHashes  = 4,
+   /// number of keys remembered as not available per default database (must be a power of two)
+   DefaultNegCacheSize     = 64,
+   /// default time to sync and deinitialize the plugins on shutdown [ms], use environment variable PERS_CLIENT_PLUGIN_SHUTDOWN_TIMEOUT to modify
+   PluginShutdownTimeout   = 2000,
+   /// number of hash buckets of the plugin name table (must be a power of two)
+   CustomLibHashSize       = 64,
+   /// number of hash buckets of the read cache of a custom storage plugin (must be a power of two)
+   CustomCacheHashSize     = 32,
+   /// max number of entries in the read cache of a custom storage plugin, further entries are not cached
+   CustomCacheMaxEntries   = 128,
+   /// max length of the path passed to a custom storage plugin
+   CustomPathMaxLen        = 128,
    /// persistence administration service block access
    PasMsg_Block            = 0x0001,
    /// persistence administration service unblock access
@@ -266,6 +322,8 @@ extern const char* gChangeSignal;
 extern const char* gDeleteSignal;
 /// create signal string
 extern const char* gCreateSignal;
+/// batched change notification signal string
+extern const char* gBatchSignal;
 
 // dbus timeout (5 seconds)
 extern int gTimeoutMs;
@@ -274,12 +332,6 @@ extern int gTimeoutMs;
 extern int gDbusPendingRvalue;
 
 
-/**
- * @brief definition of change callback function
- *
- * @param pclNotification_s callback notification structure
- */
-extern int(* gChangeNotifyCallback)(pclNotification_s * notifyStruct);
 
 /// character lookup table
 extern const char gCharLookup[];
@@ -19,8 +19,15 @@
 
 #include "persistence_client_library_db_access.h"
 #include "persistence_client_library_custom_loader.h"
+#include "persistence_client_library_custom_cache.h"
 #include "persistence_client_library_dbus_service.h"
 #include "persistence_client_library_prct_access.h"
+#include "persistence_client_library_write_cache.h"
+#include "persistence_client_library_default_snapshot.h"
+#include "persistence_client_library_rct_index.h"
+#include "persistence_client_library_rct_hash.h"
+#include "persistence_client_library_notify_exec.h"
+#include "crc32.h"
 
 #include <persComErrors.h>
 #include <persComDataOrg.h>
@@ -31,12 +38,64 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 
 
 
-/// btree array
-static int gHandlesDB[DbTableSize][PersistenceDB_LastEntry];
-static int gHandlesDBCreated[DbTableSize][PersistenceDB_LastEntry] = { {0} };
+/// key filter of a default database, used to avoid probing the default databases for keys they don't contain
+typedef struct _PersDefaultKeyFilter_s
+{
+   /// bit mask to get the bloom filter bit index (number of bits - 1)
+   unsigned int bitMask;
+   /// bloom filter over the keys of the database, NULL if the key list is not available
+   unsigned char* bits;
+   /// keys probed and known to be not in the database (negative cache)
+   char absentKeys[DefaultNegCacheSize][DbKeyMaxLen];
+} PersDefaultKeyFilter_s;
+
+/// mutex to protect the key filters, also while a filter is read (filters are freed when a database is closed)
+static pthread_mutex_t gDefaultKeyFilterMtx = PTHREAD_MUTEX_INITIALIZER;
+
+
+/// open database, entry of the database handle table.
+/// Lookups are lock free: entries are published with release semantics and never freed
+/// while the library is initialized, a closed entry is recycled for the next database.
+typedef struct _PersDbHandleEntry_s
+{
+   /// next entry in the hash bucket
+   struct _PersDbHandleEntry_s* next;
+   /// the database handle
+   int handleDB;
+   /// number of callers using the handle, a handle in use is never closed; -1 if the entry is closed
+   int users;
+   /// value of the use clock at the last use, used to find the least recently used database
+   unsigned int lastUse;
+   /// key filter (default databases only), created on first use; protected by gDefaultKeyFilterMtx
+   PersDefaultKeyFilter_s* filter;
+   /// full path of the database
+   char path[DbPathMaxLen];
+} PersDbHandleEntry_s;
+
+/// database handle table, hashed by database path
+static PersDbHandleEntry_s* gDbHandleTable[DbHandleHashSize] = {NULL};
+/// closed entries available for reuse
+static PersDbHandleEntry_s* gDbHandleFreeList = NULL;
+/// use clock, advanced each time a database is opened
+static unsigned int gDbHandleUseClock = 0;
+/// number of open databases
+static unsigned int gDbHandleNumOpen = 0;
+/// max number of open databases, 0 if not yet initialized
+static unsigned int gDbHandleMaxOpen = 0;
+/// number of database open calls
+static unsigned int gDbHandleOpenCount = 0;
+/// number of databases closed to stay below the max number of open databases
+static unsigned int gDbHandleEvictCount = 0;
+/// number of lookups traversing the handle table, entries are only freed if no lookup is running
+static int gDbHandleReaders = 0;
+/// mutex to serialize opening and closing of databases, not needed for lookups
+static pthread_mutex_t gDbHandleMtx = PTHREAD_MUTEX_INITIALIZER;
 
 
 // function prototype
@@ -63,213 +122,784 @@ char* pers_get_raw_key(char *key)
 
 
 
-static int database_get(PersistenceInfo_s* info, const char* dbPath, int dbType)
+/**
+ * @brief pin a handle table entry, fails if the entry has been closed
+ *
+ * @return 1 if pinned, 0 if the entry is closed
+ */
+static int database_pin(PersDbHandleEntry_s* entry)
 {
-   int arrayIdx = 0;
-   int handleDB = -1;
+   int users = __atomic_load_n(&entry->users, __ATOMIC_RELAXED);
 
-   // create array index: index is a combination of resource config table type and group
-   arrayIdx = info->configKey.storage + info->context.ldbid ;
-
-   if(arrayIdx < DbTableSize)
+   while(users >= 0)
    {
-      if(gHandlesDBCreated[arrayIdx][dbType] == 0)
+      if(__atomic_compare_exchange_n(&entry->users, &users, users + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
       {
-         char path[DbPathMaxLen] = {0};
+         unsigned int now = __atomic_load_n(&gDbHandleUseClock, __ATOMIC_RELAXED);
 
-         if(PersistencePolicy_wt == dbType)				/// write through database
+         if(__atomic_load_n(&entry->lastUse, __ATOMIC_RELAXED) != now)    // avoid writing the shared cache line on every access
          {
-            snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalWt);
+            __atomic_store_n(&entry->lastUse, now, __ATOMIC_RELAXED);
          }
-         else if(PersistencePolicy_wc == dbType)		// cached database
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+
+
+/// find and pin the entry of a database, returns NULL if the database is not open
+static PersDbHandleEntry_s* database_lookup(unsigned int bucket, const char* path)
+{
+   PersDbHandleEntry_s* entry = NULL;
+
+   __atomic_add_fetch(&gDbHandleReaders, 1, __ATOMIC_SEQ_CST);
+
+   entry = __atomic_load_n(&gDbHandleTable[bucket], __ATOMIC_ACQUIRE);
+   while(entry != NULL)
+   {
+      if(   (strncmp(entry->path, path, DbPathMaxLen) == 0)
+         && (database_pin(entry) == 1) )
+      {
+         // the entry may have been recycled for another database since the compare
+         if(strncmp(entry->path, path, DbPathMaxLen) == 0)
          {
-            snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalCached);
+            break;
          }
-         else if(PersistenceDB_confdefault == dbType)		// configurable default database
-			{
-			  snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalConfigurableDefault);
-			}
-			else if(PersistenceDB_default == dbType)		// default database
-			{
-			  snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalFactoryDefault);
-			}
-         else
+         __atomic_sub_fetch(&entry->users, 1, __ATOMIC_RELEASE);
+      }
+      entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE);
+   }
+
+   __atomic_sub_fetch(&gDbHandleReaders, 1, __ATOMIC_RELEASE);
+
+   return entry;
+}
+
+
+
+/// close the database and move the entry to the free list, the handle table mutex must be locked
+static int database_close_entry(PersDbHandleEntry_s* entry)
+{
+   int rval = persComDbClose(entry->handleDB);
+   PersDbHandleEntry_s** link = &gDbHandleTable[pclCrc32(0, (const unsigned char*)entry->path, strlen(entry->path)) & (DbHandleHashSize-1)];
+
+   if(rval < 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_close_entry - failed to close db:"), DLT_STRING(entry->path));
+   }
+
+   while((*link != NULL) && (*link != entry))
+   {
+      link = &(*link)->next;
+   }
+   if(*link != NULL)
+   {
+      // readers still traversing the entry continue with the rest of the bucket
+      __atomic_store_n(link, entry->next, __ATOMIC_RELEASE);
+   }
+   gDbHandleNumOpen--;
+
+   // the filter is only read with the filter mutex locked
+   pthread_mutex_lock(&gDefaultKeyFilterMtx);
+   if(entry->filter != NULL)
+   {
+      free(entry->filter->bits);
+      free(entry->filter);
+      entry->filter = NULL;
+   }
+   pthread_mutex_unlock(&gDefaultKeyFilterMtx);
+
+   entry->next = gDbHandleFreeList;
+   gDbHandleFreeList = entry;
+
+   return rval;
+}
+
+
+
+/// close the least recently used database not in use, the handle table mutex must be locked
+static void database_evict_lru(void)
+{
+   int closed = 0;
+
+   while(closed == 0)
+   {
+      PersDbHandleEntry_s* lru = NULL;
+      int i = 0;
+
+      for(i=0; i<DbHandleHashSize; i++)
+      {
+         PersDbHandleEntry_s* entry = NULL;
+
+         for(entry = gDbHandleTable[i]; entry != NULL; entry = entry->next)
          {
-            handleDB = -2;
+            if(   (__atomic_load_n(&entry->users, __ATOMIC_RELAXED) == 0)
+               && ((lru == NULL) || ((int)(entry->lastUse - lru->lastUse) < 0)) )
+            {
+               lru = entry;
+            }
          }
+      }
+
+      if(lru == NULL)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("database_evict_lru - all databases in use, max open databases exceeded"));
+         break;
+      }
+
+      // mark the entry closed, fails if a reader pinned the entry in the meantime
+      int users = 0;
+      if(__atomic_compare_exchange_n(&lru->users, &users, -1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      {
+         (void)database_close_entry(lru);
+         gDbHandleEvictCount++;
+         closed = 1;
+      }
+   }
+}
+
+
+
+/**
+ * @brief get the handle of a database, the database is opened if not yet open.
+ *        If the max number of open databases is reached, the least recently used
+ *        database not in use is closed.
+ *        Lookups of open databases don't take a lock and can run in parallel.
+ *        The handle must be released with ::database_release after use.
+ *
+ * @param entry returns the handle table entry, to be passed to ::database_release
+ *
+ * @return the database handle or a negative value on error
+ */
+static int database_get(const char* dbPath, int dbType, PersDbHandleEntry_s** entry)
+{
+   int handleDB = -1;
+   char path[DbPathMaxLen] = {0};
+
+   *entry = NULL;
+
+   if(PersistencePolicy_wt == dbType)				/// write through database
+   {
+      snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalWt);
+   }
+   else if(PersistencePolicy_wc == dbType)		// cached database
+   {
+      snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalCached);
+   }
+   else if(PersistenceDB_confdefault == dbType)		// configurable default database
+   {
+      snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalConfigurableDefault);
+   }
+   else if(PersistenceDB_default == dbType)		// default database
+   {
+      snprintf(path, DbPathMaxLen, "%s%s", dbPath, gLocalFactoryDefault);
+   }
+   else
+   {
+      handleDB = -2;
+   }
+
+   if(handleDB == -1)
+   {
+      unsigned int bucket = pclCrc32(0, (const unsigned char*)path, strlen(path)) & (DbHandleHashSize-1);
+      PersDbHandleEntry_s* dbEntry = database_lookup(bucket, path);
 
-         if (handleDB == -1)
+      if(dbEntry == NULL)
+      {
+         pthread_mutex_lock(&gDbHandleMtx);
+
+         // another thread may have opened the database in the meantime
+         dbEntry = database_lookup(bucket, path);
+         if(dbEntry == NULL)
          {
-            handleDB = persComDbOpen(path, 0x01);
-            if(handleDB >= 0)
+            if(gDbHandleMaxOpen == 0)
+            {
+               const char* pMaxOpen = getenv("PERS_CLIENT_MAX_OPEN_DB");
+               gDbHandleMaxOpen = ((pMaxOpen != NULL) && (atoi(pMaxOpen) > 0)) ? (unsigned int)atoi(pMaxOpen) : DbHandleMaxOpen;
+            }
+
+            if(gDbHandleNumOpen >= gDbHandleMaxOpen)
+            {
+               database_evict_lru();
+            }
+
+            if(gDbHandleFreeList != NULL)
             {
-               gHandlesDB[arrayIdx][dbType] = handleDB ;
-               gHandlesDBCreated[arrayIdx][dbType] = 1;
+               dbEntry = gDbHandleFreeList;
+               gDbHandleFreeList = dbEntry->next;
             }
             else
             {
-               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_get - persComDbOpen() failed"));
+               dbEntry = calloc(1, sizeof(PersDbHandleEntry_s));
+               if(dbEntry != NULL)
+               {
+                  dbEntry->users = -1;
+               }
+            }
+
+            if(dbEntry != NULL)
+            {
+               int handle = persComDbOpen(path, 0x01);
+               gDbHandleOpenCount++;
+
+               if(handle >= 0)
+               {
+                  strncpy(dbEntry->path, path, DbPathMaxLen);
+                  dbEntry->path[DbPathMaxLen-1] = '\0';
+                  dbEntry->handleDB = handle;
+                  dbEntry->lastUse  = __atomic_add_fetch(&gDbHandleUseClock, 1, __ATOMIC_RELAXED);
+                  dbEntry->next     = gDbHandleTable[bucket];
+
+                  // open the entry (pinned for this caller) and publish it
+                  __atomic_store_n(&dbEntry->users, 1, __ATOMIC_RELEASE);
+                  __atomic_store_n(&gDbHandleTable[bucket], dbEntry, __ATOMIC_RELEASE);
+                  gDbHandleNumOpen++;
+               }
+               else
+               {
+                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_get - persComDbOpen() failed"), DLT_STRING(path));
+                  dbEntry->next = gDbHandleFreeList;
+                  gDbHandleFreeList = dbEntry;
+                  dbEntry = NULL;
+               }
             }
          }
-         else
-         {
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_get - wrong policy! Cannot extend dbPath wit database."));
-         }
+
+         pthread_mutex_unlock(&gDbHandleMtx);
       }
-      else
+
+      if(dbEntry != NULL)
       {
-         handleDB = gHandlesDB[arrayIdx][dbType];
+         handleDB = dbEntry->handleDB;
+         *entry = dbEntry;
       }
    }
    else
    {
-      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_get - invalid storage type"), DLT_STRING(dbPath));
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_get - wrong policy! Cannot extend dbPath wit database."));
    }
+
    return handleDB;
 }
 
 
-int pers_get_defaults(char* dbPath, char* key, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size, PersGetDefault_e job)
+
+/**
+ * @brief release a database handle returned by ::database_get
+ *
+ * @param entry the handle table entry, may be NULL
+ */
+static void database_release(PersDbHandleEntry_s* entry)
 {
-   PersDefaultType_e i = PersDefaultType_Configurable;
-   int handleDefaultDB = -1;
-   int read_size = EPERS_NOKEY;
-   char dltMessage[DbPathMaxLen] = {0};
+   if(entry != NULL)
+   {
+      __atomic_sub_fetch(&entry->users, 1, __ATOMIC_RELEASE);
+   }
+}
+
+
+int database_write_key(PersistenceInfo_s* info, const char* dbPath, const char* key, unsigned char* buffer, unsigned int buffer_size)
+{
+   int write_size = EPERS_NOPRCTABLE;
+   PersDbHandleEntry_s* dbEntry = NULL;
+   int handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
 
-   for(i=(int)PersistenceDB_confdefault; i<(int)PersistenceDB_LastEntry; i++)
+   if(handleDB >= 0)
    {
-   	handleDefaultDB = database_get(info, dbPath, i);
-      if(handleDefaultDB >= 0)
+      write_size = persComDbWriteKey(handleDB, key, (char*)buffer, buffer_size);
+   }
+   database_release(dbEntry);
+
+   return write_size;
+}
+
+
+
+static void default_filter_hash(const char* key, unsigned int* hash1, unsigned int* hash2)
+{
+   // second hash (FNV-1a) for double hashing
+   const unsigned char* c = (const unsigned char*)key;
+   unsigned int fnv = 2166136261U;
+
+   while(*c != '\0')
+   {
+      fnv = (fnv ^ *c++) * 16777619U;
+   }
+
+   *hash1 = pclCrc32(0, (const unsigned char*)key, strlen(key));
+   *hash2 = fnv | 1;
+}
+
+
+
+static void default_filter_add(PersDefaultKeyFilter_s* filter, const char* key)
+{
+   int k = 0;
+   unsigned int hash1 = 0, hash2 = 0;
+
+   default_filter_hash(key, &hash1, &hash2);
+
+   for(k=0; k<DefaultFilterNumHashes; k++)
+   {
+      unsigned int bit = (hash1 + k * hash2) & filter->bitMask;
+      filter->bits[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+   }
+}
+
+
+
+/**
+ * @brief get the key filter of a default database, the filter is created on first use
+ *        from the key list of the database. The filter mutex must be locked.
+ *
+ * @return the filter or NULL if no filter is available
+ */
+static PersDefaultKeyFilter_s* default_filter_get_locked(PersDbHandleEntry_s* dbEntry)
+{
+   PersDefaultKeyFilter_s* filter = dbEntry->filter;
+
+   if(filter == NULL)
+   {
+      filter = calloc(1, sizeof(PersDefaultKeyFilter_s));
+      if(filter != NULL)
       {
-         if (PersGetDefault_Data == job)
-         {
-         	read_size = persComDbReadKey(handleDefaultDB, key, (char*)buffer, buffer_size);
-         }
-         else if (PersGetDefault_Size == job)
-         {
-            read_size = persComDbGetKeySize(handleDefaultDB, key);
-         }
-         else
-         {
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_get_defaults - unknown job"));
-            break;
-         }
+         int listSize = persComDbGetSizeKeysList(dbEntry->handleDB);
+         char* keyList = (listSize > 0) ? malloc(listSize) : NULL;
 
-         if(read_size < 0) // check read_size
+         if((listSize == 0) || ((keyList != NULL) && (persComDbGetKeysList(dbEntry->handleDB, keyList, listSize) >= 0)))
          {
-            if(PERS_COM_ERR_NOT_FOUND == read_size)
+            int pos = 0, numKeys = 0;
+            unsigned int numBits = 64;
+
+            for(pos=0; pos<listSize; pos += strlen(keyList+pos) + 1)
             {
-               read_size = EPERS_NOKEY;
+               numKeys++;
             }
-         }
-         else /* read_size >= 0 --> default value found */
-         {
-            if (PersDefaultType_Configurable == i)
+
+            while(numBits < (unsigned int)(numKeys * DefaultFilterBitsPerKey))
             {
-               snprintf(dltMessage, DbPathMaxLen, "%s%s", dbPath, gLocalConfigurableDefault);
+               numBits <<= 1;
             }
-            if (PersDefaultType_Factory == i)
+
+            filter->bits = calloc(numBits / 8, 1);
+            if(filter->bits != NULL)
             {
-                snprintf(dltMessage, DbPathMaxLen, "%s%s", dbPath, gLocalFactoryDefault);
+               filter->bitMask = numBits - 1;
+               for(pos=0; pos<listSize; pos += strlen(keyList+pos) + 1)
+               {
+                  default_filter_add(filter, keyList+pos);
+               }
             }
-            DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("pers_get_defaults - efault data will be used for Key"), DLT_STRING(key),
-                                                  DLT_STRING("from"), DLT_STRING(dltMessage));
-            break;
+            DLT_LOG(gPclDLTContext, DLT_LOG_DEBUG, DLT_STRING("default_filter_get_locked - created key filter, keys:"), DLT_INT(numKeys),
+                                                   DLT_STRING("bits:"), DLT_UINT(numBits));
          }
-      }
-   }
 
-   if (read_size < 0)
-   {
-       DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("pers_get_defaults - default data not available for Key"), DLT_STRING(key),
-                                             DLT_STRING("Path:"), DLT_STRING(dbPath));
+         free(keyList);
+         dbEntry->filter = filter;
+      }
    }
 
-   return read_size;
+   return filter;
 }
 
 
 
-#if 0
-void database_close(PersistenceInfo_s* info)
+/**
+ * @brief check if a key may be in a default database, the filter of the database is created on first use
+ *
+ * @return 0 if the key is definitely not in the database, 1 if it may be in the database
+ */
+static int default_filter_may_contain(PersDbHandleEntry_s* dbEntry, const char* key)
 {
-   int arrayIdx = info->configKey.storage + info->context.ldbid;
+   int k = 0, rval = 1;
+   unsigned int hash1 = 0, hash2 = 0;
+   PersDefaultKeyFilter_s* filter = NULL;
+
+   default_filter_hash(key, &hash1, &hash2);
 
-   if(info->configKey.storage <= PersistenceStorage_shared )
+   // the filter can be freed by closing the database, it is only read with the mutex locked
+   pthread_mutex_lock(&gDefaultKeyFilterMtx);
+
+   filter = default_filter_get_locked(dbEntry);
+   if(filter != NULL)
    {
-      int iErrorCode = persComDbClose(gHandlesDB[arrayIdx][info->configKey.policy]) ;
-      if (iErrorCode < 0)
+      if(filter->bits != NULL)
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_close ==> persComDbClose() failed"));
+         for(k=0; k<DefaultFilterNumHashes; k++)
+         {
+            unsigned int bit = (hash1 + k * hash2) & filter->bitMask;
+            if((filter->bits[bit >> 3] & (1 << (bit & 7))) == 0)
+            {
+               rval = 0;
+               break;
+            }
+         }
       }
-      else
+
+      if(   (rval == 1)
+         && (strncmp(filter->absentKeys[hash1 & (DefaultNegCacheSize-1)], key, DbKeyMaxLen) == 0) )
       {
-        gHandlesDBCreated[arrayIdx][info->configKey.policy] = 0;
+         rval = 0;
       }
    }
-   else
+
+   pthread_mutex_unlock(&gDefaultKeyFilterMtx);
+
+   return rval;
+}
+
+
+
+/// remember a key probed and not found in a default database
+static void default_filter_add_absent(PersDbHandleEntry_s* dbEntry, const char* key)
+{
+   unsigned int hash1 = 0, hash2 = 0;
+
+   default_filter_hash(key, &hash1, &hash2);
+
+   pthread_mutex_lock(&gDefaultKeyFilterMtx);
+   if(dbEntry->filter != NULL)
    {
-      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_close ==> invalid storage type"), DLT_INT(info->context.ldbid ));
+      strncpy(dbEntry->filter->absentKeys[hash1 & (DefaultNegCacheSize-1)], key, DbKeyMaxLen);
+      dbEntry->filter->absentKeys[hash1 & (DefaultNegCacheSize-1)][DbKeyMaxLen-1] = '\0';
    }
+   pthread_mutex_unlock(&gDefaultKeyFilterMtx);
 }
-#endif
-void database_close_all()
+
+
+
+/**
+ * @brief make sure the buffer can hold the given number of bytes, the buffer is grown if needed
+ *
+ * @return 0 on success or EPERS_COMMON if no memory is available
+ */
+static int alloc_buffer_reserve(unsigned char** buffer, unsigned int* buffer_size, unsigned int size)
 {
-   int i = 0, j = 0;
+   int rval = 0;
 
-   for(i=0; i<DbTableSize; i++)
+   if((*buffer == NULL) || (*buffer_size < size))
    {
-   	for(j=0; j < PersistenceDB_LastEntry; j++)
-   	{
-			if(gHandlesDBCreated[i][j] == 1)
-			{
-				int iErrorCode = persComDbClose(gHandlesDB[i][j]);
-				if (iErrorCode < 0)
-				{
-					DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("database_close_all - failed to close db"));
-				}
-				else
-				{
-					 gHandlesDBCreated[i][j] = 0;
-				}
-			}
-   	}
+      unsigned char* newBuffer = realloc(*buffer, (size > 0) ? size : 1);
+
+      if(newBuffer != NULL)
+      {
+         *buffer = newBuffer;
+         *buffer_size = (size > 0) ? size : 1;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("alloc_buffer_reserve - failed to allocate buffer, size:"), DLT_UINT(size));
+         rval = EPERS_COMMON;
+      }
    }
+
+   return rval;
 }
 
 
 
-int persistence_get_data(char* dbPath, char* key, const char* resourceID, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size)
+/**
+ * @brief read a key into a buffer allocated or grown as needed, with one size request.
+ *        The buffer gets one byte more than the key size, a read filling the buffer
+ *        completely means the key has grown in the meantime and the read is repeated.
+ *
+ * @return the number of bytes read or a negative error code
+ */
+static int read_key_alloc(int handleDB, const char* key, unsigned char** buffer, unsigned int* buffer_size)
 {
-   int read_size = -1;
-   int ret_defaults = -1;
+   int read_size = EPERS_COMMON;
+   int tries = 0;
 
-   if(   PersistenceStorage_shared == info->configKey.storage
-      || PersistenceStorage_local == info->configKey.storage)
+   for(tries=0; tries<AllocReadMaxTries; tries++)
    {
-      int handleDB = database_get(info, dbPath, info->configKey.policy);
-      if(handleDB >= 0)
+      int size = persComDbGetKeySize(handleDB, key);
+
+      if(size < 0)
       {
-         read_size = persComDbReadKey(handleDB, key, (char*)buffer, buffer_size);
-         if(read_size < 0)
-         {
-            read_size = pers_get_defaults(dbPath, (char*)resourceID, info, buffer, buffer_size, PersGetDefault_Data); /* 0 ==> Get data */
-         }
+         read_size = size;
+         break;
+      }
+
+      if(alloc_buffer_reserve(buffer, buffer_size, (unsigned int)size + 1) != 0)
+      {
+         read_size = EPERS_COMMON;
+         break;
+      }
+
+      read_size = persComDbReadKey(handleDB, key, (char*)*buffer, *buffer_size);
+      if((read_size < 0) || ((unsigned int)read_size < *buffer_size))
+      {
+         break;
       }
    }
-   else if(PersistenceStorage_custom == info->configKey.storage)   // custom storage implementation via custom library
+
+   if((read_size >= 0) && ((unsigned int)read_size >= *buffer_size))
    {
-      int idx =  custom_client_name_to_id(dbPath, 1);
-      char workaroundPath[128];  								// workaround, because /sys/ can not be accessed on host!!!!
-      snprintf(workaroundPath, 128, "%s%s", "/Data", dbPath  );
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("read_key_alloc - key is changing while read:"), DLT_STRING(key));
+   }
 
-      if(idx < PersCustomLib_LastEntry)
-      {
-      	int available = 0;
-      	if(gPersCustomFuncs[idx].custom_plugin_get_size == NULL )
-			{
-				if(getCustomLoadingType(idx) == LoadType_OnDemand)
-				{
+   return read_size;
+}
+
+
+
+/// get the default data or size of a key, the buffer is only grown for ::PersGetDefault_DataAlloc
+static int pers_get_defaults_job(char* dbPath, char* key, unsigned char** buffer, unsigned int* buffer_size, PersGetDefault_e job)
+{
+   int i = PersistenceDB_confdefault;
+   int handleDefaultDB = -1;
+   int read_size = EPERS_NOKEY;
+   int found = 0;
+
+   for(i=(int)PersistenceDB_confdefault; (i<(int)PersistenceDB_LastEntry) && (found == 0); i++)
+   {
+      PersDbHandleEntry_s* dbEntry = NULL;
+
+   	handleDefaultDB = database_get(dbPath, i, &dbEntry);
+      if(handleDefaultDB >= 0)
+      {
+         PersDefaultSnapshot_s* snapshot = default_snapshot_get(dbEntry->path, handleDefaultDB);
+
+         if(snapshot != NULL)
+         {
+            // the snapshot contains all keys of the database, no database access needed
+            read_size = default_snapshot_read(snapshot, key, (PersGetDefault_Data == job) ? *buffer : NULL, *buffer_size);
+            if((PersGetDefault_DataAlloc == job) && (read_size >= 0))
+            {
+               // the snapshot does not change, the size is still valid when the data is read
+               read_size = (alloc_buffer_reserve(buffer, buffer_size, read_size) == 0)
+                         ? default_snapshot_read(snapshot, key, *buffer, *buffer_size) : EPERS_COMMON;
+            }
+            default_snapshot_put(snapshot);
+         }
+         else
+         {
+            if(default_filter_may_contain(dbEntry, key) == 0)
+            {
+               read_size = EPERS_NOKEY;   // key is not in this database, no need to probe
+            }
+            else if (PersGetDefault_Data == job)
+            {
+               read_size = persComDbReadKey(handleDefaultDB, key, (char*)*buffer, *buffer_size);
+            }
+            else if (PersGetDefault_Size == job)
+            {
+               read_size = persComDbGetKeySize(handleDefaultDB, key);
+            }
+            else if (PersGetDefault_DataAlloc == job)
+            {
+               read_size = read_key_alloc(handleDefaultDB, key, buffer, buffer_size);
+            }
+            else
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_get_defaults - unknown job"));
+               read_size = EPERS_COMMON;
+               found = 1;   // no need to check the other default databases
+            }
+         }
+
+         if(read_size < 0) // check read_size
+         {
+            if(PERS_COM_ERR_NOT_FOUND == read_size)
+            {
+               read_size = EPERS_NOKEY;
+
+               if(snapshot == NULL)
+               {
+                  default_filter_add_absent(dbEntry, key);
+               }
+            }
+         }
+         else /* read_size >= 0 --> default value found */
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("pers_get_defaults - default data will be used for Key"), DLT_STRING(key),
+                                                  DLT_STRING("from"), DLT_STRING(dbPath),
+                                                  DLT_STRING((PersistenceDB_confdefault == i) ? gLocalConfigurableDefault : gLocalFactoryDefault));
+            found = 1;
+         }
+
+         // the filter belongs to the database handle, release the handle after the last filter access
+         database_release(dbEntry);
+      }
+   }
+
+   if (read_size < 0)
+   {
+       DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("pers_get_defaults - default data not available for Key"), DLT_STRING(key),
+                                             DLT_STRING("Path:"), DLT_STRING(dbPath));
+   }
+
+   return read_size;
+}
+
+
+
+int pers_get_defaults(char* dbPath, char* key, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size, PersGetDefault_e job)
+{
+   (void)info;
+
+   if(PersGetDefault_DataAlloc == job)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_get_defaults - use pers_get_defaults_alloc"));
+      return EPERS_COMMON;
+   }
+
+   return pers_get_defaults_job(dbPath, key, &buffer, &buffer_size, job);
+}
+
+
+
+int pers_get_defaults_alloc(char* dbPath, char* key, PersistenceInfo_s* info, unsigned char** buffer, unsigned int* buffer_size)
+{
+   (void)info;
+
+   return pers_get_defaults_job(dbPath, key, buffer, buffer_size, PersGetDefault_DataAlloc);
+}
+
+
+
+void get_database_handle_stats(unsigned int* numOpen, unsigned int* openCount, unsigned int* evictCount)
+{
+   pthread_mutex_lock(&gDbHandleMtx);
+   *numOpen    = gDbHandleNumOpen;
+   *openCount  = gDbHandleOpenCount;
+   *evictCount = gDbHandleEvictCount;
+   pthread_mutex_unlock(&gDbHandleMtx);
+}
+
+
+
+void database_close_all()
+{
+   int i = 0, waited = 0;
+   unsigned int numInUse = 0;
+
+   default_snapshot_close_all();
+
+   do
+   {
+      numInUse = 0;
+
+      pthread_mutex_lock(&gDbHandleMtx);
+
+      // close all databases not in use, databases in use are closed in the next round after the last user released them
+      for(i=0; i<DbHandleHashSize; i++)
+      {
+         PersDbHandleEntry_s* entry = gDbHandleTable[i];
+
+         while(entry != NULL)
+         {
+            PersDbHandleEntry_s* next = entry->next;
+            int users = 0;
+
+            if(__atomic_compare_exchange_n(&entry->users, &users, -1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            {
+               (void)database_close_entry(entry);
+            }
+            else
+            {
+               numInUse++;
+            }
+            entry = next;
+         }
+      }
+
+      if(numInUse == 0)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("database_close_all - opened:"), DLT_UINT(gDbHandleOpenCount),
+                                               DLT_STRING("closed (LRU):"), DLT_UINT(gDbHandleEvictCount));
+
+         // lookups may still traverse closed entries, wait for them before the entries are freed
+         while(__atomic_load_n(&gDbHandleReaders, __ATOMIC_SEQ_CST) > 0)
+         {
+            sched_yield();
+         }
+
+         while(gDbHandleFreeList != NULL)
+         {
+            PersDbHandleEntry_s* entry = gDbHandleFreeList;
+            gDbHandleFreeList = entry->next;
+            free(entry);
+         }
+
+         gDbHandleOpenCount  = 0;
+         gDbHandleEvictCount = 0;
+      }
+
+      pthread_mutex_unlock(&gDbHandleMtx);
+
+      if(numInUse > 0)
+      {
+         if(waited == 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("database_close_all - wait for databases in use:"), DLT_UINT(numInUse));
+            waited = 1;
+         }
+         sched_yield();
+      }
+   }
+   while(numInUse > 0);
+}
+
+
+
+/// create the path of a resource passed to the custom storage plugin
+static void custom_plugin_path(const PersistenceInfo_s* info, const char* key, char pathKeyString[128])
+{
+   if(info->configKey.customID[0] == '\0')   // if we have not a customID we use the key
+   {
+      snprintf(pathKeyString, 128, "0x%08X/%s/%s", info->context.ldbid, info->configKey.custom_name, key);
+   }
+   else
+   {
+      snprintf(pathKeyString, 128, "0x%08X/%s", info->context.ldbid, info->configKey.customID);
+   }
+}
+
+
+
+int persistence_get_data(char* dbPath, char* key, const char* resourceID, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size)
+{
+   int read_size = -1;
+   int ret_defaults = -1;
+
+   if(   PersistenceStorage_shared == info->configKey.storage
+      || PersistenceStorage_local == info->configKey.storage)
+   {
+      // data not yet written back is served from the write-behind cache
+      read_size = write_cache_get(info, dbPath, key, buffer, buffer_size);
+      if(read_size < 0)
+      {
+         PersDbHandleEntry_s* dbEntry = NULL;
+         int handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
+         if(handleDB >= 0)
+         {
+            read_size = persComDbReadKey(handleDB, key, (char*)buffer, buffer_size);
+            database_release(dbEntry);
+            if(read_size < 0)
+            {
+               read_size = pers_get_defaults(dbPath, (char*)resourceID, info, buffer, buffer_size, PersGetDefault_Data); /* 0 ==> Get data */
+            }
+         }
+      }
+   }
+   else if(PersistenceStorage_custom == info->configKey.storage)   // custom storage implementation via custom library
+   {
+      int idx = info->customIdx;   // plugin resolved with the resource context
+      wait_custom_plugin_loaded(idx);   // the plugin may still be loaded by a loader thread
+      char workaroundPath[128];  								// workaround, because /sys/ can not be accessed on host!!!!
+      snprintf(workaroundPath, 128, "%s%s", "/Data", dbPath  );
+
+      if(check_valid_idx(idx) != -1)
+      {
+      	int available = 0;
+      	if(gPersCustomFuncs[idx].custom_plugin_get_size == NULL )
+			{
+				if(getCustomLoadingType(idx) == LoadType_OnDemand)
+				{
 					// plugin not loaded, try to load the requested plugin
 					if(load_custom_library(idx, &gPersCustomFuncs[idx]) == 1)
 					{
@@ -302,42 +932,804 @@ int persistence_get_data(char* dbPath, char* key, const char* resourceID, Persis
       	if(available == 1)
       	{
 				char pathKeyString[128] = {0};
-				if(info->configKey.customID[0] == '\0')   // if we have not a customID we use the key
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s/%s", info->context.ldbid, info->configKey.custom_name, key);
-				}
-				else
+				custom_plugin_path(info, key, pathKeyString);
+
+				// plugins with a cache policy are only called if the data is not cached
+				read_size = custom_cache_get_data(idx, pathKeyString, buffer, buffer_size);
+				if(read_size < 0)
 				{
-					snprintf(pathKeyString, 128, "0x%08X/%s", info->context.ldbid, info->configKey.customID);
+					unsigned int generation = custom_cache_generation(idx);
+					read_size = gPersCustomFuncs[idx].custom_plugin_get_data(pathKeyString, (char*)buffer, buffer_size);
+					custom_cache_add_data(idx, pathKeyString, generation, buffer, read_size, buffer_size);
 				}
-				read_size = gPersCustomFuncs[idx].custom_plugin_get_data(pathKeyString, (char*)buffer, buffer_size);
       	}
       	else
       	{
       		read_size = EPERS_NOPLUGINFUNCT;
       	}
       }
-      else
+      else
+      {
+         read_size = EPERS_NOPLUGINFUNCT;
+      }
+
+      if (1 > read_size) /* Try to get default values */
+      {
+         info->configKey.policy = PersistencePolicy_wc;			/* Set the policy */
+         info->configKey.type   = PersistenceResourceType_key;  /* Set the type */
+
+         (void)get_db_path_and_key(info, key, NULL, dbPath);
+
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("persistence_get_data - Plugin data not available - get default data of key:"), DLT_STRING(key));
+         ret_defaults = pers_get_defaults(dbPath, (char*)resourceID, info, buffer, buffer_size, PersGetDefault_Data);
+         if (0 < ret_defaults)
+         {
+        	   read_size = ret_defaults;
+         }
+      }
+   }
+   return read_size;
+}
+
+
+
+int persistence_get_data_alloc(char* dbPath, char* key, const char* resourceID, PersistenceInfo_s* info,
+                               unsigned char** buffer, unsigned int* buffer_size)
+{
+   int read_size = -1;
+
+   if(   PersistenceStorage_shared == info->configKey.storage
+      || PersistenceStorage_local == info->configKey.storage)
+   {
+      int cached = 0, tries = 0;
+
+      for(tries=0; tries<AllocReadMaxTries; tries++)
+      {
+         int size = write_cache_get(info, dbPath, key, NULL, 0);
+
+         if(size < 0)
+         {
+            break;
+         }
+
+         if(alloc_buffer_reserve(buffer, buffer_size, (unsigned int)size + 1) != 0)
+         {
+            read_size = EPERS_COMMON;
+            cached = 1;
+            break;
+         }
+
+         // the key may have been written back in the meantime, then it is read from the database
+         read_size = write_cache_get(info, dbPath, key, *buffer, *buffer_size);
+         cached = (read_size >= 0);
+         if((cached == 0) || ((unsigned int)read_size < *buffer_size))
+         {
+            break;
+         }
+      }
+
+      if(cached == 0)
+      {
+         PersDbHandleEntry_s* dbEntry = NULL;
+         int handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
+         if(handleDB >= 0)
+         {
+            read_size = read_key_alloc(handleDB, key, buffer, buffer_size);
+            if((read_size < 0) && (read_size != EPERS_COMMON))
+            {
+               // one lookup in the default databases, size and data are read from the same database
+               read_size = pers_get_defaults_alloc(dbPath, (char*)resourceID, info, buffer, buffer_size);
+            }
+         }
+         database_release(dbEntry);
+      }
+   }
+   else if(PersistenceStorage_custom == info->configKey.storage)
+   {
+      // the plugin interface has no combined call, get the size and read the data;
+      // a read filling the buffer completely means the data has grown in the meantime
+      int tries = 0;
+
+      for(tries=0; tries<AllocReadMaxTries; tries++)
+      {
+         read_size = persistence_get_data_size(dbPath, key, resourceID, info);
+         if(read_size < 0)
+         {
+            break;
+         }
+
+         read_size = (alloc_buffer_reserve(buffer, buffer_size, (unsigned int)read_size + 1) == 0)
+                   ? persistence_get_data(dbPath, key, resourceID, info, *buffer, *buffer_size) : EPERS_COMMON;
+         if((read_size < 0) || ((unsigned int)read_size < *buffer_size))
+         {
+            break;
+         }
+      }
+   }
+
+   return read_size;
+}
+
+
+
+/**
+ * @brief get or set the data of several items stored by the same custom storage plugin with one plugin call
+ *
+ * @param items the items, all stored by the same plugin
+ * @param num_items the number of items
+ * @param set 1 to set the data, 0 to get the data
+ *
+ * @return the number of items processed successfully or EPERS_NOPLUGINFUNCT if the plugin
+ *         has no batch function or the batch call failed; the items must be processed key by key then
+ */
+static int persistence_custom_data_batch(PersistenceBatchItem_s** items, unsigned int num_items, int set)
+{
+   int rval = EPERS_NOPLUGINFUNCT;
+   int idx = items[0]->info.customIdx;
+   int (*batchFunct)(plugin_batch_entry_s* entries, int num_entries) = NULL;
+
+   wait_custom_plugin_loaded(idx);
+
+   if(check_valid_idx(idx) != -1)
+   {
+      if(   (gPersCustomFuncs[idx].custom_plugin_get_data == NULL)     // plugin not loaded yet
+         && (getCustomLoadingType(idx) == LoadType_OnDemand) )
+      {
+         (void)load_custom_library(idx, &gPersCustomFuncs[idx]);
+      }
+
+      batchFunct = (set == 1) ? gPersCustomFuncs[idx].custom_plugin_set_data_batch
+                              : gPersCustomFuncs[idx].custom_plugin_get_data_batch;
+   }
+
+   if(batchFunct != NULL)
+   {
+      plugin_batch_entry_s* entries = malloc(num_items * sizeof(plugin_batch_entry_s));
+      PersistenceBatchItem_s** entryItems = malloc(num_items * sizeof(PersistenceBatchItem_s*));
+      char (*paths)[128] = malloc(num_items * sizeof(*paths));
+
+      if((entries != NULL) && (entryItems != NULL) && (paths != NULL))
+      {
+         unsigned int i = 0, numEntries = 0;
+         unsigned int generation = custom_cache_generation(idx);
+         int numCached = 0;
+
+         for(i=0; i<num_items; i++)
+         {
+            custom_plugin_path(&items[i]->info, items[i]->dbKey, paths[i]);
+
+            if(set == 0)
+            {
+               // cached data is not requested from the plugin
+               items[i]->result = custom_cache_get_data(idx, paths[i], items[i]->buffer, items[i]->buffer_size);
+               if(items[i]->result >= 0)
+               {
+                  numCached++;
+                  continue;
+               }
+            }
+
+            entries[numEntries].path   = paths[i];
+            entries[numEntries].buffer = (char*)items[i]->buffer;
+            entries[numEntries].size   = items[i]->buffer_size;
+            entries[numEntries].result = PCCL_FAILURE;
+            entryItems[numEntries]     = items[i];
+            numEntries++;
+         }
+
+         rval = (numEntries > 0) ? batchFunct(entries, numEntries) : 0;
+
+         if(set == 1)
+         {
+            // invalidate after the write, also if the batch failed, some entries may have been written
+            for(i=0; i<numEntries; i++)
+            {
+               custom_cache_remove(idx, entries[i].path);
+            }
+         }
+
+         if(rval >= 0)
+         {
+            for(i=0; i<numEntries; i++)
+            {
+               entryItems[i]->result = entries[i].result;
+               if(set == 0)
+               {
+                  custom_cache_add_data(idx, entries[i].path, generation, entryItems[i]->buffer, entries[i].result, entryItems[i]->buffer_size);
+               }
+            }
+            rval += numCached;
+         }
+         else
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("persistence_custom_data_batch - plugin batch call failed:"), DLT_INT(rval));
+            rval = EPERS_NOPLUGINFUNCT;
+         }
+      }
+
+      free(entryItems);
+      free(entries);
+      free(paths);
+   }
+
+   return rval;
+}
+
+
+
+/**
+ * @brief write data to a custom storage plugin
+ *
+ * @return the number of bytes written or a negative error code
+ */
+static int persistence_set_custom_data(char* key, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size)
+{
+   int write_size = -1;
+   int available = 0;
+   int idx = info->customIdx;
+   wait_custom_plugin_loaded(idx);
+
+   if(check_valid_idx(idx) != -1)
+   {
+      if(gPersCustomFuncs[idx].custom_plugin_set_data == NULL)
+      {
+         if (getCustomLoadingType(idx) == LoadType_OnDemand)
+         {
+            // plugin not loaded, try to load the requested plugin
+            if(load_custom_library(idx, &gPersCustomFuncs[idx]) == 1)
+            {
+               // check again if the plugin function is now available
+               if(gPersCustomFuncs[idx].custom_plugin_set_data != NULL)
+               {
+                  available = 1;
+               }
+            }
+         }
+         else if(getCustomLoadingType(idx) == LoadType_PclInit)
+         {
+            if(gPersCustomFuncs[idx].custom_plugin_set_data != NULL)
+            {
+               available = 1;
+            }
+         }
+         else
+         {
+             DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("persistence_set_data - Plugin not available, unknown loading type: "),
+                                                   DLT_INT(getCustomLoadingType(idx)));
+             write_size = EPERS_COMMON;
+         }
+      }
+      else
+      {
+         available = 1;   // already loaded
+      }
+
+      if(available == 1)
+      {
+         char pathKeyString[128] = {0};
+         custom_plugin_path(info, key, pathKeyString);
+
+         write_size = gPersCustomFuncs[idx].custom_plugin_set_data(pathKeyString, (char*)buffer, buffer_size);
+         // invalidate after the write, a concurrent read must not cache the old data again
+         custom_cache_remove(idx, pathKeyString);
+      }
+      else
+      {
+         write_size = EPERS_NOPLUGINFUNCT;
+      }
+   }
+   else
+   {
+      write_size = EPERS_NOPLUGINFUNCT;
+   }
+
+   return write_size;
+}
+
+
+
+static int batch_item_cmp(const void* a, const void* b)
+{
+   const PersistenceBatchItem_s* itemA = *(const PersistenceBatchItem_s* const*)a;
+   const PersistenceBatchItem_s* itemB = *(const PersistenceBatchItem_s* const*)b;
+   int rval = 0;
+
+   if(itemA->info.configKey.storage != itemB->info.configKey.storage)
+   {
+      rval = (itemA->info.configKey.storage < itemB->info.configKey.storage) ? -1 : 1;
+   }
+   else if(itemA->info.configKey.policy != itemB->info.configKey.policy)
+   {
+      rval = (itemA->info.configKey.policy < itemB->info.configKey.policy) ? -1 : 1;
+   }
+   else if(itemA->info.context.ldbid != itemB->info.context.ldbid)
+   {
+      rval = (itemA->info.context.ldbid < itemB->info.context.ldbid) ? -1 : 1;
+   }
+   else
+   {
+      rval = strncmp(itemA->dbPath, itemB->dbPath, DbPathMaxLen);
+   }
+
+   return rval;
+}
+
+
+
+static int batch_item_same_db(const PersistenceBatchItem_s* itemA, const PersistenceBatchItem_s* itemB)
+{
+   return (   itemA->info.configKey.storage == itemB->info.configKey.storage
+           && itemA->info.configKey.policy  == itemB->info.configKey.policy
+           && itemA->info.context.ldbid     == itemB->info.context.ldbid
+           && strncmp(itemA->dbPath, itemB->dbPath, DbPathMaxLen) == 0);
+}
+
+
+
+/**
+ * @brief create a list of the items to process, sorted by database
+ *
+ * @return the list (to be freed by the caller) or NULL; the number of items in the list is returned in numSorted
+ */
+static PersistenceBatchItem_s** batch_sort_items(PersistenceBatchItem_s* items, unsigned int num_items, unsigned int* numSorted)
+{
+   unsigned int i = 0;
+   PersistenceBatchItem_s** sorted = malloc(num_items * sizeof(PersistenceBatchItem_s*));
+
+   *numSorted = 0;
+
+   if(sorted != NULL)
+   {
+      for(i=0; i<num_items; i++)
+      {
+         if(items[i].result == 0)
+         {
+            sorted[(*numSorted)++] = &items[i];
+         }
+      }
+      qsort(sorted, *numSorted, sizeof(PersistenceBatchItem_s*), batch_item_cmp);
+   }
+
+   return sorted;
+}
+
+
+
+int persistence_get_data_batch(PersistenceBatchItem_s* items, unsigned int num_items)
+{
+   int numRead = 0;
+   unsigned int i = 0, numSorted = 0;
+   PersistenceBatchItem_s** sorted = batch_sort_items(items, num_items, &numSorted);
+
+   if(sorted == NULL)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_get_data_batch - failed to allocate memory"));
+      return EPERS_COMMON;
+   }
+
+   while(i < numSorted)
+   {
+      PersistenceBatchItem_s* first = sorted[i];
+
+      if(   PersistenceStorage_shared == first->info.configKey.storage
+         || PersistenceStorage_local == first->info.configKey.storage)
+      {
+         // one database lookup for all items stored in the same database
+         PersDbHandleEntry_s* dbEntry = NULL;
+         int handleDB = database_get(first->dbPath, first->info.configKey.policy, &dbEntry);
+
+         for( ; (i < numSorted) && batch_item_same_db(first, sorted[i]); i++)
+         {
+            PersistenceBatchItem_s* item = sorted[i];
+
+            item->result = write_cache_get(&item->info, item->dbPath, item->dbKey, item->buffer, item->buffer_size);
+            if(item->result >= 0)
+            {
+               continue;   // data not yet written back
+            }
+
+            if(handleDB >= 0)
+            {
+               item->result = persComDbReadKey(handleDB, item->dbKey, (char*)item->buffer, item->buffer_size);
+               if(item->result < 0)
+               {
+                  item->result = pers_get_defaults(item->dbPath, (char*)item->resource_id, &item->info,
+                                                   item->buffer, item->buffer_size, PersGetDefault_Data);
+               }
+            }
+            else
+            {
+               item->result = EPERS_COMMON;
+            }
+         }
+         database_release(dbEntry);
+      }
+      else
+      {
+         unsigned int groupEnd = i;
+         int batchRead = 0;
+
+         for( ; (groupEnd < numSorted) && batch_item_same_db(first, sorted[groupEnd]); groupEnd++)
+         {
+            ;
+         }
+
+         // custom storage, one plugin call for all items of the same plugin if the plugin supports it
+         batchRead = persistence_custom_data_batch(&sorted[i], groupEnd - i, 0);
+
+         for( ; i < groupEnd; i++)
+         {
+            PersistenceBatchItem_s* item = sorted[i];
+
+            // plugins without batch function are accessed key by key, missing data is read from the defaults
+            if((batchRead < 0) || (item->result < 1))
+            {
+               item->result = persistence_get_data(item->dbPath, item->dbKey, item->resource_id, &item->info,
+                                                   item->buffer, item->buffer_size);
+            }
+         }
+      }
+   }
+
+   for(i=0; i<numSorted; i++)
+   {
+      if(sorted[i]->result >= 0)
+      {
+         numRead++;
+      }
+   }
+
+   free(sorted);
+
+   return numRead;
+}
+
+
+
+/// value of a batch item before the batch has been written, used to roll back a failed batch
+typedef struct _PersBatchUndo_s
+{
+   /// the old value, NULL if the resource did not exist
+   unsigned char* data;
+   /// size of the old value
+   int size;
+   /// the new value has been written and must be restored on rollback
+   int written;
+} PersBatchUndo_s;
+
+
+
+/// load the plugin of a batch item if needed, returns 1 if the plugin can read, write and delete data
+static int batch_custom_plugin_available(int idx)
+{
+   int available = 0;
+
+   wait_custom_plugin_loaded(idx);
+
+   if(check_valid_idx(idx) != -1)
+   {
+      if(   (gPersCustomFuncs[idx].custom_plugin_get_data == NULL)     // plugin not loaded yet
+         && (getCustomLoadingType(idx) == LoadType_OnDemand) )
+      {
+         (void)load_custom_library(idx, &gPersCustomFuncs[idx]);
+      }
+
+      if(   (gPersCustomFuncs[idx].custom_plugin_get_data    != NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_set_data    != NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_delete_data != NULL) )
+      {
+         available = 1;
+      }
+   }
+
+   return available;
+}
+
+
+
+/**
+ * @brief keep the current value of a batch item to be able to roll back the batch,
+ *        the default values are not used, a resource without value is deleted on rollback
+ *
+ * @return 0 on success or a negative error code if the current value can't be read
+ */
+static int batch_item_stage(const PersistenceBatchItem_s* item, int handleDB, unsigned char* scratch, PersBatchUndo_s* undo)
+{
+   int rval = 0;
+   int size = -1;
+
+   if(PersistenceStorage_custom != item->info.configKey.storage)
+   {
+      size = write_cache_get(&item->info, item->dbPath, item->dbKey, scratch, (unsigned int)gMaxKeyValDataSize);
+      if(size < 0)
+      {
+         if(handleDB >= 0)
+         {
+            size = persComDbReadKey(handleDB, item->dbKey, (char*)scratch, gMaxKeyValDataSize);
+            if((size < 0) && (size != PERS_COM_ERR_NOT_FOUND))
+            {
+               rval = EPERS_DB_ERROR_INTERNAL;
+            }
+         }
+         else
+         {
+            rval = EPERS_NOPRCTABLE;
+         }
+      }
+   }
+   else if(batch_custom_plugin_available(item->info.customIdx) == 1)
+   {
+      char pathKeyString[128] = {0};
+      custom_plugin_path(&item->info, item->dbKey, pathKeyString);
+
+      // plugins don't report a missing resource in a defined way, it is deleted on rollback
+      size = gPersCustomFuncs[item->info.customIdx].custom_plugin_get_data(pathKeyString, (char*)scratch, gMaxKeyValDataSize);
+   }
+   else
+   {
+      rval = EPERS_NOPLUGINFUNCT;
+   }
+
+   undo->data    = NULL;
+   undo->size    = 0;
+   undo->written = 0;
+
+   if((rval == 0) && (size >= 0))
+   {
+      undo->data = malloc((size > 0) ? (unsigned int)size : 1);
+      if(undo->data != NULL)
+      {
+         memcpy(undo->data, scratch, (unsigned int)size);
+         undo->size = size;
+      }
+      else
+      {
+         rval = EPERS_COMMON;
+      }
+   }
+
+   return rval;
+}
+
+
+
+/// restore the value of a batch item before the batch has been written
+static void batch_item_restore(PersistenceBatchItem_s* item, const PersBatchUndo_s* undo)
+{
+   int rval = 0;
+
+   if(PersistenceStorage_custom != item->info.configKey.storage)
+   {
+      PersDbHandleEntry_s* dbEntry = NULL;
+      int handleDB = -1;
+
+      if(   (undo->data == NULL)
+         || (write_cache_set(&item->info, item->dbPath, item->dbKey, undo->data, (unsigned int)undo->size) < 0) )
+      {
+         (void)write_cache_remove(&item->info, item->dbPath, item->dbKey);
+
+         handleDB = database_get(item->dbPath, item->info.configKey.policy, &dbEntry);
+         if(handleDB >= 0)
+         {
+            if(undo->data != NULL)
+            {
+               rval = persComDbWriteKey(handleDB, item->dbKey, (char*)undo->data, undo->size);
+            }
+            else
+            {
+               rval = persComDbDeleteKey(handleDB, item->dbKey);
+               if(rval == PERS_COM_ERR_NOT_FOUND)
+               {
+                  rval = 0;
+               }
+            }
+            database_release(dbEntry);
+         }
+         else
+         {
+            rval = EPERS_NOPRCTABLE;
+         }
+      }
+   }
+   else
+   {
+      int idx = item->info.customIdx;
+      char pathKeyString[128] = {0};
+      custom_plugin_path(&item->info, item->dbKey, pathKeyString);
+
+      if(undo->data != NULL)
+      {
+         rval = gPersCustomFuncs[idx].custom_plugin_set_data(pathKeyString, (char*)undo->data, undo->size);
+      }
+      else
+      {
+         (void)gPersCustomFuncs[idx].custom_plugin_delete_data(pathKeyString);
+      }
+      custom_cache_remove(idx, pathKeyString);
+   }
+
+   if(rval < 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data_batch - rollback failed:"), DLT_STRING(item->resource_id),
+                                             DLT_INT(rval));
+   }
+}
+
+
+
+int persistence_set_data_batch(PersistenceBatchItem_s* items, unsigned int num_items)
+{
+   int numWritten = 0, failed = 0;
+   unsigned int i = 0, numSorted = 0, numSignals = 0;
+   PersistenceBatchItem_s** sorted = batch_sort_items(items, num_items, &numSorted);
+   PersBatchUndo_s* undo = calloc(num_items, sizeof(PersBatchUndo_s));
+   PersNotifySignal_s* signals = malloc(num_items * sizeof(PersNotifySignal_s));
+   unsigned char* scratch = malloc((unsigned int)gMaxKeyValDataSize);
+
+   if((sorted == NULL) || (undo == NULL) || (signals == NULL) || (scratch == NULL))
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data_batch - failed to allocate memory"));
+      free(sorted);
+      free(undo);
+      free(signals);
+      free(scratch);
+      return EPERS_COMMON;
+   }
+
+   // stage and write database by database, the first failure rolls back the entries already written
+   while((i < numSorted) && (failed == 0))
+   {
+      PersistenceBatchItem_s* first = sorted[i];
+      unsigned int groupStart = i, groupEnd = i, j = 0;
+      PersDbHandleEntry_s* dbEntry = NULL;
+      int handleDB = -1;
+
+      for( ; (groupEnd < numSorted) && batch_item_same_db(first, sorted[groupEnd]); groupEnd++)
+      {
+         ;
+      }
+
+      if(PersistenceStorage_custom != first->info.configKey.storage)
+      {
+         // one database lookup for all items stored in the same database
+         handleDB = database_get(first->dbPath, first->info.configKey.policy, &dbEntry);
+      }
+
+      for(j=groupStart; (j < groupEnd) && (failed == 0); j++)
+      {
+         sorted[j]->result = batch_item_stage(sorted[j], handleDB, scratch, &undo[j]);
+         failed = (sorted[j]->result < 0) ? 1 : 0;
+      }
+
+      if(failed == 0)
+      {
+         if(PersistenceStorage_custom != first->info.configKey.storage)
+         {
+            for(j=groupStart; (j < groupEnd) && (failed == 0); j++)
+            {
+               PersistenceBatchItem_s* item = sorted[j];
+
+               item->result = write_cache_set(&item->info, item->dbPath, item->dbKey, item->buffer, item->buffer_size);
+               if(item->result < 0)
+               {
+                  item->result = (handleDB >= 0) ? persComDbWriteKey(handleDB, item->dbKey, (char*)item->buffer, item->buffer_size)
+                                                 : EPERS_NOPRCTABLE;
+               }
+               undo[j].written = 1;   // a failed write may have changed the value as well
+
+               if(item->result < 0)
+               {
+                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data_batch - write failure"),
+                                                         DLT_STRING(item->resource_id), DLT_INT(item->result));
+                  failed = 1;
+               }
+            }
+         }
+         else
+         {
+            // custom storage, one plugin call for all items of the same plugin if the plugin supports it
+            int batchWritten = persistence_custom_data_batch(&sorted[groupStart], groupEnd - groupStart, 1);
+
+            for(j=groupStart; j < groupEnd; j++)
+            {
+               PersistenceBatchItem_s* item = sorted[j];
+
+               if((batchWritten < 0) && (failed == 0))   // plugin without batch function, accessed key by key
+               {
+                  item->result = persistence_set_custom_data(item->dbKey, &item->info, item->buffer, item->buffer_size);
+               }
+               else if(batchWritten < 0)
+               {
+                  item->result = EPERS_SETDTAFAILED;   // not written, an item before has failed
+                  continue;
+               }
+               undo[j].written = 1;
+
+               if((item->result > 0) && ((unsigned int)item->result != item->buffer_size))
+               {
+                  item->result = EPERS_SETDTAFAILED;
+               }
+               if(item->result < 0)
+               {
+                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data_batch - plugin write failure"),
+                                                         DLT_STRING(item->resource_id), DLT_INT(item->result));
+                  failed = 1;
+               }
+            }
+         }
+      }
+
+      database_release(dbEntry);
+      i = groupEnd;
+   }
+
+   if(failed == 1)
+   {
+      // roll back in reverse order, the entries of the batch keep their value before the batch
+      for(i=numSorted; i>0; i--)
       {
-         read_size = EPERS_NOPLUGINFUNCT;
+         if(undo[i-1].written == 1)
+         {
+            batch_item_restore(sorted[i-1], &undo[i-1]);
+         }
+         if(sorted[i-1]->result >= 0)
+         {
+            sorted[i-1]->result = EPERS_SETDTAFAILED;
+         }
       }
-
-      if (1 > read_size) /* Try to get default values */
+      numWritten = EPERS_SETDTAFAILED;
+   }
+   else
+   {
+      // one aggregated change notification for all written shared and custom resources of the batch
+      for(i=0; i<numSorted; i++)
       {
-         info->configKey.policy = PersistencePolicy_wc;			/* Set the policy */
-         info->configKey.type   = PersistenceResourceType_key;  /* Set the type */
+         PersistenceBatchItem_s* item = sorted[i];
 
-         (void)get_db_path_and_key(info, key, NULL, dbPath);
+         if(   PersistenceStorage_shared == item->info.configKey.storage
+            || PersistenceStorage_custom == item->info.configKey.storage)
+         {
+            signals[numSignals].ldbid   = item->info.context.ldbid;
+            signals[numSignals].user_no = item->info.context.user_no;
+            signals[numSignals].seat_no = item->info.context.seat_no;
+            signals[numSignals].reason  = pclNotifyStatus_changed;
+            snprintf(signals[numSignals].key, DbKeyMaxLen, "%s", item->resource_id);
+            numSignals++;
+         }
+      }
 
-         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("persistence_get_data - Plugin data not available - get default data of key:"), DLT_STRING(key));
-         ret_defaults = pers_get_defaults(dbPath, (char*)resourceID, info, buffer, buffer_size, PersGetDefault_Data);
-         if (0 < ret_defaults)
+      if((numSignals > 0) && (pers_send_Notification_Signal_List(signals, numSignals) <= 0))
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data_batch - failed to send notification signal"));
+         for(i=0; i<numSorted; i++)
          {
-        	   read_size = ret_defaults;
+            if(   PersistenceStorage_shared == sorted[i]->info.configKey.storage
+               || PersistenceStorage_custom == sorted[i]->info.configKey.storage)
+            {
+               sorted[i]->result = EPERS_NOTIFY_SIG;
+            }
+         }
+      }
+
+      for(i=0; i<numSorted; i++)
+      {
+         if(sorted[i]->result >= 0)
+         {
+            numWritten++;
          }
       }
    }
-   return read_size;
+
+   for(i=0; i<numSorted; i++)
+   {
+      free(undo[i].data);
+   }
+   free(sorted);
+   free(undo);
+   free(signals);
+   free(scratch);
+
+   return numWritten;
 }
 
 
@@ -350,114 +1742,207 @@ int persistence_set_data(char* dbPath, char* key, const char* resource_id, Persi
       || PersistenceStorage_shared == info->configKey.storage )
    {
       int handleDB = -1 ;
+      PersDbHandleEntry_s* dbEntry = NULL;
 
-
-      handleDB = database_get(info, dbPath, info->configKey.policy);
-      if(handleDB >= 0)
+      // local write cached data is written back later by the write-behind cache (if enabled)
+      write_size = write_cache_set(info, dbPath, key, buffer, buffer_size);
+      if(write_size < 0)
       {
-         write_size = persComDbWriteKey(handleDB, key, (char*)buffer, buffer_size) ;
-         if(write_size < 0)
-         {
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - persComDbWriteKey() failure"));
-         }
-         else
+         handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
+         if(handleDB >= 0)
          {
-            if(PersistenceStorage_shared == info->configKey.storage)
+            write_size = persComDbWriteKey(handleDB, key, (char*)buffer, buffer_size) ;
+            database_release(dbEntry);
+            if(write_size < 0)
             {
-               int rval = pers_send_Notification_Signal(resource_id, &info->context, pclNotifyStatus_changed);
-               if(rval <= 0)
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - persComDbWriteKey() failure"));
+            }
+            else
+            {
+               if(PersistenceStorage_shared == info->configKey.storage)
                {
-                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - failed to send notification signal"));
-                  write_size = rval;
+                  int rval = pers_send_Notification_Signal(resource_id, &info->context, pclNotifyStatus_changed);
+                  if(rval <= 0)
+                  {
+                     DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - failed to send notification signal"));
+                     write_size = rval;
+                  }
                }
             }
-         }
 
+         }
+         else
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - no resource config table"), DLT_STRING(dbPath), DLT_STRING(key));
+            write_size = EPERS_NOPRCTABLE;
+         }
       }
-      else
+   }
+   else if(PersistenceStorage_custom == info->configKey.storage)   // custom storage implementation via custom library
+   {
+      write_size = persistence_set_custom_data(key, info, buffer, buffer_size);
+
+      if ((0 < write_size) && ((unsigned int)write_size == buffer_size)) /* Check return value and send notification if OK */
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - no resource config table"), DLT_STRING(dbPath), DLT_STRING(key));
-         write_size = EPERS_NOPRCTABLE;
+         int rval = pers_send_Notification_Signal(resource_id, &info->context, pclNotifyStatus_changed);
+         if(rval <= 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - failed to send notification signal"));
+            write_size = rval;
+         }
       }
    }
-   else if(PersistenceStorage_custom == info->configKey.storage)   // custom storage implementation via custom library
+   return write_size;
+}
+
+
+
+/// load an on demand plugin if needed, returns 1 if the plugin provides the handle functions
+static int custom_plugin_handle_available(int idx)
+{
+   int available = 0;
+
+   if(check_valid_idx(idx) != -1)
    {
-   	int available = 0;
-      int idx = custom_client_name_to_id(dbPath, 1);
-      if(idx < PersCustomLib_LastEntry )
+      if(   (gPersCustomFuncs[idx].custom_plugin_handle_open == NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_get_data == NULL)      // plugin not loaded yet
+         && (getCustomLoadingType(idx) == LoadType_OnDemand) )
       {
-      	if(gPersCustomFuncs[idx].custom_plugin_set_data == NULL)
-      	{
-				if (getCustomLoadingType(idx) == LoadType_OnDemand)
-				{
-					// plugin not loaded, try to load the requested plugin
-					if(load_custom_library(idx, &gPersCustomFuncs[idx]) == 1)
-					{
-						// check again if the plugin function is now available
-						if(gPersCustomFuncs[idx].custom_plugin_set_data != NULL)
-						{
-							available = 1;
-						}
-					}
-				}
-				else if(getCustomLoadingType(idx) == LoadType_PclInit)
-				{
-					if(gPersCustomFuncs[idx].custom_plugin_set_data != NULL)
-					{
-						available = 1;
-					}
-				}
-				else
-				{
-					 DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("persistence_set_data - Plugin not available, unknown loading type: "),
-					                                       DLT_INT(getCustomLoadingType(idx)));
-					 write_size = EPERS_COMMON;
-				}
-			}
-      	else
-      	{
-      		available = 1;	// already loaded
-      	}
+         (void)load_custom_library(idx, &gPersCustomFuncs[idx]);
+      }
 
-      	if(available == 1)
-      	{
-				char pathKeyString[128] = {0};
-				if(info->configKey.customID[0] == '\0')   // if we have not a customID we use the key
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s/%s", info->context.ldbid, info->configKey.custom_name, key);
-				}
-				else
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s", info->context.ldbid, info->configKey.customID);
-				}
-				write_size = gPersCustomFuncs[idx].custom_plugin_set_data(pathKeyString, (char*)buffer, buffer_size);
-				//write_size = persComDbWriteKey(handleDB, key, (char*)buffer, buffer_size) ;
+      if(   (gPersCustomFuncs[idx].custom_plugin_handle_open     != NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_handle_get_data != NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_handle_set_data != NULL)
+         && (gPersCustomFuncs[idx].custom_plugin_handle_close    != NULL) )
+      {
+         available = 1;
+      }
+   }
 
-				if ((0 < write_size) && ((unsigned int)write_size == buffer_size)) /* Check return value and send notification if OK */
-				{
-					int rval = pers_send_Notification_Signal(resource_id, &info->context, pclNotifyStatus_changed);
-					if(rval <= 0)
-					{
-						DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_set_data - failed to send notification signal"));
-						write_size = rval;
-					}
-				}
-      	}
-      	else
-      	{
-      		write_size = EPERS_NOPLUGINFUNCT;
-      	}
+   return available;
+}
+
+
+
+int persistence_custom_handle_open(char* key, PersistenceInfo_s* info, int* customIdx, unsigned int* generation, char pathKeyString[128])
+{
+   int customHandle = EPERS_NOPLUGINFUNCT;
+   int idx = info->customIdx;
+   wait_custom_plugin_loaded(idx);
+
+   if(custom_plugin_handle_available(idx) == 1)
+   {
+      int flag = O_RDWR;
+
+      custom_plugin_path(info, key, pathKeyString);
+      *generation = custom_plugin_generation(idx);
+
+      if(info->configKey.permission == PersistencePermission_ReadOnly)
+      {
+         flag = O_RDONLY;
+      }
+      else if(info->configKey.permission == PersistencePermission_WriteOnly)
+      {
+         flag = O_WRONLY;
+      }
+
+      customHandle = gPersCustomFuncs[idx].custom_plugin_handle_open(pathKeyString, flag, 0);
+      if(customHandle >= 0)
+      {
+         *customIdx = idx;
       }
       else
       {
-         write_size = EPERS_NOPLUGINFUNCT;
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("persistence_custom_handle_open - plugin open failed:"), DLT_STRING(pathKeyString),
+                                               DLT_INT(customHandle));
+      }
+   }
+
+   return customHandle;
+}
+
+
+
+/// check if a plugin handle belongs to the loaded plugin instance, the plugin may have been unloaded or reloaded in the meantime
+static int custom_handle_valid(int customIdx, unsigned int generation)
+{
+   return (   (check_valid_idx(customIdx) != -1)
+           && (custom_plugin_generation(customIdx) == generation) ) ? 1 : 0;
+}
+
+
+
+int persistence_custom_handle_get_data(int customIdx, int customHandle, unsigned int generation,
+                                       unsigned char* buffer, unsigned int buffer_size)
+{
+   int read_size = EPERS_NOPLUGINFUNCT;
+
+   if((custom_handle_valid(customIdx, generation) == 1) && (gPersCustomFuncs[customIdx].custom_plugin_handle_get_data != NULL))
+   {
+      read_size = gPersCustomFuncs[customIdx].custom_plugin_handle_get_data(customHandle, (char*)buffer, buffer_size);
+   }
+
+   return read_size;
+}
+
+
+
+int persistence_custom_handle_set_data(int customIdx, int customHandle, unsigned int generation, const char* path,
+                                       const char* resource_id, PersistenceInfo_s* info,
+                                       unsigned char* buffer, unsigned int buffer_size)
+{
+   int write_size = EPERS_NOPLUGINFUNCT;
+
+   if((custom_handle_valid(customIdx, generation) == 1) && (gPersCustomFuncs[customIdx].custom_plugin_handle_set_data != NULL))
+   {
+      write_size = gPersCustomFuncs[customIdx].custom_plugin_handle_set_data(customHandle, (char*)buffer, buffer_size);
+      custom_cache_remove(customIdx, path);
+
+      if ((0 < write_size) && ((unsigned int)write_size == buffer_size)) /* Check return value and send notification if OK */
+      {
+         int rval = pers_send_Notification_Signal(resource_id, &info->context, pclNotifyStatus_changed);
+         if(rval <= 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_custom_handle_set_data - failed to send notification signal"));
+            write_size = rval;
+         }
       }
    }
+
    return write_size;
 }
 
 
 
+int persistence_custom_handle_get_size(int customIdx, int customHandle, unsigned int generation)
+{
+   int size = EPERS_NOPLUGINFUNCT;
+
+   if((custom_handle_valid(customIdx, generation) == 1) && (gPersCustomFuncs[customIdx].custom_plugin_handle_get_size != NULL))
+   {
+      size = gPersCustomFuncs[customIdx].custom_plugin_handle_get_size(customHandle);
+   }
+
+   return size;
+}
+
+
+
+int persistence_custom_handle_close(int customIdx, int customHandle, unsigned int generation)
+{
+   int rval = EPERS_NOPLUGINFUNCT;
+
+   if((custom_handle_valid(customIdx, generation) == 1) && (gPersCustomFuncs[customIdx].custom_plugin_handle_close != NULL))
+   {
+      rval = gPersCustomFuncs[customIdx].custom_plugin_handle_close(customHandle);
+   }
+
+   return rval;
+}
+
+
+
 int persistence_get_data_size(char* dbPath, char* key, const char* resourceID, PersistenceInfo_s* info)
 {
    int read_size = -1;
@@ -466,22 +1951,28 @@ int persistence_get_data_size(char* dbPath, char* key, const char* resourceID, P
    if(   PersistenceStorage_shared == info->configKey.storage
       || PersistenceStorage_local == info->configKey.storage)
    {
-      int handleDB = database_get(info, dbPath, info->configKey.policy);
-      if(handleDB >= 0)
+      read_size = write_cache_get(info, dbPath, key, NULL, 0);
+      if(read_size < 0)
       {
-
-         read_size = persComDbGetKeySize(handleDB, key);
-         if(read_size < 0)
+         PersDbHandleEntry_s* dbEntry = NULL;
+         int handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
+         if(handleDB >= 0)
          {
-            read_size = pers_get_defaults( dbPath, (char*)resourceID, info, NULL, 0, PersGetDefault_Size);
+            read_size = persComDbGetKeySize(handleDB, key);
+            database_release(dbEntry);
+            if(read_size < 0)
+            {
+               read_size = pers_get_defaults( dbPath, (char*)resourceID, info, NULL, 0, PersGetDefault_Size);
+            }
          }
       }
    }
    else if(PersistenceStorage_custom == info->configKey.storage)   // custom storage implementation via custom library
    {
    	int available = 0;
-      int idx = custom_client_name_to_id(dbPath, 1);
-      if(idx < PersCustomLib_LastEntry )
+      int idx = info->customIdx;
+      wait_custom_plugin_loaded(idx);
+      if(check_valid_idx(idx) != -1)
       {
       	if(gPersCustomFuncs[idx].custom_plugin_get_size == NULL )
       	{
@@ -519,15 +2010,15 @@ int persistence_get_data_size(char* dbPath, char* key, const char* resourceID, P
       	if(available == 1)
       	{
       		char pathKeyString[128] = {0};
-				if(info->configKey.customID[0] == '\0')   // if we have not a customID we use the key
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s/%s", info->context.ldbid, info->configKey.custom_name, key);
-				}
-				else
+				custom_plugin_path(info, key, pathKeyString);
+
+				read_size = custom_cache_get_size(idx, pathKeyString);
+				if(read_size < 0)
 				{
-					snprintf(pathKeyString, 128, "0x%08X/%s", info->context.ldbid, info->configKey.customID);
+					unsigned int generation = custom_cache_generation(idx);
+					read_size = gPersCustomFuncs[idx].custom_plugin_get_size(pathKeyString);
+					custom_cache_add_size(idx, pathKeyString, generation, read_size);
 				}
-				read_size = gPersCustomFuncs[idx].custom_plugin_get_size(pathKeyString);
       	}
       	else
       	{
@@ -563,10 +2054,18 @@ int persistence_delete_data(char* dbPath, char* key, const char* resource_id, Pe
    int ret = 0;
    if(PersistenceStorage_custom != info->configKey.storage)
    {
-      int handleDB = database_get(info, dbPath, info->configKey.policy);
+      int cached = write_cache_remove(info, dbPath, key);
+      PersDbHandleEntry_s* dbEntry = NULL;
+      int handleDB = database_get(dbPath, info->configKey.policy, &dbEntry);
       if(handleDB >= 0)
       {
          ret = persComDbDeleteKey(handleDB, key) ;
+         database_release(dbEntry);
+         if((ret == PERS_COM_ERR_NOT_FOUND) && (cached == 1))
+         {
+            ret = 0;    // the key has only been in the write-behind cache so far
+         }
+
          if(ret < 0)
          {
             DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_delete_data - failed: "), DLT_STRING(key));
@@ -594,8 +2093,9 @@ int persistence_delete_data(char* dbPath, char* key, const char* resource_id, Pe
    else   // custom storage implementation via custom library
    {
    	int available = 0;
-      int idx = custom_client_name_to_id(dbPath, 1);
-      if(idx < PersCustomLib_LastEntry)
+      int idx = info->customIdx;
+      wait_custom_plugin_loaded(idx);
+      if(check_valid_idx(idx) != -1)
       {
       	if(gPersCustomFuncs[idx].custom_plugin_delete_data == NULL )
 			{
@@ -633,15 +2133,10 @@ int persistence_delete_data(char* dbPath, char* key, const char* resource_id, Pe
       	if(available == 1)
       	{
 				char pathKeyString[128] = {0};
-				if(info->configKey.customID[0] == '\0')   // if we have not a customID we use the key
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s/%s", info->context.ldbid, info->configKey.custom_name, key);
-				}
-				else
-				{
-					snprintf(pathKeyString, 128, "0x%08X/%s", info->context.ldbid, info->configKey.customID);
-				}
+				custom_plugin_path(info, key, pathKeyString);
+
 				ret = gPersCustomFuncs[idx].custom_plugin_delete_data(pathKeyString);
+				custom_cache_remove(idx, pathKeyString);
 
 				if(0 <= ret) /* Check return value and send notification if OK */
 				{
@@ -682,18 +2177,25 @@ int persistence_notify_on_change(const char* key, unsigned int ldbid, unsigned i
       if(regPolicy == Notify_register)
       {
          // assign callback
-         gChangeNotifyCallback = callback;
+         rval = notify_exec_register(ldbid, key, user_no, seat_no, callback);
       }
       else if(regPolicy == Notify_unregister)
       {
          // remove callback
-         gChangeNotifyCallback = NULL;
+         notify_exec_unregister(ldbid, key, user_no, seat_no);
       }
 
-      if(-1 == deliverToMainloop(&data))
+      if(rval == 0)
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_notify_on_change - failed to write to pipe"), DLT_INT(errno));
-         rval = -1;
+         if(-1 == deliverToMainloop(&data))
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_notify_on_change - failed to write to pipe"), DLT_INT(errno));
+            if(regPolicy == Notify_register)
+            {
+               notify_exec_unregister(ldbid, key, user_no, seat_no);
+            }
+            rval = -1;
+         }
       }
    }
    else
@@ -706,6 +2208,82 @@ int persistence_notify_on_change(const char* key, unsigned int ldbid, unsigned i
 
 
 
+int persistence_notify_on_change_list(pclNotifyRegEntry_s* entries, unsigned int num_entries, PersNotifyRegPolicy_e regPolicy)
+{
+   int rval = EPERS_COMMON;
+   PersNotifySignal_s* regs = NULL;
+
+   if((regPolicy < Notify_lastEntry) && (NULL != (regs = malloc(num_entries * sizeof(PersNotifySignal_s)))))
+   {
+      unsigned int i = 0, numRegs = 0;
+
+      for(i=0; i<num_entries; i++)
+      {
+         if(entries[i].result == 0)
+         {
+            if(regPolicy == Notify_register)
+            {
+               entries[i].result = notify_exec_register(entries[i].ldbid, entries[i].resource_id, entries[i].user_no,
+                                                        entries[i].seat_no, entries[i].callback);
+            }
+            else
+            {
+               notify_exec_unregister(entries[i].ldbid, entries[i].resource_id, entries[i].user_no, entries[i].seat_no);
+            }
+         }
+
+         if(entries[i].result == 0)
+         {
+            regs[numRegs].ldbid   = entries[i].ldbid;
+            regs[numRegs].user_no = entries[i].user_no;
+            regs[numRegs].seat_no = entries[i].seat_no;
+            regs[numRegs].reason  = regPolicy;
+            snprintf(regs[numRegs].key, DbKeyMaxLen, "%s", entries[i].resource_id);
+            numRegs++;
+         }
+      }
+
+      if(numRegs > 0)
+      {
+         MainLoopData_u data;
+
+         data.list.cmd        = (uint32_t)CMD_REG_NOTIFY_SIGNAL_LIST;
+         data.list.numEntries = numRegs;
+         data.list.entries    = regs;
+
+         // blocking delivery, the list is accessed by the mainloop
+         if(-1 == deliverToMainloop(&data))
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_notify_on_change_list - failed to write to pipe"), DLT_INT(errno));
+
+            for(i=0; i<num_entries; i++)
+            {
+               if(entries[i].result == 0)
+               {
+                  if(regPolicy == Notify_register)
+                  {
+                     notify_exec_unregister(entries[i].ldbid, entries[i].resource_id, entries[i].user_no, entries[i].seat_no);
+                  }
+                  entries[i].result = EPERS_COMMON;
+               }
+            }
+            numRegs = 0;
+         }
+      }
+
+      free(regs);
+      rval = (int)numRegs;
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("persistence_notify_on_change_list - invalid policy or no memory"));
+   }
+
+   return rval;
+}
+
+
+
 
 
 
@@ -724,9 +2302,10 @@ int pers_send_Notification_Signal(const char* key, PersistenceDbContext_s* conte
 
    	snprintf(data.message.string, DbKeyMaxLen, "%s", key);
 
-      if(-1 == deliverToMainloop(&data) )
+      // fire and forget, the command is copied into the command queue of the mainloop
+      if(-1 == deliverToMainloop_NM(&data) )
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_send_Notification_Signal - failed to write to pipe"), DLT_INT(errno));
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_send_Notification_Signal - failed to queue signal"), DLT_INT(errno));
          rval = EPERS_NOTIFY_SIG;
       }
    }
@@ -739,6 +2318,27 @@ int pers_send_Notification_Signal(const char* key, PersistenceDbContext_s* conte
 }
 
 
+
+int pers_send_Notification_Signal_List(PersNotifySignal_s* signals, unsigned int numSignals)
+{
+   int rval = 1;
+   MainLoopData_u data;
+
+   data.list.cmd        = (uint32_t)CMD_SEND_NOTIFY_SIGNAL_LIST;
+   data.list.numEntries = numSignals;
+   data.list.entries    = signals;
+
+   // blocking delivery, the list is accessed by the mainloop
+   if(-1 == deliverToMainloop(&data) )
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pers_send_Notification_Signal_List - failed to write to pipe"), DLT_INT(errno));
+      rval = EPERS_NOTIFY_SIG;
+   }
+
+   return rval;
+}
+
+
 void pers_rct_close_all()
 {
    int i = 0;
@@ -756,5 +2356,12 @@ void pers_rct_close_all()
 			invalidate_resource_cfg_table(i);
    	}
    }
+
+   close_retired_resource_cfg_tables();
+   rct_index_destroy_all();
+   rct_hash_unload_all();
+
+   // resolved contexts are only valid as long as the tables are open
+   invalidate_db_context_cache();
 }
 
@@ -28,6 +28,7 @@ extern "C" {
 
 
 #include "persistence_client_library_data_organization.h"
+#include "persistence_client_library_dbus_service.h"
 
 //#include "persistence_client_library_rc_table.h"
 #include <persComRct.h>
@@ -49,6 +50,26 @@ typedef enum PersistenceDB_e_
 } PersistenceDefaultDB_e;
 
 
+/// resolved entry of a multi key batch
+typedef struct _PersistenceBatchItem_s
+{
+   /// persistence information
+   PersistenceInfo_s info;
+   /// the database key
+   char dbKey[DbKeyMaxLen];
+   /// the database path
+   char dbPath[DbPathMaxLen];
+   /// the resource id
+   const char* resource_id;
+   /// the data buffer
+   unsigned char* buffer;
+   /// size of the data buffer
+   unsigned int buffer_size;
+   /// result of the operation: number of bytes or a negative error code
+   int result;
+} PersistenceBatchItem_s;
+
+
 /**
  * @brief get the raw key without prefixed '/node/', '/user/3/' etc
  *
@@ -90,6 +111,37 @@ int pers_db_open_default(const char* dbPath, PersDefaultType_e DefaultType);
 int pers_get_defaults(char* dbPath, char* key, PersistenceInfo_s* info, unsigned char* buffer, unsigned int buffer_size, PersGetDefault_e job);
 
 
+/**
+ * @brief tries to get the default data of a key from the configurable and factory default databases,
+ *        the buffer is allocated or grown as needed. The default databases are looked up only once.
+ *
+ * @param dbPath the path to the directory where the default databases are in
+ * @param key the database key
+ * @param info the persistence context information
+ * @param buffer pointer to the buffer, may point to NULL or to a buffer allocated with malloc
+ * @param buffer_size the size of the buffer, returns the new size if the buffer has been grown
+ *
+ * @return the number of bytes read or a negative value if an error occured with the following error codes:
+ *         EPERS_NOKEY, EPERS_COMMON
+ */
+int pers_get_defaults_alloc(char* dbPath, char* key, PersistenceInfo_s* info, unsigned char** buffer, unsigned int* buffer_size);
+
+
+
+/**
+ * @brief write data directly to the database of a key (no notification, no write-behind cache)
+ *
+ * @param info persistence information
+ * @param dbPath the path to the database where the key is in
+ * @param key the database key
+ * @param buffer the buffer holding the data
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes written or a negative value on error
+ */
+int database_write_key(PersistenceInfo_s* info, const char* dbPath, const char* key, unsigned char* buffer, unsigned int buffer_size);
+
+
 
 /**
  * @brief write data to a key
@@ -125,6 +177,54 @@ int persistence_get_data(char* dbPath, char* key, const char* resourceID, Persis
 
 
 
+/**
+ * @brief get data of several keys; the items are grouped by database, so
+ *        each database is looked up only once per batch.
+ *        Only items with result 0 (context resolved successfully) are processed.
+ *
+ * @param items the resolved batch items, the result of each item is stored in the item
+ * @param num_items number of items
+ *
+ * @return the number of items read successfully or EPERS_COMMON if the batch could not be processed
+ */
+int persistence_get_data_batch(PersistenceBatchItem_s* items, unsigned int num_items);
+
+
+
+/**
+ * @brief get data of a key, the buffer is allocated or grown as needed.
+ *        The database is looked up only once, no separate size request is needed.
+ *
+ * @param dbPath the path to the database where the key is in
+ * @param key the database key
+ * @param resourceID the resource identifier
+ * @param info persistence information
+ * @param buffer pointer to the buffer, may point to NULL or to a buffer allocated with malloc
+ * @param buffer_size the size of the buffer, returns the new size if the buffer has been grown
+ *
+ * @return the number of bytes read or a negative value if an error occured with the following error codes:
+ *   EPERS_COMMON, EPERS_NOKEY, EPERS_NOPLUGINFUNCT
+ */
+int persistence_get_data_alloc(char* dbPath, char* key, const char* resourceID, PersistenceInfo_s* info,
+                               unsigned char** buffer, unsigned int* buffer_size);
+
+
+
+/**
+ * @brief write data of several keys; the items are grouped by database, so
+ *        each database is looked up only once per batch. The change notifications
+ *        of all written shared and custom resources are delivered to the mainloop at once.
+ *        Only items with result 0 (context resolved successfully) are processed.
+ *
+ * @param items the resolved batch items, the result of each item is stored in the item
+ * @param num_items number of items
+ *
+ * @return the number of items written successfully or EPERS_COMMON if the batch could not be processed
+ */
+int persistence_set_data_batch(PersistenceBatchItem_s* items, unsigned int num_items);
+
+
+
 /**
  * @brief get the size of the data from a given key
  *
@@ -140,6 +240,89 @@ int persistence_get_data_size(char* dbPath, char* key, const char* resourceID, P
 
 
 
+/**
+ * @brief open the plugin handle of a custom storage resource.
+ *        The plugin path is created once, the handle is used by the
+ *        persistence_custom_handle_* functions.
+ *
+ * @param key the database key
+ * @param info persistence information
+ * @param customIdx returns the plugin index
+ * @param generation returns the generation of the plugin instance which opened the handle
+ * @param pathKeyString returns the plugin path of the resource
+ *
+ * @return the plugin handle (0 or greater) or a negative value if the plugin
+ *         does not provide the handle functions (EPERS_NOPLUGINFUNCT) or the open failed
+ */
+int persistence_custom_handle_open(char* key, PersistenceInfo_s* info, int* customIdx, unsigned int* generation, char pathKeyString[128]);
+
+
+
+/**
+ * @brief get data of a custom storage resource via the plugin handle
+ *
+ * @param customIdx the plugin index
+ * @param customHandle the plugin handle
+ * @param generation the generation of the plugin instance which opened the handle
+ * @param buffer the buffer for the data
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes read or a negative value if an error occured,
+ *         EPERS_NOPLUGINFUNCT if the plugin has been unloaded or reloaded since the handle has been opened
+ */
+int persistence_custom_handle_get_data(int customIdx, int customHandle, unsigned int generation,
+                                       unsigned char* buffer, unsigned int buffer_size);
+
+
+
+/**
+ * @brief set data of a custom storage resource via the plugin handle, a change notification is sent
+ *
+ * @param customIdx the plugin index
+ * @param customHandle the plugin handle
+ * @param generation the generation of the plugin instance which opened the handle
+ * @param path the plugin path of the resource, its cached data is dropped
+ * @param resource_id the resource identifier
+ * @param info persistence information
+ * @param buffer the data to write
+ * @param buffer_size the number of bytes to write
+ *
+ * @return the number of bytes written or a negative value if an error occured,
+ *         EPERS_NOPLUGINFUNCT if the plugin has been unloaded or reloaded since the handle has been opened
+ */
+int persistence_custom_handle_set_data(int customIdx, int customHandle, unsigned int generation, const char* path,
+                                       const char* resource_id, PersistenceInfo_s* info,
+                                       unsigned char* buffer, unsigned int buffer_size);
+
+
+
+/**
+ * @brief get the data size of a custom storage resource via the plugin handle
+ *
+ * @param customIdx the plugin index
+ * @param customHandle the plugin handle
+ * @param generation the generation of the plugin instance which opened the handle
+ *
+ * @return the size of the data or EPERS_NOPLUGINFUNCT if the plugin does not provide the function
+ *         or the plugin has been unloaded or reloaded since the handle has been opened
+ */
+int persistence_custom_handle_get_size(int customIdx, int customHandle, unsigned int generation);
+
+
+
+/**
+ * @brief close the plugin handle of a custom storage resource
+ *
+ * @param customIdx the plugin index
+ * @param customHandle the plugin handle
+ * @param generation the generation of the plugin instance which opened the handle
+ *
+ * @return the return value of the plugin or EPERS_NOPLUGINFUNCT
+ */
+int persistence_custom_handle_close(int customIdx, int customHandle, unsigned int generation);
+
+
+
 /**
  * @brief delete data
  *
@@ -164,8 +347,23 @@ int persistence_delete_data(char* dbPath, char* key, const char* resource_id, Pe
 
 
 
+/**
+ * @brief get the statistics of the database handle table
+ *
+ * @param numOpen number of currently open databases
+ * @param openCount number of databases opened since the last ::database_close_all
+ * @param evictCount number of databases closed to stay below the max number of open databases
+ *                   (environment variable PERS_CLIENT_MAX_OPEN_DB)
+ */
+void get_database_handle_stats(unsigned int* numOpen, unsigned int* openCount, unsigned int* evictCount);
+
+
+
 /**
  * @brief close all databases
+ *
+ * @note databases still in use by other threads are closed after they have been released,
+ *       the function returns when all databases are closed
  */
 void database_close_all();
 
@@ -181,13 +379,29 @@ void database_close_all();
  * @param callback the function callback to be called
  * @param regPolicy ::Notify_register to register; ::Notify_unregister to unregister
  *
- * @return 0 of registration was successful; -1 if registration fails
+ * @return 0 of registration was successful; -1 if registration fails;
+ *         ::EPERS_NOTIFY_NOT_ALLOWED if a different callback is registered for the key
  */
 int persistence_notify_on_change(const char* key, unsigned int ldbid, unsigned int user_no, unsigned int seat_no,
                                      pclChangeNotifyCallback_t callback, PersNotifyRegPolicy_e regPolicy);
 
 
 
+/**
+ * @brief register or unregister for change notifications of a list of keys
+ *        with one request to the dbus mainloop
+ *
+ * @param entries the registrations, only entries with a result of 0 are registered;
+ *        the result of each entry is set to 0 on success or a negative error code
+ * @param num_entries the number of entries
+ * @param regPolicy ::Notify_register to register; ::Notify_unregister to unregister
+ *
+ * @return the number of entries registered successfully or ::EPERS_COMMON
+ */
+int persistence_notify_on_change_list(pclNotifyRegEntry_s* entries, unsigned int num_entries, PersNotifyRegPolicy_e regPolicy);
+
+
+
 /**
  * @brief send a notification signal
  *
@@ -200,6 +414,18 @@ int persistence_notify_on_change(const char* key, unsigned int ldbid, unsigned i
 int pers_send_Notification_Signal(const char* key, PersistenceDbContext_s* context, pclNotifyStatus_e reason);
 
 
+
+/**
+ * @brief send a list of notification signals with one mainloop command
+ *
+ * @param signals the notification signals
+ * @param numSignals the number of notification signals
+ *
+ * @return 1 if the signals have been delivered to the mainloop; EPERS_NOTIFY_SIG on error
+ */
+int pers_send_Notification_Signal_List(PersNotifySignal_s* signals, unsigned int numSignals);
+
+
 /**
  * @brief close all open persistence resource configuration tables
  */
@@ -18,6 +18,10 @@
 
 #include <errno.h>
 #include <dlfcn.h>																/* For dlclose() */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "persistence_client_library_dbus_cmd.h"
 
 #include "persistence_client_library_handle.h"
@@ -26,6 +30,8 @@
 #include "persistence_client_library_pas_interface.h"
 #include "persistence_client_library_data_organization.h"
 #include "persistence_client_library_db_access.h"
+#include "persistence_client_library_write_cache.h"
+#include "crc32.h"
 
 #if USE_FILECACHE
    #include <persistence_file_cache.h>
@@ -45,51 +51,254 @@
 void msg_pending_func(DBusPendingCall *call, void *data);
 
 
+/// coalesced change notification signal waiting to be sent
+typedef struct _PersNotifyPending_s
+{
+   /// time the signal is sent [ms]
+   unsigned int due;
+   /// hash value of the key
+   unsigned int hash;
+   /// the signal, the reason is the reason of the latest event
+   PersNotifySignal_s signal;
+} PersNotifyPending_s;
+
+
+/// coalescing window of change notification signals [ms], 0 if disabled
+static unsigned int gNotifyWindow = 0;
+/// timer to send the coalesced signals, -1 if coalescing is disabled
+static int gNotifyTimerFd = -1;
+/// pending signals, ordered by the time of the first event
+static PersNotifyPending_s gNotifyPending[NotifyPendingMaxEntries];
+/// number of pending signals
+static unsigned int gNumNotifyPending = 0;
+/// number of events merged into a pending signal
+static unsigned int gNumNotifyCoalesced = 0;
+
+/// send the change notifications as one batched signal per mainloop cycle (1) or as single signals (0)
+static int gNotifyBatchEnabled = 0;
+/// notifications of the current batch
+static PersNotifySignal_s gNotifyBatch[NotifyBatchMaxEntries];
+/// number of notifications of the current batch
+static unsigned int gNumNotifyBatch = 0;
+
+
+/// registered change notification
+typedef struct _PersNotifyReg_s
+{
+   /// next entry in the hash bucket
+   struct _PersNotifyReg_s* next;
+   /// hash value of the key
+   unsigned int hash;
+   /// number of registrations
+   unsigned int count;
+   /// logical database id
+   unsigned int ldbid;
+   /// user number
+   unsigned int user_no;
+   /// seat number
+   unsigned int seat_no;
+   /// the resource id
+   char key[DbKeyMaxLen];
+} PersNotifyReg_s;
+
+/// registered change notifications, used to filter batched signals (only accessed by the mainloop)
+static PersNotifyReg_s* gNotifyReg[NotifyRegHashSize] = {NULL};
+/// number of registered change notifications
+static unsigned int gNumNotifyReg = 0;
+/// match rule for batched signals, added while change notifications are registered
+static const char* gBatchMatchRule = "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResBatch',path='/org/genivi/persistence/adminconsumer'";
+/// match rule for all notification signals, used instead of the per key match rules if the signals are filtered locally
+static const char* gAllNotifyMatchRule = "type='signal',interface='org.genivi.persistence.adminconsumer',path='/org/genivi/persistence/adminconsumer'";
+/// filter the notification signals locally with one match rule (1) or by the bus daemon with match rules per key (0)
+static int gNotifyLocalFilter = 0;
+
+
+
+/// find a registered change notification, returns the address of the link to the entry
+static PersNotifyReg_s** notify_reg_find(unsigned int hash, unsigned int ldbid, unsigned int user_no,
+                                         unsigned int seat_no, const char* key)
+{
+   PersNotifyReg_s** pEntry = &gNotifyReg[hash & (NotifyRegHashSize-1)];
+
+   while(   (*pEntry != NULL)
+         && (   ((*pEntry)->hash != hash)
+             || ((*pEntry)->ldbid != ldbid)
+             || ((*pEntry)->user_no != user_no)
+             || ((*pEntry)->seat_no != seat_no)
+             || (strncmp((*pEntry)->key, key, DbKeyMaxLen) != 0) ) )
+   {
+      pEntry = &(*pEntry)->next;
+   }
 
-void process_reg_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
-                                                           unsigned int notifySeatNo, unsigned int notifyPolicy, const char* notifyKey)
+   return pEntry;
+}
+
+
+
+/// add or remove a change notification to the registered notifications
+static void notify_reg_update(DBusConnection* conn, unsigned int ldbid, unsigned int user_no,
+                              unsigned int seat_no, unsigned int policy, const char* key)
 {
-   char ruleChanged[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
-   char ruleDeleted[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
-   char ruleCreated[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
+   unsigned int hash = pclCrc32(0, (const unsigned char*)key, strnlen(key, DbKeyMaxLen));
+   PersNotifyReg_s** pEntry = notify_reg_find(hash, ldbid, user_no, seat_no, key);
+   unsigned int numReg = gNumNotifyReg;
+
+   if(policy == Notify_register)
+   {
+      if(*pEntry != NULL)
+      {
+         (*pEntry)->count++;
+      }
+      else
+      {
+         PersNotifyReg_s* entry = calloc(1, sizeof(PersNotifyReg_s));
+         if(entry != NULL)
+         {
+            entry->hash    = hash;
+            entry->count   = 1;
+            entry->ldbid   = ldbid;
+            entry->user_no = user_no;
+            entry->seat_no = seat_no;
+            snprintf(entry->key, DbKeyMaxLen, "%s", key);
+            *pEntry = entry;
+            gNumNotifyReg++;
+         }
+      }
+   }
+   else if((policy == Notify_unregister) && (*pEntry != NULL))
+   {
+      if(--(*pEntry)->count == 0)
+      {
+         PersNotifyReg_s* entry = *pEntry;
+         *pEntry = entry->next;
+         free(entry);
+         gNumNotifyReg--;
+      }
+   }
 
-   // add match for  c h a n g e
-   snprintf(ruleChanged, DbusMatchRuleSize,
-            "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResChange',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
-            notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+   // one match rule for the batched signals (or all signals if filtered locally) of all registered notifications
+   if((numReg == 0) && (gNumNotifyReg > 0))
+   {
+      dbus_bus_add_match(conn, (gNotifyLocalFilter == 1) ? gAllNotifyMatchRule : gBatchMatchRule, NULL);
+   }
+   else if((numReg > 0) && (gNumNotifyReg == 0))
+   {
+      dbus_bus_remove_match(conn, (gNotifyLocalFilter == 1) ? gAllNotifyMatchRule : gBatchMatchRule, NULL);
+   }
+}
+
+
+
+void process_notify_filter_init(void)
+{
+   int i = 0;
+   const char* pFilter = getenv("PERS_CLIENT_NOTIFY_LOCAL_FILTER");
 
-   // add match for  d e l e t e
-   snprintf(ruleDeleted, DbusMatchRuleSize,
-            "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResDelete',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
-            notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+   // the match rules of the registered notifications belong to the previous connection
+   for(i=0; i<NotifyRegHashSize; i++)
+   {
+      while(gNotifyReg[i] != NULL)
+      {
+         PersNotifyReg_s* entry = gNotifyReg[i];
+         gNotifyReg[i] = entry->next;
+         free(entry);
+      }
+   }
+   gNumNotifyReg = 0;
 
-   // add match for  c r e a t e
-   snprintf(ruleCreated, DbusMatchRuleSize,
-            "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResCreate',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
-            notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+   gNotifyLocalFilter = ((pFilter != NULL) && (atoi(pFilter) > 0)) ? 1 : 0;
 
-   if(notifyPolicy == Notify_register)
+   if(gNotifyLocalFilter == 1)
    {
-      dbus_bus_add_match(conn, ruleChanged, NULL);
-      dbus_bus_add_match(conn, ruleDeleted, NULL);
-      dbus_bus_add_match(conn, ruleCreated, NULL);
-      DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("Registered for change notifications:"), DLT_STRING(ruleChanged));
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("process_notify_filter_init - notification signals are filtered locally"));
    }
-   else if(notifyPolicy == Notify_unregister)
+}
+
+
+
+int process_is_notification_registered(unsigned int ldbid, unsigned int user_no, unsigned int seat_no, const char* key)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)key, strnlen(key, DbKeyMaxLen));
+
+   return (*notify_reg_find(hash, ldbid, user_no, seat_no, key) != NULL) ? 1 : 0;
+}
+
+
+
+/// register or unregister a change notification, the connection is not flushed
+static void reg_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
+                                                          unsigned int notifySeatNo, unsigned int notifyPolicy, const char* notifyKey)
+{
+   notify_reg_update(conn, notifyLdbid, notifyUserNo, notifySeatNo, notifyPolicy, notifyKey);
+
+   // signals filtered locally are received through one match rule, see notify_reg_update
+   if(gNotifyLocalFilter == 0)
    {
-      dbus_bus_remove_match(conn, ruleChanged, NULL);
-      dbus_bus_remove_match(conn, ruleDeleted, NULL);
-      dbus_bus_remove_match(conn, ruleCreated, NULL);
-      DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("Unregistered for change notifications:"), DLT_STRING(ruleChanged));
+      char ruleChanged[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
+      char ruleDeleted[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
+      char ruleCreated[DbusMatchRuleSize] = {[0 ... DbusMatchRuleSize-1] = 0};
+
+      // add match for  c h a n g e
+      snprintf(ruleChanged, DbusMatchRuleSize,
+               "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResChange',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
+               notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+
+      // add match for  d e l e t e
+      snprintf(ruleDeleted, DbusMatchRuleSize,
+               "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResDelete',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
+               notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+
+      // add match for  c r e a t e
+      snprintf(ruleCreated, DbusMatchRuleSize,
+               "type='signal',interface='org.genivi.persistence.adminconsumer',member='PersistenceResCreate',path='/org/genivi/persistence/adminconsumer',arg0='%s',arg1='%u',arg2='%u',arg3='%u'",
+               notifyKey, notifyLdbid, notifyUserNo, notifySeatNo);
+
+      if(notifyPolicy == Notify_register)
+      {
+         dbus_bus_add_match(conn, ruleChanged, NULL);
+         dbus_bus_add_match(conn, ruleDeleted, NULL);
+         dbus_bus_add_match(conn, ruleCreated, NULL);
+         DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("Registered for change notifications:"), DLT_STRING(ruleChanged));
+      }
+      else if(notifyPolicy == Notify_unregister)
+      {
+         dbus_bus_remove_match(conn, ruleChanged, NULL);
+         dbus_bus_remove_match(conn, ruleDeleted, NULL);
+         dbus_bus_remove_match(conn, ruleCreated, NULL);
+         DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("Unregistered for change notifications:"), DLT_STRING(ruleChanged));
+      }
    }
+}
+
+
+
+void process_reg_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
+                                                           unsigned int notifySeatNo, unsigned int notifyPolicy, const char* notifyKey)
+{
+   reg_notification_signal(conn, notifyLdbid, notifyUserNo, notifySeatNo, notifyPolicy, notifyKey);
 
    dbus_connection_flush(conn);  // flush the connection to add the match
 }
 
 
 
-void process_send_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
-                                                            unsigned int notifySeatNo, unsigned int notifyReason, const char* notifyKey)
+void process_reg_notification_signal_list(DBusConnection* conn, const PersNotifySignal_s* regs, unsigned int numRegs)
+{
+   unsigned int i = 0;
+
+   for(i=0; i<numRegs; i++)
+   {
+      reg_notification_signal(conn, regs[i].ldbid, regs[i].user_no, regs[i].seat_no, regs[i].reason /*policy*/, regs[i].key);
+   }
+
+   dbus_connection_flush(conn);  // flush the connection once to add the matches
+}
+
+
+
+/// send a single change notification signal on the bus
+static void send_single_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
+                                                           unsigned int notifySeatNo, unsigned int notifyReason, const char* notifyKey)
 {
    dbus_bool_t ret;
    DBusMessage* message;
@@ -171,13 +380,381 @@ void process_send_notification_signal(DBusConnection* conn, unsigned int notifyL
 
 
 
-void process_block_and_write_data_back(unsigned int requestID, unsigned int status)
+/// send a list of notifications as one signal on the bus
+static void send_notification_batch_signal(DBusConnection* conn, const PersNotifySignal_s* signals, unsigned int numSignals)
+{
+   DBusMessage* message = dbus_message_new_signal(gPersAdminConsumerPath, gDbusPersAdminConsInterface, gBatchSignal);
+
+   if(message != NULL)
+   {
+      DBusMessageIter iter;
+      DBusMessageIter array;
+      dbus_bool_t ret = TRUE;
+      unsigned int i = 0;
+
+      dbus_message_iter_init_append(message, &iter);
+
+      // array of (resource_id, ldbid, user_no, seat_no, reason)
+      ret = dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(suuuu)", &array);
+      for(i=0; (i<numSignals) && (ret == TRUE); i++)
+      {
+         DBusMessageIter entry;
+         const char* key = signals[i].key;
+
+         ret = dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT, NULL, &entry);
+         if(ret == TRUE)
+         {
+            ret =    dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key)
+                  && dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32, &signals[i].ldbid)
+                  && dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32, &signals[i].user_no)
+                  && dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32, &signals[i].seat_no)
+                  && dbus_message_iter_append_basic(&entry, DBUS_TYPE_UINT32, &signals[i].reason)
+                  && dbus_message_iter_close_container(&array, &entry);
+         }
+      }
+
+      if((ret == TRUE) && (dbus_message_iter_close_container(&iter, &array) == TRUE))
+      {
+         if((conn == NULL) || (dbus_connection_send(conn, message, 0) != TRUE))
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("send_notification_batch_signal - failed to send dbus message, notifications:"), DLT_UINT(numSignals));
+         }
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("send_notification_batch_signal - failed to create message, notifications:"), DLT_UINT(numSignals));
+      }
+      dbus_message_unref(message);
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("send_notification_batch_signal - dbus_message_new_signal failed"));
+   }
+}
+
+
+
+/// send the notifications of the current batch as one signal on the bus
+static void send_notification_batch(DBusConnection* conn)
+{
+   send_notification_batch_signal(conn, gNotifyBatch, gNumNotifyBatch);
+   gNumNotifyBatch = 0;
+}
+
+
+
+/// send a change notification signal, or add it to the current batch if batched signals are enabled
+static void send_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
+                                                           unsigned int notifySeatNo, unsigned int notifyReason, const char* notifyKey)
+{
+   if(   (gNotifyBatchEnabled == 1)
+      && (notifyReason > pclNotifyStatus_no_changed) && (notifyReason < pclNotifyStatus_lastEntry) )
+   {
+      PersNotifySignal_s* signal = &gNotifyBatch[gNumNotifyBatch++];
+
+      signal->ldbid   = notifyLdbid;
+      signal->user_no = notifyUserNo;
+      signal->seat_no = notifySeatNo;
+      signal->reason  = notifyReason;
+      snprintf(signal->key, DbKeyMaxLen, "%s", notifyKey);
+
+      if(gNumNotifyBatch == NotifyBatchMaxEntries)
+      {
+         send_notification_batch(conn);
+      }
+   }
+   else
+   {
+      send_single_notification_signal(conn, notifyLdbid, notifyUserNo, notifySeatNo, notifyReason, notifyKey);
+   }
+}
+
+
+
+void process_notify_batch_init(void)
+{
+   const char* pBatch = getenv("PERS_CLIENT_NOTIFY_BATCH");
+
+   gNumNotifyBatch = 0;
+   gNotifyBatchEnabled = ((pBatch != NULL) && (atoi(pBatch) > 0)) ? 1 : 0;
+
+   if(gNotifyBatchEnabled == 1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("process_notify_batch_init - batched notification signals enabled"));
+   }
+}
+
+
+
+void process_notify_batch_flush(DBusConnection* conn)
+{
+   if(gNumNotifyBatch > 0)
+   {
+      send_notification_batch(conn);
+   }
+}
+
+
+
+static unsigned int notify_time_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+/// arm the timer for the oldest pending signal, or disarm it if no signal is pending
+static void notify_arm_timer(unsigned int now)
+{
+   struct itimerspec its;
+
+   memset(&its, 0, sizeof(its));
+
+   if(gNumNotifyPending > 0)
+   {
+      // a zero value disarms the timer, so wait at least 1 ms
+      int delay = (int)(gNotifyPending[0].due - now);
+      if(delay <= 0)
+      {
+         delay = 1;
+      }
+      its.it_value.tv_sec  = delay / 1000;
+      its.it_value.tv_nsec = (delay % 1000) * 1000000;
+   }
+
+   if(timerfd_settime(gNotifyTimerFd, 0, &its, NULL) == -1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("notify_arm_timer - timerfd_settime() failed"), DLT_STRING(strerror(errno)));
+   }
+}
+
+
+
+/// send a pending signal and remove it
+static void notify_send_pending(DBusConnection* conn, unsigned int idx)
+{
+   const PersNotifySignal_s* signal = &gNotifyPending[idx].signal;
+
+   send_notification_signal(conn, signal->ldbid, signal->user_no, signal->seat_no, signal->reason, signal->key);
+
+   gNumNotifyPending--;
+   memmove(&gNotifyPending[idx], &gNotifyPending[idx+1], (gNumNotifyPending - idx) * sizeof(PersNotifyPending_s));
+}
+
+
+
+/// find the pending signal of a resource, returns -1 if no signal is pending
+static int notify_find_pending(unsigned int hash, unsigned int ldbid, unsigned int user_no,
+                               unsigned int seat_no, const char* key)
+{
+   unsigned int i = 0;
+
+   for(i=0; i<gNumNotifyPending; i++)
+   {
+      const PersNotifyPending_s* pending = &gNotifyPending[i];
+
+      if(   (pending->hash == hash)
+         && (pending->signal.ldbid == ldbid)
+         && (pending->signal.user_no == user_no)
+         && (pending->signal.seat_no == seat_no)
+         && (strncmp(pending->signal.key, key, DbKeyMaxLen) == 0) )
+      {
+         return (int)i;
+      }
+   }
+
+   return -1;
+}
+
+
+
+int process_notify_coalesce_init(void)
+{
+   const char* pWindow = getenv("PERS_CLIENT_NOTIFY_COALESCE_WINDOW");
+
+   gNotifyWindow       = 0;
+   gNumNotifyPending   = 0;
+   gNumNotifyCoalesced = 0;
+
+   if((pWindow != NULL) && (atoi(pWindow) > 0))
+   {
+      gNotifyWindow = (unsigned int)atoi(pWindow);
+
+      gNotifyTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+      if(gNotifyTimerFd != -1)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("process_notify_coalesce_init - notification coalescing window [ms]:"),
+                                               DLT_UINT(gNotifyWindow));
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("process_notify_coalesce_init - timerfd_create() failed"), DLT_STRING(strerror(errno)));
+         gNotifyWindow = 0;
+      }
+   }
+
+   return gNotifyTimerFd;
+}
+
+
+
+void process_notify_coalesce_timeout(DBusConnection* conn)
 {
+   uint64_t numExpired = 0;
+   unsigned int now = notify_time_ms();
+
+   if(read(gNotifyTimerFd, &numExpired, sizeof(numExpired)) == -1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("process_notify_coalesce_timeout - read() failed"), DLT_STRING(strerror(errno)));
+   }
+
+   while((gNumNotifyPending > 0) && ((int)(gNotifyPending[0].due - now) <= 0))
+   {
+      notify_send_pending(conn, 0);
+   }
+
+   notify_arm_timer(now);
+}
+
+
+
+void process_notify_coalesce_deinit(DBusConnection* conn)
+{
+   if(gNotifyTimerFd != -1)
+   {
+      while(gNumNotifyPending > 0)
+      {
+         notify_send_pending(conn, 0);
+      }
+
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("process_notify_coalesce_deinit - coalesced notifications:"),
+                                            DLT_UINT(gNumNotifyCoalesced));
+
+      close(gNotifyTimerFd);
+      gNotifyTimerFd = -1;
+      gNotifyWindow  = 0;
+   }
+}
+
+
+
+void get_notify_coalesce_stats(unsigned int* numPending, unsigned int* numCoalesced)
+{
+   *numPending   = gNumNotifyPending;
+   *numCoalesced = gNumNotifyCoalesced;
+}
+
+
+
+void process_send_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
+                                                            unsigned int notifySeatNo, unsigned int notifyReason, const char* notifyKey)
+{
+   if(gNotifyWindow == 0)
+   {
+      send_notification_signal(conn, notifyLdbid, notifyUserNo, notifySeatNo, notifyReason, notifyKey);
+   }
+   else
+   {
+      unsigned int now  = notify_time_ms();
+      unsigned int hash = pclCrc32(0, (const unsigned char*)notifyKey, strnlen(notifyKey, DbKeyMaxLen));
+      int idx = notify_find_pending(hash, notifyLdbid, notifyUserNo, notifySeatNo, notifyKey);
+
+      if((notifyReason == pclNotifyStatus_changed) || (notifyReason == pclNotifyStatus_deleted))
+      {
+         if(idx != -1)
+         {
+            // merge into the pending signal, the subscribers get the final state
+            gNotifyPending[idx].signal.reason = notifyReason;
+            gNumNotifyCoalesced++;
+         }
+         else
+         {
+            PersNotifyPending_s* pending = NULL;
+
+            if(gNumNotifyPending == NotifyPendingMaxEntries)
+            {
+               notify_send_pending(conn, 0);
+               notify_arm_timer(now);
+            }
+
+            pending = &gNotifyPending[gNumNotifyPending++];
+            pending->due  = now + gNotifyWindow;
+            pending->hash = hash;
+            pending->signal.ldbid   = notifyLdbid;
+            pending->signal.user_no = notifyUserNo;
+            pending->signal.seat_no = notifySeatNo;
+            pending->signal.reason  = notifyReason;
+            snprintf(pending->signal.key, DbKeyMaxLen, "%s", notifyKey);
+
+            if(gNumNotifyPending == 1)
+            {
+               notify_arm_timer(now);
+            }
+         }
+      }
+      else
+      {
+         // other events are not coalesced, keep the order of the events of the resource
+         if(idx != -1)
+         {
+            notify_send_pending(conn, (unsigned int)idx);
+            if(idx == 0)
+            {
+               notify_arm_timer(now);
+            }
+         }
+         send_notification_signal(conn, notifyLdbid, notifyUserNo, notifySeatNo, notifyReason, notifyKey);
+      }
+   }
+}
+
+
+
+void process_send_notification_signal_list(DBusConnection* conn, const PersNotifySignal_s* signals, unsigned int numSignals)
+{
+   unsigned int i = 0;
+
+   // the notifications sent before are delivered first
+   process_notify_batch_flush(conn);
+
+   // the list carries the latest status, pending coalesced signals of the same resources are outdated
+   for(i=0; (i<numSignals) && (gNumNotifyPending > 0); i++)
+   {
+      unsigned int hash = pclCrc32(0, (const unsigned char*)signals[i].key, strnlen(signals[i].key, DbKeyMaxLen));
+      int idx = notify_find_pending(hash, signals[i].ldbid, signals[i].user_no, signals[i].seat_no, signals[i].key);
+
+      if(idx != -1)
+      {
+         gNumNotifyPending--;
+         memmove(&gNotifyPending[idx], &gNotifyPending[idx+1], (gNumNotifyPending - (unsigned int)idx) * sizeof(PersNotifyPending_s));
+         gNumNotifyCoalesced++;
+      }
+   }
+
+   send_notification_batch_signal(conn, signals, numSignals);
+}
+
+
+
+int process_block_and_write_data_back(unsigned int requestID, unsigned int status)
+{
+   int rval = 0;
    (void)requestID;
    (void)status;
    // lock persistence data access
    pers_lock_access();
    // sync data back to memory device
+   if(write_cache_flush() < 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("process_block_and_write_data_back - failed to write back cached data"));
+      rval = EPERS_SETDTAFAILED;
+   }
+
+   return rval;
 }
 
 
@@ -224,6 +801,12 @@ void process_prepare_shutdown(int complete)
       }
    }
 
+   // write back data of the write-behind cache
+   if(write_cache_flush() < 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("process_prepare_shutdown - failed to write back cached data"));
+   }
+
    // close all opend rct
    pers_rct_close_all();
 
@@ -238,19 +821,8 @@ void process_prepare_shutdown(int complete)
 
    if(complete > 0)
    {
-		// unload custom client libraries
-		for(i=0; i<PersCustomLib_LastEntry; i++)
-		{
-			if(gPersCustomFuncs[i].custom_plugin_deinit != NULL)
-			{
-				// deinitialize plugin
-				gPersCustomFuncs[i].custom_plugin_deinit();
-				// close library handle
-				dlclose(gPersCustomFuncs[i].handle);
-
-				invalidate_custom_plugin(i);
-			}
-		}
+		// sync and unload custom client libraries
+		(void)deinit_custom_plugins();
    }
 }
 
@@ -32,7 +32,80 @@ void process_prepare_shutdown(int complete);
 
 
 /**
- * @brief send notification signal
+ * @brief initialize the coalescing of change notification signals.
+ *        Coalescing is enabled with the environment variable PERS_CLIENT_NOTIFY_COALESCE_WINDOW,
+ *        the window in [ms]: repeated change or delete events of the same resource
+ *        (key, ldbid, user, seat) within the window are sent as one signal with the latest reason.
+ *
+ * @return the timer file descriptor the mainloop must wait on for EPOLLIN, see ::process_notify_coalesce_timeout,
+ *         or -1 if coalescing is disabled
+ */
+int process_notify_coalesce_init(void);
+
+
+/**
+ * @brief send the coalesced notification signals whose window has expired
+ *
+ * @param conn the dbus connection
+ */
+void process_notify_coalesce_timeout(DBusConnection* conn);
+
+
+/**
+ * @brief send all pending coalesced notification signals and disable coalescing
+ *
+ * @param conn the dbus connection
+ */
+void process_notify_coalesce_deinit(DBusConnection* conn);
+
+
+/**
+ * @brief get the statistics of the notification coalescing, must be called by the mainloop thread
+ *
+ * @param numPending number of coalesced signals waiting to be sent
+ * @param numCoalesced number of events merged into a waiting signal since ::process_notify_coalesce_init
+ */
+void get_notify_coalesce_stats(unsigned int* numPending, unsigned int* numCoalesced);
+
+
+/**
+ * @brief initialize batched change notification signals.
+ *        If the environment variable PERS_CLIENT_NOTIFY_BATCH is set to 1 the change notifications
+ *        are not sent as single signals, but collected and sent as one "PersistenceResBatch" signal
+ *        with an array of (resource_id, ldbid, user_no, seat_no, reason) per mainloop cycle,
+ *        see ::process_notify_batch_flush.
+ *        Receivers without batch support do not get the notifications anymore.
+ */
+void process_notify_batch_init(void);
+
+
+/**
+ * @brief send the collected change notifications as one batched signal,
+ *        must be called by the mainloop after each cycle
+ *
+ * @param conn the dbus connection
+ */
+void process_notify_batch_flush(DBusConnection* conn);
+
+
+/**
+ * @brief check if a change notification has been registered by this process,
+ *        used to filter the notifications of a batched signal
+ *
+ * @param ldbid the ldbid
+ * @param user_no the user number
+ * @param seat_no the seat number
+ * @param key the resource id
+ *
+ * @return 1 if registered, 0 if not
+ */
+int process_is_notification_registered(unsigned int ldbid, unsigned int user_no, unsigned int seat_no, const char* key);
+
+
+/**
+ * @brief send notification signal.
+ *        If coalescing is enabled change and delete signals are delayed
+ *        and merged, see ::process_notify_coalesce_init
  *
  * @param conn the dbus connection
  * @param notifyLdbid the ldbid to notify on
@@ -45,6 +118,17 @@ void process_send_notification_signal(DBusConnection* conn, unsigned int notifyL
                                                             unsigned int notifySeatNo, unsigned int notifyReason, const char* notifyKey);
 
 
+/**
+ * @brief send a list of notification signals as one "PersistenceResBatch" signal.
+ *        Pending coalesced signals of the resources in the list are dropped, the list has the latest status.
+ *
+ * @param conn the dbus connection
+ * @param signals the notification signals to send
+ * @param numSignals the number of notification signals
+ */
+void process_send_notification_signal_list(DBusConnection* conn, const PersNotifySignal_s* signals, unsigned int numSignals);
+
+
 /**
  * @brief register for notification signal
  *
@@ -58,6 +142,27 @@ void process_send_notification_signal(DBusConnection* conn, unsigned int notifyL
 void process_reg_notification_signal(DBusConnection* conn, unsigned int notifyLdbid, unsigned int notifyUserNo,
                                                            unsigned int notifySeatNo, unsigned int notifyPolicy, const char* notifyKey);
 
+/**
+ * @brief register or unregister for a list of notification signals,
+ *        the connection is flushed once for the whole list
+ *
+ * @param conn the dbus connection
+ * @param regs the notifications, the reason member holds the notify policy (::Notify_register or ::Notify_unregister)
+ * @param numRegs the number of notifications
+ */
+void process_reg_notification_signal_list(DBusConnection* conn, const PersNotifySignal_s* regs, unsigned int numRegs);
+
+
+/**
+ * @brief initialize the filtering of change notification signals, removes all registered notifications.
+ *        If the environment variable PERS_CLIENT_NOTIFY_LOCAL_FILTER is set to 1 no match rules per
+ *        key are added to the bus daemon, but one match rule for all notification signals;
+ *        the received signals are filtered against the registered notifications,
+ *        see ::process_is_notification_registered
+ */
+void process_notify_filter_init(void);
+
+
 /**
  * @brief send lifecycle request
  *
@@ -84,8 +189,10 @@ void process_send_lifecycle_register(DBusConnection* conn, int regType, int shut
  *
  * @param requestID the requestID
  * @param status the status
+ *
+ * @return 0 on success or EPERS_SETDTAFAILED if cached data could not be written back
  */
-void process_block_and_write_data_back(unsigned int requestID, unsigned int status);
+int process_block_and_write_data_back(unsigned int requestID, unsigned int status);
 
 
 
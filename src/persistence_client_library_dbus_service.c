@@ -21,6 +21,8 @@
 #include "persistence_client_library_lc_interface.h"
 #include "persistence_client_library_pas_interface.h"
 #include "persistence_client_library_dbus_cmd.h"
+#include "persistence_client_library_notify_exec.h"
+#include "persistence_client_library_prct_access.h"
 #include "persistence_client_library_data_organization.h"
 
 
@@ -29,6 +31,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
 
 
 pthread_cond_t  gDbusInitializedCond = PTHREAD_COND_INITIALIZER;
@@ -37,8 +42,6 @@ pthread_mutex_t gDbusInitializedMtx  = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t gDbusPendingRegMtx   = PTHREAD_MUTEX_INITIALIZER;
 
 
-pthread_mutex_t gDeliverpMtx         = PTHREAD_MUTEX_INITIALIZER;
-
 pthread_mutex_t gMainCondMtx         = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t  gMainLoopCond        = PTHREAD_COND_INITIALIZER;
 
@@ -59,48 +62,102 @@ const char* gDbusPersAdminPath          = "/org/genivi/persistence/admin";
 const char* gDbusPersAdminInterface     = "org.genivi.persistence.admin";
 const char* gDbusPersAdminConsMsg       = "PersistenceAdminRequest";
 
-/// communication channel into the dbus mainloop
-static int gPipeFd[2] = {0};
-
-
+/// command queue slot
+typedef struct _PersCmdQueueSlot_s
+{
+   /// sequence number of the slot, the slot is free for position p if seq == p and filled if seq == p + 1
+   unsigned int seq;
+   /// completion flag of a blocking command, set by the mainloop to 1 if processed or -1 if not processed,
+   /// NULL if the sender does not wait
+   int* done;
+   /// the command
+   MainLoopData_u data;
+} PersCmdQueueSlot_s;
+
+
+/// command queue into the dbus mainloop (bounded, lock free for the senders, the mainloop is the only reader)
+static PersCmdQueueSlot_s gCmdQueue[MainLoopCmdQueueSize];
+/// next position to write (senders)
+static unsigned int gCmdQueueTail = 0;
+/// next position to read (mainloop)
+static unsigned int gCmdQueueHead = 0;
+/// eventfd to wake up the mainloop when commands have been queued, -1 if the mainloop is not running
+static int gCmdEventFd = -1;
+/// number of senders adding a command, the eventfd is closed when no sender is active
+static unsigned int gCmdSenders = 0;
+/// number of senders waiting for a free slot of the full command queue
+static unsigned int gCmdQueueWaiters = 0;
+
+
+/// type of a mainloop event source
 typedef enum EDBusObjectType
 {
    OT_NONE = 0,
    OT_WATCH,
-   OT_TIMEOUT
+   OT_TIMEOUT,
+   OT_CMD,
+   OT_NOTIFY_TIMER,
+   OT_RCT_TIMER
 } tDBusObjectType;
 
 
+struct SWatchEntry;
 
-/// object entry
-typedef struct SObjectEntry
+/// file descriptor registered at the epoll instance
+typedef struct SPollEntry
 {
-   tDBusObjectType objtype;	/// libdbus' object
-   union
-   {
-      DBusWatch * watch;		/// watch "object"
-      DBusTimeout * timeout;	/// timeout "object"
-   };
-} tObjectEntry;
+   tDBusObjectType objtype;      /// type of the source, OT_NONE if it has been removed
+   int fd;                       /// the file descriptor
+   uint32_t events;              /// events registered at the epoll instance
+   struct SWatchEntry* watches;  /// watches of the fd (libdbus may use separate read and write watches)
+   struct SPollEntry* next;      /// next registered fd
+   struct SPollEntry* nextFree;  /// next removed fd waiting to be freed
+} tPollEntry;
+
 
+/// libdbus watch
+typedef struct SWatchEntry
+{
+   DBusWatch* watch;             /// watch "object", NULL if it has been removed
+   tPollEntry* pollEntry;        /// the fd the watch belongs to
+   struct SWatchEntry* next;     /// next watch of the fd
+   struct SWatchEntry* nextFree; /// next removed watch waiting to be freed
+} tWatchEntry;
+
+
+/// libdbus timeout, no fd is used, the epoll timeout is calculated from the due times
+typedef struct STimeoutEntry
+{
+   DBusTimeout* timeout;         /// timeout "object"
+   unsigned long long due;       /// due time [ms], 0 if the timeout is disabled
+   unsigned int pass;            /// timeout handling pass the timeout has been handled in last
+   struct STimeoutEntry* next;   /// next timeout
+} tTimeoutEntry;
 
 
 /// polling structure
 typedef struct SPollInfo
 {
-   int nfds;						/// number of polls
-   struct pollfd fds[10];		/// poll file descriptors array
-   tObjectEntry objects[10];	/// poll object
+   int epollFd;                  /// the epoll instance
+   tPollEntry* entries;          /// registered fds
+   tTimeoutEntry* timeouts;      /// timeouts
+   tPollEntry* freeEntries;      /// removed fds, freed at the end of the mainloop cycle
+   tWatchEntry* freeWatches;     /// removed watches, freed at the end of the mainloop cycle
+   unsigned int numFds;          /// number of registered fds
+   unsigned int numWakeups;      /// number of mainloop wakeups
+   unsigned int numIdleWakeups;  /// number of wakeups without an event or due timeout
+   unsigned int numEvents;       /// number of handled fd events
+   unsigned int numTimeouts;     /// number of handled timeouts
+   unsigned int timeoutPass;     /// number of timeout handling passes
+   unsigned long long idleTime;  /// time spent waiting for events [ms]
 } tPollInfo;
 
 
 /// polling information
-static tPollInfo gPollInfo;	/// polling information
+static tPollInfo gPollInfo = { .epollFd = -1 };
 
 int bContinue = 0;				/// indicator if dbus mainloop shall continue
 
-#define ARRAY_SIZE(a) (sizeof(a)/sizeof(a[0]))
-
 
 /* function to unregister ojbect path message handler */
 static void unregisterMessageHandler(DBusConnection *connection, void *user_data)
@@ -110,6 +167,76 @@ static void unregisterMessageHandler(DBusConnection *connection, void *user_data
    DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("unregisterObjectPath\n"));
 }
 
+/* fan out a batched change notification signal to the registered callbacks */
+static DBusHandlerResult handleNotificationBatch(DBusMessage * message)
+{
+   DBusHandlerResult result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+   DBusMessageIter iter;
+   DBusMessageIter array;
+
+   if(   (TRUE==dbus_message_iter_init(message, &iter))
+      && (DBUS_TYPE_ARRAY==dbus_message_iter_get_arg_type(&iter))
+      && (DBUS_TYPE_STRUCT==dbus_message_iter_get_element_type(&iter)) )
+   {
+      dbus_message_iter_recurse(&iter, &array);
+
+      while(DBUS_TYPE_STRUCT==dbus_message_iter_get_arg_type(&array))
+      {
+         DBusMessageIter entry;
+         pclNotification_s notifyStruct;
+         unsigned int values[4] = {0};   // ldbid, user_no, seat_no, reason
+         int i = 0;
+
+         dbus_message_iter_recurse(&array, &entry);
+
+         if(DBUS_TYPE_STRING==dbus_message_iter_get_arg_type(&entry))
+         {
+            dbus_message_iter_get_basic(&entry, &notifyStruct.resource_id);
+
+            for(i=0; i<4; i++)
+            {
+               if(   (TRUE!=dbus_message_iter_next(&entry))
+                  || (DBUS_TYPE_UINT32!=dbus_message_iter_get_arg_type(&entry)) )
+               {
+                  break;
+               }
+               dbus_message_iter_get_basic(&entry, &values[i]);
+            }
+         }
+
+         if(i == 4)
+         {
+            notifyStruct.ldbid               = values[0];
+            notifyStruct.user_no             = values[1];
+            notifyStruct.seat_no             = values[2];
+            notifyStruct.pclKeyNotify_Status = (pclNotifyStatus_e)values[3];
+
+            // the batch contains the notifications of all resources changed by the sender
+            if(1==process_is_notification_registered(notifyStruct.ldbid, notifyStruct.user_no,
+                                                     notifyStruct.seat_no, notifyStruct.resource_id))
+            {
+               (void)notify_exec_post(&notifyStruct);
+            }
+         }
+         else
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("handleNotificationBatch - invalid notification entry"));
+         }
+
+         dbus_message_iter_next(&array);
+      }
+      result = DBUS_HANDLER_RESULT_HANDLED;
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("handleNotificationBatch - invalid signature:"), DLT_STRING(dbus_message_get_signature(message)));
+   }
+
+   return result;
+}
+
+
+
 /* catches messages not directed to any registered object path ("garbage collector") */
 static DBusHandlerResult handleObjectPathMessageFallback(DBusConnection * connection, DBusMessage * message, void * user_data)
 {
@@ -140,21 +267,25 @@ static DBusHandlerResult handleObjectPathMessageFallback(DBusConnection * connec
          pclNotification_s notifyStruct;
          int validMessage = 0;
 
-         if((0==strcmp("PersistenceResChange", dbus_message_get_member(message))))
+         if((0==strcmp(gChangeSignal, dbus_message_get_member(message))))
          {
             notifyStruct.pclKeyNotify_Status = pclNotifyStatus_changed;
             validMessage = 1;
          }
-         else if((0==strcmp("PersistenceResDelete", dbus_message_get_member(message))))
+         else if((0==strcmp(gDeleteSignal, dbus_message_get_member(message))))
          {
             notifyStruct.pclKeyNotify_Status = pclNotifyStatus_deleted;
             validMessage = 1;
          }
-         else if((0==strcmp("PersistenceRes", dbus_message_get_member(message))))
+         else if((0==strcmp(gCreateSignal, dbus_message_get_member(message))))
          {
             notifyStruct.pclKeyNotify_Status = pclNotifyStatus_created;
             validMessage = 1;
          }
+         else if((0==strcmp(gBatchSignal, dbus_message_get_member(message))))
+         {
+            result = handleNotificationBatch(message);
+         }
 
          if(validMessage == 1)
          {
@@ -185,6 +316,7 @@ static DBusHandlerResult handleObjectPathMessageFallback(DBusConnection * connec
 
                result = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;;
                dbus_message_unref(reply);
+               dbus_connection_flush(connection);
             }
             else
             {
@@ -192,18 +324,15 @@ static DBusHandlerResult handleObjectPathMessageFallback(DBusConnection * connec
                notifyStruct.user_no     = atoi(user_no);
                notifyStruct.seat_no     = atoi(seat_no);
 
-               // call the registered callback function
-               if(gChangeNotifyCallback != NULL )
+               // signals are not filtered by the bus daemon if filtered locally
+               if(1==process_is_notification_registered(notifyStruct.ldbid, notifyStruct.user_no,
+                                                        notifyStruct.seat_no, notifyStruct.resource_id))
                {
-                  gChangeNotifyCallback(&notifyStruct);
-               }
-               else
-               {
-                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("handleObjectPathMessageFallback - gChangeNotifyCallback is not set (possibly NULL)") );
+                  // the registered callback is called by the notification executor
+                  (void)notify_exec_post(&notifyStruct);
                }
                result = DBUS_HANDLER_RESULT_HANDLED;
             }
-            dbus_connection_flush(connection);
          }
       }
    }
@@ -347,37 +476,184 @@ int setup_dbus_mainloop(void)
 
 
 
-static dbus_bool_t addWatch(DBusWatch *watch, void *data)
+/// current time [ms]
+static unsigned long long mainloop_time_ms(void)
 {
-   dbus_bool_t result = FALSE;
-   (void)data;
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+
+/// register a fd at the epoll instance, returns NULL on error
+static tPollEntry* add_poll_entry(int fd, tDBusObjectType objtype, uint32_t events)
+{
+   tPollEntry* pEntry = calloc(1, sizeof(tPollEntry));
+
+   if(pEntry != NULL)
+   {
+      struct epoll_event ev;
+
+      memset(&ev, 0, sizeof(ev));
+      ev.events   = events;
+      ev.data.ptr = pEntry;
+
+      if(-1 != epoll_ctl(gPollInfo.epollFd, EPOLL_CTL_ADD, fd, &ev))
+      {
+         pEntry->objtype = objtype;
+         pEntry->fd      = fd;
+         pEntry->events  = events;
+         pEntry->next    = gPollInfo.entries;
+         gPollInfo.entries = pEntry;
+         gPollInfo.numFds++;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("add_poll_entry - epoll_ctl() failed for fd:"), DLT_INT(fd),
+                                                DLT_STRING(strerror(errno)) );
+         free(pEntry);
+         pEntry = NULL;
+      }
+   }
+
+   return pEntry;
+}
+
+
+
+/// unregister a fd from the epoll instance, the entry is freed at the end of the mainloop cycle
+/// as events of the current cycle may still reference it
+static void remove_poll_entry(tPollEntry* pEntry)
+{
+   tPollEntry** ppEntry = &gPollInfo.entries;
 
-   if (ARRAY_SIZE(gPollInfo.fds)>gPollInfo.nfds)
+   while((*ppEntry != NULL) && (*ppEntry != pEntry))
    {
-      int flags = dbus_watch_get_flags(watch);
+      ppEntry = &(*ppEntry)->next;
+   }
 
-      tObjectEntry * const pEntry = &gPollInfo.objects[gPollInfo.nfds];
-      pEntry->objtype = OT_WATCH;
-      pEntry->watch = watch;
+   if(*ppEntry != NULL)
+   {
+      *ppEntry = pEntry->next;
+      gPollInfo.numFds--;
 
-      gPollInfo.fds[gPollInfo.nfds].fd = dbus_watch_get_unix_fd(watch);
+      if(-1 == epoll_ctl(gPollInfo.epollFd, EPOLL_CTL_DEL, pEntry->fd, NULL))
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("remove_poll_entry - epoll_ctl() failed for fd:"), DLT_INT(pEntry->fd),
+                                               DLT_STRING(strerror(errno)) );
+      }
+
+      pEntry->objtype  = OT_NONE;
+      pEntry->nextFree = gPollInfo.freeEntries;
+      gPollInfo.freeEntries = pEntry;
+   }
+}
+
+
+
+/// free the fds and watches removed in this mainloop cycle
+static void free_removed_entries(void)
+{
+   while(gPollInfo.freeEntries != NULL)
+   {
+      tPollEntry* pEntry = gPollInfo.freeEntries;
+      gPollInfo.freeEntries = pEntry->nextFree;
+      free(pEntry);
+   }
 
-      if (TRUE==dbus_watch_get_enabled(watch))
+   while(gPollInfo.freeWatches != NULL)
+   {
+      tWatchEntry* pWatch = gPollInfo.freeWatches;
+      gPollInfo.freeWatches = pWatch->nextFree;
+      free(pWatch);
+   }
+}
+
+
+
+/// update the events of a watch fd from its enabled watches
+static void update_watch_events(tPollEntry* pEntry)
+{
+   uint32_t events = 0;
+   tWatchEntry* pWatch = NULL;
+
+   for(pWatch = pEntry->watches; pWatch != NULL; pWatch = pWatch->next)
+   {
+      if(TRUE == dbus_watch_get_enabled(pWatch->watch))
       {
-         if (flags&DBUS_WATCH_READABLE)
+         const unsigned int flags = dbus_watch_get_flags(pWatch->watch);
+
+         if(flags & DBUS_WATCH_READABLE)
          {
-            gPollInfo.fds[gPollInfo.nfds].events |= POLLIN;
+            events |= EPOLLIN;
          }
-         if (flags&DBUS_WATCH_WRITABLE)
+         if(flags & DBUS_WATCH_WRITABLE)
          {
-            gPollInfo.fds[gPollInfo.nfds].events |= POLLOUT;
+            events |= EPOLLOUT;
          }
+      }
+   }
 
-         ++gPollInfo.nfds;
+   if(events != pEntry->events)
+   {
+      struct epoll_event ev;
+
+      memset(&ev, 0, sizeof(ev));
+      ev.events   = events;
+      ev.data.ptr = pEntry;
+
+      if(-1 != epoll_ctl(gPollInfo.epollFd, EPOLL_CTL_MOD, pEntry->fd, &ev))
+      {
+         pEntry->events = events;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("update_watch_events - epoll_ctl() failed for fd:"), DLT_INT(pEntry->fd),
+                                                DLT_STRING(strerror(errno)) );
       }
+   }
+}
+
+
+
+static dbus_bool_t addWatch(DBusWatch *watch, void *data)
+{
+   dbus_bool_t result = FALSE;
+   const int fd = dbus_watch_get_unix_fd(watch);
+   tPollEntry* pEntry = gPollInfo.entries;
+   tWatchEntry* pWatch = calloc(1, sizeof(tWatchEntry));
+   (void)data;
 
+   // epoll accepts a fd only once, all watches of a fd share the entry
+   while((pEntry != NULL) && ((pEntry->objtype != OT_WATCH) || (pEntry->fd != fd)))
+   {
+      pEntry = pEntry->next;
+   }
+
+   if((pEntry == NULL) && (pWatch != NULL))
+   {
+      pEntry = add_poll_entry(fd, OT_WATCH, 0);
+   }
+
+   if((pEntry != NULL) && (pWatch != NULL))
+   {
+      pWatch->watch     = watch;
+      pWatch->pollEntry = pEntry;
+      pWatch->next      = pEntry->watches;
+      pEntry->watches   = pWatch;
+      dbus_watch_set_data(watch, pWatch, NULL);
+
+      update_watch_events(pEntry);
       result = TRUE;
    }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("addWatch - failed to add watch for fd:"), DLT_INT(fd) );
+      free(pWatch);
+   }
 
    return result;
 }
@@ -386,14 +662,38 @@ static dbus_bool_t addWatch(DBusWatch *watch, void *data)
 
 static void removeWatch(DBusWatch *watch, void *data)
 {
-   void* w_data = dbus_watch_get_data(watch);
+   tWatchEntry* pWatch = (tWatchEntry*)dbus_watch_get_data(watch);
 
    (void)data;
 
-   DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("removeWatch called "), DLT_INT( (int)watch) );
+   if(pWatch != NULL)
+   {
+      tPollEntry* pEntry = pWatch->pollEntry;
+      tWatchEntry** ppWatch = &pEntry->watches;
+
+      while((*ppWatch != NULL) && (*ppWatch != pWatch))
+      {
+         ppWatch = &(*ppWatch)->next;
+      }
+      if(*ppWatch != NULL)
+      {
+         *ppWatch = pWatch->next;
+      }
 
-   if(w_data)
-      free(w_data);
+      // the watch may be referenced by the watch handling of the current cycle, free it later
+      pWatch->watch    = NULL;
+      pWatch->nextFree = gPollInfo.freeWatches;
+      gPollInfo.freeWatches = pWatch;
+
+      if(pEntry->watches == NULL)
+      {
+         remove_poll_entry(pEntry);
+      }
+      else
+      {
+         update_watch_events(pEntry);
+      }
+   }
 
    dbus_watch_set_data(watch, NULL, NULL);
 }
@@ -402,106 +702,461 @@ static void removeWatch(DBusWatch *watch, void *data)
 
 static void watchToggled(DBusWatch *watch, void *data)
 {
+   tWatchEntry* pWatch = (tWatchEntry*)dbus_watch_get_data(watch);
+
    (void)data;
-   DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("watchToggled called "), DLT_INT( (int)watch) );
 
-   if(dbus_watch_get_enabled(watch))
-      addWatch(watch, data);
+   if(pWatch != NULL)
+   {
+      update_watch_events(pWatch->pollEntry);
+   }
+}
+
+
+
+/// set the due time of a timeout, 0 if the timeout is disabled
+static void set_timeout_due(tTimeoutEntry* pTimeout, unsigned long long now)
+{
+   if(TRUE == dbus_timeout_get_enabled(pTimeout->timeout))
+   {
+      const int interval = dbus_timeout_get_interval(pTimeout->timeout);
+      pTimeout->due = now + ((interval > 0) ? interval : 0);
+   }
    else
-      removeWatch(watch, data);
+   {
+      pTimeout->due = 0;
+   }
 }
 
 
 
 static dbus_bool_t addTimeout(DBusTimeout *timeout, void *data)
 {
-   (void)data;
    dbus_bool_t ret = FALSE;
+   tTimeoutEntry* pTimeout = calloc(1, sizeof(tTimeoutEntry));
+   (void)data;
+
+   if(pTimeout != NULL)
+   {
+      pTimeout->timeout = timeout;
+      set_timeout_due(pTimeout, mainloop_time_ms());
+      pTimeout->next = gPollInfo.timeouts;
+      gPollInfo.timeouts = pTimeout;
+      dbus_timeout_set_data(timeout, pTimeout, NULL);
+      ret = TRUE;
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("addTimeout - no memory"));
+   }
+
+   return ret;
+}
+
+
+
+static void removeTimeout(DBusTimeout *timeout, void *data)
+{
+   tTimeoutEntry* pTimeout = (tTimeoutEntry*)dbus_timeout_get_data(timeout);
+   tTimeoutEntry** ppTimeout = &gPollInfo.timeouts;
+   (void)data;
+
+   while((*ppTimeout != NULL) && (*ppTimeout != pTimeout))
+   {
+      ppTimeout = &(*ppTimeout)->next;
+   }
+
+   if(*ppTimeout != NULL)
+   {
+      *ppTimeout = pTimeout->next;
+      free(pTimeout);
+   }
+
+   dbus_timeout_set_data(timeout, NULL, NULL);
+}
+
 
-   if (ARRAY_SIZE(gPollInfo.fds)>gPollInfo.nfds)
+
+/** callback for libdbus' when timeout changed */
+static void timeoutToggled(DBusTimeout *timeout, void *data)
+{
+   tTimeoutEntry* pTimeout = (tTimeoutEntry*)dbus_timeout_get_data(timeout);
+   (void)data;
+
+   if(pTimeout != NULL)
    {
-      const int interval = dbus_timeout_get_interval(timeout);
-      if ((0<interval)&&(TRUE==dbus_timeout_get_enabled(timeout)))
+      set_timeout_due(pTimeout, mainloop_time_ms());
+   }
+}
+
+
+
+/// epoll timeout until the next due dbus timeout [ms], -1 if no timeout is enabled
+static int next_timeout(unsigned long long now)
+{
+   int waitTime = -1;
+   tTimeoutEntry* pTimeout = NULL;
+
+   for(pTimeout = gPollInfo.timeouts; pTimeout != NULL; pTimeout = pTimeout->next)
+   {
+      if(pTimeout->due != 0)
       {
-         const int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
-         if (-1!=tfd)
+         const unsigned long long remaining = (pTimeout->due > now) ? (pTimeout->due - now) : 0;
+
+         if((waitTime == -1) || (remaining < (unsigned long long)waitTime))
          {
-            const struct itimerspec its = { .it_value= {interval/1000, interval%1000} };
-            if (-1!=timerfd_settime(tfd, 0, &its, NULL))
-            {
-               tObjectEntry * const pEntry = &gPollInfo.objects[gPollInfo.nfds];
-               pEntry->objtype = OT_TIMEOUT;
-               pEntry->timeout = timeout;
-               gPollInfo.fds[gPollInfo.nfds].fd = tfd;
-               gPollInfo.fds[gPollInfo.nfds].events |= POLLIN;
-               ++gPollInfo.nfds;
-               ret = TRUE;
-            }
-            else
-            {
-               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("addTimeout - timerfd_settime() failed"), DLT_STRING(strerror(errno)) );
-            }
+            waitTime = (remaining < INT_MAX) ? (int)remaining : INT_MAX;
          }
-         else
+      }
+   }
+
+   return waitTime;
+}
+
+
+
+/// handle the due dbus timeouts, returns the number of handled timeouts
+static unsigned int handle_timeouts(void)
+{
+   unsigned int numHandled = 0;
+   const unsigned long long now = mainloop_time_ms();
+   tTimeoutEntry* pTimeout = gPollInfo.timeouts;
+
+   gPollInfo.timeoutPass++;
+
+   while(pTimeout != NULL)
+   {
+      // a timeout is handled once per pass, a rearmed timeout with interval 0 is due again immediately
+      if((pTimeout->due != 0) && (pTimeout->due <= now) && (pTimeout->pass != gPollInfo.timeoutPass))
+      {
+         // rearm before handling, the handler may remove or toggle timeouts, so restart the search afterwards
+         set_timeout_due(pTimeout, now);
+         pTimeout->pass = gPollInfo.timeoutPass;
+         numHandled++;
+
+         if(FALSE == dbus_timeout_handle(pTimeout->timeout))
          {
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("addTimeout - timerfd_create() failed"), DLT_STRING(strerror(errno)) );
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - dbus_timeout_handle() failed!?"));
          }
+         pTimeout = gPollInfo.timeouts;
+      }
+      else
+      {
+         pTimeout = pTimeout->next;
       }
    }
-   else
+
+   return numHandled;
+}
+
+
+
+/// handle the events of a watch fd
+static void handle_watch_events(tPollEntry* pEntry, uint32_t events)
+{
+   unsigned int flags = 0;
+   tWatchEntry* pWatch = NULL;
+
+   if(0 != (events & EPOLLIN))
    {
-      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("addTimeout - cannot create another fd to be poll()'ed"));
+      flags |= DBUS_WATCH_READABLE;
+   }
+   if(0 != (events & EPOLLOUT))
+   {
+      flags |= DBUS_WATCH_WRITABLE;
+   }
+   if(0 != (events & EPOLLERR))
+   {
+      flags |= DBUS_WATCH_ERROR;
+   }
+   if(0 != (events & EPOLLHUP))
+   {
+      flags |= DBUS_WATCH_HANGUP;
+   }
+
+   // removed watches stay valid (watch == NULL) until the end of the cycle
+   for(pWatch = pEntry->watches; pWatch != NULL; pWatch = pWatch->next)
+   {
+      if((pWatch->watch != NULL) && (TRUE == dbus_watch_get_enabled(pWatch->watch)))
+      {
+         const unsigned int watchFlags = flags & (dbus_watch_get_flags(pWatch->watch) | DBUS_WATCH_ERROR | DBUS_WATCH_HANGUP);
+
+         if((watchFlags != 0) && (FALSE == dbus_watch_handle(pWatch->watch, watchFlags)))
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("mainLoop - dbus_watch_handle() out of memory, fd:"), DLT_INT(pEntry->fd) );
+         }
+      }
    }
-   return ret;
 }
 
 
 
-static void removeTimeout(DBusTimeout *timeout, void *data)
+/// reset the command queue, called by the mainloop before commands can be sent
+static void cmd_queue_init(void)
 {
-   int i = gPollInfo.nfds;
-   (void)data;
+   unsigned int i = 0;
 
-   while ((0<i--)&&(timeout!=gPollInfo.objects[i].timeout));
+   for(i=0; i<MainLoopCmdQueueSize; i++)
+   {
+      gCmdQueue[i].seq  = i;
+      gCmdQueue[i].done = NULL;
+   }
+   gCmdQueueHead = 0;
+   __atomic_store_n(&gCmdQueueTail, 0, __ATOMIC_RELEASE);
+}
+
+
+
+/// wait until the mainloop has taken commands from the full command queue, at most MainLoopCmdQueueWaitTime
+static void cmd_queue_wait_for_space(void)
+{
+   struct timespec ts;
 
-   if (0<i)
+   clock_gettime(CLOCK_REALTIME, &ts);
+   ts.tv_nsec += MainLoopCmdQueueWaitTime * 1000000;
+   if(ts.tv_nsec >= 1000000000)
    {
-      if (-1==close(gPollInfo.fds[i].fd))
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+   }
+
+   __atomic_fetch_add(&gCmdQueueWaiters, 1, __ATOMIC_SEQ_CST);
+   pthread_mutex_lock(&gMainCondMtx);
+   (void)pthread_cond_timedwait(&gMainLoopCond, &gMainCondMtx, &ts);
+   pthread_mutex_unlock(&gMainCondMtx);
+   __atomic_fetch_sub(&gCmdQueueWaiters, 1, __ATOMIC_SEQ_CST);
+}
+
+
+
+/**
+ * @brief add a command to the command queue and wake up the mainloop.
+ *        If the queue is full the sender waits until the mainloop has taken commands from the queue.
+ *
+ * @param payload the command
+ * @param done completion flag set by the mainloop when the command has been processed, NULL if not needed
+ *
+ * @return 0 on success or -1 if the mainloop is not running
+ */
+static int cmd_queue_put(const MainLoopData_u* payload, int* done)
+{
+   int rval = -1;
+   int fd = -1;
+   int reserved = 0;
+   int waiting = 0;
+   uint64_t wakeup = 1;
+   PersCmdQueueSlot_s* slot = NULL;
+   unsigned int pos = 0;
+
+   // the mainloop closes the eventfd only when no sender is active
+   __atomic_fetch_add(&gCmdSenders, 1, __ATOMIC_SEQ_CST);
+   fd = __atomic_load_n(&gCmdEventFd, __ATOMIC_SEQ_CST);
+   pos = __atomic_load_n(&gCmdQueueTail, __ATOMIC_RELAXED);
+
+   // reserve a slot
+   while((reserved == 0) && (fd != -1))
+   {
+      int diff = 0;
+
+      slot = &gCmdQueue[pos & (MainLoopCmdQueueSize-1)];
+      diff = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+      if(diff == 0)
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("removeTimeout - close() timerfd"), DLT_STRING(strerror(errno)) );
+         reserved = __atomic_compare_exchange_n(&gCmdQueueTail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
       }
+      else if(diff < 0)
+      {
+         // queue full: wait for the mainloop, it can't wait for itself
+         if(pthread_equal(pthread_self(), gMainLoopThread) != 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("deliverToMainloop - command queue full, cmd:"), DLT_INT(payload->message.cmd));
+            fd = -1;
+         }
+         else
+         {
+            if(waiting == 0)
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("deliverToMainloop - command queue full, waiting, cmd:"), DLT_INT(payload->message.cmd));
+               waiting = 1;
+            }
+            cmd_queue_wait_for_space();
+            fd  = __atomic_load_n(&gCmdEventFd, __ATOMIC_SEQ_CST);
+            pos = __atomic_load_n(&gCmdQueueTail, __ATOMIC_RELAXED);
+         }
+      }
+      else
+      {
+         pos = __atomic_load_n(&gCmdQueueTail, __ATOMIC_RELAXED);
+      }
+   }
+
+   if(reserved == 1)
+   {
+      memcpy(&slot->data, payload, sizeof(MainLoopData_u));
+      slot->done = done;
+      __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
 
-      --gPollInfo.nfds;
-      while (gPollInfo.nfds>i)
+      // the eventfd counter only fails to increase if it would overflow, the mainloop is awake then anyway
+      if(write(fd, &wakeup, sizeof(wakeup)) != (ssize_t)sizeof(wakeup))
       {
-         gPollInfo.fds[i] = gPollInfo.fds[i+1];
-         gPollInfo.objects[i] = gPollInfo.objects[i+1];
-         ++i;
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("deliverToMainloop - failed to wake up mainloop"), DLT_INT(errno));
       }
+      rval = 0;
+   }
+   else if(waiting == 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("deliverToMainloop - mainloop not running, cmd:"), DLT_INT(payload->message.cmd));
+   }
+
+   __atomic_fetch_sub(&gCmdSenders, 1, __ATOMIC_SEQ_CST);
+
+   return rval;
+}
+
+
 
-      gPollInfo.fds[gPollInfo.nfds].fd = -1;
-      gPollInfo.objects[gPollInfo.nfds].objtype = OT_NONE;
+/// complete a blocking command, result is 1 if the command has been processed or -1 if not
+static void cmd_queue_complete(int* done, int result)
+{
+   if(done != NULL)
+   {
+      pthread_mutex_lock(&gMainCondMtx);
+      *done = result;
+      pthread_cond_broadcast(&gMainLoopCond);
+      pthread_mutex_unlock(&gMainCondMtx);
    }
 }
 
 
 
-/** callback for libdbus' when timeout changed */
-static void timeoutToggled(DBusTimeout *timeout, void *data)
+/// take the next command from the command queue, returns 1 if a command has been taken
+static int cmd_queue_get(MainLoopData_u* data, int** done)
 {
-   int i = gPollInfo.nfds;
-   (void)data;
+   int rval = 0;
+   PersCmdQueueSlot_s* slot = &gCmdQueue[gCmdQueueHead & (MainLoopCmdQueueSize-1)];
 
-   while ((0<i--)&&(timeout!=gPollInfo.objects[i].timeout));
-   DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("timeoutToggled") );
-   if (0<i)
+   if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == gCmdQueueHead + 1)
    {
-      const int interval = (TRUE==dbus_timeout_get_enabled(timeout))?dbus_timeout_get_interval(timeout):0;
-      const struct itimerspec its = { .it_value= {interval/1000, interval%1000} };
-      if (-1!=timerfd_settime(gPollInfo.fds[i].fd, 0, &its, NULL))
+      memcpy(data, &slot->data, sizeof(MainLoopData_u));
+      *done = slot->done;
+      __atomic_store_n(&slot->seq, gCmdQueueHead + MainLoopCmdQueueSize, __ATOMIC_RELEASE);
+      gCmdQueueHead++;
+      rval = 1;
+   }
+
+   return rval;
+}
+
+
+
+/// process all queued commands, returns 1 if the quit command has been received
+static int process_commands(DBusConnection* conn)
+{
+   int quit = 0;
+   int* done = NULL;
+   MainLoopData_u readData;
+
+   while(cmd_queue_get(&readData, &done) == 1)
+   {
+      if(quit == 0)
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("timeoutToggled - timerfd_settime()"), DLT_STRING(strerror(errno)) );
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("mainLoop - receive cmd:"), DLT_INT(readData.message.cmd));
+         switch (readData.message.cmd)
+         {
+            case CMD_PAS_BLOCK_AND_WRITE_BACK:
+            {
+               // report the failure to the PAS if cached data could not be written back
+               int status = process_block_and_write_data_back(readData.message.params[1] /*requestID*/, readData.message.params[0] /*status*/);
+               process_send_pas_request(conn, readData.message.params[1] /*request*/, (status < 0) ? status : (int)readData.message.params[0] /*status*/);
+               break;
+            }
+            case CMD_LC_PREPARE_SHUTDOWN:
+               process_prepare_shutdown(Shutdown_Full);
+               process_send_lifecycle_request(conn, readData.message.params[1] /*requestID*/, readData.message.params[0] /*status*/);
+               break;
+            case CMD_SEND_NOTIFY_SIGNAL:
+               process_send_notification_signal(conn, readData.message.params[0] /*ldbid*/, readData.message.params[1], /*user*/
+                                                      readData.message.params[2] /*seat*/,  readData.message.params[3], /*reason*/
+                                                      readData.message.string);
+               break;
+            case CMD_SEND_NOTIFY_SIGNAL_LIST:
+               process_send_notification_signal_list(conn, (const PersNotifySignal_s*)readData.list.entries,
+                                                     readData.list.numEntries);
+               break;
+            case CMD_REG_NOTIFY_SIGNAL:
+               process_reg_notification_signal(conn, readData.message.params[0] /*ldbid*/, readData.message.params[1], /*user*/
+                                                     readData.message.params[2] /*seat*/,  readData.message.params[3], /*,policy*/
+                                                     readData.message.string);
+               break;
+            case CMD_REG_NOTIFY_SIGNAL_LIST:
+               process_reg_notification_signal_list(conn, (const PersNotifySignal_s*)readData.list.entries,
+                                                    readData.list.numEntries);
+               break;
+            case CMD_SEND_PAS_REGISTER:
+               process_send_pas_register(conn, readData.message.params[0] /*regType*/, readData.message.params[1] /*notifyFlag*/);
+               break;
+            case CMD_SEND_LC_REGISTER:
+               process_send_lifecycle_register(conn, readData.message.params[0] /*regType*/, readData.message.params[1] /*mode*/);
+               break;
+            case CMD_QUIT:
+               quit = 1;
+               break;
+            default:
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - command not handled"), DLT_INT(readData.message.cmd) );
+               break;
+         }
       }
+      else
+      {
+         // commands sent after the quit command are not processed, blocked senders are released
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("mainLoop - cmd after quit not processed:"), DLT_INT(readData.message.cmd));
+      }
+
+      cmd_queue_complete(done, ((quit == 0) || (readData.message.cmd == CMD_QUIT)) ? 1 : -1);
+   }
+
+   // wake up senders waiting for a free slot
+   if(__atomic_load_n(&gCmdQueueWaiters, __ATOMIC_SEQ_CST) > 0)
+   {
+      pthread_mutex_lock(&gMainCondMtx);
+      pthread_cond_broadcast(&gMainLoopCond);
+      pthread_mutex_unlock(&gMainCondMtx);
+   }
+
+   return quit;
+}
+
+
+
+/// stop the command queue when the mainloop ends: no command can be added anymore,
+/// the senders of commands which have not been processed are released
+static void cmd_queue_shutdown(void)
+{
+   int* done = NULL;
+   MainLoopData_u readData;
+   int fd = __atomic_exchange_n(&gCmdEventFd, -1, __ATOMIC_SEQ_CST);
+
+   // wake up senders waiting for a free slot, they give up now
+   pthread_mutex_lock(&gMainCondMtx);
+   pthread_cond_broadcast(&gMainLoopCond);
+   pthread_mutex_unlock(&gMainCondMtx);
+
+   // senders which have seen the eventfd may still add a command
+   while(__atomic_load_n(&gCmdSenders, __ATOMIC_SEQ_CST) != 0)
+   {
+      (void)sched_yield();
+   }
+
+   while(cmd_queue_get(&readData, &done) == 1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("mainLoop - cmd after quit not processed:"), DLT_INT(readData.message.cmd));
+      cmd_queue_complete(done, -1);
+   }
+
+   if(fd != -1)
+   {
+      close(fd);
    }
 }
 
@@ -511,6 +1166,7 @@ int mainLoop(DBusObjectPathVTable vtable, DBusObjectPathVTable vtable2,
              DBusObjectPathVTable vtableFallback, void* userData)
 {
    DBusError err;
+   int cmdFd = -1;
    // lock mutex to make sure dbus main loop is running
    pthread_mutex_lock(&gDbusInitializedMtx);
 
@@ -525,24 +1181,50 @@ int mainLoop(DBusObjectPathVTable vtable, DBusObjectPathVTable vtable2,
    else if (NULL != conn)
    {
       dbus_connection_set_exit_on_disconnect(conn, FALSE);
-      //if (-1 == (gEfds = eventfd(0, 0)))
-      if (-1 == (pipe(gPipeFd)))
+
+      cmd_queue_init();
+
+      memset(&gPollInfo, 0 , sizeof(gPollInfo));
+
+      if (-1 == (gPollInfo.epollFd = epoll_create1(EPOLL_CLOEXEC)))
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - epoll_create1() failed w/ errno:"), DLT_INT(errno) );
+      }
+      else if (-1 == (cmdFd = eventfd(0, EFD_CLOEXEC)))
       {
          DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - eventfd() failed w/ errno:"), DLT_INT(errno) );
       }
       else
       {
-         int ret;
-         memset(&gPollInfo, 0 , sizeof(gPollInfo));
+         int nEvents = 0;
+         int notifyTimerFd = -1;
+         int rctTimerFd = -1;
 
-         gPollInfo.nfds = 1;
-         gPollInfo.fds[0].fd = gPipeFd[0];
-         gPollInfo.fds[0].events = POLLIN;
+         // commands can be sent from now on
+         __atomic_store_n(&gCmdEventFd, cmdFd, __ATOMIC_SEQ_CST);
+
+         process_notify_filter_init();
+         process_notify_batch_init();
+         notifyTimerFd = process_notify_coalesce_init();
+         rctTimerFd = resource_cfg_check_timer_init();
+
+         bContinue = (NULL != add_poll_entry(gCmdEventFd, OT_CMD, EPOLLIN));
+
+         if((notifyTimerFd != -1) && (NULL == add_poll_entry(notifyTimerFd, OT_NOTIFY_TIMER, EPOLLIN)))
+         {
+            bContinue = 0;
+         }
+
+         if((rctTimerFd != -1) && (NULL == add_poll_entry(rctTimerFd, OT_RCT_TIMER, EPOLLIN)))
+         {
+            bContinue = 0;
+         }
 
          dbus_bus_add_match(conn, "type='signal',interface='org.genivi.persistence.admin',member='PersistenceModeChanged',path='/org/genivi/persistence/admin'", &err);
 
          // register for messages
-         if (   (TRUE==dbus_connection_register_object_path(conn, gDbusLcConsPath, &vtable2, userData))
+         if (   (0 != bContinue)
+             && (TRUE==dbus_connection_register_object_path(conn, gDbusLcConsPath, &vtable2, userData))
 #if USE_PASINTERFACE == 1
              && (TRUE==dbus_connection_register_object_path(conn, gPersAdminConsumerPath, &vtable, userData))
 #endif
@@ -555,135 +1237,99 @@ int mainLoop(DBusObjectPathVTable vtable, DBusObjectPathVTable vtable2,
             }
             else
             {
+               struct epoll_event events[MainLoopMaxEvents];
+
                pthread_cond_signal(&gDbusInitializedCond);
                pthread_mutex_unlock(&gDbusInitializedMtx);
-               do
+
+               while (0!=bContinue)
                {
-                  bContinue = 0; /* assume error */
+                  unsigned long long waitStart = 0;
+                  unsigned int numTimeouts = 0;
 
                   while(DBUS_DISPATCH_DATA_REMAINS==dbus_connection_dispatch(conn));
 
-                  while ((-1==(ret=poll(gPollInfo.fds, gPollInfo.nfds, -1)))&&(EINTR==errno));
+                  // send the change notifications collected in the last cycle
+                  process_notify_batch_flush(conn);
 
-                  if (0>ret)
-                  {
-                     DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - poll() failed w/ errno "), DLT_INT(errno) );
-                  }
-                  else if (0==ret)
+                  waitStart = mainloop_time_ms();
+                  while ((-1==(nEvents=epoll_wait(gPollInfo.epollFd, events, MainLoopMaxEvents, next_timeout(waitStart))))&&(EINTR==errno));
+                  gPollInfo.idleTime += mainloop_time_ms() - waitStart;
+                  gPollInfo.numWakeups++;
+
+                  if (0>nEvents)
                   {
-                     /* poll time-out */
+                     DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - epoll_wait() failed w/ errno "), DLT_INT(errno) );
+                     bContinue = 0;
                   }
                   else
                   {
                      int i;
-                     int bQuit = FALSE;
 
-                     for (i=0; gPollInfo.nfds>i && !bQuit; ++i)
+                     for (i=0; (nEvents>i) && (0!=bContinue); ++i)
                      {
-                        /* anything to do */
-                        if (0!=gPollInfo.fds[i].revents)
-                        {
-                           if (OT_TIMEOUT==gPollInfo.objects[i].objtype)
-                           {
-                              /* time-out occured */
-                              unsigned long long nExpCount = 0;
+                        tPollEntry* pEntry = (tPollEntry*)events[i].data.ptr;
 
-                              if ((ssize_t)sizeof(nExpCount)!=read(gPollInfo.fds[i].fd, &nExpCount, sizeof(nExpCount)))
-                              {
-                                 DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - read failed"));
-                              }
-                              DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - timeout"));
+                        gPollInfo.numEvents++;
 
-                              if (FALSE==dbus_timeout_handle(gPollInfo.objects[i].timeout))
-                              {
-                                 DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - dbus_timeout_handle() failed!?"));
-                              }
-                              bContinue = TRUE;
-                           }
-                           else if (gPollInfo.fds[i].fd == gPipeFd[0])
+                        switch(pEntry->objtype)
+                        {
+                           case OT_WATCH:
+                              handle_watch_events(pEntry, events[i].events);
+                              break;
+                           case OT_NOTIFY_TIMER:
+                              /* coalesced notification signals due */
+                              process_notify_coalesce_timeout(conn);
+                              break;
+                           case OT_RCT_TIMER:
+                              /* check for modified resource configuration tables */
+                              resource_cfg_check_timeout();
+                              break;
+                           case OT_CMD:
                            {
-
                               /* internal command */
-                              if (0!=(gPollInfo.fds[i].revents & POLLIN))
-                              {
-                              	MainLoopData_u readData;
-                                 bContinue = TRUE;
-                                 while ((-1==(ret = read(gPollInfo.fds[i].fd, readData.payload, 128)))&&(EINTR == errno));
-                                 if(ret < 0)
-                                 {
-                                    DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - read() failed"), DLT_STRING(strerror(errno)) );
-                                 }
-                                 else
-                                 {
-                                    pthread_mutex_lock(&gMainCondMtx);
-                                    //printf("--- *** --- Receive => mainloop => cmd: %d | string: %s | size: %d\n\n", readData.message.cmd, readData.message.string, ret);
-                                    DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("mainLoop - receive cmd:"), DLT_INT(readData.message.cmd));
-                                    switch (readData.message.cmd)
-                                    {
-                                       case CMD_PAS_BLOCK_AND_WRITE_BACK:
-                                          process_block_and_write_data_back(readData.message.params[1] /*requestID*/, readData.message.params[0] /*status*/);
-                                          process_send_pas_request(conn,    readData.message.params[1] /*request*/,   readData.message.params[0] /*status*/);
-                                          break;
-                                       case CMD_LC_PREPARE_SHUTDOWN:
-                                          process_prepare_shutdown(Shutdown_Full);
-                                          process_send_lifecycle_request(conn, readData.message.params[1] /*requestID*/, readData.message.params[0] /*status*/);
-                                          break;
-                                       case CMD_SEND_NOTIFY_SIGNAL:
-                                          process_send_notification_signal(conn, readData.message.params[0] /*ldbid*/, readData.message.params[1], /*user*/
-                		                                                            readData.message.params[2] /*seat*/,  readData.message.params[3], /*reason*/
-                                                                                 readData.message.string);
-                                          break;
-                                       case CMD_REG_NOTIFY_SIGNAL:
-                                          process_reg_notification_signal(conn, readData.message.params[0] /*ldbid*/, readData.message.params[1], /*user*/
-                		                                                           readData.message.params[2] /*seat*/,  readData.message.params[3], /*,policy*/
-                                                                                readData.message.string);
-                                          break;
-                                       case CMD_SEND_PAS_REGISTER:
-                                          process_send_pas_register(conn, readData.message.params[0] /*regType*/, readData.message.params[1] /*notifyFlag*/);
-                                          break;
-                                       case CMD_SEND_LC_REGISTER:
-                                          process_send_lifecycle_register(conn, readData.message.params[0] /*regType*/, readData.message.params[1] /*mode*/);
-                                          break;
-                                       case CMD_QUIT:
-                                          bContinue = 0;
-                                          bQuit = TRUE;
-                                          break;
-                                       default:
-                                          DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - command not handled"), DLT_INT(readData.message.cmd) );
-                                          break;
-                                    }
-                                    pthread_cond_signal(&gMainLoopCond);
-                                    pthread_mutex_unlock(&gMainCondMtx);
-                                 }
-                              }
-                           }
-                           else
-                           {
-                              int flags = 0;
+                              uint64_t numWakeups = 0;
+                              ssize_t readSize = 0;
 
-                              if (0!=(gPollInfo.fds[i].revents & POLLIN))
-                              {
-                                 flags |= DBUS_WATCH_READABLE;
-                              }
-                              if (0!=(gPollInfo.fds[i].revents & POLLOUT))
+                              while ((-1==(readSize = read(gCmdEventFd, &numWakeups, sizeof(numWakeups))))&&(EINTR == errno));
+                              if(readSize < 0)
                               {
-                                 flags |= DBUS_WATCH_WRITABLE;
+                                 DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("mainLoop - read() failed"), DLT_STRING(strerror(errno)) );
                               }
-                              if (0!=(gPollInfo.fds[i].revents & POLLERR))
-                              {
-                                 flags |= DBUS_WATCH_ERROR;
-                              }
-                              if (0!=(gPollInfo.fds[i].revents & POLLHUP))
+
+                              if(process_commands(conn) == 1)
                               {
-                                 flags |= DBUS_WATCH_HANGUP;
+                                 bContinue = 0;
                               }
-                              bContinue = dbus_watch_handle(gPollInfo.objects[i].watch, flags);
+                              break;
                            }
+                           default:
+                              /* removed during this cycle */
+                              break;
                         }
                      }
+
+                     if(0!=bContinue)
+                     {
+                        numTimeouts = handle_timeouts();
+                        gPollInfo.numTimeouts += numTimeouts;
+                     }
+
+                     if((0==i) && (0==numTimeouts))
+                     {
+                        gPollInfo.numIdleWakeups++;
+                     }
                   }
+
+                  free_removed_entries();
                }
-               while (0!=bContinue);
+
+               DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("mainLoop - wakeups:"), DLT_UINT(gPollInfo.numWakeups),
+                                                     DLT_STRING("idle wakeups:"), DLT_UINT(gPollInfo.numIdleWakeups),
+                                                     DLT_STRING("idle time [ms]:"), DLT_UINT64(gPollInfo.idleTime),
+                                                     DLT_STRING("events:"), DLT_UINT(gPollInfo.numEvents),
+                                                     DLT_STRING("timeouts:"), DLT_UINT(gPollInfo.numTimeouts),
+                                                     DLT_STRING("fds:"), DLT_UINT(gPollInfo.numFds));
             }
 #if USE_PASINTERFACE == 1
             dbus_connection_unregister_object_path(conn, gPersAdminConsumerPath);
@@ -692,9 +1338,31 @@ int mainLoop(DBusObjectPathVTable vtable, DBusObjectPathVTable vtable2,
             dbus_connection_unregister_object_path(conn, "/");
          }
 
-         close(gPipeFd[0]);
-         close(gPipeFd[1]);
+         // libdbus removes all watches and timeouts through the remove callbacks,
+         // remove the internal fds from the epoll instance before they are closed
+         dbus_connection_set_watch_functions(conn, NULL, NULL, NULL, NULL, NULL);
+         dbus_connection_set_timeout_functions(conn, NULL, NULL, NULL, NULL, NULL);
+         while(gPollInfo.entries != NULL)
+         {
+            remove_poll_entry(gPollInfo.entries);
+         }
+         free_removed_entries();
+
+         // send the coalesced and batched notification signals before the connection is closed
+         process_notify_coalesce_deinit(conn);
+         resource_cfg_check_timer_deinit();
+         process_notify_batch_flush(conn);
+         dbus_connection_flush(conn);
+
+         cmd_queue_shutdown();
       }
+
+      if(-1 != gPollInfo.epollFd)
+      {
+         close(gPollInfo.epollFd);
+         gPollInfo.epollFd = -1;
+      }
+
       dbus_connection_close(conn);
       dbus_connection_unref(conn);
       dbus_shutdown();
@@ -710,35 +1378,31 @@ int mainLoop(DBusObjectPathVTable vtable, DBusObjectPathVTable vtable2,
 int deliverToMainloop(MainLoopData_u* payload)
 {
    int rval = 0;
+   int done = 0;
 
-   pthread_mutex_lock(&gDeliverpMtx);
-
-   pthread_mutex_lock(&gMainCondMtx);
-
-   deliverToMainloop_NM(payload);
-
-   pthread_cond_wait(&gMainLoopCond, &gMainCondMtx);
-   pthread_mutex_unlock(&gMainCondMtx);
-
+   rval = cmd_queue_put(payload, &done);
+   if(rval == 0)
+   {
+      // wait until the mainloop has processed the command (or released it when it ends)
+      pthread_mutex_lock(&gMainCondMtx);
+      while(done == 0)
+      {
+         pthread_cond_wait(&gMainLoopCond, &gMainCondMtx);
+      }
+      pthread_mutex_unlock(&gMainCondMtx);
 
-   pthread_mutex_unlock(&gDeliverpMtx);
+      if(done != 1)
+      {
+         rval = -1;
+      }
+   }
 
    return rval;
 }
 
-int deliverToMainloop_NM(MainLoopData_u* payload)
-{
-   int rval = 0, length = 128;
-
-   //length = sizeof(payload->message) + strlen(payload->message.string) + 1; // TODO calculate the correct length of the message
 
-   //printf("--- *** --- Send => deliverToMainloop_NM => %d: | String: %s | size: %d\n", payload->message.cmd, payload->message.string, length);
 
-   if(-1 == write(gPipeFd[1], payload->payload, length))
-   {
-     DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("deliverToMainloop => failed to write to pipe"), DLT_INT(errno));
-     rval = -1;
-   }
-   return rval;
+int deliverToMainloop_NM(MainLoopData_u* payload)
+{
+   return cmd_queue_put(payload, NULL);
 }
-
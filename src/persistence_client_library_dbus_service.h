@@ -20,7 +20,7 @@
  */
 
 #include <dbus/dbus.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <pthread.h>
 #include <sys/eventfd.h>
 #include <sys/timerfd.h>
@@ -38,8 +38,12 @@ typedef enum ECmd
    CMD_LC_PREPARE_SHUTDOWN,
    /// command send changed notification signal
    CMD_SEND_NOTIFY_SIGNAL,
+   /// command send a list of changed notification signals
+   CMD_SEND_NOTIFY_SIGNAL_LIST,
    /// command send register/unregister command
    CMD_REG_NOTIFY_SIGNAL,
+   /// command send a list of register/unregister commands
+   CMD_REG_NOTIFY_SIGNAL_LIST,
    /// command send admin register/unregister
    CMD_SEND_PAS_REGISTER,
    /// command send lifecycle register/unregister
@@ -62,11 +66,38 @@ typedef union MainLoopData_u_{
 		char string[DbKeyMaxLen];
 	} message;
 
+	/// list message structure, the list must stay valid until
+	/// the command has been processed (use deliverToMainloop)
+	struct {
+		/// dbus mainloop command
+		uint32_t cmd;
+		/// number of list entries
+		uint32_t numEntries;
+		/// the list entries
+		void* entries;
+	} list;
+
 	/// the message payload
 	char payload[128];
 } MainLoopData_u;
 
 
+/// change notification signal data
+typedef struct _PersNotifySignal_s
+{
+   /// logical database id
+   unsigned int ldbid;
+   /// user number
+   unsigned int user_no;
+   /// seat number
+   unsigned int seat_no;
+   /// notification reason, see ::pclNotifyStatus_e
+   unsigned int reason;
+   /// the resource id
+   char key[DbKeyMaxLen];
+} PersNotifySignal_s;
+
+
 /// mutex to make sure main loop is running
 extern pthread_mutex_t gDbusInitializedMtx;
 /// dbus init conditional variable
@@ -127,24 +158,29 @@ int setup_dbus_mainloop(void);
 
 /**
  * @brief deliver message to mainloop (blocking)
- *        The function blocks until the message has
- *        been delivered to the mainloop
+ *        The message is added to the command queue of the mainloop,
+ *        the function blocks until the mainloop has processed the message.
+ *        Use it for commands that need the result of the mainloop or
+ *        reference data of the caller (list commands).
  *
  * @param payload the message to deliver to the mainloop (command and data)
  *
- * @return 0
+ * @return 0 on success or -1 if the mainloop is not running or has ended before processing the message
  */
 int deliverToMainloop(MainLoopData_u* payload);
 
 
 /**
  * @brief deliver message to mainloop (non blocking)
- *        The function does N O T  block until the message has
- *        been delivered to the mainloop
+ *        The message is copied into the lock free command queue of the mainloop
+ *        and the mainloop is woken up, the function does N O T  wait until
+ *        the message has been processed (fire and forget).
+ *        Commands are processed in the order they have been queued.
+ *        If the command queue is full the function waits until the mainloop has taken commands from the queue.
  *
  * @param payload the message to deliver to the mainloop (command and data)
  *
- * @return 0
+ * @return 0 on success or -1 if the mainloop is not running
  */
 int deliverToMainloop_NM(MainLoopData_u* payload);
 
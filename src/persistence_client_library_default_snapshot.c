@@ -0,0 +1,570 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_default_snapshot.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the read only snapshot of the default databases
+ * @see
+ */
+
+#include "persistence_client_library_default_snapshot.h"
+#include "persistence_client_library_db_access.h"
+
+#include <persComDbAccess.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/// snapshot file identifier "PCLS"
+static const uint32_t gSnapshotMagic   = 0x534C4350;
+/// snapshot file format version
+static const uint32_t gSnapshotVersion = 1;
+
+
+/// snapshot file header
+typedef struct _PersSnapshotHeader_s
+{
+   /// file identifier
+   uint32_t magic;
+   /// file format version
+   uint32_t version;
+   /// number of keys
+   uint32_t numKeys;
+   /// not used, alignment
+   uint32_t reserved;
+   /// modification time of the database the snapshot has been created from
+   uint64_t srcMtime;
+   /// size of the database the snapshot has been created from
+   uint64_t srcSize;
+} PersSnapshotHeader_s;
+
+
+/// snapshot key entry, the entries are sorted by key
+typedef struct _PersSnapshotEntry_s
+{
+   /// offset of the key string
+   uint32_t keyOffset;
+   /// offset of the data
+   uint32_t dataOffset;
+   /// size of the data
+   uint32_t dataSize;
+} PersSnapshotEntry_s;
+
+
+struct _PersDefaultSnapshot_s
+{
+   /// next snapshot in the snapshot list
+   struct _PersDefaultSnapshot_s* next;
+   /// path of the database the snapshot has been created from
+   char dbFile[DbPathMaxLen];
+   /// the snapshot image (header, entries, keys and data), NULL if the snapshot could not be created
+   const unsigned char* image;
+   /// size of the image
+   size_t size;
+   /// the image is mapped from the snapshot file (1) or allocated (0)
+   int mapped;
+   /// number of readers using the snapshot, see ::default_snapshot_get
+   unsigned int refCount;
+   /// the snapshot has been removed from the snapshot list, it is freed when the last reader has released it
+   int retired;
+};
+
+
+/// snapshot is enabled (1), disabled (0) or not yet checked (-1)
+static int gDefaultSnapshotEnabled = -1;
+/// snapshots of the configurable default and factory default databases
+static PersDefaultSnapshot_s* gDefaultSnapshotList = NULL;
+/// mutex to protect the snapshot table
+static pthread_mutex_t gDefaultSnapshotMtx = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+int default_snapshot_enabled(void)
+{
+   if(gDefaultSnapshotEnabled == -1)
+   {
+      const char* pEnabled = getenv("PERS_CLIENT_DEFAULT_SNAPSHOT");
+      gDefaultSnapshotEnabled = ((pEnabled != NULL) && (atoi(pEnabled) == 1)) ? 1 : 0;
+   }
+
+   return gDefaultSnapshotEnabled;
+}
+
+
+
+static int snapshot_key_cmp(const void* a, const void* b)
+{
+   return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+
+/// check the image header and all entries, returns 1 if the image is valid for the database.
+/// The file may be truncated or corrupt, every key and data range must be inside the image.
+static int snapshot_is_valid(const unsigned char* image, size_t size, const struct stat* srcStat)
+{
+   int valid = 0;
+   const PersSnapshotHeader_s* header = (const PersSnapshotHeader_s*)image;
+
+   if(   (size >= sizeof(PersSnapshotHeader_s))
+      && (size <= UINT32_MAX)
+      && (header->magic    == gSnapshotMagic)
+      && (header->version  == gSnapshotVersion)
+      && (header->srcMtime == (uint64_t)srcStat->st_mtime)
+      && (header->srcSize  == (uint64_t)srcStat->st_size)
+      && (header->numKeys <= (size - sizeof(PersSnapshotHeader_s)) / sizeof(PersSnapshotEntry_s)) )
+   {
+      const PersSnapshotEntry_s* entries = (const PersSnapshotEntry_s*)(header + 1);
+      const size_t tableEnd = sizeof(PersSnapshotHeader_s) + header->numKeys * sizeof(PersSnapshotEntry_s);
+      const char* prevKey = NULL;
+      unsigned int i = 0;
+
+      valid = 1;
+
+      for(i=0; (i<header->numKeys) && (valid == 1); i++)
+      {
+         const char* key = (const char*)image + entries[i].keyOffset;
+
+         if(   (entries[i].keyOffset < tableEnd)
+            || (entries[i].keyOffset >= size)
+            || (memchr(key, '\0', size - entries[i].keyOffset) == NULL)                 // key terminated
+            || (entries[i].dataOffset < tableEnd)
+            || (entries[i].dataOffset > size)
+            || (entries[i].dataSize > size - entries[i].dataOffset)
+            || (entries[i].dataSize > INT32_MAX)
+            || ((prevKey != NULL) && (strcmp(prevKey, key) >= 0)) )                       // sorted for the binary search
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("snapshot_is_valid - invalid entry:"), DLT_UINT(i));
+            valid = 0;
+         }
+         prevKey = key;
+      }
+   }
+
+   return valid;
+}
+
+
+
+static PersDefaultSnapshot_s* snapshot_map(const char* snapPath, const struct stat* srcStat)
+{
+   PersDefaultSnapshot_s* snapshot = NULL;
+   int fd = open(snapPath, O_RDONLY);
+
+   if(fd != -1)
+   {
+      struct stat snapStat;
+
+      if((fstat(fd, &snapStat) != -1) && (snapStat.st_size >= (off_t)sizeof(PersSnapshotHeader_s)))
+      {
+         void* image = mmap(NULL, snapStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+         if(image != MAP_FAILED)
+         {
+            if(snapshot_is_valid(image, snapStat.st_size, srcStat) == 1)
+            {
+               snapshot = calloc(1, sizeof(PersDefaultSnapshot_s));
+            }
+
+            if(snapshot != NULL)
+            {
+               snapshot->image  = image;
+               snapshot->size   = snapStat.st_size;
+               snapshot->mapped = 1;
+            }
+            else
+            {
+               munmap(image, snapStat.st_size);
+            }
+         }
+      }
+      close(fd);
+   }
+
+   return snapshot;
+}
+
+
+
+/// create the snapshot image from the database, returns the image size or 0 on error
+static size_t snapshot_create_image(int handleDB, const struct stat* srcStat, unsigned char** pImage)
+{
+   size_t size = 0;
+   int listSize = persComDbGetSizeKeysList(handleDB);
+   char* keyList = (listSize > 0) ? malloc(listSize) : NULL;
+   char** keys = NULL;
+   int* dataSizes = NULL;
+   unsigned int numKeys = 0, i = 0;
+   int pos = 0;
+
+   *pImage = NULL;
+
+   if((listSize > 0) && ((keyList == NULL) || (persComDbGetKeysList(handleDB, keyList, listSize) < 0)))
+   {
+      listSize = -1;
+   }
+
+   for(pos=0; pos<listSize; pos += strlen(keyList+pos) + 1)
+   {
+      numKeys++;
+   }
+
+   if(listSize >= 0)
+   {
+      keys      = malloc((numKeys + 1) * sizeof(char*));
+      dataSizes = malloc((numKeys + 1) * sizeof(int));
+   }
+
+   if((keys != NULL) && (dataSizes != NULL))
+   {
+      size = sizeof(PersSnapshotHeader_s) + numKeys * sizeof(PersSnapshotEntry_s);
+
+      for(pos=0, i=0; pos<listSize; pos += strlen(keyList+pos) + 1, i++)
+      {
+         keys[i] = keyList+pos;
+      }
+      qsort(keys, numKeys, sizeof(char*), snapshot_key_cmp);
+
+      for(i=0; i<numKeys; i++)
+      {
+         dataSizes[i] = persComDbGetKeySize(handleDB, keys[i]);
+         if(dataSizes[i] < 0)
+         {
+            size = 0;
+            break;
+         }
+         size += strlen(keys[i]) + 1 + dataSizes[i];
+      }
+
+      if((size > 0) && (size <= UINT32_MAX))
+      {
+         *pImage = malloc(size);
+      }
+   }
+
+   if(*pImage != NULL)
+   {
+      PersSnapshotHeader_s* header = (PersSnapshotHeader_s*)*pImage;
+      PersSnapshotEntry_s* entries = (PersSnapshotEntry_s*)(header + 1);
+      uint32_t offset = sizeof(PersSnapshotHeader_s) + numKeys * sizeof(PersSnapshotEntry_s);
+
+      header->magic    = gSnapshotMagic;
+      header->version  = gSnapshotVersion;
+      header->numKeys  = numKeys;
+      header->reserved = 0;
+      header->srcMtime = (uint64_t)srcStat->st_mtime;
+      header->srcSize  = (uint64_t)srcStat->st_size;
+
+      for(i=0; i<numKeys; i++)
+      {
+         size_t keyLen = strlen(keys[i]) + 1;
+
+         entries[i].keyOffset = offset;
+         memcpy(*pImage + offset, keys[i], keyLen);
+         offset += keyLen;
+
+         entries[i].dataOffset = offset;
+         entries[i].dataSize   = dataSizes[i];
+         if(   (dataSizes[i] > 0)
+            && (persComDbReadKey(handleDB, keys[i], (char*)*pImage + offset, dataSizes[i]) != dataSizes[i]) )
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("snapshot_create_image - failed to read key:"), DLT_STRING(keys[i]));
+            free(*pImage);
+            *pImage = NULL;
+            size = 0;
+            break;
+         }
+         offset += dataSizes[i];
+      }
+   }
+   else
+   {
+      size = 0;
+   }
+
+   free(dataSizes);
+   free(keys);
+   free(keyList);
+
+   return size;
+}
+
+
+
+/// write the image to a temporary file and rename it, so other processes never see a partial snapshot
+static int snapshot_write_file(const char* snapPath, const unsigned char* image, size_t size)
+{
+   int rval = -1;
+   char tmpPath[DbPathMaxLen] = {0};
+   int fd = -1;
+
+   snprintf(tmpPath, DbPathMaxLen, "%s.%d", snapPath, (int)getpid());
+
+   fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+   if(fd != -1)
+   {
+      size_t written = 0;
+
+      while(written < size)
+      {
+         ssize_t n = write(fd, image + written, size - written);
+         if(n <= 0)
+         {
+            if((n == -1) && (errno == EINTR))
+            {
+               continue;
+            }
+            break;
+         }
+         written += n;
+      }
+
+      if((close(fd) == 0) && (written == size) && (rename(tmpPath, snapPath) == 0))
+      {
+         rval = 0;
+      }
+      else
+      {
+         remove(tmpPath);
+      }
+   }
+
+   return rval;
+}
+
+
+
+static PersDefaultSnapshot_s* snapshot_create(const char* dbFile, int handleDB)
+{
+   PersDefaultSnapshot_s* snapshot = NULL;
+   char snapPath[DbPathMaxLen] = {0};
+   struct stat srcStat;
+   struct timespec start, end;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   snprintf(snapPath, DbPathMaxLen, "%s.snap", dbFile);
+
+   if(stat(dbFile, &srcStat) != -1)
+   {
+      // use the snapshot of a previous run or of another process if still valid
+      snapshot = snapshot_map(snapPath, &srcStat);
+      if(snapshot == NULL)
+      {
+         unsigned char* image = NULL;
+         size_t size = snapshot_create_image(handleDB, &srcStat, &image);
+
+         if(image != NULL)
+         {
+            if(snapshot_write_file(snapPath, image, size) == 0)
+            {
+               snapshot = snapshot_map(snapPath, &srcStat);
+            }
+
+            if(snapshot == NULL)
+            {
+               // snapshot file not writable, keep the image in memory (not shared with other processes)
+               snapshot = calloc(1, sizeof(PersDefaultSnapshot_s));
+               if(snapshot != NULL)
+               {
+                  snapshot->image  = image;
+                  snapshot->size   = size;
+                  snapshot->mapped = 0;
+                  image = NULL;
+               }
+            }
+            free(image);
+         }
+      }
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   if(snapshot != NULL)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("snapshot_create - default snapshot:"), DLT_STRING(snapPath),
+                                            DLT_STRING("keys:"), DLT_UINT(((const PersSnapshotHeader_s*)snapshot->image)->numKeys),
+                                            DLT_STRING("size:"), DLT_UINT(snapshot->size),
+                                            DLT_STRING("mapped:"), DLT_INT(snapshot->mapped),
+                                            DLT_STRING("time [us]:"),
+                                            DLT_INT((int)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000)));
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("snapshot_create - failed to create default snapshot:"), DLT_STRING(snapPath));
+   }
+
+   return snapshot;
+}
+
+
+
+PersDefaultSnapshot_s* default_snapshot_get(const char* dbFile, int handleDB)
+{
+   PersDefaultSnapshot_s* snapshot = NULL;
+
+   if(default_snapshot_enabled() == 1)
+   {
+      pthread_mutex_lock(&gDefaultSnapshotMtx);
+
+      for(snapshot = gDefaultSnapshotList; snapshot != NULL; snapshot = snapshot->next)
+      {
+         if(strncmp(snapshot->dbFile, dbFile, DbPathMaxLen) == 0)
+         {
+            break;
+         }
+      }
+
+      if(snapshot == NULL)
+      {
+         snapshot = snapshot_create(dbFile, handleDB);
+         if(snapshot == NULL)
+         {
+            // remember the failure, the snapshot is not created again
+            snapshot = calloc(1, sizeof(PersDefaultSnapshot_s));
+         }
+
+         if(snapshot != NULL)
+         {
+            strncpy(snapshot->dbFile, dbFile, DbPathMaxLen);
+            snapshot->dbFile[DbPathMaxLen-1] = '\0';
+            snapshot->next = gDefaultSnapshotList;
+            gDefaultSnapshotList = snapshot;
+         }
+      }
+
+      if((snapshot != NULL) && (snapshot->image == NULL))
+      {
+         snapshot = NULL;
+      }
+
+      // the snapshot stays mapped until the reader has released it, even if all snapshots are closed meanwhile
+      if(snapshot != NULL)
+      {
+         snapshot->refCount++;
+      }
+
+      pthread_mutex_unlock(&gDefaultSnapshotMtx);
+   }
+
+   return snapshot;
+}
+
+
+
+/// unmap and free a snapshot
+static void snapshot_free(PersDefaultSnapshot_s* snapshot)
+{
+   if(snapshot->mapped == 1)
+   {
+      munmap((void*)snapshot->image, snapshot->size);
+   }
+   else
+   {
+      free((void*)snapshot->image);
+   }
+   free(snapshot);
+}
+
+
+
+void default_snapshot_put(PersDefaultSnapshot_s* snapshot)
+{
+   if(snapshot != NULL)
+   {
+      pthread_mutex_lock(&gDefaultSnapshotMtx);
+
+      snapshot->refCount--;
+      if((snapshot->retired == 1) && (snapshot->refCount == 0))
+      {
+         snapshot_free(snapshot);
+      }
+
+      pthread_mutex_unlock(&gDefaultSnapshotMtx);
+   }
+}
+
+
+
+int default_snapshot_read(const PersDefaultSnapshot_s* snapshot, const char* key, unsigned char* buffer, unsigned int buffer_size)
+{
+   int rval = EPERS_NOKEY;
+   const PersSnapshotHeader_s* header = (const PersSnapshotHeader_s*)snapshot->image;
+   const PersSnapshotEntry_s* entries = (const PersSnapshotEntry_s*)(header + 1);
+   unsigned int low = 0, high = header->numKeys;
+
+   while(low < high)
+   {
+      unsigned int mid = low + (high - low) / 2;
+      int cmp = strcmp(key, (const char*)snapshot->image + entries[mid].keyOffset);
+
+      if(cmp == 0)
+      {
+         if(buffer == NULL)
+         {
+            rval = (int)entries[mid].dataSize;
+         }
+         else
+         {
+            rval = (int)((entries[mid].dataSize < buffer_size) ? entries[mid].dataSize : buffer_size);
+            memcpy(buffer, snapshot->image + entries[mid].dataOffset, rval);
+         }
+         break;
+      }
+      else if(cmp < 0)
+      {
+         high = mid;
+      }
+      else
+      {
+         low = mid + 1;
+      }
+   }
+
+   return rval;
+}
+
+
+
+void default_snapshot_close_all(void)
+{
+   pthread_mutex_lock(&gDefaultSnapshotMtx);
+
+   while(gDefaultSnapshotList != NULL)
+   {
+      PersDefaultSnapshot_s* snapshot = gDefaultSnapshotList;
+
+      gDefaultSnapshotList = snapshot->next;
+
+      // snapshots still used by a reader are freed when released
+      if(snapshot->refCount == 0)
+      {
+         snapshot_free(snapshot);
+      }
+      else
+      {
+         snapshot->retired = 1;
+      }
+   }
+
+   pthread_mutex_unlock(&gDefaultSnapshotMtx);
+}
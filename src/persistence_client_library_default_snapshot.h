@@ -0,0 +1,84 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_DEFAULT_SNAPSHOT_H
+#define PERSISTENCE_CLIENT_LIBRARY_DEFAULT_SNAPSHOT_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_default_snapshot.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the read only snapshot of the default databases.
+ *                 The configurable default and factory default databases don't
+ *                 change at runtime. On first use a sorted snapshot of the
+ *                 database is written next to the database ("<db>.snap") and
+ *                 mapped into memory, default values are then read from the
+ *                 mapping without accessing the database.
+ *                 The snapshot is enabled with the environment variable
+ *                 PERS_CLIENT_DEFAULT_SNAPSHOT=1
+ * @see
+ */
+
+#include "persistence_client_library_data_organization.h"
+
+
+/// snapshot of a default database
+typedef struct _PersDefaultSnapshot_s PersDefaultSnapshot_s;
+
+
+/**
+ * @brief check if the default database snapshot is enabled
+ *
+ * @return 1 if enabled, 0 if not
+ */
+int default_snapshot_enabled(void);
+
+
+/**
+ * @brief get the snapshot of a default database, the snapshot is created on first use.
+ *        The snapshot must be released with ::default_snapshot_put when it is not used anymore.
+ *
+ * @param dbFile the path of the database file
+ * @param handleDB the handle of the opened database, used to create the snapshot
+ *
+ * @return the snapshot or NULL if the snapshot is disabled or not available
+ */
+PersDefaultSnapshot_s* default_snapshot_get(const char* dbFile, int handleDB);
+
+
+/**
+ * @brief release a snapshot returned by ::default_snapshot_get
+ *
+ * @param snapshot the snapshot, may be NULL
+ */
+void default_snapshot_put(PersDefaultSnapshot_s* snapshot);
+
+
+/**
+ * @brief read a default value from a snapshot
+ *
+ * @param snapshot the snapshot
+ * @param key the database key
+ * @param buffer the buffer for the data, NULL to get the size of the data only
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes read (or the size of the data if buffer is NULL)
+ *         or EPERS_NOKEY if the key is not in the database
+ */
+int default_snapshot_read(const PersDefaultSnapshot_s* snapshot, const char* key, unsigned char* buffer, unsigned int buffer_size);
+
+
+/**
+ * @brief unmap and free all snapshots, snapshots still used by a reader are freed when released
+ */
+void default_snapshot_close_all(void);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_DEFAULT_SNAPSHOT_H */
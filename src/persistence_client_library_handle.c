@@ -110,7 +110,8 @@ void close_all_persistence_handle()
 }
 
 
-int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned int user_no, unsigned int seat_no)
+int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned int user_no, unsigned int seat_no,
+                        const PersistenceInfo_s* info, const char* dbKey, const char* dbPath, unsigned int generation)
 {
 	int handle = -1;
 
@@ -124,6 +125,14 @@ int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned i
 			gKeyHandleArray[idx].user_no = user_no;
 			gKeyHandleArray[idx].seat_no = seat_no;
 
+			memcpy(&gKeyHandleArray[idx].info, info, sizeof(gKeyHandleArray[idx].info));
+			strncpy(gKeyHandleArray[idx].dbKey, dbKey, DbKeyMaxLen);
+			gKeyHandleArray[idx].dbKey[DbKeyMaxLen-1] = '\0';
+			strncpy(gKeyHandleArray[idx].dbPath, dbPath, DbPathMaxLen);
+			gKeyHandleArray[idx].dbPath[DbPathMaxLen-1] = '\0';
+			gKeyHandleArray[idx].ctxGeneration = generation;
+			gKeyHandleArray[idx].customOpen = 0;
+
 			handle = idx;
 		}
 		else
@@ -138,6 +147,77 @@ int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned i
 }
 
 
+int set_key_handle_context(int idx, const PersistenceKeyHandle_s* handleStruct)
+{
+	int rval = -1;
+
+	if(pthread_mutex_lock(&gKeyHandleAccessMtx) == 0)
+	{
+		// the handle may have been closed or reused in the meantime
+		if(   (idx < MaxPersHandle) && (0 < idx)
+		   && (strncmp(gKeyHandleArray[idx].resource_id, handleStruct->resource_id, DbResIDMaxLen) == 0) )
+		{
+			memcpy(&gKeyHandleArray[idx].info, &handleStruct->info, sizeof(gKeyHandleArray[idx].info));
+			memcpy(gKeyHandleArray[idx].dbKey,  handleStruct->dbKey,  DbKeyMaxLen);
+			memcpy(gKeyHandleArray[idx].dbPath, handleStruct->dbPath, DbPathMaxLen);
+			gKeyHandleArray[idx].ctxGeneration = handleStruct->ctxGeneration;
+			gKeyHandleArray[idx].customOpen    = handleStruct->customOpen;
+
+			rval = 0;
+		}
+
+		pthread_mutex_unlock(&gKeyHandleAccessMtx);
+	}
+
+	return rval;
+}
+
+
+int set_key_handle_custom_data(int idx, int customIdx, int customHandle, unsigned int generation, const char* path)
+{
+	int rval = -1;
+
+	if(pthread_mutex_lock(&gKeyHandleAccessMtx) == 0)
+	{
+		if((idx < MaxPersHandle) && (0 < idx))
+		{
+			gKeyHandleArray[idx].customOpen   = 1;
+			gKeyHandleArray[idx].customIdx    = customIdx;
+			gKeyHandleArray[idx].customHandle = customHandle;
+			gKeyHandleArray[idx].customGeneration = generation;
+			strncpy(gKeyHandleArray[idx].customPath, path, sizeof(gKeyHandleArray[idx].customPath));
+			gKeyHandleArray[idx].customPath[sizeof(gKeyHandleArray[idx].customPath)-1] = '\0';
+
+			rval = 0;
+		}
+
+		pthread_mutex_unlock(&gKeyHandleAccessMtx);
+	}
+
+	return rval;
+}
+
+
+void close_key_handle_custom_data(int customIdx, int (*closeFunct)(int))
+{
+	int idx = 0;
+
+	if(pthread_mutex_lock(&gKeyHandleAccessMtx) == 0)
+	{
+		for(idx=1; idx<MaxPersHandle; idx++)
+		{
+			if((gKeyHandleArray[idx].customOpen == 1) && (gKeyHandleArray[idx].customIdx == customIdx))
+			{
+				(void)closeFunct(gKeyHandleArray[idx].customHandle);
+				gKeyHandleArray[idx].customOpen = 0;
+			}
+		}
+
+		pthread_mutex_unlock(&gKeyHandleAccessMtx);
+	}
+}
+
+
 int get_key_handle_data(int idx, PersistenceKeyHandle_s* handleStruct)
 {
 	int rval = -1;
@@ -146,11 +226,7 @@ int get_key_handle_data(int idx, PersistenceKeyHandle_s* handleStruct)
 	{
 		if((idx < MaxPersHandle) && (idx > 0))
 		{
-			strncpy(handleStruct->resource_id, gKeyHandleArray[idx].resource_id, DbResIDMaxLen);
-
-			handleStruct->ldbid   = gKeyHandleArray[idx].ldbid;
-			handleStruct->user_no = gKeyHandleArray[idx].user_no;
-			handleStruct->seat_no = gKeyHandleArray[idx].seat_no;
+			memcpy(handleStruct, &gKeyHandleArray[idx], sizeof(PersistenceKeyHandle_s));
 
 			rval = 0;
 		}
@@ -35,6 +35,24 @@ typedef struct _PersistenceKeyHandle_s
    unsigned int user_no;
    /// Seat No
    unsigned int seat_no;
+   /// the resolved database context (resource configuration), set at handle open
+   PersistenceInfo_s info;
+   /// the resolved database key
+   char dbKey[DbKeyMaxLen];
+   /// the resolved database path
+   char dbPath[DbPathMaxLen];
+   /// generation of the resolved database context, see db_context_generation
+   unsigned int ctxGeneration;
+   /// 1 if a plugin handle has been opened (custom storage resources only)
+   int customOpen;
+   /// the plugin index of the custom storage resource
+   int customIdx;
+   /// the plugin handle of the custom storage resource
+   int customHandle;
+   /// generation of the plugin instance which opened the plugin handle
+   unsigned int customGeneration;
+   /// the plugin path of the custom storage resource
+   char customPath[128];
 } PersistenceKeyHandle_s;
 
 
@@ -97,10 +115,50 @@ void close_all_persistence_handle();
  * @param ldbid the logical database id
  * @param user_no the user identifier
  * @param seat_no the seat number
+ * @param info the resolved database context of the resource
+ * @param dbKey the resolved database key
+ * @param dbPath the resolved database path
+ * @param generation the generation of the resolved database context
  *
  * @return a positive value (0 or greather) or -1 on error
  */
-int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned int user_no, unsigned int seat_no);
+int set_key_handle_data(int idx, const char* id, unsigned int ldbid,  unsigned int user_no, unsigned int seat_no,
+                        const PersistenceInfo_s* info, const char* dbKey, const char* dbPath, unsigned int generation);
+
+
+/**
+ * @brief update the resolved database context of a key handle, after it has been resolved again
+ *
+ * @param idx the index
+ * @param handleStruct the handle structure with the new context (info, dbKey, dbPath, ctxGeneration, customOpen)
+ *
+ * @return 0 on success, -1 on error or if the handle has been closed in the meantime
+ */
+int set_key_handle_context(int idx, const PersistenceKeyHandle_s* handleStruct);
+
+
+/**
+ * @brief set the plugin handle of a custom storage resource to the key handle
+ *
+ * @param idx the index
+ * @param customIdx the plugin index
+ * @param customHandle the plugin handle
+ * @param generation the generation of the plugin instance which opened the plugin handle
+ * @param path the plugin path of the resource
+ *
+ * @return 0 on success, -1 on error
+ */
+int set_key_handle_custom_data(int idx, int customIdx, int customHandle, unsigned int generation, const char* path);
+
+
+/**
+ * @brief close the plugin handles of the open key handles of a plugin,
+ *        the key handles use the path based access afterwards
+ *
+ * @param customIdx the plugin index
+ * @param closeFunct the plugin function to close a plugin handle
+ */
+void close_key_handle_custom_data(int customIdx, int (*closeFunct)(int));
 
 
 /**
@@ -26,6 +26,7 @@
 #include "crc32.h"
 
 #include <persComRct.h>
+#include <stdlib.h>
 
 
 
@@ -34,6 +35,52 @@ static int handleRegNotifyOnChange(int key_handle, pclChangeNotifyCallback_t cal
 static int regNotifyOnChange(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no,
                       pclChangeNotifyCallback_t callback, PersNotifyRegPolicy_e regPolicy);
 
+
+
+/// resolve the database context of a key handle again if the resource configuration tables have been reloaded since it was resolved
+static void key_handle_refresh(int key_handle, PersistenceKeyHandle_s* persHandle)
+{
+   unsigned int generation = db_context_generation();
+
+   if(persHandle->ctxGeneration != generation)
+   {
+      PersistenceInfo_s dbContext;
+
+      char dbKey[DbKeyMaxLen]   = {0};    // database key
+      char dbPath[DbPathMaxLen] = {0};    // database location
+
+      dbContext.context.ldbid   = persHandle->ldbid;
+      dbContext.context.seat_no = persHandle->seat_no;
+      dbContext.context.user_no = persHandle->user_no;
+
+      if(   (get_db_context(&dbContext, persHandle->resource_id, ResIsNoFile, dbKey, dbPath) >= 0)
+         && (dbContext.configKey.type == PersistenceResourceType_key)
+         && (dbContext.configKey.storage < PersistenceStorage_LastEntry) )
+      {
+         // the plugin handle is kept only if the resource is still stored by the same plugin
+         if(   (persHandle->customOpen == 1)
+            && (   (dbContext.configKey.storage != PersistenceStorage_custom)
+                || (dbContext.customIdx != persHandle->customIdx) ) )
+         {
+            (void)persistence_custom_handle_close(persHandle->customIdx, persHandle->customHandle, persHandle->customGeneration);
+            persHandle->customOpen = 0;
+         }
+
+         memcpy(&persHandle->info, &dbContext, sizeof(persHandle->info));
+         memcpy(persHandle->dbKey,  dbKey,  DbKeyMaxLen);
+         memcpy(persHandle->dbPath, dbPath, DbPathMaxLen);
+         persHandle->ctxGeneration = generation;
+
+         (void)set_key_handle_context(key_handle, persHandle);
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("key_handle_refresh - resource not resolved, keep context of:"),
+                                               DLT_STRING(persHandle->resource_id));
+      }
+   }
+}
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 // function with handle
@@ -48,6 +95,8 @@ int pclKeyHandleOpen(unsigned int ldbid, const char* resource_id, unsigned int u
    if(gPclInitialized >= PCLinitialized)
    {
       PersistenceInfo_s dbContext;
+      // read before the context is resolved, a reload in the meantime makes the handle resolve it again
+      unsigned int generation = db_context_generation();
 
       char dbKey[DbKeyMaxLen]   = {0};    // database key
       char dbPath[DbPathMaxLen] = {0};    // database location
@@ -63,7 +112,23 @@ int pclKeyHandleOpen(unsigned int ldbid, const char* resource_id, unsigned int u
          if(dbContext.configKey.storage < PersistenceStorage_LastEntry)    // check if store policy is valid
          {
 				// remember data in handle array
-				handle = set_key_handle_data(get_persistence_handle_idx(), resource_id, ldbid, user_no, seat_no);
+				// remember the resolved context too, so handle operations don't need to resolve the resource again
+				handle = set_key_handle_data(get_persistence_handle_idx(), resource_id, ldbid, user_no, seat_no,
+				                             &dbContext, dbKey, dbPath, generation);
+
+				// custom storage: open the plugin handle once, handle operations don't need to build the plugin path again
+				if((handle >= 0) && (dbContext.configKey.storage == PersistenceStorage_custom))
+				{
+				   int customIdx = 0;
+				   unsigned int customGeneration = 0;
+				   char customPath[128] = {0};
+				   int customHandle = persistence_custom_handle_open(dbKey, &dbContext, &customIdx, &customGeneration, customPath);
+
+				   if(customHandle >= 0)
+				   {
+				      (void)set_key_handle_custom_data(handle, customIdx, customHandle, customGeneration, customPath);
+				   }
+				}
          }
          else
          {
@@ -93,6 +158,11 @@ int pclKeyHandleClose(int key_handle)
       {
    		if ('\0' != persHandle.resource_id[0])
          {
+            if(persHandle.customOpen == 1)
+            {
+               (void)persistence_custom_handle_close(persHandle.customIdx, persHandle.customHandle, persHandle.customGeneration);
+            }
+
             /* Invalidate key handle data */
         	   set_persistence_handle_close_idx(key_handle);
             clear_key_handle_array(key_handle);
@@ -126,8 +196,18 @@ int pclKeyHandleGetSize(int key_handle)
       {
          if ('\0' != persHandle.resource_id[0])
          {
-        	 size = pclKeyGetSize(persHandle.ldbid, persHandle.resource_id,
-        			                persHandle.user_no, persHandle.seat_no);
+            key_handle_refresh(key_handle, &persHandle);
+
+            size = EPERS_NOPLUGINFUNCT;
+            if(persHandle.customOpen == 1)
+            {
+               size = persistence_custom_handle_get_size(persHandle.customIdx, persHandle.customHandle, persHandle.customGeneration);
+            }
+
+            if(size == EPERS_NOPLUGINFUNCT)
+            {
+               size = persistence_get_data_size(persHandle.dbPath, persHandle.dbKey, persHandle.resource_id, &persHandle.info);
+            }
          }
          else
          {
@@ -157,9 +237,27 @@ int pclKeyHandleReadData(int key_handle, unsigned char* buffer, int buffer_size)
       {
          if ('\0' != persHandle.resource_id[0])
          {
-        	 size = pclKeyReadData(persHandle.ldbid, persHandle.resource_id,
-        			                 persHandle.user_no, persHandle.seat_no,
-                                buffer, buffer_size);
+            key_handle_refresh(key_handle, &persHandle);
+
+            if(AccessNoLock != isAccessLocked() ) // check if access to persistent data is locked
+            {
+               size = 0;
+               if(persHandle.customOpen == 1)
+               {
+                  size = persistence_custom_handle_get_data(persHandle.customIdx, persHandle.customHandle, persHandle.customGeneration,
+                                                            buffer, buffer_size);
+               }
+
+               if(size < 1)   // no plugin handle or no plugin data, the path based access provides the default data
+               {
+                  size = persistence_get_data(persHandle.dbPath, persHandle.dbKey, persHandle.resource_id, &persHandle.info,
+                                              buffer, buffer_size);
+               }
+            }
+            else
+            {
+               size = EPERS_LOCKFS;
+            }
          }
          else
          {
@@ -177,21 +275,59 @@ int pclKeyHandleReadData(int key_handle, unsigned char* buffer, int buffer_size)
 
 
 
+int pclKeyHandleReadDataAlloc(int key_handle, unsigned char** buffer, int* buffer_size)
+{
+   int size = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      PersistenceKeyHandle_s persHandle;
+
+      if((buffer == NULL) || (buffer_size == NULL) || (*buffer_size < 0))
+      {
+         size = EPERS_COMMON;
+      }
+      else if(get_key_handle_data(key_handle, &persHandle) != -1)
+      {
+         if ('\0' != persHandle.resource_id[0])
+         {
+            key_handle_refresh(key_handle, &persHandle);
+
+            if(AccessNoLock != isAccessLocked() ) // check if access to persistent data is locked
+            {
+               unsigned int allocSize = (*buffer != NULL) ? (unsigned int)*buffer_size : 0;
+
+               size = persistence_get_data_alloc(persHandle.dbPath, persHandle.dbKey, persHandle.resource_id, &persHandle.info,
+                                                 buffer, &allocSize);
+               *buffer_size = (int)allocSize;
+            }
+            else
+            {
+               size = EPERS_LOCKFS;
+            }
+         }
+         else
+         {
+            size = EPERS_INVALID_HANDLE;
+         }
+      }
+      else
+      {
+         size = EPERS_MAXHANDLE;
+      }
+   }
+
+   return size;
+}
+
+
+
 int pclKeyHandleRegisterNotifyOnChange(int key_handle, pclChangeNotifyCallback_t callback)
 {
-   int rval = EPERS_COMMON;
    //DLT_LOG(gDLTContext, DLT_LOG_INFO, DLT_STRING("pclKeyHandleRegisterNotifyOnChange: "),
    //            DLT_INT(gKeyHandleArray[key_handle].info.context.ldbid), DLT_STRING(gKeyHandleArray[key_handle].resourceID) );
-   if((gChangeNotifyCallback == callback) || (gChangeNotifyCallback == NULL))
-   {
-      rval = handleRegNotifyOnChange(key_handle, callback, Notify_register);
-   }
-   else
-   {
-      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyHandleRegisterNotifyOnChange - Only one callback is allowed for change notifications."));
-      rval = EPERS_NOTIFY_NOT_ALLOWED;
-   }
-   return rval;
+   // each resource has its own callback, see persistence_notify_on_change
+   return handleRegNotifyOnChange(key_handle, callback, Notify_register);
 }
 
 int pclKeyHandleUnRegisterNotifyOnChange(int key_handle, pclChangeNotifyCallback_t callback)
@@ -244,9 +380,37 @@ int pclKeyHandleWriteData(int key_handle, unsigned char* buffer, int buffer_size
       {
          if ('\0' != persHandle.resource_id[0])
          {
-        	 size = pclKeyWriteData(persHandle.ldbid,   persHandle.resource_id,
-        			                  persHandle.user_no, persHandle.seat_no,
-                                    buffer, buffer_size);
+            key_handle_refresh(key_handle, &persHandle);
+
+            if(AccessNoLock == isAccessLocked() ) // check if access to persistent data is locked
+            {
+               size = EPERS_LOCKFS;
+            }
+            else if(buffer_size > gMaxKeyValDataSize)  // check data size
+            {
+               size = EPERS_BUFLIMIT;
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyHandleWriteData - buffer_size to big, limit is [bytes]:"), DLT_INT(gMaxKeyValDataSize));
+            }
+            else if(persHandle.info.configKey.permission == PersistencePermission_ReadOnly)  // don't write to a read only resource
+            {
+               size = EPERS_RESOURCE_READ_ONLY;
+            }
+            else
+            {
+               size = EPERS_NOPLUGINFUNCT;
+               if(persHandle.customOpen == 1)
+               {
+                  size = persistence_custom_handle_set_data(persHandle.customIdx, persHandle.customHandle, persHandle.customGeneration,
+                                                            persHandle.customPath, persHandle.resource_id, &persHandle.info,
+                                                            buffer, buffer_size);
+               }
+
+               if(size == EPERS_NOPLUGINFUNCT)   // no plugin handle or the plugin has been reloaded
+               {
+                  size = persistence_set_data(persHandle.dbPath, persHandle.dbKey, persHandle.resource_id, &persHandle.info,
+                                              buffer, buffer_size);
+               }
+            }
          }
          else
          {
@@ -406,6 +570,207 @@ int pclKeyReadData(unsigned int ldbid, const char* resource_id, unsigned int use
 
 
 
+int pclKeyReadDataById(unsigned int ldbid, const pclResourceId_s* resource, unsigned int user_no, unsigned int seat_no,
+                       unsigned char* buffer, int buffer_size)
+{
+   int data_size = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if(AccessNoLock != isAccessLocked() ) // check if access to persistent data is locked
+      {
+         PersistenceInfo_s dbContext;
+
+         char dbKey[DbKeyMaxLen]   = {0};      // database key
+         char dbPath[DbPathMaxLen] = {0};    // database location
+
+         dbContext.context.ldbid   = ldbid;
+         dbContext.context.seat_no = seat_no;
+         dbContext.context.user_no = user_no;
+
+         // get database context from the slot of the compiled resource configuration table
+         data_size = get_db_context_by_id(&dbContext, resource, dbKey, dbPath);
+         if(   (data_size >= 0)
+            && (dbContext.configKey.type == PersistenceResourceType_key) )
+         {
+            if(   dbContext.configKey.storage < PersistenceStorage_LastEntry)   // check if store policy is valid
+            {
+               data_size = persistence_get_data(dbPath, dbKey, resource->resource_id, &dbContext, buffer, buffer_size);
+            }
+            else
+            {
+               data_size = EPERS_BADPOL;
+            }
+         }
+         else
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyReadDataById - no database context or resource is not a key"));
+         }
+      }
+      else
+      {
+         data_size = EPERS_LOCKFS;
+      }
+   }
+
+   return data_size;
+}
+
+
+
+int pclKeyReadDataAlloc(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no,
+                        unsigned char** buffer, int* buffer_size)
+{
+   int data_size = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if((buffer == NULL) || (buffer_size == NULL) || (*buffer_size < 0))
+      {
+         data_size = EPERS_COMMON;
+      }
+      else if(AccessNoLock != isAccessLocked() ) // check if access to persistent data is locked
+      {
+         PersistenceInfo_s dbContext;
+
+         char dbKey[DbKeyMaxLen]   = {0};      // database key
+         char dbPath[DbPathMaxLen] = {0};    // database location
+
+         dbContext.context.ldbid   = ldbid;
+         dbContext.context.seat_no = seat_no;
+         dbContext.context.user_no = user_no;
+
+         // get database context: database path and database key
+         data_size = get_db_context(&dbContext, resource_id, ResIsNoFile, dbKey, dbPath);
+         if(   (data_size >= 0)
+            && (dbContext.configKey.type == PersistenceResourceType_key) )
+         {
+            if(   dbContext.configKey.storage < PersistenceStorage_LastEntry)   // check if store policy is valid
+            {
+               unsigned int allocSize = (*buffer != NULL) ? (unsigned int)*buffer_size : 0;
+
+               data_size = persistence_get_data_alloc(dbPath, dbKey, resource_id, &dbContext, buffer, &allocSize);
+               *buffer_size = (int)allocSize;
+            }
+            else
+            {
+               data_size = EPERS_BADPOL;
+            }
+         }
+         else
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyReadDataAlloc - no database context or resource is not a key"));
+         }
+      }
+      else
+      {
+         data_size = EPERS_LOCKFS;
+      }
+   }
+
+   return data_size;
+}
+
+
+
+/**
+ * @brief resolve the database context of all batch entries
+ *
+ * @return the resolved items (to be freed by the caller) or NULL if no memory is available
+ */
+static PersistenceBatchItem_s* resolve_batch_entries(pclKeyBatchEntry_s* entries, unsigned int num_entries)
+{
+   unsigned int i = 0;
+   PersistenceBatchItem_s* items = calloc(num_entries, sizeof(PersistenceBatchItem_s));
+
+   if(items != NULL)
+   {
+      for(i=0; i<num_entries; i++)
+      {
+         PersistenceBatchItem_s* item = &items[i];
+
+         item->info.context.ldbid   = entries[i].ldbid;
+         item->info.context.seat_no = entries[i].seat_no;
+         item->info.context.user_no = entries[i].user_no;
+         item->resource_id          = entries[i].resource_id;
+         item->buffer               = entries[i].buffer;
+         item->buffer_size          = entries[i].buffer_size;
+
+         if((entries[i].resource_id == NULL) || (entries[i].buffer == NULL) || (entries[i].buffer_size < 0))
+         {
+            item->result = EPERS_COMMON;
+         }
+         else
+         {
+            // get database context: database path and database key
+            item->result = get_db_context(&item->info, item->resource_id, ResIsNoFile, item->dbKey, item->dbPath);
+            if(item->result >= 0)
+            {
+               if(   (item->info.configKey.type != PersistenceResourceType_key)
+                  || (item->info.configKey.storage >= PersistenceStorage_LastEntry) )  // check if type and store policy is valid
+               {
+                  item->result = EPERS_BADPOL;
+               }
+               else
+               {
+                  item->result = 0;
+               }
+            }
+         }
+      }
+   }
+
+   return items;
+}
+
+
+
+int pclKeyReadDataBatch(pclKeyBatchEntry_s* entries, unsigned int num_entries)
+{
+   int numRead = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if(AccessNoLock != isAccessLocked() ) // check if access to persistent data is locked
+      {
+         if((entries != NULL) && (num_entries > 0))
+         {
+            PersistenceBatchItem_s* items = resolve_batch_entries(entries, num_entries);
+
+            if(items != NULL)
+            {
+               unsigned int i = 0;
+
+               numRead = persistence_get_data_batch(items, num_entries);
+
+               for(i=0; i<num_entries; i++)
+               {
+                  entries[i].result = items[i].result;
+               }
+               free(items);
+            }
+            else
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyReadDataBatch - failed to allocate memory"));
+               numRead = EPERS_COMMON;
+            }
+         }
+         else
+         {
+            numRead = EPERS_COMMON;
+         }
+      }
+      else
+      {
+         numRead = EPERS_LOCKFS;
+      }
+   }
+
+   return numRead;
+}
+
+
+
 int pclKeyWriteData(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no,
                    unsigned char* buffer, int buffer_size)
 {
@@ -474,6 +839,145 @@ int pclKeyWriteData(unsigned int ldbid, const char* resource_id, unsigned int us
 
 
 
+int pclKeyWriteDataById(unsigned int ldbid, const pclResourceId_s* resource, unsigned int user_no, unsigned int seat_no,
+                        unsigned char* buffer, int buffer_size)
+{
+   int data_size = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if(AccessNoLock != isAccessLocked() )     // check if access to persistent data is locked
+      {
+         if(buffer_size <= gMaxKeyValDataSize)  // check data size
+         {
+            PersistenceInfo_s dbContext;
+
+            char dbKey[DbKeyMaxLen]   = {0};      // database key
+            char dbPath[DbPathMaxLen] = {0};    // database location
+
+            dbContext.context.ldbid   = ldbid;
+            dbContext.context.seat_no = seat_no;
+            dbContext.context.user_no = user_no;
+
+            // get database context from the slot of the compiled resource configuration table
+            data_size = get_db_context_by_id(&dbContext, resource, dbKey, dbPath);
+            if(   (data_size >= 0)
+               && (dbContext.configKey.type == PersistenceResourceType_key))
+            {
+               if(dbContext.configKey.permission != PersistencePermission_ReadOnly)  // don't write to a read only resource
+               {
+                  if(   dbContext.configKey.storage < PersistenceStorage_LastEntry)   // check if store policy is valid
+                  {
+                     data_size = persistence_set_data(dbPath, dbKey, resource->resource_id, &dbContext, buffer, buffer_size);
+                  }
+                  else
+                  {
+                     data_size = EPERS_BADPOL;
+                  }
+               }
+               else
+               {
+                  data_size = EPERS_RESOURCE_READ_ONLY;
+               }
+            }
+            else
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyWriteDataById no database context or resource is not a key"));
+            }
+         }
+         else
+         {
+            data_size = EPERS_BUFLIMIT;
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyWriteDataById - buffer_size to big, limit is [bytes]:"), DLT_INT(gMaxKeyValDataSize));
+         }
+      }
+      else
+      {
+         data_size = EPERS_LOCKFS;
+      }
+   }
+   return data_size;
+}
+
+
+
+int pclKeyWriteDataBatch(pclKeyBatchEntry_s* entries, unsigned int num_entries)
+{
+   int numWritten = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if(AccessNoLock != isAccessLocked() )     // check if access to persistent data is locked
+      {
+         if((entries != NULL) && (num_entries > 0))
+         {
+            PersistenceBatchItem_s* items = resolve_batch_entries(entries, num_entries);
+
+            if(items != NULL)
+            {
+               unsigned int i = 0;
+               int valid = 1;
+
+               // validate the complete batch before anything is written
+               for(i=0; i<num_entries; i++)
+               {
+                  if(items[i].result == 0)
+                  {
+                     if(entries[i].buffer_size > gMaxKeyValDataSize)  // check data size
+                     {
+                        items[i].result = EPERS_BUFLIMIT;
+                     }
+                     else if(items[i].info.configKey.permission == PersistencePermission_ReadOnly)  // don't write to a read only resource
+                     {
+                        items[i].result = EPERS_RESOURCE_READ_ONLY;
+                     }
+                  }
+
+                  if(items[i].result < 0)
+                  {
+                     valid = 0;
+                  }
+               }
+
+               if(valid == 1)
+               {
+                  numWritten = persistence_set_data_batch(items, num_entries);
+               }
+               else
+               {
+                  DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyWriteDataBatch - invalid entries, batch not written"));
+                  numWritten = EPERS_SETDTAFAILED;
+               }
+
+               for(i=0; i<num_entries; i++)
+               {
+                  // valid entries of a rejected batch are reported as not written
+                  entries[i].result = ((valid == 0) && (items[i].result == 0)) ? EPERS_SETDTAFAILED : items[i].result;
+               }
+               free(items);
+            }
+            else
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyWriteDataBatch - failed to allocate memory"));
+               numWritten = EPERS_COMMON;
+            }
+         }
+         else
+         {
+            numWritten = EPERS_COMMON;
+         }
+      }
+      else
+      {
+         numWritten = EPERS_LOCKFS;
+      }
+   }
+
+   return numWritten;
+}
+
+
+
 int pclKeyUnRegisterNotifyOnChange( unsigned int  ldbid, const char *  resource_id, unsigned int  user_no, unsigned int  seat_no, pclChangeNotifyCallback_t  callback)
 {
    return regNotifyOnChange(ldbid, resource_id, user_no, seat_no, callback, Notify_unregister);
@@ -482,63 +986,97 @@ int pclKeyUnRegisterNotifyOnChange( unsigned int  ldbid, const char *  resource_
 
 int pclKeyRegisterNotifyOnChange(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no, pclChangeNotifyCallback_t callback)
 {
-   int rval = EPERS_COMMON;
    //DLT_LOG(gDLTContext, DLT_LOG_INFO, DLT_STRING("pclKeyRegisterNotifyOnChange: "),
    //            DLT_INT(ldbid), DLT_STRING(resource_id) );
-   if((gChangeNotifyCallback == callback) || (gChangeNotifyCallback == NULL))
+   // each resource has its own callback, see persistence_notify_on_change
+   return regNotifyOnChange(ldbid, resource_id, user_no, seat_no, callback, Notify_register);
+}
+
+
+
+
+/// check if change notifications of a resource can be registered, returns 0 if possible or a negative error code
+static int check_notify_resource(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no)
+{
+   int rval = 0;
+   PersistenceInfo_s dbContext;
+
+   //   unsigned int hash_val_data = 0;
+   char dbKey[DbKeyMaxLen]   = {0};      // database key
+   char dbPath[DbPathMaxLen] = {0};    // database location
+
+   dbContext.context.ldbid   = ldbid;
+   dbContext.context.seat_no = seat_no;
+   dbContext.context.user_no = user_no;
+
+   // get database context: database path and database key
+   rval = get_db_context(&dbContext, resource_id, ResIsNoFile, dbKey, dbPath);
+
+   if (rval==0)  // no error, key found
    {
-      rval = regNotifyOnChange(ldbid, resource_id, user_no, seat_no, callback, Notify_register);
+      // registration is only on shared and custom keys possible
+      if(   (dbContext.configKey.storage == PersistenceStorage_local)
+         || (dbContext.configKey.type    != PersistenceResourceType_key) )
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("regNotifyOnChange - Not allowed! Resource is local or it is a file:"),
+                                 DLT_STRING(resource_id), DLT_STRING("LDBID:"), DLT_UINT(ldbid));
+         rval = EPERS_NOTIFY_NOT_ALLOWED;
+      }
    }
    else
    {
-      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("pclKeyRegisterNotifyOnChange - Only one callback is allowed for change notifications."));
-      rval = EPERS_NOTIFY_NOT_ALLOWED;
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR,
+                           DLT_STRING("regNotifyOnChange - Not possible! get_db_context() returned:"),
+                           DLT_INT(rval));
    }
+
    return rval;
 }
 
 
 
-
 int regNotifyOnChange(unsigned int ldbid, const char* resource_id, unsigned int user_no, unsigned int seat_no, pclChangeNotifyCallback_t callback, PersNotifyRegPolicy_e regPolicy)
 {
    int rval = EPERS_NOT_INITIALIZED;
 
    if(gPclInitialized >= PCLinitialized)
    {
-      PersistenceInfo_s dbContext;
+      rval = check_notify_resource(ldbid, resource_id, user_no, seat_no);
 
-      //   unsigned int hash_val_data = 0;
-      char dbKey[DbKeyMaxLen]   = {0};      // database key
-      char dbPath[DbPathMaxLen] = {0};    // database location
+      if (rval==0)
+      {
+         rval = persistence_notify_on_change(resource_id, ldbid, user_no, seat_no, callback, regPolicy);
+      }
+   }
 
-      dbContext.context.ldbid   = ldbid;
-      dbContext.context.seat_no = seat_no;
-      dbContext.context.user_no = user_no;
+   return rval;
+}
 
-      // get database context: database path and database key
-      rval = get_db_context(&dbContext, resource_id, ResIsNoFile, dbKey, dbPath);
 
-      if (rval==0)  // no error, key found
-	  { 
-         // registration is only on shared and custom keys possible
-         if(   (dbContext.configKey.storage != PersistenceStorage_local)
-            && (dbContext.configKey.type    == PersistenceResourceType_key) )
-         {
-            rval = persistence_notify_on_change(resource_id, ldbid, user_no, seat_no, callback, regPolicy);
-         }
-         else
+
+static int regNotifyOnChangeList(pclNotifyRegEntry_s* entries, unsigned int num_entries, PersNotifyRegPolicy_e regPolicy)
+{
+   int rval = EPERS_NOT_INITIALIZED;
+
+   if(gPclInitialized >= PCLinitialized)
+   {
+      if((entries != NULL) && (num_entries > 0))
+      {
+         unsigned int i = 0;
+
+         for(i=0; i<num_entries; i++)
          {
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("regNotifyOnChange - Not allowed! Resource is local or it is a file:"),
-            		                  DLT_STRING(resource_id), DLT_STRING("LDBID:"), DLT_UINT(ldbid));
-            rval = EPERS_NOTIFY_NOT_ALLOWED;
+            entries[i].result = (entries[i].resource_id != NULL)
+                              ? check_notify_resource(entries[i].ldbid, entries[i].resource_id, entries[i].user_no, entries[i].seat_no)
+                              : EPERS_COMMON;
          }
+
+         // one request to the dbus mainloop for all valid entries
+         rval = persistence_notify_on_change_list(entries, num_entries, regPolicy);
       }
       else
       {
-         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR,
-                              DLT_STRING("regNotifyOnChange - Not possible! get_db_context() returned:"),
-                              DLT_INT(rval));
+         rval = EPERS_COMMON;
       }
    }
 
@@ -547,6 +1085,20 @@ int regNotifyOnChange(unsigned int ldbid, const char* resource_id, unsigned int
 
 
 
+int pclKeyRegisterNotifyOnChangeList(pclNotifyRegEntry_s* entries, unsigned int num_entries)
+{
+   return regNotifyOnChangeList(entries, num_entries, Notify_register);
+}
+
+
+
+int pclKeyUnRegisterNotifyOnChangeList(pclNotifyRegEntry_s* entries, unsigned int num_entries)
+{
+   return regNotifyOnChangeList(entries, num_entries, Notify_unregister);
+}
+
+
+
 
 
 
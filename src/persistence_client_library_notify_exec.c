@@ -0,0 +1,542 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_notify_exec.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the change notification callback executor
+ * @see
+ */
+
+#include "persistence_client_library_notify_exec.h"
+#include "persistence_client_library_data_organization.h"
+#include "crc32.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/// registered callback of a resource
+typedef struct _PersNotifyCallback_s
+{
+   /// next entry in the hash bucket
+   struct _PersNotifyCallback_s* next;
+   /// hash value of the key
+   unsigned int hash;
+   /// logical database id
+   unsigned int ldbid;
+   /// user number
+   unsigned int user_no;
+   /// seat number
+   unsigned int seat_no;
+   /// number of registrations
+   unsigned int count;
+   /// the callback
+   pclChangeNotifyCallback_t callback;
+   /// number of calls
+   unsigned int numCalls;
+   /// number of calls that took longer than NotifyCallbackWarnTime
+   unsigned int numSlowCalls;
+   /// overall duration of the calls [us]
+   unsigned long long totalTime;
+   /// longest call [us]
+   unsigned int maxTime;
+   /// the resource id
+   char key[DbKeyMaxLen];
+} PersNotifyCallback_s;
+
+
+/// queued notification
+typedef struct _PersNotifyJob_s
+{
+   /// hash value of the key
+   unsigned int hash;
+   /// logical database id
+   unsigned int ldbid;
+   /// user number
+   unsigned int user_no;
+   /// seat number
+   unsigned int seat_no;
+   /// notification status
+   pclNotifyStatus_e status;
+   /// the resource id
+   char key[DbKeyMaxLen];
+} PersNotifyJob_s;
+
+
+/// executor thread
+typedef struct _PersNotifyExecutor_s
+{
+   /// the thread
+   pthread_t thread;
+   /// mutex to protect the queue
+   pthread_mutex_t mutex;
+   /// signaled when a notification has been queued or the executor is stopped
+   pthread_cond_t cond;
+   /// queued notifications (ring buffer)
+   PersNotifyJob_s* jobs;
+   /// size of the ring buffer
+   unsigned int queueSize;
+   /// index of the oldest queued notification
+   unsigned int head;
+   /// number of queued notifications
+   unsigned int numJobs;
+   /// number of notifications merged into a queued notification of the same resource (queue full)
+   unsigned int numCoalesced;
+   /// number of dropped notifications (queue could not be grown)
+   unsigned int numDropped;
+   /// executor is running
+   int running;
+} PersNotifyExecutor_s;
+
+
+/// registered callbacks
+static PersNotifyCallback_s* gNotifyCallbacks[NotifyCallbackHashSize] = {NULL};
+/// mutex to protect the registered callbacks
+static pthread_mutex_t gNotifyCallbackMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/// executor threads
+static PersNotifyExecutor_s gNotifyExecutors[NotifyExecMaxThreads];
+/// number of running executor threads
+static int gNumNotifyExecutors = 0;
+
+
+
+static unsigned long long notify_exec_time_us(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+
+/// find a registered callback, returns the address of the link to the entry; the callback mutex must be locked
+static PersNotifyCallback_s** notify_exec_find(unsigned int hash, unsigned int ldbid, unsigned int user_no,
+                                               unsigned int seat_no, const char* key)
+{
+   PersNotifyCallback_s** pEntry = &gNotifyCallbacks[hash & (NotifyCallbackHashSize-1)];
+
+   while(   (*pEntry != NULL)
+         && (   ((*pEntry)->hash != hash)
+             || ((*pEntry)->ldbid != ldbid)
+             || ((*pEntry)->user_no != user_no)
+             || ((*pEntry)->seat_no != seat_no)
+             || (strncmp((*pEntry)->key, key, DbKeyMaxLen) != 0) ) )
+   {
+      pEntry = &(*pEntry)->next;
+   }
+
+   return pEntry;
+}
+
+
+
+static void notify_exec_log_stats(const PersNotifyCallback_s* entry)
+{
+   if(entry->numCalls > 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("notify_exec - callback of:"), DLT_STRING(entry->key),
+                                            DLT_STRING("ldbid:"), DLT_UINT(entry->ldbid),
+                                            DLT_STRING("calls:"), DLT_UINT(entry->numCalls),
+                                            DLT_STRING("avg [us]:"), DLT_UINT((unsigned int)(entry->totalTime / entry->numCalls)),
+                                            DLT_STRING("max [us]:"), DLT_UINT(entry->maxTime),
+                                            DLT_STRING("slow calls:"), DLT_UINT(entry->numSlowCalls));
+   }
+}
+
+
+
+/// merge a notification into the latest queued notification of the same resource; the queue mutex must be locked
+static int notify_exec_coalesce(PersNotifyExecutor_s* executor, unsigned int hash, const pclNotification_s* notifyStruct)
+{
+   int rval = -1;
+   unsigned int i = 0;
+
+   // search backwards, only the latest notification of a resource may be replaced to keep the order
+   for(i=executor->numJobs; i>0; i--)
+   {
+      PersNotifyJob_s* job = &executor->jobs[(executor->head + i - 1) % executor->queueSize];
+
+      if(   (job->hash == hash)
+         && (job->ldbid == notifyStruct->ldbid)
+         && (job->user_no == notifyStruct->user_no)
+         && (job->seat_no == notifyStruct->seat_no)
+         && (strncmp(job->key, notifyStruct->resource_id, DbKeyMaxLen) == 0) )
+      {
+         job->status = notifyStruct->pclKeyNotify_Status;
+         executor->numCoalesced++;
+         rval = 0;
+         break;
+      }
+   }
+
+   return rval;
+}
+
+
+
+/// double the size of the queue; the queue mutex must be locked
+static int notify_exec_grow(PersNotifyExecutor_s* executor)
+{
+   int rval = -1;
+   unsigned int i = 0;
+   PersNotifyJob_s* jobs = malloc(2 * executor->queueSize * sizeof(PersNotifyJob_s));
+
+   if(jobs != NULL)
+   {
+      // unwrap the ring buffer, the oldest notification goes to index 0
+      for(i=0; i<executor->numJobs; i++)
+      {
+         memcpy(&jobs[i], &executor->jobs[(executor->head + i) % executor->queueSize], sizeof(PersNotifyJob_s));
+      }
+
+      free(executor->jobs);
+      executor->jobs = jobs;
+      executor->queueSize *= 2;
+      executor->head = 0;
+      rval = 0;
+   }
+
+   return rval;
+}
+
+
+
+/// call the registered callback of a notification and update the statistics of the callback
+static void notify_exec_call(const PersNotifyJob_s* job)
+{
+   PersNotifyCallback_s* entry = NULL;
+   pclChangeNotifyCallback_t callback = NULL;
+
+   pthread_mutex_lock(&gNotifyCallbackMtx);
+   entry = *notify_exec_find(job->hash, job->ldbid, job->user_no, job->seat_no, job->key);
+   if(entry != NULL)
+   {
+      callback = entry->callback;
+   }
+   pthread_mutex_unlock(&gNotifyCallbackMtx);
+
+   if(callback != NULL)
+   {
+      pclNotification_s notifyStruct;
+      unsigned long long start = 0;
+      unsigned int duration = 0;
+
+      notifyStruct.pclKeyNotify_Status = job->status;
+      notifyStruct.ldbid               = job->ldbid;
+      notifyStruct.resource_id         = job->key;
+      notifyStruct.user_no             = job->user_no;
+      notifyStruct.seat_no             = job->seat_no;
+
+      start = notify_exec_time_us();
+      callback(&notifyStruct);
+      duration = (unsigned int)(notify_exec_time_us() - start);
+
+      if(duration > NotifyCallbackWarnTime * 1000)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("notify_exec - slow callback of:"), DLT_STRING(job->key),
+                                               DLT_STRING("ldbid:"), DLT_UINT(job->ldbid),
+                                               DLT_STRING("duration [us]:"), DLT_UINT(duration));
+      }
+
+      // the callback may have been unregistered in the meantime
+      pthread_mutex_lock(&gNotifyCallbackMtx);
+      entry = *notify_exec_find(job->hash, job->ldbid, job->user_no, job->seat_no, job->key);
+      if((entry != NULL) && (entry->callback == callback))
+      {
+         entry->numCalls++;
+         entry->totalTime += duration;
+         if(duration > entry->maxTime)
+         {
+            entry->maxTime = duration;
+         }
+         if(duration > NotifyCallbackWarnTime * 1000)
+         {
+            entry->numSlowCalls++;
+         }
+      }
+      pthread_mutex_unlock(&gNotifyCallbackMtx);
+   }
+}
+
+
+
+static void* notify_exec_thread(void* dataPtr)
+{
+   PersNotifyExecutor_s* executor = (PersNotifyExecutor_s*)dataPtr;
+
+   pthread_mutex_lock(&executor->mutex);
+
+   while(executor->running == 1)
+   {
+      if(executor->numJobs > 0)
+      {
+         PersNotifyJob_s job;
+
+         memcpy(&job, &executor->jobs[executor->head], sizeof(PersNotifyJob_s));
+         executor->head = (executor->head + 1) % executor->queueSize;
+         executor->numJobs--;
+
+         pthread_mutex_unlock(&executor->mutex);
+         notify_exec_call(&job);
+         pthread_mutex_lock(&executor->mutex);
+      }
+      else
+      {
+         pthread_cond_wait(&executor->cond, &executor->mutex);
+      }
+   }
+
+   pthread_mutex_unlock(&executor->mutex);
+
+   return NULL;
+}
+
+
+
+int notify_exec_init(void)
+{
+   int rval = 0, i = 0;
+   int numThreads = NotifyExecThreads;
+   const char* pThreads = getenv("PERS_CLIENT_NOTIFY_THREADS");
+
+   if((pThreads != NULL) && (atoi(pThreads) > 0))
+   {
+      numThreads = atoi(pThreads);
+      if(numThreads > NotifyExecMaxThreads)
+      {
+         numThreads = NotifyExecMaxThreads;
+      }
+   }
+
+   gNumNotifyExecutors = 0;
+   for(i=0; i<numThreads; i++)
+   {
+      PersNotifyExecutor_s* executor = &gNotifyExecutors[gNumNotifyExecutors];
+
+      memset(executor, 0, sizeof(PersNotifyExecutor_s));
+      executor->jobs = malloc(NotifyExecQueueSize * sizeof(PersNotifyJob_s));
+      if(executor->jobs == NULL)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("notify_exec_init - failed to allocate queue"));
+         break;
+      }
+      executor->queueSize = NotifyExecQueueSize;
+      pthread_mutex_init(&executor->mutex, NULL);
+      pthread_cond_init(&executor->cond, NULL);
+      executor->running = 1;
+
+      if(pthread_create(&executor->thread, NULL, notify_exec_thread, executor) == 0)
+      {
+         (void)pthread_setname_np(executor->thread, "pclNotifyExec");
+         gNumNotifyExecutors++;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("notify_exec_init - pthread_create failed"));
+         pthread_cond_destroy(&executor->cond);
+         pthread_mutex_destroy(&executor->mutex);
+         free(executor->jobs);
+         executor->jobs = NULL;
+         break;
+      }
+   }
+
+   if(gNumNotifyExecutors == 0)
+   {
+      rval = -1;
+   }
+
+   return rval;
+}
+
+
+
+void notify_exec_deinit(void)
+{
+   int i = 0;
+   int numExecutors = gNumNotifyExecutors;
+
+   gNumNotifyExecutors = 0;
+
+   for(i=0; i<numExecutors; i++)
+   {
+      PersNotifyExecutor_s* executor = &gNotifyExecutors[i];
+
+      pthread_mutex_lock(&executor->mutex);
+      executor->running = 0;
+      pthread_cond_signal(&executor->cond);
+      pthread_mutex_unlock(&executor->mutex);
+
+      pthread_join(executor->thread, NULL);
+
+      if((executor->numJobs > 0) || (executor->numCoalesced > 0) || (executor->numDropped > 0))
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("notify_exec_deinit - executor:"), DLT_INT(i),
+                                               DLT_STRING("discarded:"), DLT_UINT(executor->numJobs),
+                                               DLT_STRING("coalesced:"), DLT_UINT(executor->numCoalesced),
+                                               DLT_STRING("dropped:"), DLT_UINT(executor->numDropped),
+                                               DLT_STRING("queue size:"), DLT_UINT(executor->queueSize));
+      }
+
+      pthread_cond_destroy(&executor->cond);
+      pthread_mutex_destroy(&executor->mutex);
+      free(executor->jobs);
+      executor->jobs = NULL;
+   }
+
+   pthread_mutex_lock(&gNotifyCallbackMtx);
+   for(i=0; i<NotifyCallbackHashSize; i++)
+   {
+      while(gNotifyCallbacks[i] != NULL)
+      {
+         PersNotifyCallback_s* entry = gNotifyCallbacks[i];
+         gNotifyCallbacks[i] = entry->next;
+         notify_exec_log_stats(entry);
+         free(entry);
+      }
+   }
+   pthread_mutex_unlock(&gNotifyCallbackMtx);
+}
+
+
+
+int notify_exec_register(unsigned int ldbid, const char* key, unsigned int user_no, unsigned int seat_no,
+                         pclChangeNotifyCallback_t callback)
+{
+   int rval = 0;
+   unsigned int hash = pclCrc32(0, (const unsigned char*)key, strnlen(key, DbKeyMaxLen));
+   PersNotifyCallback_s** pEntry = NULL;
+
+   pthread_mutex_lock(&gNotifyCallbackMtx);
+
+   pEntry = notify_exec_find(hash, ldbid, user_no, seat_no, key);
+   if(*pEntry != NULL)
+   {
+      if((*pEntry)->callback == callback)
+      {
+         (*pEntry)->count++;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("notify_exec_register - other callback registered for:"), DLT_STRING(key));
+         rval = EPERS_NOTIFY_NOT_ALLOWED;
+      }
+   }
+   else
+   {
+      PersNotifyCallback_s* entry = calloc(1, sizeof(PersNotifyCallback_s));
+      if(entry != NULL)
+      {
+         entry->hash     = hash;
+         entry->ldbid    = ldbid;
+         entry->user_no  = user_no;
+         entry->seat_no  = seat_no;
+         entry->count    = 1;
+         entry->callback = callback;
+         snprintf(entry->key, DbKeyMaxLen, "%s", key);
+         *pEntry = entry;
+      }
+      else
+      {
+         rval = -1;
+      }
+   }
+
+   pthread_mutex_unlock(&gNotifyCallbackMtx);
+
+   return rval;
+}
+
+
+
+void notify_exec_unregister(unsigned int ldbid, const char* key, unsigned int user_no, unsigned int seat_no)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)key, strnlen(key, DbKeyMaxLen));
+   PersNotifyCallback_s** pEntry = NULL;
+
+   pthread_mutex_lock(&gNotifyCallbackMtx);
+
+   pEntry = notify_exec_find(hash, ldbid, user_no, seat_no, key);
+   if((*pEntry != NULL) && (--(*pEntry)->count == 0))
+   {
+      PersNotifyCallback_s* entry = *pEntry;
+      *pEntry = entry->next;
+      notify_exec_log_stats(entry);
+      free(entry);
+   }
+
+   pthread_mutex_unlock(&gNotifyCallbackMtx);
+}
+
+
+
+int notify_exec_post(const pclNotification_s* notifyStruct)
+{
+   int rval = -1, dropped = 0;
+   int numExecutors = gNumNotifyExecutors;
+
+   if(numExecutors > 0)
+   {
+      unsigned int hash = pclCrc32(0, (const unsigned char*)notifyStruct->resource_id,
+                                   strnlen(notifyStruct->resource_id, DbKeyMaxLen));
+      // the notifications of a resource are always handled by the same executor to keep their order
+      PersNotifyExecutor_s* executor = &gNotifyExecutors[hash % numExecutors];
+
+      pthread_mutex_lock(&executor->mutex);
+
+      if(executor->numJobs == executor->queueSize)
+      {
+         // queue full: a pending notification of the same resource is updated in place,
+         // otherwise the queue is grown; notifications are only dropped if no memory is left
+         if(notify_exec_coalesce(executor, hash, notifyStruct) == 0)
+         {
+            rval = 0;
+         }
+         else if(notify_exec_grow(executor) == -1)
+         {
+            executor->numDropped++;
+            dropped = 1;
+         }
+      }
+
+      if((rval == -1) && (dropped == 0))
+      {
+         PersNotifyJob_s* job = &executor->jobs[(executor->head + executor->numJobs) % executor->queueSize];
+
+         job->hash    = hash;
+         job->ldbid   = notifyStruct->ldbid;
+         job->user_no = notifyStruct->user_no;
+         job->seat_no = notifyStruct->seat_no;
+         job->status  = notifyStruct->pclKeyNotify_Status;
+         snprintf(job->key, DbKeyMaxLen, "%s", notifyStruct->resource_id);
+         executor->numJobs++;
+
+         pthread_cond_signal(&executor->cond);
+         rval = 0;
+      }
+
+      pthread_mutex_unlock(&executor->mutex);
+
+      if(dropped == 1)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("notify_exec_post - failed to grow queue, notification dropped:"),
+                                                DLT_STRING(notifyStruct->resource_id));
+      }
+   }
+
+   return rval;
+}
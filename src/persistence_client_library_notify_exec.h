@@ -0,0 +1,88 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_NOTIFY_EXEC_H
+#define PERSISTENCE_CLIENT_LIBRARY_NOTIFY_EXEC_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_notify_exec.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the change notification callback executor.
+ *                 Each registered resource (key, ldbid, user, seat) has its own callback.
+ *                 Received notifications are queued by the dbus mainloop and the callbacks
+ *                 are called by executor threads, so application code never runs on the
+ *                 dbus mainloop thread. The notifications of a resource are always handled
+ *                 by the same executor thread, in the order they have been received.
+ * @see
+ */
+
+#include "../include/persistence_client_library_key.h"
+
+
+/**
+ * @brief start the executor threads.
+ *        The number of threads can be set with the environment variable PERS_CLIENT_NOTIFY_THREADS.
+ *
+ * @return 0 on success or -1 if no executor thread could be started
+ */
+int notify_exec_init(void);
+
+
+/**
+ * @brief stop the executor threads and remove all registered callbacks,
+ *        queued notifications are discarded. The callback statistics are logged.
+ *        Must be called when the dbus mainloop has been stopped.
+ */
+void notify_exec_deinit(void);
+
+
+/**
+ * @brief register the callback of a resource
+ *
+ * @param ldbid the logical database id
+ * @param key the resource id
+ * @param user_no the user number
+ * @param seat_no the seat number
+ * @param callback the callback
+ *
+ * @return 0 on success, EPERS_NOTIFY_NOT_ALLOWED if a different callback is
+ *         registered for the resource or -1 if no memory is available
+ */
+int notify_exec_register(unsigned int ldbid, const char* key, unsigned int user_no, unsigned int seat_no,
+                         pclChangeNotifyCallback_t callback);
+
+
+/**
+ * @brief unregister the callback of a resource, the callback statistics are logged
+ *        when the last registration of the resource has been removed
+ *
+ * @param ldbid the logical database id
+ * @param key the resource id
+ * @param user_no the user number
+ * @param seat_no the seat number
+ */
+void notify_exec_unregister(unsigned int ldbid, const char* key, unsigned int user_no, unsigned int seat_no);
+
+
+/**
+ * @brief queue a received notification for the executor, does not block.
+ *        Notifications of resources without a registered callback are ignored by the executor.
+ *        If the queue is full the status of a pending notification of the same resource is
+ *        updated, otherwise the queue is grown.
+ *
+ * @param notifyStruct the notification, the data is copied
+ *
+ * @return 0 on success or -1 if the notification has been dropped (executor not running or queue could not be grown)
+ */
+int notify_exec_post(const pclNotification_s* notifyStruct);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_NOTIFY_EXEC_H */
@@ -21,8 +21,19 @@
 
 #include "persistence_client_library_prct_access.h"
 #include "persistence_client_library_db_access.h"
+#include "persistence_client_library_custom_loader.h"
+#include "persistence_client_library_rct_index.h"
+#include "persistence_client_library_rct_hash.h"
+#include "crc32.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 #include <persComRct.h>
 #include <persComDbAccess.h>
@@ -33,6 +44,68 @@
 static int gResource_table[PrctDbTableSize] = {[0 ... PrctDbTableSize-1] = -1};
 /// array to hold the information of database is already open
 static int gResourceOpen[PrctDbTableSize] = { [0 ... PrctDbTableSize-1] = 0 };
+/// mutex to serialize opening of resource tables, an open table is read without lock
+static pthread_mutex_t gResourceMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/// handle of a modified resource table waiting to be closed
+typedef struct _PersistenceRetiredRct_s
+{
+   /// the handle
+   int handle;
+   /// next retired handle
+   struct _PersistenceRetiredRct_s* next;
+} PersistenceRetiredRct_s;
+
+/// number of lookups using a resource table handle without lock
+static unsigned int gResourceReaders = 0;
+/// handles of modified resource tables, closed when no lookup uses a handle anymore
+static PersistenceRetiredRct_s* gResourceRetired = NULL;
+/// timer of the check for modified resource tables, read by the dbus mainloop
+static int gResourceCheckFd = -1;
+/// a resource table or a compiled table is open and has to be checked for modifications
+static int gResourceCheckWanted = 0;
+
+
+/// resolved database context cache entry
+typedef struct _PersistenceCtxCacheEntry_s
+{
+   /// sequence counter, odd while the entry is written (readers retry or treat as miss)
+   unsigned int seq;
+   /// entry contains valid data
+   int valid;
+   /// hash value of the lookup key
+   unsigned int hash;
+   /// resource is a file or a key
+   unsigned int isFile;
+   /// entry has been stored by a lookup with a resource descriptor
+   int byId;
+   /// hash value of the resource id taken from the resource descriptor
+   unsigned int resHash;
+   /// slot of the resource taken from the resource descriptor
+   unsigned int resSlot;
+   /// the resource id
+   char resource_id[DbResIDMaxLen];
+   /// the resolved context (database context and resource configuration)
+   PersistenceInfo_s info;
+   /// the resolved database key
+   char dbKey[DbKeyMaxLen];
+   /// the resolved database path
+   char dbPath[DbPathMaxLen];
+} PersistenceCtxCacheEntry_s;
+
+/// resolved database context cache (direct mapped)
+static PersistenceCtxCacheEntry_s gCtxCache[PrctCtxCacheSize];
+/// mutex to serialize writers of the resolved database context cache, readers don't lock
+static pthread_mutex_t gCtxCacheMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/// number of context cache hits
+static unsigned int gCtxCacheHits = 0;
+/// number of context cache misses
+static unsigned int gCtxCacheMisses = 0;
+/// number of valid entries replaced by another resource
+static unsigned int gCtxCacheEvictions = 0;
+/// incremented when the cache is invalidated, contexts resolved in another generation must be resolved again
+static unsigned int gCtxGeneration = 0;
 
 
 /// persistence resource config table type definition
@@ -82,98 +155,649 @@ PersistenceRCT_e get_table_id(int ldbid, int* groupId)
 
 int get_resource_cfg_table_by_idx(int i)
 {
-   return gResource_table[i];
+   return __atomic_load_n(&gResource_table[i], __ATOMIC_ACQUIRE);
+}
+
+
+static unsigned int db_context_hash(const PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)resource_id, strlen(resource_id));
+
+   hash = pclCrc32(hash, (const unsigned char*)&dbContext->context, sizeof(dbContext->context));
+
+   return hash ^ isFile;
+}
+
+
+/// start writing a cache entry, the cache mutex must be locked
+static void db_context_cache_write_begin(PersistenceCtxCacheEntry_s* entry)
+{
+   __atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+/// finish writing a cache entry, the cache mutex must be locked
+static void db_context_cache_write_end(PersistenceCtxCacheEntry_s* entry)
+{
+   __atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+/// hash value of a lookup with a resource descriptor, no string operation is done
+static unsigned int db_context_hash_by_id(const PersistenceInfo_s* dbContext, const pclResourceId_s* resource)
+{
+   unsigned int hash = resource->hash ^ (resource->slot * 0x9E3779B1u);
+
+   hash ^= (dbContext->context.ldbid * 0x85EBCA6Bu) ^ (dbContext->context.user_no * 0xC2B2AE35u)
+         ^ (dbContext->context.seat_no * 0x27D4EB2Fu);
+
+   return hash ^ (hash >> 16);
+}
+
+
+/// copy the resolved context of a matching entry, returns 1 if the entry has not been written in the meantime
+static int db_context_cache_copy(const PersistenceCtxCacheEntry_s* entry, unsigned int seq,
+                                 PersistenceInfo_s* dbContext, char dbKey[], char dbPath[])
+{
+   int found = 0;
+   PersistenceConfigurationKey_s configKey;
+   int customIdx = entry->info.customIdx;
+   char key[DbKeyMaxLen];
+   char path[DbPathMaxLen];
+
+   memcpy(&configKey, &entry->info.configKey, sizeof(configKey));
+   memcpy(key,  entry->dbKey,  DbKeyMaxLen);
+   memcpy(path, entry->dbPath, DbPathMaxLen);
+
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   if(__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == seq)
+   {
+      memcpy(&dbContext->configKey, &configKey, sizeof(dbContext->configKey));
+      dbContext->customIdx = customIdx;
+      memcpy(dbKey,  key,  DbKeyMaxLen);
+      memcpy(dbPath, path, DbPathMaxLen);
+      found = 1;
+   }
+
+   return found;
+}
+
+
+/// count a cache hit or miss
+static void db_context_cache_count(int found)
+{
+   if(found == 1)
+   {
+      __atomic_fetch_add(&gCtxCacheHits, 1, __ATOMIC_RELAXED);
+   }
+   else
+   {
+      __atomic_fetch_add(&gCtxCacheMisses, 1, __ATOMIC_RELAXED);
+   }
+}
+
+
+static int db_context_cache_lookup(PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile,
+                                   unsigned int hash, char dbKey[], char dbPath[])
+{
+   int found = 0;
+   PersistenceCtxCacheEntry_s* entry = &gCtxCache[hash & (PrctCtxCacheSize-1)];
+   unsigned int seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+
+   // lock free read: copy the entry and check that it has not been written in the meantime
+   if(   (seq & 1) == 0
+      && entry->valid == 1
+      && entry->byId == 0
+      && entry->hash == hash
+      && entry->isFile == isFile
+      && memcmp(&entry->info.context, &dbContext->context, sizeof(dbContext->context)) == 0
+      && strncmp(entry->resource_id, resource_id, DbResIDMaxLen) == 0)
+   {
+      found = db_context_cache_copy(entry, seq, dbContext, dbKey, dbPath);
+   }
+
+   db_context_cache_count(found);
+
+   return found;
+}
+
+
+/// lookup with a resource descriptor, the entry is identified by the descriptor hash and slot and the context
+static int db_context_cache_lookup_by_id(PersistenceInfo_s* dbContext, const pclResourceId_s* resource,
+                                         unsigned int hash, char dbKey[], char dbPath[])
+{
+   int found = 0;
+   PersistenceCtxCacheEntry_s* entry = &gCtxCache[hash & (PrctCtxCacheSize-1)];
+   unsigned int seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+
+   if(   (seq & 1) == 0
+      && entry->valid == 1
+      && entry->byId == 1
+      && entry->resHash == resource->hash
+      && entry->resSlot == resource->slot
+      && entry->info.context.ldbid   == dbContext->context.ldbid
+      && entry->info.context.user_no == dbContext->context.user_no
+      && entry->info.context.seat_no == dbContext->context.seat_no)
+   {
+      found = db_context_cache_copy(entry, seq, dbContext, dbKey, dbPath);
+   }
+
+   db_context_cache_count(found);
+
+   return found;
+}
+
+
+static void db_context_cache_store(const PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile,
+                                   unsigned int hash, const char dbKey[], const char dbPath[])
+{
+   PersistenceCtxCacheEntry_s* entry = &gCtxCache[hash & (PrctCtxCacheSize-1)];
+
+   if(strlen(resource_id) < DbResIDMaxLen)
+   {
+      pthread_mutex_lock(&gCtxCacheMtx);
+
+      if(entry->valid == 1)
+      {
+         gCtxCacheEvictions++;
+      }
+
+      db_context_cache_write_begin(entry);
+      entry->hash   = hash;
+      entry->isFile = isFile;
+      entry->byId   = 0;
+      strncpy(entry->resource_id, resource_id, DbResIDMaxLen);
+      memcpy(&entry->info, dbContext, sizeof(entry->info));
+      memcpy(entry->dbKey,  dbKey,  DbKeyMaxLen);
+      memcpy(entry->dbPath, dbPath, DbPathMaxLen);
+      entry->valid  = 1;
+      db_context_cache_write_end(entry);
+
+      pthread_mutex_unlock(&gCtxCacheMtx);
+   }
+}
+
+
+static void db_context_cache_store_by_id(const PersistenceInfo_s* dbContext, const pclResourceId_s* resource,
+                                         unsigned int hash, const char dbKey[], const char dbPath[])
+{
+   PersistenceCtxCacheEntry_s* entry = &gCtxCache[hash & (PrctCtxCacheSize-1)];
+
+   pthread_mutex_lock(&gCtxCacheMtx);
+
+   if(entry->valid == 1)
+   {
+      gCtxCacheEvictions++;
+   }
+
+   db_context_cache_write_begin(entry);
+   entry->hash    = hash;
+   entry->isFile  = ResIsNoFile;
+   entry->byId    = 1;
+   entry->resHash = resource->hash;
+   entry->resSlot = resource->slot;
+   entry->resource_id[0] = '\0';
+   memcpy(&entry->info, dbContext, sizeof(entry->info));
+   memcpy(entry->dbKey,  dbKey,  DbKeyMaxLen);
+   memcpy(entry->dbPath, dbPath, DbPathMaxLen);
+   entry->valid   = 1;
+   db_context_cache_write_end(entry);
+
+   pthread_mutex_unlock(&gCtxCacheMtx);
+}
+
+
+void invalidate_db_context_cache(void)
+{
+   int i = 0;
+
+   pthread_mutex_lock(&gCtxCacheMtx);
+
+   if((gCtxCacheHits + gCtxCacheMisses) > 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("invalidate_db_context_cache - hits:"), DLT_UINT(gCtxCacheHits),
+                                            DLT_STRING("misses:"), DLT_UINT(gCtxCacheMisses),
+                                            DLT_STRING("evictions:"), DLT_UINT(gCtxCacheEvictions),
+                                            DLT_STRING("hit rate [%]:"), DLT_UINT((gCtxCacheHits * 100) / (gCtxCacheHits + gCtxCacheMisses)));
+   }
+
+   for(i=0; i<PrctCtxCacheSize; i++)
+   {
+      db_context_cache_write_begin(&gCtxCache[i]);
+      gCtxCache[i].valid = 0;
+      db_context_cache_write_end(&gCtxCache[i]);
+   }
+
+   __atomic_store_n(&gCtxCacheHits,   0, __ATOMIC_RELAXED);
+   __atomic_store_n(&gCtxCacheMisses, 0, __ATOMIC_RELAXED);
+   gCtxCacheEvictions = 0;
+
+   // after the entries have been invalidated, a context resolved in the new generation is not taken from the cache
+   __atomic_add_fetch(&gCtxGeneration, 1, __ATOMIC_RELEASE);
+
+   pthread_mutex_unlock(&gCtxCacheMtx);
+}
+
+
+
+unsigned int db_context_generation(void)
+{
+   return __atomic_load_n(&gCtxGeneration, __ATOMIC_ACQUIRE);
+}
+
+
+void get_db_context_cache_stats(unsigned int* hits, unsigned int* misses, unsigned int* evictions)
+{
+   pthread_mutex_lock(&gCtxCacheMtx);
+   *hits      = __atomic_load_n(&gCtxCacheHits,   __ATOMIC_RELAXED);
+   *misses    = __atomic_load_n(&gCtxCacheMisses, __ATOMIC_RELAXED);
+   *evictions = gCtxCacheEvictions;
+   pthread_mutex_unlock(&gCtxCacheMtx);
 }
 
 
 void invalidate_resource_cfg_table(int i)
 {
-   gResource_table[i] = -1;
+   pthread_mutex_lock(&gResourceMtx);
+   __atomic_store_n(&gResource_table[i], -1, __ATOMIC_RELEASE);
    gResourceOpen[i] = 0;
+   pthread_mutex_unlock(&gResourceMtx);
+}
+
+
+/// start the periodic check for modified resource tables, the first open table starts the timer
+static void resource_cfg_check_timer_arm(void)
+{
+   int fd = -1;
+
+   if(__atomic_exchange_n(&gResourceCheckWanted, 1, __ATOMIC_SEQ_CST) == 0)
+   {
+      fd = __atomic_load_n(&gResourceCheckFd, __ATOMIC_SEQ_CST);
+      if(fd != -1)
+      {
+         struct itimerspec its;
+
+         its.it_value.tv_sec     = RctIndexCheckInterval / 1000;
+         its.it_value.tv_nsec    = (RctIndexCheckInterval % 1000) * 1000000;
+         its.it_interval         = its.it_value;
+
+         if(timerfd_settime(fd, 0, &its, NULL) == -1)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("resource_cfg_check_timer_arm - timerfd_settime() failed"), DLT_STRING(strerror(errno)));
+         }
+      }
+   }
+}
+
+
+int resource_cfg_check_timer_init(void)
+{
+   int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+   if(fd != -1)
+   {
+      __atomic_store_n(&gResourceCheckFd, fd, __ATOMIC_SEQ_CST);
+
+      // tables opened before the mainloop has been started
+      if(__atomic_exchange_n(&gResourceCheckWanted, 0, __ATOMIC_SEQ_CST) == 1)
+      {
+         resource_cfg_check_timer_arm();
+      }
+   }
+   else
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("resource_cfg_check_timer_init - timerfd_create() failed"), DLT_STRING(strerror(errno)));
+   }
+
+   return fd;
+}
+
+
+void resource_cfg_check_timeout(void)
+{
+   uint64_t numExpired = 0;
+
+   if(read(gResourceCheckFd, &numExpired, sizeof(numExpired)) == -1)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_VERBOSE, DLT_STRING("resource_cfg_check_timeout - read() failed"), DLT_STRING(strerror(errno)));
+   }
+
+   close_modified_resource_cfg_tables();
+}
+
+
+void resource_cfg_check_timer_deinit(void)
+{
+   int fd = __atomic_exchange_n(&gResourceCheckFd, -1, __ATOMIC_SEQ_CST);
+
+   if(fd != -1)
+   {
+      close(fd);
+   }
+}
+
+
+/// create the path of a resource configuration table
+static void get_resource_cfg_table_name(PersistenceRCT_e rct, int group, char filename[])
+{
+   switch(rct)    // create db name
+   {
+   case PersistenceRCT_local:
+      snprintf(filename, DbPathMaxLen, gLocalWtPathKey, gAppId, gResTableCfg);
+      break;
+   case PersistenceRCT_shared_public:
+      snprintf(filename, DbPathMaxLen, gSharedPublicWtPathKey, gAppId, gResTableCfg);
+      break;
+   case PersistenceRCT_shared_group:
+      snprintf(filename, DbPathMaxLen, gSharedWtPathKey, gAppId, group, gResTableCfg);
+      break;
+   default:
+      DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("get_resource_cfg_table - no valid PersistenceRCT_e"));
+      break;
+   }
 }
 
 
 int get_resource_cfg_table(PersistenceRCT_e rct, int group)
 {
    int arrayIdx = 0;
+   int handleRCT = -1;
 
    // create array index: index is a combination of resource config table type and group
    arrayIdx = rct + group;
 
    if(arrayIdx < PrctDbTableSize)
    {
-      if(gResourceOpen[arrayIdx] == 0)   // check if database is already open
+      // the handle is published once the table is open, no lock needed to read it
+      handleRCT = __atomic_load_n(&gResource_table[arrayIdx], __ATOMIC_SEQ_CST);
+      if(handleRCT < 0)
       {
-         char filename[DbPathMaxLen] = { [0 ... DbPathMaxLen-1] = 0};
+         pthread_mutex_lock(&gResourceMtx);
 
-         switch(rct)    // create db name
+         if(gResourceOpen[arrayIdx] == 0)   // check if database is already open
          {
-         case PersistenceRCT_local:
-            snprintf(filename, DbPathMaxLen, gLocalWtPathKey, gAppId, gResTableCfg);
-            break;
-         case PersistenceRCT_shared_public:
-            snprintf(filename, DbPathMaxLen, gSharedPublicWtPathKey, gAppId, gResTableCfg);
-            break;
-         case PersistenceRCT_shared_group:
-            snprintf(filename, DbPathMaxLen, gSharedWtPathKey, gAppId, group, gResTableCfg);
-            break;
-         default:
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("get_resource_cfg_table - no valid PersistenceRCT_e"));
-            break;
+            char filename[DbPathMaxLen] = { [0 ... DbPathMaxLen-1] = 0};
+
+            get_resource_cfg_table_name(rct, group, filename);
+
+            handleRCT = persComRctOpen(filename, 0x00);
+
+            if(handleRCT < 0)
+            {
+               gResourceOpen[arrayIdx] = 0;
+               DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("get_resource_cfg_table - RCT problem"), DLT_INT(handleRCT));
+            }
+            else
+            {
+               gResourceOpen[arrayIdx] = 1 ;
+
+               if(rct_index_enabled() == 1)
+               {
+                  (void)rct_index_create(arrayIdx, handleRCT, filename);
+                  resource_cfg_check_timer_arm();
+               }
+
+               // the table has been (re)opened, previously resolved contexts may be stale
+               invalidate_db_context_cache();
+            }
+            __atomic_store_n(&gResource_table[arrayIdx], handleRCT, __ATOMIC_RELEASE);
+         }
+         else
+         {
+            handleRCT = gResource_table[arrayIdx];
          }
 
-         gResource_table[arrayIdx] = persComRctOpen(filename, 0x00);
+         pthread_mutex_unlock(&gResourceMtx);
+      }
+   }
+
+   return handleRCT;
+}
+
+
+/// close the retired resource configuration table handles if no lookup uses a handle, the resource mutex must be locked
+static void close_retired_resource_cfg_tables_locked(void)
+{
+   // a lookup started after the handle has been unpublished can't get the retired handle
+   if(__atomic_load_n(&gResourceReaders, __ATOMIC_SEQ_CST) == 0)
+   {
+      while(gResourceRetired != NULL)
+      {
+         PersistenceRetiredRct_s* retired = gResourceRetired;
+         gResourceRetired = retired->next;
+
+         (void)persComRctClose(retired->handle);
+         free(retired);
+      }
+   }
+}
+
+
+/// start a lookup using a resource configuration table handle without lock
+static void resource_cfg_table_reader_enter(void)
+{
+   __atomic_fetch_add(&gResourceReaders, 1, __ATOMIC_SEQ_CST);
+}
+
+
+/// finish a lookup, the last lookup closes the retired handles
+static void resource_cfg_table_reader_leave(void)
+{
+   if(   (__atomic_sub_fetch(&gResourceReaders, 1, __ATOMIC_SEQ_CST) == 0)
+      && (__atomic_load_n(&gResourceRetired, __ATOMIC_SEQ_CST) != NULL) )
+   {
+      pthread_mutex_lock(&gResourceMtx);
+      close_retired_resource_cfg_tables_locked();
+      pthread_mutex_unlock(&gResourceMtx);
+   }
+}
+
+
+void close_retired_resource_cfg_tables(void)
+{
+   pthread_mutex_lock(&gResourceMtx);
+
+   while(gResourceRetired != NULL)
+   {
+      close_retired_resource_cfg_tables_locked();
+
+      if(gResourceRetired != NULL)
+      {
+         // wait for the running lookups to finish
+         pthread_mutex_unlock(&gResourceMtx);
+         (void)sched_yield();
+         pthread_mutex_lock(&gResourceMtx);
+      }
+   }
+
+   pthread_mutex_unlock(&gResourceMtx);
+}
+
+
+void close_modified_resource_cfg_tables(void)
+{
+   int* modified = NULL;
+   int numModified = 0, numCompiled = 0, i = 0;
+
+   if(rct_index_enabled() == 1)
+   {
+      numModified = rct_index_check_modified(&modified);
+   }
+
+   // compiled tables are consulted before the index and the table, unload them so they are validated again
+   for(i=0; i<numModified; i++)
+   {
+      rct_hash_unload(modified[i]);
+   }
+   for(i=0; i<PrctDbTableSize; i++)
+   {
+      if(rct_hash_check_modified(i) == 1)
+      {
+         rct_hash_unload(i);
+         numCompiled++;
+      }
+   }
+
+   // nothing modified, the resource mutex is not needed
+   if((numModified == 0) && (numCompiled == 0))
+   {
+      free(modified);
+      return;
+   }
 
-         if(gResource_table[arrayIdx] < 0)
+   pthread_mutex_lock(&gResourceMtx);
+
+   for(i=0; i<numModified; i++)
+   {
+      int handle = gResource_table[modified[i]];
+
+      __atomic_store_n(&gResource_table[modified[i]], -1, __ATOMIC_SEQ_CST);
+      gResourceOpen[modified[i]] = 0;
+
+      if(handle >= 0)
+      {
+         PersistenceRetiredRct_s* retired = malloc(sizeof(PersistenceRetiredRct_s));
+
+         if(retired != NULL)
          {
-         	gResourceOpen[arrayIdx] = 0;
-            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("get_resource_cfg_table - RCT problem"), DLT_INT(gResource_table[arrayIdx] ));
+            retired->handle  = handle;
+            retired->next    = gResourceRetired;
+            gResourceRetired = retired;
          }
          else
          {
-             gResourceOpen[arrayIdx] = 1 ;
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("close_modified_resource_cfg_tables - no memory, handle not closed:"), DLT_INT(handle));
          }
       }
    }
 
-   return gResource_table[arrayIdx];
+   close_retired_resource_cfg_tables_locked();
+
+   pthread_mutex_unlock(&gResourceMtx);
+
+   if((numModified > 0) || (numCompiled > 0))
+   {
+      invalidate_db_context_cache();
+   }
+
+   free(modified);
+}
+
+
+/// get the compiled resource configuration table, returns 1 if it is loaded
+static int get_compiled_resource_cfg_table(PersistenceRCT_e rct, int group)
+{
+   int hashLoaded = rct_hash_is_loaded(rct + group);
+
+   if(hashLoaded == -1)
+   {
+      char filename[DbPathMaxLen] = { [0 ... DbPathMaxLen-1] = 0};
+
+      get_resource_cfg_table_name(rct, group, filename);
+      hashLoaded = rct_hash_load(rct + group, filename);
+      if(hashLoaded == 1)
+      {
+         resource_cfg_check_timer_arm();
+      }
+   }
+
+   return hashLoaded;
+}
+
+
+/// set the resource configuration and create database path and key
+static int set_db_context(PersistenceInfo_s* dbContext, const PersistenceConfigurationKey_s* config,
+                          const char* resource_id, char dbKey[], char dbPath[])
+{
+   int rval = 0;
+
+   memcpy(&dbContext->configKey, config, sizeof(dbContext->configKey)) ;
+   dbContext->customIdx = -1;
+   if(config->storage != PersistenceStorage_custom )
+   {
+      rval = get_db_path_and_key(dbContext, resource_id, dbKey, dbPath);
+   }
+   else
+   {
+      // the plugin is resolved once, the index is kept with the resolved context
+      dbContext->customIdx = custom_client_name_to_id(dbContext->configKey.custom_name, 1);
+
+      // if customer storage, we use the custom name as dbPath
+      strncpy(dbPath, dbContext->configKey.custom_name, strlen(dbContext->configKey.custom_name));
+
+      // and resource_id as dbKey
+      strncpy(dbKey, resource_id, strlen(resource_id));
+   }
+
+   return rval;
 }
 
 
 // status: OK
-int get_db_context(PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile, char dbKey[], char dbPath[])
+/**
+ * @brief resolve the database context of a resource, see get_db_context
+ *
+ * @param tableAvailable set to 1 if the context has been resolved from the resource configuration table,
+ *                       0 if the default context has been used because the table is not available
+ */
+static int db_context_resolve(PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile,
+                              char dbKey[], char dbPath[], int* tableAvailable)
 {
    int rval = 0, resourceFound = 0, groupId = 0;
+   unsigned int hash = db_context_hash(dbContext, resource_id, isFile);
 
    PersistenceRCT_e rct = PersistenceRCT_LastEntry;
 
+   *tableAvailable = 1;
+
+   // resources are resolved only once, as long as the resource configuration tables stay open
+   if(db_context_cache_lookup(dbContext, resource_id, isFile, hash, dbKey, dbPath) == 1)
+   {
+      return 0;
+   }
+
    rct = get_table_id(dbContext->context.ldbid, &groupId);
 
-   // get resource configuration table
-   int handleRCT = get_resource_cfg_table(rct, groupId);
+   *tableAvailable = 0;
+   int iErrCode = EPERS_NOPRCTABLE;
+   PersistenceConfigurationKey_s sRctEntry ;
 
-   if(handleRCT >= 0)
+   // use the compiled table if available, the resource configuration table is not opened then
+   if(get_compiled_resource_cfg_table(rct, groupId) == 1)
    {
-      PersistenceConfigurationKey_s sRctEntry ;
+      iErrCode = rct_hash_read(rct + groupId, resource_id, &sRctEntry);
+      *tableAvailable = 1;
+   }
+   else
+   {
+      int handleRCT = -1;
 
-      // check if resouce id is in write through table
-      int iErrCode = persComRctRead(handleRCT, resource_id, &sRctEntry) ;
-      
-      if(sizeof(PersistenceConfigurationKey_s) == iErrCode)
+      // the handle stays open until the lookup has finished, even if the table is modified in the meantime
+      resource_cfg_table_reader_enter();
+
+      // get resource configuration table
+      handleRCT = get_resource_cfg_table(rct, groupId);
+
+      if(handleRCT >= 0)
       {
-    	   memcpy(&dbContext->configKey, &sRctEntry, sizeof(dbContext->configKey)) ;
-         if(sRctEntry.storage != PersistenceStorage_custom )
+         // check if resouce id is in write through table (served from the in-memory index if available)
+         iErrCode = rct_index_read(rct + groupId, resource_id, &sRctEntry);
+         if(iErrCode == EPERS_NOPRCTABLE)
          {
-            rval = get_db_path_and_key(dbContext, resource_id, dbKey, dbPath);
+            iErrCode = persComRctRead(handleRCT, resource_id, &sRctEntry) ;
          }
-         else
-         {
-            // if customer storage, we use the custom name as dbPath
-            strncpy(dbPath, dbContext->configKey.custom_name, strlen(dbContext->configKey.custom_name));
+         *tableAvailable = 1;
+      }
 
-            // and resource_id as dbKey
-            strncpy(dbKey, resource_id, strlen(resource_id));
-         }
+      resource_cfg_table_reader_leave();
+   }
+
+   if(*tableAvailable == 1)
+   {
+      if(sizeof(PersistenceConfigurationKey_s) == iErrCode)
+      {
+         rval = set_db_context(dbContext, &sRctEntry, resource_id, dbKey, dbPath);
          resourceFound = 1;
       }
       else
@@ -195,6 +819,7 @@ int get_db_context(PersistenceInfo_s* dbContext, const char* resource_id, unsign
       //
       dbContext->configKey.policy      = PersistencePolicy_wc;
       dbContext->configKey.storage     = PersistenceStorage_local;
+      dbContext->customIdx             = -1;
       dbContext->configKey.permission  = PersistencePermission_ReadWrite;
       dbContext->configKey.max_size    = defaultMaxKeyValDataSize;
       if(isFile == PersistenceResourceType_file)
@@ -221,11 +846,26 @@ int get_db_context(PersistenceInfo_s* dbContext, const char* resource_id, unsign
 	   rval = 0;
    }
 
+   // the default context is not cached, the table is tried again on the next access
+   if((rval == 0) && (*tableAvailable == 1))
+   {
+      db_context_cache_store(dbContext, resource_id, isFile, hash, dbKey, dbPath);
+   }
+
    return rval;
 }
 
 
 
+int get_db_context(PersistenceInfo_s* dbContext, const char* resource_id, unsigned int isFile, char dbKey[], char dbPath[])
+{
+   int tableAvailable = 0;
+
+   return db_context_resolve(dbContext, resource_id, isFile, dbKey, dbPath, &tableAvailable);
+}
+
+
+
 int get_db_path_and_key(PersistenceInfo_s* dbContext, const char* resource_id, char dbKey[], char dbPath[])
 {
    int storePolicy = PersistenceStorage_LastEntry;
@@ -362,6 +1002,40 @@ int get_db_path_and_key(PersistenceInfo_s* dbContext, const char* resource_id, c
 
 
 
+int get_db_context_by_id(PersistenceInfo_s* dbContext, const pclResourceId_s* resource, char dbKey[], char dbPath[])
+{
+   int rval = 0, groupId = 0, tableAvailable = 1;
+   unsigned int hash = db_context_hash_by_id(dbContext, resource);
+   PersistenceConfigurationKey_s sRctEntry;
+   PersistenceRCT_e rct = PersistenceRCT_LastEntry;
+
+   // the resource is resolved only once, the descriptor identifies it without resource id string operations
+   if(db_context_cache_lookup_by_id(dbContext, resource, hash, dbKey, dbPath) == 1)
+   {
+      return 0;
+   }
 
+   rct = get_table_id(dbContext->context.ldbid, &groupId);
+
+   if(   (get_compiled_resource_cfg_table(rct, groupId) == 1)
+      && (rct_hash_read_slot(rct + groupId, resource->slot, resource->hash, &sRctEntry) == sizeof(PersistenceConfigurationKey_s)) )
+   {
+      rval = set_db_context(dbContext, &sRctEntry, resource->resource_id, dbKey, dbPath);
+      if(0 < rval)
+      {
+         rval = 0;
+      }
+   }
+   else
+   {
+      // no compiled table or the descriptor has been generated from another table
+      rval = db_context_resolve(dbContext, resource->resource_id, ResIsNoFile, dbKey, dbPath, &tableAvailable);
+   }
 
+   if((rval == 0) && (tableAvailable == 1))
+   {
+      db_context_cache_store_by_id(dbContext, resource, hash, dbKey, dbPath);
+   }
 
+   return rval;
+}
@@ -52,6 +52,23 @@ int get_db_context(PersistenceInfo_s* dbContext, const char* resource_id, unsign
 
 
 
+/**
+ * @brief Create database search key and database location path of a resource identified by
+ *        a generated resource descriptor. The resource configuration is read from the slot
+ *        of the compiled resource configuration table, if the slot does not match the
+ *        descriptor get_db_context is used.
+ *
+ * @param dbContext the database context
+ * @param resource the resource descriptor
+ * @param dbKey the array where the database key will be stored
+ * @param dbPath the array where the database location path will be stored
+ *
+ * @return 0 or a negative value with one of the following errors: EPERS_NOKEYDATA or EPERS_NOPRCTABLE
+ */
+int get_db_context_by_id(PersistenceInfo_s* dbContext, const pclResourceId_s* resource, char dbKey[], char dbPath[]);
+
+
+
 /**
  * @brief get the resource configuration table gvbd database by id
  *
@@ -68,5 +85,69 @@ int get_resource_cfg_table_by_idx(int i);
 void invalidate_resource_cfg_table(int i);
 
 
+/**
+ * @brief close the handles of modified resource configuration tables which have been kept open
+ *        for running lookups, waits until the running lookups have finished
+ */
+void close_retired_resource_cfg_tables(void);
+
+
+/**
+ * @brief close the resource configuration tables modified on disk, they are opened and indexed again on next access.
+ *        The compiled tables of modified tables are unloaded and validated again on next access.
+ *        Lookups may still use the handle of a modified table, the handle is closed when they have finished.
+ */
+void close_modified_resource_cfg_tables(void);
+
+
+/**
+ * @brief create the timer of the check for modified resource configuration tables.
+ *        The timer is started when the first table has been indexed or a compiled table has been loaded,
+ *        lookups don't check the tables.
+ *
+ * @return the timer file descriptor to be polled by the dbus mainloop or -1 on error
+ */
+int resource_cfg_check_timer_init(void);
+
+
+/**
+ * @brief the timer of the check has expired, close the modified resource configuration tables
+ */
+void resource_cfg_check_timeout(void);
+
+
+/**
+ * @brief close the timer of the check for modified resource configuration tables
+ */
+void resource_cfg_check_timer_deinit(void);
+
+
+/**
+ * @brief invalidate all entries of the resolved database context cache.
+ *        The cache statistics are logged and reset.
+ */
+void invalidate_db_context_cache(void);
+
+
+/**
+ * @brief get the generation of the resolved database contexts.
+ *        The generation is incremented when the context cache is invalidated (resource configuration
+ *        tables reloaded), contexts resolved in an older generation must be resolved again.
+ *
+ * @return the generation
+ */
+unsigned int db_context_generation(void);
+
+
+/**
+ * @brief get the statistics of the resolved database context cache
+ *
+ * @param hits number of get_db_context calls served from the cache
+ * @param misses number of get_db_context calls which needed a resource configuration table lookup
+ * @param evictions number of cache entries replaced by another resource
+ */
+void get_db_context_cache_stats(unsigned int* hits, unsigned int* misses, unsigned int* evictions);
+
+
 
 #endif /* PERSISTENCE_CLIENT_LIBRARY_ACCESS_HELPER_H */
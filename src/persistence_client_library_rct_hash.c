@@ -0,0 +1,374 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_rct_hash.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the access to the compiled resource configuration tables
+ * @see
+ */
+
+#include "persistence_client_library_rct_hash.h"
+#include "persistence_client_library_data_organization.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/// load state of a compiled table
+typedef enum _PersRctHashState_e
+{
+   /// not yet tried to load
+   PersRctHashState_unknown = 0,
+   /// loaded
+   PersRctHashState_loaded,
+   /// not available
+   PersRctHashState_none
+} PersRctHashState_e;
+
+
+/// mapped compiled table
+typedef struct _PersRctHashMap_s
+{
+   /// the mapped file
+   const unsigned char* image;
+   /// size of the mapped file
+   size_t size;
+   /// the file header
+   const PersRctHashHeader_s* header;
+   /// the bucket seeds
+   const uint32_t* seeds;
+   /// the slots
+   const PersRctHashSlot_s* slots;
+   /// path of the resource configuration table the compiled table belongs to
+   char rctFilename[DbPathMaxLen];
+   /// modification time of the resource configuration table when the compiled table has been loaded
+   time_t rctMtime;
+   /// size of the resource configuration table when the compiled table has been loaded
+   off_t rctFileSize;
+} PersRctHashMap_s;
+
+
+/// the compiled tables, the map is published before the state is set to loaded
+static PersRctHashMap_s gRctHashMap[PrctDbTableSize];
+/// load state of the compiled tables
+static int gRctHashState[PrctDbTableSize] = {0};
+/// mutex to serialize loading and unloading
+static pthread_mutex_t gRctHashMtx = PTHREAD_MUTEX_INITIALIZER;
+/// number of reads using a mapped table, the tables are unmapped when no read is running
+static int gRctHashReaders = 0;
+
+
+
+/// start a read, returns the map if the table is loaded; ::rct_hash_read_leave must be called in any case
+static const PersRctHashMap_s* rct_hash_read_enter(int idx)
+{
+   const PersRctHashMap_s* map = NULL;
+
+   __atomic_add_fetch(&gRctHashReaders, 1, __ATOMIC_SEQ_CST);
+
+   if(   (idx >= 0) && (idx < PrctDbTableSize)
+      && (__atomic_load_n(&gRctHashState[idx], __ATOMIC_SEQ_CST) == PersRctHashState_loaded) )
+   {
+      map = &gRctHashMap[idx];
+   }
+
+   return map;
+}
+
+
+
+static void rct_hash_read_leave(void)
+{
+   __atomic_sub_fetch(&gRctHashReaders, 1, __ATOMIC_SEQ_CST);
+}
+
+
+
+int rct_hash_is_loaded(int idx)
+{
+   int rval = 0;
+
+   if((idx >= 0) && (idx < PrctDbTableSize))
+   {
+      switch(__atomic_load_n(&gRctHashState[idx], __ATOMIC_ACQUIRE))
+      {
+      case PersRctHashState_loaded:
+         rval = 1;
+         break;
+      case PersRctHashState_unknown:
+         rval = -1;
+         break;
+      default:
+         rval = 0;
+         break;
+      }
+   }
+
+   return rval;
+}
+
+
+
+/// check header and table bounds of a mapped file
+static int rct_hash_is_valid(const unsigned char* image, size_t size, uint32_t rctSize, uint32_t rctChecksum)
+{
+   const PersRctHashHeader_s* header = (const PersRctHashHeader_s*)image;
+
+   return (   (size >= sizeof(PersRctHashHeader_s))
+           && (header->magic       == PersRctHashMagic)
+           && (header->version     == PersRctHashVersion)
+           && (header->configSize  == sizeof(PersistenceConfigurationKey_s))
+           && (header->rctSize     == rctSize)          // compiled from the current table
+           && (header->rctChecksum == rctChecksum)
+           && (header->numBuckets > 0)
+           && (header->numSlots   > 0)
+           && (header->bucketOffset % sizeof(uint32_t) == 0)
+           && (header->slotOffset % sizeof(uint32_t) == 0)
+           && ((uint64_t)header->bucketOffset + (uint64_t)header->numBuckets * sizeof(uint32_t) <= size)
+           && ((uint64_t)header->slotOffset + (uint64_t)header->numSlots * sizeof(PersRctHashSlot_s) <= size)
+           && (image[size-1] == '\0') );    // resource ids are terminated
+}
+
+
+
+int rct_hash_load(int idx, const char* rctFilename)
+{
+   int rval = 0;
+
+   if((idx >= 0) && (idx < PrctDbTableSize))
+   {
+      pthread_mutex_lock(&gRctHashMtx);
+
+      if(gRctHashState[idx] == PersRctHashState_unknown)
+      {
+         char filename[DbPathMaxLen] = {0};
+         int fd = -1;
+         int state = PersRctHashState_none;
+         uint32_t rctSize = 0, rctChecksum = 0;
+         struct stat rctStat;
+
+         snprintf(filename, DbPathMaxLen, "%s%s", rctFilename, PERS_RCT_HASH_EXT);
+
+         // the table is checked before the checksum, a modification after the checksum is detected by rct_hash_check_modified
+         fd = open(filename, O_RDONLY);
+         if(   (fd != -1)
+            && (   (stat(rctFilename, &rctStat) == -1)
+                || (pers_rct_checksum(rctFilename, &rctSize, &rctChecksum) == -1)) )
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("rct_hash_load - failed to read RCT:"), DLT_STRING(rctFilename));
+            close(fd);
+            fd = -1;
+         }
+
+         if(fd != -1)
+         {
+            struct stat fileStat;
+
+            if((fstat(fd, &fileStat) != -1) && (fileStat.st_size > 0))
+            {
+               void* image = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+               if(image != MAP_FAILED)
+               {
+                  if(rct_hash_is_valid(image, fileStat.st_size, rctSize, rctChecksum) == 1)
+                  {
+                     gRctHashMap[idx].image  = image;
+                     gRctHashMap[idx].size   = fileStat.st_size;
+                     gRctHashMap[idx].header = image;
+                     gRctHashMap[idx].seeds  = (const uint32_t*)((const unsigned char*)image + gRctHashMap[idx].header->bucketOffset);
+                     gRctHashMap[idx].slots  = (const PersRctHashSlot_s*)((const unsigned char*)image + gRctHashMap[idx].header->slotOffset);
+                     gRctHashMap[idx].rctMtime    = rctStat.st_mtime;
+                     gRctHashMap[idx].rctFileSize = rctStat.st_size;
+                     snprintf(gRctHashMap[idx].rctFilename, DbPathMaxLen, "%s", rctFilename);
+                     state = PersRctHashState_loaded;
+
+                     DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("rct_hash_load - compiled RCT:"), DLT_STRING(filename),
+                                                           DLT_STRING("resources:"), DLT_UINT(gRctHashMap[idx].header->numEntries));
+                  }
+                  else
+                  {
+                     DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("rct_hash_load - invalid or outdated compiled RCT:"), DLT_STRING(filename));
+                     munmap(image, fileStat.st_size);
+                  }
+               }
+            }
+            close(fd);
+         }
+
+         __atomic_store_n(&gRctHashState[idx], state, __ATOMIC_RELEASE);
+      }
+
+      rval = (gRctHashState[idx] == PersRctHashState_loaded) ? 1 : 0;
+
+      pthread_mutex_unlock(&gRctHashMtx);
+   }
+
+   return rval;
+}
+
+
+
+int rct_hash_read(int idx, const char* resource_id, PersistenceConfigurationKey_s* config)
+{
+   int rval = EPERS_NOPRCTABLE;
+   const PersRctHashMap_s* map = rct_hash_read_enter(idx);
+
+   if(map != NULL)
+   {
+      uint32_t hash = pers_rct_hash(0, resource_id);
+      uint32_t seed = map->seeds[hash % map->header->numBuckets];
+      const PersRctHashSlot_s* slot = &map->slots[pers_rct_hash(seed, resource_id) % map->header->numSlots];
+
+      if(   (slot->resIdOffset != 0)
+         && (slot->hash == hash)
+         && (slot->resIdOffset < map->size)
+         && (strcmp((const char*)map->image + slot->resIdOffset, resource_id) == 0) )
+      {
+         memcpy(config, &slot->config, sizeof(PersistenceConfigurationKey_s));
+         rval = sizeof(PersistenceConfigurationKey_s);
+      }
+      else
+      {
+         rval = EPERS_NOKEYDATA;
+      }
+   }
+
+   rct_hash_read_leave();
+
+   return rval;
+}
+
+
+
+int rct_hash_read_slot(int idx, unsigned int slot, unsigned int hash, PersistenceConfigurationKey_s* config)
+{
+   int rval = EPERS_NOPRCTABLE;
+   const PersRctHashMap_s* map = rct_hash_read_enter(idx);
+
+   if(map != NULL)
+   {
+      if(   (slot < map->header->numSlots)
+         && (map->slots[slot].resIdOffset != 0)
+         && (map->slots[slot].hash == hash) )
+      {
+         memcpy(config, &map->slots[slot].config, sizeof(PersistenceConfigurationKey_s));
+         rval = sizeof(PersistenceConfigurationKey_s);
+      }
+      else
+      {
+         rval = EPERS_NOKEYDATA;
+      }
+   }
+
+   rct_hash_read_leave();
+
+   return rval;
+}
+
+
+
+int rct_hash_check_modified(int idx)
+{
+   int rval = 0;
+
+   if(   (idx >= 0) && (idx < PrctDbTableSize)
+      && (__atomic_load_n(&gRctHashState[idx], __ATOMIC_ACQUIRE) == PersRctHashState_loaded) )
+   {
+      pthread_mutex_lock(&gRctHashMtx);
+
+      if(gRctHashState[idx] == PersRctHashState_loaded)
+      {
+         struct stat fileStat;
+
+         if(   (stat(gRctHashMap[idx].rctFilename, &fileStat) == -1)
+            || (fileStat.st_mtime != gRctHashMap[idx].rctMtime)
+            || (fileStat.st_size  != gRctHashMap[idx].rctFileSize) )
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("rct_hash_check_modified - RCT modified:"), DLT_STRING(gRctHashMap[idx].rctFilename));
+            rval = 1;
+         }
+      }
+
+      pthread_mutex_unlock(&gRctHashMtx);
+   }
+
+   return rval;
+}
+
+
+
+void rct_hash_unload(int idx)
+{
+   if((idx >= 0) && (idx < PrctDbTableSize))
+   {
+      int loaded = 0;
+
+      pthread_mutex_lock(&gRctHashMtx);
+
+      // new reads don't use the table anymore, the next lookup loads and validates the compiled table again
+      loaded = (gRctHashState[idx] == PersRctHashState_loaded);
+      __atomic_store_n(&gRctHashState[idx], PersRctHashState_unknown, __ATOMIC_SEQ_CST);
+
+      if(loaded == 1)
+      {
+         // wait until running reads have finished
+         while(__atomic_load_n(&gRctHashReaders, __ATOMIC_SEQ_CST) > 0)
+         {
+            sched_yield();
+         }
+
+         munmap((void*)gRctHashMap[idx].image, gRctHashMap[idx].size);
+         memset(&gRctHashMap[idx], 0, sizeof(gRctHashMap[idx]));
+      }
+
+      pthread_mutex_unlock(&gRctHashMtx);
+   }
+}
+
+
+
+void rct_hash_unload_all(void)
+{
+   int i = 0, loaded[PrctDbTableSize] = {0};
+
+   pthread_mutex_lock(&gRctHashMtx);
+
+   // new reads don't use the tables anymore
+   for(i=0; i<PrctDbTableSize; i++)
+   {
+      loaded[i] = (gRctHashState[i] == PersRctHashState_loaded);
+      __atomic_store_n(&gRctHashState[i], PersRctHashState_unknown, __ATOMIC_SEQ_CST);
+   }
+
+   // wait until running reads have finished
+   while(__atomic_load_n(&gRctHashReaders, __ATOMIC_SEQ_CST) > 0)
+   {
+      sched_yield();
+   }
+
+   for(i=0; i<PrctDbTableSize; i++)
+   {
+      if(loaded[i] == 1)
+      {
+         munmap((void*)gRctHashMap[i].image, gRctHashMap[i].size);
+         memset(&gRctHashMap[i], 0, sizeof(gRctHashMap[i]));
+      }
+   }
+
+   pthread_mutex_unlock(&gRctHashMtx);
+}
@@ -0,0 +1,222 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_RCT_HASH_H
+#define PERSISTENCE_CLIENT_LIBRARY_RCT_HASH_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_rct_hash.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the compiled resource configuration table.
+ *                 The tool persistence_rct_compiler converts a resource
+ *                 configuration table into a perfect hash file, stored next to
+ *                 the table ("<rct>.hash"). If available, the file is mapped
+ *                 read only and resources are resolved with no persComRct call.
+ *
+ *                 The header records size and checksum of the table it has been
+ *                 compiled from, a file not matching the table is not used.
+ *
+ *                 File layout: header, bucket seeds, slots, resource ids.
+ *                 A resource is found in slot
+ *                 hash(seed[hash(0, id) % numBuckets], id) % numSlots
+ * @see
+ */
+
+#include <persComRct.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc32.h"
+
+
+/// file name extension of the compiled resource configuration table
+#define PERS_RCT_HASH_EXT  ".hash"
+
+
+/// compiled resource configuration table constants
+enum _PersRctHashConstants
+{
+   /// file identifier "PCLH"
+   PersRctHashMagic   = 0x484C4350,
+   /// file format version
+   PersRctHashVersion = 3
+};
+
+
+/// compiled resource configuration table file header
+typedef struct _PersRctHashHeader_s
+{
+   /// file identifier
+   uint32_t magic;
+   /// file format version
+   uint32_t version;
+   /// size of the resource configuration (PersistenceConfigurationKey_s), must match the library
+   uint32_t configSize;
+   /// number of resources
+   uint32_t numEntries;
+   /// number of buckets (seeds)
+   uint32_t numBuckets;
+   /// number of slots
+   uint32_t numSlots;
+   /// file offset of the bucket seeds
+   uint32_t bucketOffset;
+   /// file offset of the slots
+   uint32_t slotOffset;
+   /// size of the resource configuration table the file has been compiled from
+   uint32_t rctSize;
+   /// checksum (crc32) of the resource configuration table the file has been compiled from
+   uint32_t rctChecksum;
+} PersRctHashHeader_s;
+
+
+/// slot of the compiled resource configuration table
+typedef struct _PersRctHashSlot_s
+{
+   /// file offset of the resource id, 0 if the slot is empty
+   uint32_t resIdOffset;
+   /// hash value of the resource id (pers_rct_hash with seed 0)
+   uint32_t hash;
+   /// the resource configuration
+   PersistenceConfigurationKey_s config;
+} PersRctHashSlot_s;
+
+
+/**
+ * @brief hash function of the compiled resource configuration table
+ *
+ * @param seed the hash seed (0 for the bucket, bucket seed for the slot)
+ * @param resource_id the resource id
+ *
+ * @return the hash value
+ */
+static inline unsigned int pers_rct_hash(unsigned int seed, const char* resource_id)
+{
+   return pclCrc32(seed, (const unsigned char*)resource_id, strlen(resource_id));
+}
+
+
+/**
+ * @brief get size and checksum of a resource configuration table,
+ *        stored in the compiled table to detect a compiled table not matching the table
+ *
+ * @param rctFilename the path of the resource configuration table
+ * @param size returns the size of the file
+ * @param checksum returns the checksum (crc32) of the file
+ *
+ * @return 0 on success or -1 if the file could not be read
+ */
+static inline int pers_rct_checksum(const char* rctFilename, uint32_t* size, uint32_t* checksum)
+{
+   unsigned char buffer[4096];
+   ssize_t readSize = 0;
+   int fd = open(rctFilename, O_RDONLY);
+
+   *size = 0;
+   *checksum = 0;
+
+   if(fd == -1)
+   {
+      return -1;
+   }
+
+   while((readSize = read(fd, buffer, sizeof(buffer))) > 0)
+   {
+      *checksum = pclCrc32(*checksum, buffer, readSize);
+      *size += (uint32_t)readSize;
+   }
+   close(fd);
+
+   return (readSize == 0) ? 0 : -1;
+}
+
+
+/**
+ * @brief check if the compiled table of a resource configuration table has been loaded
+ *
+ * @param idx the resource configuration table index (table type + group)
+ *
+ * @return 1 if loaded, 0 if not available, -1 if not yet tried to load
+ */
+int rct_hash_is_loaded(int idx);
+
+
+/**
+ * @brief map the compiled table of a resource configuration table.
+ *        The compiled table is not used if it has not been compiled from the current table.
+ *
+ * @param idx the resource configuration table index (table type + group)
+ * @param rctFilename the path of the resource configuration table, PERS_RCT_HASH_EXT is appended
+ *
+ * @return 1 if loaded, 0 if not available
+ */
+int rct_hash_load(int idx, const char* rctFilename);
+
+
+/**
+ * @brief read a resource configuration from the compiled table
+ *
+ * @param idx the resource configuration table index (table type + group)
+ * @param resource_id the resource id
+ * @param config the resource configuration
+ *
+ * @return the size of the resource configuration on success,
+ *         EPERS_NOKEYDATA if the resource is not in the table or
+ *         EPERS_NOPRCTABLE if the compiled table is not loaded
+ */
+int rct_hash_read(int idx, const char* resource_id, PersistenceConfigurationKey_s* config);
+
+
+/**
+ * @brief read a resource configuration from a slot of the compiled table,
+ *        used for resources identified by a generated ::pclResourceId_s
+ *
+ * @param idx the resource configuration table index (table type + group)
+ * @param slot the slot of the resource
+ * @param hash the hash value of the resource id, must match the hash value stored in the slot
+ * @param config the resource configuration
+ *
+ * @return the size of the resource configuration on success,
+ *         EPERS_NOKEYDATA if the slot does not hold the resource or
+ *         EPERS_NOPRCTABLE if the compiled table is not loaded
+ */
+int rct_hash_read_slot(int idx, unsigned int slot, unsigned int hash, PersistenceConfigurationKey_s* config);
+
+
+/**
+ * @brief check if the resource configuration table of a loaded compiled table
+ *        has been modified on disk since the compiled table has been loaded
+ *
+ * @param idx the resource configuration table index (table type + group)
+ *
+ * @return 1 if the compiled table is loaded and the table has been modified, 0 if not
+ */
+int rct_hash_check_modified(int idx);
+
+
+/**
+ * @brief unmap the compiled table of a resource configuration table, waits until running reads have finished.
+ *        The compiled table is loaded and validated again on the next lookup.
+ *
+ * @param idx the resource configuration table index (table type + group)
+ */
+void rct_hash_unload(int idx);
+
+
+/**
+ * @brief unmap all compiled tables, waits until running reads have finished
+ */
+void rct_hash_unload_all(void);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_RCT_HASH_H */
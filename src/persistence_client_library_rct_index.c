@@ -0,0 +1,375 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_rct_index.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the in-memory index of the resource configuration tables
+ * @see
+ */
+
+#include "persistence_client_library_rct_index.h"
+#include "crc32.h"
+
+#include <persComRct.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+
+/// index entry
+typedef struct _PersRctIndexEntry_s
+{
+   /// hash value of the resource id
+   unsigned int hash;
+   /// offset of the resource id in the resource list
+   unsigned int resIdOffset;
+   /// the resource configuration
+   PersistenceConfigurationKey_s config;
+} PersRctIndexEntry_s;
+
+
+/// index of a resource configuration table
+typedef struct _PersRctIndex_s
+{
+   /// next dropped index, a dropped index is freed when no lookup uses it anymore
+   struct _PersRctIndex_s* nextRetired;
+   /// path of the resource configuration table file
+   char filename[DbPathMaxLen];
+   /// modification time of the file when the index has been created
+   time_t mtime;
+   /// size of the file when the index has been created
+   off_t size;
+   /// number of entries
+   unsigned int numEntries;
+   /// number of slots - 1
+   unsigned int slotMask;
+   /// hash slots (open addressing), entry index + 1 or 0 if empty
+   unsigned int* slots;
+   /// the entries
+   PersRctIndexEntry_s* entries;
+   /// the resource list ('\0' separated resource ids)
+   char* resources;
+} PersRctIndex_s;
+
+
+/// index is enabled (1), disabled (0) or not yet checked (-1)
+static int gRctIndexEnabled = -1;
+/// the indexes of the resource configuration tables, published with release semantics
+static PersRctIndex_s* gRctIndex[PrctDbTableSize] = {NULL};
+/// dropped indexes, still readable by lookups started before the index has been dropped
+static PersRctIndex_s* gRctIndexRetired = NULL;
+/// number of lookups using an index without lock
+static unsigned int gRctIndexReaders = 0;
+/// mutex to serialize index creation and removal, lookups don't lock
+static pthread_mutex_t gRctIndexMtx = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+int rct_index_enabled(void)
+{
+   if(gRctIndexEnabled == -1)
+   {
+      const char* pEnabled = getenv("PERS_CLIENT_RCT_INDEX");
+      gRctIndexEnabled = ((pEnabled != NULL) && (atoi(pEnabled) == 1)) ? 1 : 0;
+   }
+
+   return gRctIndexEnabled;
+}
+
+
+
+static unsigned int rct_index_time_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (unsigned int)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+static void rct_index_free(PersRctIndex_s* index)
+{
+   free(index->slots);
+   free(index->entries);
+   free(index->resources);
+   free(index);
+}
+
+
+
+/// drop the index of a table, the index mutex must be locked
+static void rct_index_retire(int idx)
+{
+   PersRctIndex_s* index = gRctIndex[idx];
+
+   if(index != NULL)
+   {
+      __atomic_store_n(&gRctIndex[idx], NULL, __ATOMIC_SEQ_CST);
+      index->nextRetired = gRctIndexRetired;
+      __atomic_store_n(&gRctIndexRetired, index, __ATOMIC_SEQ_CST);
+   }
+}
+
+
+
+/// free the dropped indexes if no lookup uses an index, the index mutex must be locked
+static void rct_index_free_retired_locked(void)
+{
+   // a lookup started after the index has been dropped can't get the dropped index
+   if(__atomic_load_n(&gRctIndexReaders, __ATOMIC_SEQ_CST) == 0)
+   {
+      while(gRctIndexRetired != NULL)
+      {
+         PersRctIndex_s* index = gRctIndexRetired;
+         gRctIndexRetired = index->nextRetired;
+         rct_index_free(index);
+      }
+   }
+}
+
+
+
+/// finish a lookup, the last lookup frees the dropped indexes
+static void rct_index_reader_leave(void)
+{
+   if(   (__atomic_sub_fetch(&gRctIndexReaders, 1, __ATOMIC_SEQ_CST) == 0)
+      && (__atomic_load_n(&gRctIndexRetired, __ATOMIC_SEQ_CST) != NULL) )
+   {
+      pthread_mutex_lock(&gRctIndexMtx);
+      rct_index_free_retired_locked();
+      pthread_mutex_unlock(&gRctIndexMtx);
+   }
+}
+
+
+
+int rct_index_create(int idx, int handleRCT, const char* filename)
+{
+   int rval = EPERS_COMMON;
+   unsigned int start = rct_index_time_ms();
+   PersRctIndex_s* index = NULL;
+   struct stat fileStat;
+   int listSize = persComRctGetSizeResourcesList(handleRCT);
+
+   if((idx >= 0) && (idx < PrctDbTableSize) && (listSize >= 0) && (stat(filename, &fileStat) != -1))
+   {
+      index = calloc(1, sizeof(PersRctIndex_s));
+   }
+
+   if(index != NULL)
+   {
+      unsigned int numSlots = 16;
+      int pos = 0;
+
+      strncpy(index->filename, filename, DbPathMaxLen);
+      index->filename[DbPathMaxLen-1] = '\0';
+      index->mtime = fileStat.st_mtime;
+      index->size  = fileStat.st_size;
+
+      index->resources = malloc((listSize > 0) ? listSize : 1);
+      if(   (index->resources == NULL)
+         || ((listSize > 0) && (persComRctGetResourcesList(handleRCT, index->resources, listSize) < 0)) )
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("rct_index_create - failed to get the resource list:"), DLT_STRING(filename));
+         rct_index_free(index);
+         return EPERS_COMMON;
+      }
+
+      // the list must be terminated, an unterminated last resource id would be read beyond the list
+      if((listSize > 0) && (index->resources[listSize-1] != '\0'))
+      {
+         index->resources[listSize-1] = '\0';
+      }
+
+      for(pos=0; pos<listSize; pos += strlen(index->resources+pos) + 1)
+      {
+         index->numEntries++;
+      }
+
+      while(numSlots < 2 * index->numEntries)
+      {
+         numSlots <<= 1;
+      }
+      index->slotMask = numSlots - 1;
+      index->slots    = calloc(numSlots, sizeof(unsigned int));
+      index->entries  = calloc(index->numEntries + 1, sizeof(PersRctIndexEntry_s));
+
+      if((index->resources != NULL) && (index->slots != NULL) && (index->entries != NULL))
+      {
+         unsigned int numEntries = 0;
+
+         for(pos=0; pos<listSize; pos += strlen(index->resources+pos) + 1)
+         {
+            const char* resource_id = index->resources+pos;
+            PersRctIndexEntry_s* entry = &index->entries[numEntries];
+
+            if(persComRctRead(handleRCT, resource_id, &entry->config) == sizeof(PersistenceConfigurationKey_s))
+            {
+               unsigned int slot = 0;
+
+               entry->hash        = pclCrc32(0, (const unsigned char*)resource_id, strlen(resource_id));
+               entry->resIdOffset = pos;
+
+               for(slot = entry->hash & index->slotMask; index->slots[slot] != 0; slot = (slot + 1) & index->slotMask)
+               {
+                  ;
+               }
+               index->slots[slot] = ++numEntries;
+            }
+            else
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("rct_index_create - failed to read resource:"), DLT_STRING(resource_id));
+            }
+         }
+         index->numEntries = numEntries;
+
+         pthread_mutex_lock(&gRctIndexMtx);
+         rct_index_retire(idx);
+         __atomic_store_n(&gRctIndex[idx], index, __ATOMIC_RELEASE);
+         rct_index_free_retired_locked();
+         pthread_mutex_unlock(&gRctIndexMtx);
+
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("rct_index_create - RCT index:"), DLT_STRING(filename),
+                                               DLT_STRING("resources:"), DLT_UINT(index->numEntries),
+                                               DLT_STRING("size [bytes]:"),
+                                               DLT_UINT(sizeof(PersRctIndex_s) + listSize + numSlots * sizeof(unsigned int)
+                                                        + (index->numEntries + 1) * sizeof(PersRctIndexEntry_s)),
+                                               DLT_STRING("time [ms]:"), DLT_UINT(rct_index_time_ms() - start));
+         rval = 0;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("rct_index_create - failed to create RCT index:"), DLT_STRING(filename));
+         rct_index_free(index);
+      }
+   }
+
+   return rval;
+}
+
+
+
+int rct_index_read(int idx, const char* resource_id, PersistenceConfigurationKey_s* config)
+{
+   int rval = EPERS_NOPRCTABLE;
+   PersRctIndex_s* index = NULL;
+
+   // the index stays valid until the lookup has finished, even if it is dropped in the meantime
+   __atomic_fetch_add(&gRctIndexReaders, 1, __ATOMIC_SEQ_CST);
+
+   if((idx >= 0) && (idx < PrctDbTableSize))
+   {
+      index = __atomic_load_n(&gRctIndex[idx], __ATOMIC_SEQ_CST);
+   }
+
+   if(index != NULL)
+   {
+      unsigned int hash = pclCrc32(0, (const unsigned char*)resource_id, strlen(resource_id));
+      unsigned int slot = 0;
+
+      rval = EPERS_NOKEYDATA;
+
+      for(slot = hash & index->slotMask; index->slots[slot] != 0; slot = (slot + 1) & index->slotMask)
+      {
+         const PersRctIndexEntry_s* entry = &index->entries[index->slots[slot] - 1];
+
+         if(   (entry->hash == hash)
+            && (strcmp(index->resources + entry->resIdOffset, resource_id) == 0) )
+         {
+            memcpy(config, &entry->config, sizeof(PersistenceConfigurationKey_s));
+            rval = sizeof(PersistenceConfigurationKey_s);
+            break;
+         }
+      }
+   }
+
+   rct_index_reader_leave();
+
+   return rval;
+}
+
+
+
+int rct_index_check_modified(int** modified)
+{
+   int numModified = 0, i = 0;
+
+   *modified = NULL;
+
+   pthread_mutex_lock(&gRctIndexMtx);
+
+   for(i=0; i<PrctDbTableSize; i++)
+   {
+      if(gRctIndex[i] != NULL)
+      {
+         struct stat fileStat;
+
+         if(   (stat(gRctIndex[i]->filename, &fileStat) == -1)
+            || (fileStat.st_mtime != gRctIndex[i]->mtime)
+            || (fileStat.st_size  != gRctIndex[i]->size) )
+         {
+            int* list = realloc(*modified, (numModified + 1) * sizeof(int));
+
+            // keep the index if it can't be reported, the check is repeated after the next interval
+            if(list != NULL)
+            {
+               DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("rct_index_check_modified - RCT modified:"),
+                                                     DLT_STRING(gRctIndex[i]->filename));
+               rct_index_retire(i);
+               *modified = list;
+               (*modified)[numModified++] = i;
+            }
+         }
+      }
+   }
+
+   rct_index_free_retired_locked();
+
+   pthread_mutex_unlock(&gRctIndexMtx);
+
+   return numModified;
+}
+
+
+
+void rct_index_destroy_all(void)
+{
+   int i = 0;
+
+   pthread_mutex_lock(&gRctIndexMtx);
+
+   for(i=0; i<PrctDbTableSize; i++)
+   {
+      rct_index_retire(i);
+   }
+
+   while(gRctIndexRetired != NULL)
+   {
+      rct_index_free_retired_locked();
+
+      if(gRctIndexRetired != NULL)
+      {
+         // wait for the running lookups to finish
+         pthread_mutex_unlock(&gRctIndexMtx);
+         (void)sched_yield();
+         pthread_mutex_lock(&gRctIndexMtx);
+      }
+   }
+
+   pthread_mutex_unlock(&gRctIndexMtx);
+}
@@ -0,0 +1,83 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_RCT_INDEX_H
+#define PERSISTENCE_CLIENT_LIBRARY_RCT_INDEX_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_rct_index.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the in-memory index of the resource configuration tables.
+ *                 When a resource configuration table is opened, all entries are
+ *                 loaded into a hash index and resources are resolved from memory.
+ *                 An index is dropped when its table file changes on disk and is
+ *                 created again when the table is opened the next time.
+ *                 The index is enabled with the environment variable
+ *                 PERS_CLIENT_RCT_INDEX=1
+ * @see
+ */
+
+#include "persistence_client_library_data_organization.h"
+
+
+/**
+ * @brief check if the resource configuration table index is enabled
+ *
+ * @return 1 if enabled, 0 if not
+ */
+int rct_index_enabled(void);
+
+
+/**
+ * @brief create the index of a resource configuration table
+ *
+ * @param idx the resource configuration table index (table type + group)
+ * @param handleRCT the handle of the opened resource configuration table
+ * @param filename the path of the resource configuration table file
+ *
+ * @return 0 on success or a negative value if the index could not be created
+ */
+int rct_index_create(int idx, int handleRCT, const char* filename);
+
+
+/**
+ * @brief read a resource configuration from the index
+ *
+ * @param idx the resource configuration table index (table type + group)
+ * @param resource_id the resource id
+ * @param config the resource configuration
+ *
+ * @return the size of the resource configuration on success,
+ *         EPERS_NOKEYDATA if the resource is not in the table or
+ *         EPERS_NOPRCTABLE if no index is available for the table
+ */
+int rct_index_read(int idx, const char* resource_id, PersistenceConfigurationKey_s* config);
+
+
+/**
+ * @brief check if the files of the indexed tables have been modified.
+ *        The index of a modified table is dropped and freed when no lookup uses it anymore.
+ *
+ * @param modified returns the table indexes of the modified tables,
+ *        the array is allocated and must be freed by the caller (NULL if no table has been modified)
+ *
+ * @return the number of modified tables
+ */
+int rct_index_check_modified(int** modified);
+
+
+/**
+ * @brief drop all indexes, waits until the running lookups have finished
+ */
+void rct_index_destroy_all(void);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_RCT_INDEX_H */
@@ -0,0 +1,445 @@
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_write_cache.c
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Implementation of the write-behind cache for local write cached keys
+ * @see
+ */
+
+#include "persistence_client_library_write_cache.h"
+#include "persistence_client_library_db_access.h"
+#include "crc32.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/// write-behind cache entry
+typedef struct _PersWriteCacheEntry_s
+{
+   /// next entry in the hash bucket
+   struct _PersWriteCacheEntry_s* next;
+   /// persistence information (needed to get the database when writing back)
+   PersistenceInfo_s info;
+   /// the database path
+   char dbPath[DbPathMaxLen];
+   /// the database key
+   char dbKey[DbKeyMaxLen];
+   /// size of the data
+   unsigned int size;
+   /// the data
+   unsigned char* data;
+} PersWriteCacheEntry_s;
+
+
+/// hash buckets of the write-behind cache
+static PersWriteCacheEntry_s* gWriteCache[WriteCacheHashSize] = {NULL};
+/// number of entries in the write-behind cache
+static unsigned int gWriteCacheNumEntries = 0;
+/// mutex to protect the write-behind cache
+static pthread_mutex_t gWriteCacheMtx = PTHREAD_MUTEX_INITIALIZER;
+
+/// flush interval in ms, 0 if the cache is disabled (read without lock)
+static unsigned int gWriteCacheInterval = 0;
+/// number of writes absorbed by the cache (key was already in the cache)
+static unsigned int gWriteCacheAbsorbed = 0;
+
+/// flush thread
+static pthread_t gWriteCacheThread;
+/// flush thread is running
+static int gWriteCacheRunning = 0;
+/// mutex for the flush thread condition
+static pthread_mutex_t gWriteCacheThreadMtx = PTHREAD_MUTEX_INITIALIZER;
+/// condition to stop the flush thread
+static pthread_cond_t gWriteCacheThreadCond = PTHREAD_COND_INITIALIZER;
+
+
+
+static void* write_cache_flush_thread(void* dummy)
+{
+   (void)dummy;
+
+   pthread_mutex_lock(&gWriteCacheThreadMtx);
+
+   while(gWriteCacheRunning == 1)
+   {
+      struct timespec ts;
+
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_sec  += __atomic_load_n(&gWriteCacheInterval, __ATOMIC_RELAXED) / 1000;
+      ts.tv_nsec += (__atomic_load_n(&gWriteCacheInterval, __ATOMIC_RELAXED) % 1000) * 1000000;
+      if(ts.tv_nsec >= 1000000000)
+      {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000;
+      }
+
+      if(   (pthread_cond_timedwait(&gWriteCacheThreadCond, &gWriteCacheThreadMtx, &ts) == ETIMEDOUT)
+         && (gWriteCacheRunning == 1) )
+      {
+         pthread_mutex_unlock(&gWriteCacheThreadMtx);
+         (void)write_cache_flush();
+         pthread_mutex_lock(&gWriteCacheThreadMtx);
+      }
+   }
+
+   pthread_mutex_unlock(&gWriteCacheThreadMtx);
+
+   return NULL;
+}
+
+
+
+int write_cache_init(void)
+{
+   int rval = 0;
+   const char* pInterval = getenv("PERS_CLIENT_WRITE_CACHE_INTERVAL");
+
+   __atomic_store_n(&gWriteCacheInterval, 0, __ATOMIC_RELEASE);
+   if(pInterval != NULL)
+   {
+      int interval = atoi(pInterval);
+      if(interval > 0)
+      {
+         __atomic_store_n(&gWriteCacheInterval, (unsigned int)interval, __ATOMIC_RELEASE);
+      }
+   }
+
+   if(__atomic_load_n(&gWriteCacheInterval, __ATOMIC_ACQUIRE) > 0)
+   {
+      gWriteCacheRunning = 1;
+      if(pthread_create(&gWriteCacheThread, NULL, write_cache_flush_thread, NULL) == 0)
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("write_cache_init - write-behind cache enabled, flush interval [ms]:"),
+                                               DLT_UINT(__atomic_load_n(&gWriteCacheInterval, __ATOMIC_RELAXED)));
+         rval = 1;
+      }
+      else
+      {
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("write_cache_init - failed to create flush thread"), DLT_INT(errno));
+         gWriteCacheRunning  = 0;
+         __atomic_store_n(&gWriteCacheInterval, 0, __ATOMIC_RELEASE);
+         rval = -1;
+      }
+   }
+
+   return rval;
+}
+
+
+
+static unsigned int write_cache_hash(const char* dbPath, const char* key)
+{
+   unsigned int hash = pclCrc32(0, (const unsigned char*)dbPath, strlen(dbPath));
+
+   return pclCrc32(hash, (const unsigned char*)key, strlen(key)) & (WriteCacheHashSize-1);
+}
+
+
+
+static int write_cache_applies(const PersistenceInfo_s* info)
+{
+   return (   (__atomic_load_n(&gWriteCacheInterval, __ATOMIC_ACQUIRE) > 0)
+           && (info->configKey.storage == PersistenceStorage_local)
+           && (info->configKey.policy  == PersistencePolicy_wc) );
+}
+
+
+
+/// find an entry, the write cache mutex must be locked; prev returns the predecessor in the bucket
+static PersWriteCacheEntry_s* write_cache_find(unsigned int bucket, const char* dbPath, const char* key, PersWriteCacheEntry_s** prev)
+{
+   PersWriteCacheEntry_s* entry = gWriteCache[bucket];
+
+   if(prev != NULL)
+   {
+      *prev = NULL;
+   }
+
+   while(entry != NULL)
+   {
+      if(   (strncmp(entry->dbKey, key, DbKeyMaxLen) == 0)
+         && (strncmp(entry->dbPath, dbPath, DbPathMaxLen) == 0) )
+      {
+         break;
+      }
+
+      if(prev != NULL)
+      {
+         *prev = entry;
+      }
+      entry = entry->next;
+   }
+
+   return entry;
+}
+
+
+
+int write_cache_set(const PersistenceInfo_s* info, const char* dbPath, const char* key,
+                    const unsigned char* buffer, unsigned int buffer_size)
+{
+   int rval = -1;
+
+   if(write_cache_applies(info) == 1)
+   {
+      unsigned int bucket = write_cache_hash(dbPath, key);
+      unsigned char* data = malloc(buffer_size > 0 ? buffer_size : 1);
+
+      if(data != NULL)
+      {
+         PersWriteCacheEntry_s* entry = NULL;
+
+         memcpy(data, buffer, buffer_size);
+
+         pthread_mutex_lock(&gWriteCacheMtx);
+
+         if(__atomic_load_n(&gWriteCacheInterval, __ATOMIC_RELAXED) == 0)
+         {
+            entry = NULL;     // the cache has been disabled in the meantime, write directly
+         }
+         else if((entry = write_cache_find(bucket, dbPath, key, NULL)) != NULL)
+         {
+            // replace the data not yet written
+            free(entry->data);
+            gWriteCacheAbsorbed++;
+         }
+         else if(gWriteCacheNumEntries < WriteCacheMaxEntries)
+         {
+            entry = malloc(sizeof(PersWriteCacheEntry_s));
+            if(entry != NULL)
+            {
+               memcpy(&entry->info, info, sizeof(entry->info));
+               strncpy(entry->dbPath, dbPath, DbPathMaxLen);
+               entry->dbPath[DbPathMaxLen-1] = '\0';
+               strncpy(entry->dbKey, key, DbKeyMaxLen);
+               entry->dbKey[DbKeyMaxLen-1] = '\0';
+
+               entry->next = gWriteCache[bucket];
+               gWriteCache[bucket] = entry;
+               gWriteCacheNumEntries++;
+            }
+         }
+
+         if(entry != NULL)
+         {
+            entry->data = data;
+            entry->size = buffer_size;
+            rval = (int)buffer_size;
+         }
+         else
+         {
+            free(data);    // cache full, write directly
+         }
+
+         pthread_mutex_unlock(&gWriteCacheMtx);
+      }
+   }
+
+   return rval;
+}
+
+
+
+int write_cache_get(const PersistenceInfo_s* info, const char* dbPath, const char* key,
+                    unsigned char* buffer, unsigned int buffer_size)
+{
+   int rval = -1;
+
+   if(write_cache_applies(info) == 1)
+   {
+      PersWriteCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gWriteCacheMtx);
+
+      entry = write_cache_find(write_cache_hash(dbPath, key), dbPath, key, NULL);
+      if(entry != NULL)
+      {
+         if(buffer == NULL)
+         {
+            rval = (int)entry->size;
+         }
+         else
+         {
+            rval = (int)((entry->size < buffer_size) ? entry->size : buffer_size);
+            memcpy(buffer, entry->data, rval);
+         }
+      }
+
+      pthread_mutex_unlock(&gWriteCacheMtx);
+   }
+
+   return rval;
+}
+
+
+
+int write_cache_remove(const PersistenceInfo_s* info, const char* dbPath, const char* key)
+{
+   int rval = 0;
+
+   if(write_cache_applies(info) == 1)
+   {
+      unsigned int bucket = write_cache_hash(dbPath, key);
+      PersWriteCacheEntry_s* prev  = NULL;
+      PersWriteCacheEntry_s* entry = NULL;
+
+      pthread_mutex_lock(&gWriteCacheMtx);
+
+      entry = write_cache_find(bucket, dbPath, key, &prev);
+      if(entry != NULL)
+      {
+         if(prev != NULL)
+         {
+            prev->next = entry->next;
+         }
+         else
+         {
+            gWriteCache[bucket] = entry->next;
+         }
+         gWriteCacheNumEntries--;
+
+         free(entry->data);
+         free(entry);
+         rval = 1;
+      }
+
+      pthread_mutex_unlock(&gWriteCacheMtx);
+   }
+
+   return rval;
+}
+
+
+
+/// write all cached data to the databases, the write cache mutex must be locked
+static int write_cache_flush_locked(void)
+{
+   int i = 0, rval = 0;
+   unsigned int numFailed = 0;
+
+   for(i=0; i<WriteCacheHashSize; i++)
+   {
+      PersWriteCacheEntry_s* entry = gWriteCache[i];
+
+      // entries which could not be written stay in the bucket and will be written with the next flush
+      gWriteCache[i] = NULL;
+
+      while(entry != NULL)
+      {
+         PersWriteCacheEntry_s* next = entry->next;
+
+         if(database_write_key(&entry->info, entry->dbPath, entry->dbKey, entry->data, entry->size) < 0)
+         {
+            DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("write_cache_flush - failed to write key:"), DLT_STRING(entry->dbKey));
+            rval = EPERS_SETDTAFAILED;
+
+            entry->next = gWriteCache[i];
+            gWriteCache[i] = entry;
+            numFailed++;
+         }
+         else
+         {
+            if(rval >= 0)
+            {
+               rval++;
+            }
+
+            free(entry->data);
+            free(entry);
+         }
+         entry = next;
+      }
+   }
+
+   gWriteCacheNumEntries = numFailed;
+
+   if(numFailed > 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("write_cache_flush - keys kept in the cache:"), DLT_UINT(numFailed));
+   }
+
+   return rval;
+}
+
+
+
+int write_cache_flush(void)
+{
+   int rval = 0;
+
+   // the cache stays locked while writing, so readers never see the old value from the database
+   pthread_mutex_lock(&gWriteCacheMtx);
+   rval = write_cache_flush_locked();
+   pthread_mutex_unlock(&gWriteCacheMtx);
+
+   return rval;
+}
+
+
+
+void write_cache_deinit(void)
+{
+   int i = 0;
+   unsigned int numDropped = 0;
+
+   if(gWriteCacheRunning == 1)
+   {
+      pthread_mutex_lock(&gWriteCacheThreadMtx);
+      gWriteCacheRunning = 0;
+      pthread_cond_signal(&gWriteCacheThreadCond);
+      pthread_mutex_unlock(&gWriteCacheThreadMtx);
+
+      pthread_join(gWriteCacheThread, NULL);
+
+      DLT_LOG(gPclDLTContext, DLT_LOG_INFO, DLT_STRING("write_cache_deinit - writes absorbed by the cache:"), DLT_UINT(gWriteCacheAbsorbed));
+   }
+
+   // write back before the cache is disabled, readers get the cached data until it is in the database
+   pthread_mutex_lock(&gWriteCacheMtx);
+
+   if(gWriteCacheNumEntries > 0)
+   {
+      (void)write_cache_flush_locked();
+   }
+
+   // from now on everything is written directly
+   __atomic_store_n(&gWriteCacheInterval, 0, __ATOMIC_RELEASE);
+
+   // keys which could not be written are dropped, they must not show up again after the next init
+   for(i=0; i<WriteCacheHashSize; i++)
+   {
+      while(gWriteCache[i] != NULL)
+      {
+         PersWriteCacheEntry_s* entry = gWriteCache[i];
+         gWriteCache[i] = entry->next;
+
+         DLT_LOG(gPclDLTContext, DLT_LOG_ERROR, DLT_STRING("write_cache_deinit - key not written, dropped:"), DLT_STRING(entry->dbKey));
+         free(entry->data);
+         free(entry);
+         numDropped++;
+      }
+   }
+   gWriteCacheNumEntries = 0;
+   gWriteCacheAbsorbed   = 0;
+
+   pthread_mutex_unlock(&gWriteCacheMtx);
+
+   if(numDropped > 0)
+   {
+      DLT_LOG(gPclDLTContext, DLT_LOG_WARN, DLT_STRING("write_cache_deinit - keys dropped:"), DLT_UINT(numDropped));
+   }
+}
@@ -0,0 +1,99 @@
+#ifndef PERSISTENCE_CLIENT_LIBRARY_WRITE_CACHE_H
+#define PERSISTENCE_CLIENT_LIBRARY_WRITE_CACHE_H
+
+/******************************************************************************
+ * Project         Persistency
+ * (c) copyright   2014
+ * Company         XS Embedded GmbH
+ *****************************************************************************/
+/******************************************************************************
+ * This Source Code Form is subject to the terms of the
+ * Mozilla Public License, v. 2.0. If a  copy of the MPL was not distributed
+ * with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+******************************************************************************/
+ /**
+ * @file           persistence_client_library_write_cache.h
+ * @ingroup        Persistence client library
+ * @author         Ingo Huerner
+ * @brief          Header of the write-behind cache for local write cached keys.
+ *                 Repeated writes to the same key are kept in memory and
+ *                 written to the database when the cache is flushed
+ *                 (flush interval, PAS write back request or shutdown).
+ *                 The cache is enabled with the environment variable
+ *                 PERS_CLIENT_WRITE_CACHE_INTERVAL (flush interval in ms).
+ * @see
+ */
+
+#include "persistence_client_library_data_organization.h"
+
+
+/**
+ * @brief initialize the write-behind cache, if enabled the flush thread will be started
+ *
+ * @return 1 if the cache is enabled, 0 if the cache is disabled or -1 on error
+ */
+int write_cache_init(void);
+
+
+/**
+ * @brief stop the flush thread of the write-behind cache, write back the cached data and disable the cache.
+ *        Keys which could not be written are dropped (and logged).
+ */
+void write_cache_deinit(void);
+
+
+/**
+ * @brief write data to the write-behind cache
+ *
+ * @param info persistence information
+ * @param dbPath the path to the database where the key is in
+ * @param key the database key
+ * @param buffer the buffer holding the data
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes cached or -1 if the data must be written to the database directly
+ *         (cache disabled or full, resource not local and write cached)
+ */
+int write_cache_set(const PersistenceInfo_s* info, const char* dbPath, const char* key,
+                    const unsigned char* buffer, unsigned int buffer_size);
+
+
+/**
+ * @brief read data from the write-behind cache
+ *
+ * @param info persistence information
+ * @param dbPath the path to the database where the key is in
+ * @param key the database key
+ * @param buffer the buffer for the data, NULL to get the size of the data only
+ * @param buffer_size the size of the buffer
+ *
+ * @return the number of bytes read (or the size of the data if buffer is NULL)
+ *         or -1 if the key is not in the cache
+ */
+int write_cache_get(const PersistenceInfo_s* info, const char* dbPath, const char* key,
+                    unsigned char* buffer, unsigned int buffer_size);
+
+
+/**
+ * @brief remove a key from the write-behind cache, the data will not be written to the database
+ *
+ * @param info persistence information
+ * @param dbPath the path to the database where the key is in
+ * @param key the database key
+ *
+ * @return 1 if the key has been in the cache, 0 if not
+ */
+int write_cache_remove(const PersistenceInfo_s* info, const char* dbPath, const char* key);
+
+
+/**
+ * @brief write all cached data to the databases and empty the cache.
+ *        Keys which could not be written stay in the cache and are
+ *        written again with the next flush.
+ *
+ * @return the number of keys written or EPERS_SETDTAFAILED if a key could not be written
+ */
+int write_cache_flush(void);
+
+
+#endif /* PERSISTENCE_CLIENT_LIBRARY_WRITE_CACHE_H */
@@ -316,6 +316,65 @@ void handle_benchmark(int numLoops)
 }
 
 
+static volatile int gNumNotifications = 0;
+
+static int notification_callback(pclNotification_s * notifyStruct)
+{
+   (void)notifyStruct;
+   __sync_fetch_and_add(&gNumNotifications, 1);
+   return 0;
+}
+
+
+
+void notification_benchmark(int numLoops)
+{
+   int ret = 0, i = 0, waitMs = 0;
+   long long duration = 0;
+   char buffer[128] = {0};
+   const char* pBatch = getenv("PERS_CLIENT_NOTIFY_BATCH");
+   struct timespec notifyStart, notifyEnd;
+   struct timespec sleepTime = {0, 1000000};
+
+   printf("\nTest  n o t i f i c a t i o n  performance: %d times (%s signals)\n", numLoops,
+          ((pBatch != NULL) && (atoi(pBatch) > 0)) ? "batched" : "single");
+   printf(" Run with and without PERS_CLIENT_NOTIFY_BATCH=1 to compare\n");
+
+   gNumNotifications = 0;
+   ret = pclKeyRegisterNotifyOnChange(0x20, "address/home_address", 1, 1, notification_callback);
+   if(ret < 0)
+   {
+      printf(" Failed to register notification => %d\n", ret);
+      return;
+   }
+
+   clock_gettime(CLOCK_ID, &notifyStart);
+   for(i=0; i<numLoops; i++)
+   {
+      snprintf(buffer, 128, "notification benchmark %d", i);
+      (void)pclKeyWriteData(0x20, "address/home_address", 1, 1, (unsigned char*)buffer, strlen(buffer));
+   }
+
+   // wait until all notifications have been received (max 10 seconds)
+   while((gNumNotifications < numLoops) && (waitMs++ < 10000))
+   {
+      nanosleep(&sleepTime, NULL);
+   }
+   clock_gettime(CLOCK_ID, &notifyEnd);
+   duration = getNsDuration(&notifyStart, &notifyEnd);
+
+   printf(" Received %d of %d notifications\n", gNumNotifications, numLoops);
+   if(gNumNotifications > 0)
+   {
+      printf(" Notification (write to callback) => %f ms per notification\n",
+             (double)((double)duration/NANO2MIL)/gNumNotifications);
+   }
+
+   (void)pclKeyUnRegisterNotifyOnChange(0x20, "address/home_address", 1, 1, notification_callback);
+}
+
+
+
 void* do_something(void* dataPtr)
 {
    int i = 0;
@@ -411,6 +470,8 @@ int main(int argc, char *argv[])
 
    read_benchmark(numLoops);
 
+   notification_benchmark(numLoops);
+
    //pcldeinit is done inside write_benchmark
    write_benchmark(numLoops);
 
@@ -24,6 +24,9 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <poll.h>
 
 #include <dlt/dlt.h>
 #include <dlt/dlt_common.h>
@@ -36,6 +39,23 @@
 #include "../include/persistence_client_library.h"
 #include "../include/persistence_client_library_error_def.h"
 
+#include "../src/persistence_client_library_rct_index.h"
+#include "../src/persistence_client_library_default_snapshot.h"
+#include "../src/persistence_client_library_write_cache.h"
+#include "../src/persistence_client_library_db_access.h"
+#include "../src/persistence_client_library_custom_loader.h"
+#include "../src/persistence_client_library_custom_cache.h"
+#include "../src/persistence_client_library_rct_hash.h"
+#include "../src/persistence_client_library_dbus_cmd.h"
+#include "../src/persistence_client_library_prct_access.h"
+#include "../src/persistence_client_library_handle.h"
+
+
+#ifndef PERS_RCT_COMPILER
+/// the resource configuration table compiler, used by the compiled RCT test
+#define PERS_RCT_COMPILER "../rct_compiler/persistence_rct_compiler"
+#endif
+
 
 
 #define BUF_SIZE     64
@@ -77,6 +97,12 @@ int myChangeCallback(pclNotification_s * notifyStruct)
    return 1;
 }
 
+int myOtherChangeCallback(pclNotification_s * notifyStruct)
+{
+   printf(" ==> * - * myOtherChangeCallback * - *\n");
+   return 1;
+}
+
 
 
 /**
@@ -1087,7 +1113,7 @@ START_TEST(test_Plugin)
    X_TEST_REPORT_DESCRIPTION("Test of plugins");
    X_TEST_REPORT_TYPE(GOOD);
 
-	int ret = 0;
+	int ret = 0, handle = 0;
 	unsigned char buffer[READ_SIZE]  = {0};
 
 #if 1
@@ -1145,6 +1171,50 @@ START_TEST(test_Plugin)
    ret = pclKeyDelete(0xFF, "custom3",   0, 0);
    x_fail_unless(ret == 13579, "Failed query custom data size");	// plugin should return 13579
 
+
+   // key handle, accessed via the plugin handle functions
+   handle = pclKeyHandleOpen(0xFF, "custom3", 0, 0);
+   x_fail_unless(handle >= 0, "Failed to open handle custom3");
+
+   ret = pclKeyHandleReadData(handle, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("Custom plugin -> plugin_get_data_handle: custom3!"));
+   x_fail_unless(strncmp((char*)buffer,"Custom plugin -> plugin_get_data_handle: custom3!",
+                 strlen((char*)buffer)) == 0, "Buffer CUSTOM 3 not correctly read via handle");
+   memset(buffer, 0, READ_SIZE);
+
+   ret = pclKeyHandleGetSize(handle);
+   x_fail_unless(ret == 11223344, "Failed query custom data size via handle");	// plugin should return 11223344
+
+   ret = pclKeyHandleWriteData(handle, (unsigned char*)"This is a message to write", READ_SIZE);
+   x_fail_unless(ret == 123654, "Failed to write custom data via handle");	// plugin should return 123654
+
+   ret = pclKeyHandleClose(handle);
+   x_fail_unless(ret == 1, "Failed to close handle custom3");
+
+
+   // batch, one plugin call for all entries of the same plugin
+   {
+      unsigned char buffer2[READ_SIZE] = {0};
+      pclKeyBatchEntry_s entries[2] = { {0xFF, "custom3", 0, 0, buffer,  READ_SIZE, 0},
+                                        {0xFF, "custom3", 1, 0, buffer2, READ_SIZE, 0} };
+
+      ret = pclKeyReadDataBatch(entries, 2);
+      x_fail_unless(ret == 2, "Failed to read custom data batch");
+      x_fail_unless(strncmp((char*)buffer, "Custom plugin -> plugin_get_data_batch: custom3!",
+                    strlen((char*)buffer)) == 0, "Buffer CUSTOM 3 not correctly read via batch");
+      x_fail_unless(entries[1].result == strlen("Custom plugin -> plugin_get_data_batch: custom3!"));
+      memset(buffer, 0, READ_SIZE);
+
+      entries[0].buffer_size = strlen("batch 1");
+      entries[1].buffer_size = strlen("batch 2");
+      memcpy(buffer,  "batch 1", strlen("batch 1"));
+      memcpy(buffer2, "batch 2", strlen("batch 2"));
+      ret = pclKeyWriteDataBatch(entries, 2);
+      x_fail_unless(ret == 2, "Failed to write custom data batch");
+      x_fail_unless(entries[0].result == strlen("batch 1"), "Wrong write size of custom data batch");
+      memset(buffer, 0, READ_SIZE);
+   }
+
 #endif
 }
 END_TEST
@@ -1214,6 +1284,1056 @@ END_TEST
 
 
 
+START_TEST(test_ReadDataBatch)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of batch read");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0;
+   unsigned char buffer[5][READ_SIZE];
+   pclKeyBatchEntry_s entries[5] = {
+      {0xFF, "pos/last_position",      1, 1, buffer[0], READ_SIZE, 0},
+      {0xFF, "status/open_document",   3, 2, buffer[1], READ_SIZE, 0},
+      {0x20, "address/home_address",   4, 0, buffer[2], READ_SIZE, 0},
+      {0xFF, "statusHandle/default01", 3, 2, buffer[3], READ_SIZE, 0},
+      {0x20, "batch/not_available",    4, 0, buffer[4], READ_SIZE, 0}
+   };
+
+   memset(buffer, 0, sizeof(buffer));
+
+   ret = pclKeyReadDataBatch(entries, 5);
+   x_fail_unless(ret == 4, "Wrong number of entries read");
+
+   x_fail_unless(entries[0].result == strlen("CACHE_ +48 10' 38.95, +8 44' 39.06"));
+   x_fail_unless(strncmp((char*)buffer[0], "CACHE_ +48 10' 38.95, +8 44' 39.06", strlen((char*)buffer[0])) == 0,
+                 "Buffer not correctly read - pos/last_position");
+
+   x_fail_unless(entries[1].result == strlen("WT_ /var/opt/user_manual_climateControl.pdf"));
+   x_fail_unless(strncmp((char*)buffer[1], "WT_ /var/opt/user_manual_climateControl.pdf", strlen((char*)buffer[1])) == 0,
+                 "Buffer not correctly read - status/open_document");
+
+   x_fail_unless(entries[2].result == strlen("WT_ 55327 Heimatstadt, Wohnstrasse 31"));
+   x_fail_unless(strncmp((char*)buffer[2], "WT_ 55327 Heimatstadt, Wohnstrasse 31", strlen((char*)buffer[2])) == 0,
+                 "Buffer not correctly read - address/home_address");
+
+   x_fail_unless(entries[3].result == strlen("DEFAULT_01!"));
+   x_fail_unless(strncmp((char*)buffer[3], "DEFAULT_01!", strlen((char*)buffer[3])) == 0,
+                 "Buffer not correctly read - statusHandle/default01");
+
+   x_fail_unless(entries[4].result < 0, "Read of not available resource must fail");
+
+   ret = pclKeyReadDataBatch(NULL, 5);
+   x_fail_unless(ret == EPERS_COMMON, "Batch without entries must fail");
+}
+END_TEST
+
+
+
+START_TEST(test_WriteDataBatch)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of batch write");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0, i = 0;
+   unsigned char buffer[4][READ_SIZE];
+   static unsigned char bigBuffer[17*1024] = {0};
+   pclKeyBatchEntry_s entries[4] = {
+      {0x20, "links/last_link2", 2, 1, (unsigned char*)"Batch notify shared data 2", strlen("Batch notify shared data 2"), 0},
+      {0x20, "links/last_link3", 3, 2, (unsigned char*)"Batch notify shared data 3", strlen("Batch notify shared data 3"), 0},
+      {0x20, "links/last_link4", 4, 1, (unsigned char*)"Batch notify shared data 4", strlen("Batch notify shared data 4"), 0},
+      {0xFF, "key_70",           1, 2, (unsigned char*)"Batch local data",           strlen("Batch local data"), 0}
+   };
+   pclKeyBatchEntry_s readEntries[4];
+
+   ret = pclKeyWriteDataBatch(entries, 4);
+   x_fail_unless(ret == 4, "Wrong number of entries written");
+
+   memset(buffer, 0, sizeof(buffer));
+   for(i=0; i<4; i++)
+   {
+      x_fail_unless(entries[i].result == entries[i].buffer_size, "Wrong write size");
+
+      readEntries[i] = entries[i];
+      readEntries[i].buffer      = buffer[i];
+      readEntries[i].buffer_size = READ_SIZE;
+   }
+
+   ret = pclKeyReadDataBatch(readEntries, 4);
+   x_fail_unless(ret == 4, "Wrong number of entries read");
+   for(i=0; i<4; i++)
+   {
+      x_fail_unless(readEntries[i].result == entries[i].buffer_size, "Wrong read size");
+      x_fail_unless(strncmp((char*)buffer[i], (char*)entries[i].buffer, entries[i].buffer_size) == 0, "Buffer not correctly read");
+   }
+
+   // one invalid entry ==> nothing is written
+   entries[0].buffer = (unsigned char*)"Must not be written";
+   entries[0].buffer_size = strlen("Must not be written");
+   entries[3].buffer = bigBuffer;
+   entries[3].buffer_size = sizeof(bigBuffer);
+
+   ret = pclKeyWriteDataBatch(entries, 4);
+   x_fail_unless(ret == EPERS_SETDTAFAILED, "Batch with invalid entry must be rejected");
+   x_fail_unless(entries[0].result == EPERS_SETDTAFAILED, "Valid entry of rejected batch");
+   x_fail_unless(entries[3].result == EPERS_BUFLIMIT, "Invalid entry not reported");
+
+   memset(buffer[0], 0, READ_SIZE);
+   ret = pclKeyReadData(0x20, "links/last_link2", 2, 1, buffer[0], READ_SIZE);
+   x_fail_unless(strncmp((char*)buffer[0], "Batch notify shared data 2", strlen("Batch notify shared data 2")) == 0,
+                 "Data of rejected batch has been written");
+}
+END_TEST
+
+
+
+START_TEST(test_ReadDataAlloc)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of read data into library allocated buffer");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0, handle = 0;
+   int size = 0;
+   unsigned char* buffer = NULL;
+
+   // buffer allocated by the library
+   ret = pclKeyReadDataAlloc(0xFF, "pos/last_position", 1, 1, &buffer, &size);
+   x_fail_unless(ret == strlen("CACHE_ +48 10' 38.95, +8 44' 39.06"), "Wrong read size");
+   x_fail_unless(buffer != NULL, "No buffer allocated");
+   x_fail_unless(size >= ret, "Wrong buffer size");
+   x_fail_unless(strncmp((char*)buffer, "CACHE_ +48 10' 38.95, +8 44' 39.06", ret) == 0, "Buffer not correctly read");
+
+   // buffer is reused and grown
+   free(buffer);
+   size = 4;
+   buffer = malloc(size);
+   ret = pclKeyReadDataAlloc(0x20, "address/home_address", 4, 0, &buffer, &size);
+   x_fail_unless(ret == strlen("WT_ 55327 Heimatstadt, Wohnstrasse 31"), "Wrong read size");
+   x_fail_unless(size >= ret, "Buffer not grown");
+   x_fail_unless(strncmp((char*)buffer, "WT_ 55327 Heimatstadt, Wohnstrasse 31", ret) == 0, "Buffer not correctly read");
+
+   // default value
+   ret = pclKeyReadDataAlloc(0xFF, "statusHandle/default01", 3, 2, &buffer, &size);
+   x_fail_unless(ret == strlen("DEFAULT_01!"), "Wrong read size of default value");
+   x_fail_unless(strncmp((char*)buffer, "DEFAULT_01!", ret) == 0, "Default value not correctly read");
+
+   // handle
+   handle = pclKeyHandleOpen(0xFF, "posHandle/last_position", 0, 0);
+   x_fail_unless(handle >= 0, "Failed to open handle ==> /posHandle/last_position");
+   ret = pclKeyHandleReadDataAlloc(handle, &buffer, &size);
+   x_fail_unless(ret == pclKeyHandleGetSize(handle), "Wrong read size of handle");
+   x_fail_unless(strncmp((char*)buffer, "WT_ H A N D L E: +48° 10' 38.95\", +8° 44' 39.06\"", ret) == 0, "Buffer not correctly read - handle");
+   (void)pclKeyHandleClose(handle);
+
+   free(buffer);
+
+   ret = pclKeyReadDataAlloc(0xFF, "pos/last_position", 1, 1, NULL, &size);
+   x_fail_unless(ret == EPERS_COMMON, "Read without buffer must fail");
+}
+END_TEST
+
+
+
+START_TEST(test_DataById)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of read and write data by resource descriptor");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0;
+   unsigned char buffer[READ_SIZE] = {0};
+   // not generated from the test resource configuration tables, the resource id is looked up
+   const pclResourceId_s lastPosition = { "pos/last_position", 0x12345678u, 0u };
+   const pclResourceId_s byIdKey      = { "ById/data", 0u, 1u };
+
+   ret = pclKeyReadDataById(0xFF, &lastPosition, 1, 1, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("CACHE_ +48 10' 38.95, +8 44' 39.06"), "Wrong read size");
+   x_fail_unless(strncmp((char*)buffer, "CACHE_ +48 10' 38.95, +8 44' 39.06", ret) == 0, "Buffer not correctly read");
+
+   ret = pclKeyWriteDataById(0xFF, &byIdKey, 1, 1, (unsigned char*)"Data by id", strlen("Data by id"));
+   x_fail_unless(ret == strlen("Data by id"), "Wrong write size");
+
+   memset(buffer, 0, READ_SIZE);
+   ret = pclKeyReadData(0xFF, "ById/data", 1, 1, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("Data by id"), "Wrong read size - by resource id");
+   x_fail_unless(strncmp((char*)buffer, "Data by id", ret) == 0, "Buffer not correctly read - by resource id");
+
+   memset(buffer, 0, READ_SIZE);
+   ret = pclKeyReadDataById(0xFF, &byIdKey, 1, 1, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("Data by id"), "Wrong read size - by descriptor");
+   x_fail_unless(strncmp((char*)buffer, "Data by id", ret) == 0, "Buffer not correctly read - by descriptor");
+}
+END_TEST
+
+
+
+START_TEST(test_DefaultSnapshot)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the memory mapped snapshot of the default databases, including corrupt snapshot files");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0, handle = -1, fd = -1;
+   unsigned char buffer[READ_SIZE] = {0};
+   unsigned char snapImage[READ_SIZE] = {0};
+   const char* dbPath   = "/tmp/pcl_test_default_snapshot.db";
+   const char* snapPath = "/tmp/pcl_test_default_snapshot.db.snap";
+   PersDefaultSnapshot_s* snapshot = NULL;
+   // snapshot file layout: 32 byte header, 12 byte entries (key offset, data offset, data size)
+   const int entryOffset = 32;
+   uint32_t badOffset = 0xFFFFFF00;
+
+   setenv("PERS_CLIENT_DEFAULT_SNAPSHOT", "1", 1);
+
+   (void)unlink(dbPath);
+   (void)unlink(snapPath);
+   handle = persComDbOpen(dbPath, 1);
+   x_fail_unless(handle >= 0, "Failed to create the default database");
+   x_fail_unless(persComDbWriteKey(handle, "snapKey_a", "value_a", strlen("value_a")) >= 0, "Failed to write key a");
+   x_fail_unless(persComDbWriteKey(handle, "snapKey_b", "value_bb", strlen("value_bb")) >= 0, "Failed to write key b");
+   (void)persComDbClose(handle);
+   handle = persComDbOpen(dbPath, 0);
+   x_fail_unless(handle >= 0, "Failed to open the default database");
+
+   // snapshot creation
+   snapshot = default_snapshot_get(dbPath, handle);
+   x_fail_unless(snapshot != NULL, "Snapshot not created");
+   ret = default_snapshot_read(snapshot, "snapKey_b", buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_bb"), "Wrong read size");
+   x_fail_unless(strncmp((char*)buffer, "value_bb", ret) == 0, "Buffer not correctly read");
+   x_fail_unless(default_snapshot_read(snapshot, "snapKey_a", NULL, 0) == strlen("value_a"), "Wrong data size");
+   x_fail_unless(default_snapshot_read(snapshot, "snapKey_unknown", buffer, READ_SIZE) == EPERS_NOKEY, "Unknown key found");
+
+   // the snapshot stays readable until released, even if all snapshots are closed
+   default_snapshot_close_all();
+   ret = default_snapshot_read(snapshot, "snapKey_a", buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_a"), "Snapshot not readable after close");
+   default_snapshot_put(snapshot);
+
+   // corrupt snapshot file: data offset of the first entry beyond the end of the file
+   fd = open(snapPath, O_RDWR);
+   x_fail_unless(fd != -1, "Snapshot file not written");
+   ret = read(fd, snapImage, READ_SIZE);
+   x_fail_unless(ret > entryOffset + 12, "Snapshot file too small");
+   (void)pwrite(fd, &badOffset, sizeof(badOffset), entryOffset + 4);
+   close(fd);
+
+   snapshot = default_snapshot_get(dbPath, handle);
+   x_fail_unless(snapshot != NULL, "Snapshot not created again for corrupt file");
+   memset(buffer, 0, READ_SIZE);
+   ret = default_snapshot_read(snapshot, "snapKey_a", buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_a"), "Wrong read size - corrupt file");
+   x_fail_unless(strncmp((char*)buffer, "value_a", ret) == 0, "Buffer not correctly read - corrupt file");
+   default_snapshot_put(snapshot);
+   default_snapshot_close_all();
+
+   // truncated snapshot file: keys and data cut off
+   x_fail_unless(truncate(snapPath, entryOffset + 2 * 12) == 0, "Failed to truncate the snapshot file");
+
+   snapshot = default_snapshot_get(dbPath, handle);
+   x_fail_unless(snapshot != NULL, "Snapshot not created again for truncated file");
+   memset(buffer, 0, READ_SIZE);
+   ret = default_snapshot_read(snapshot, "snapKey_b", buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_bb"), "Wrong read size - truncated file");
+   x_fail_unless(strncmp((char*)buffer, "value_bb", ret) == 0, "Buffer not correctly read - truncated file");
+   default_snapshot_put(snapshot);
+   default_snapshot_close_all();
+
+   (void)persComDbClose(handle);
+   (void)unlink(dbPath);
+   (void)unlink(snapPath);
+}
+END_TEST
+
+
+
+START_TEST(test_RctIndex)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the in-memory index of the resource configuration tables");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0, handle = -1;
+   int* modified = NULL;
+   const int idx = PrctDbTableSize - 1;
+   const char* rctPath = "/tmp/pcl_test_rct_index.itz";
+   PersistenceConfigurationKey_s config, readConfig;
+
+   memset(&config, 0, sizeof(config));
+   config.policy     = PersistencePolicy_wt;
+   config.storage    = PersistenceStorage_local;
+   config.type       = PersistenceResourceType_key;
+   config.permission = PersistencePermission_ReadWrite;
+   config.max_size   = 1234;
+   strncpy(config.reponsible, "rctIndexTest", PERS_RCT_MAX_LENGTH_RESPONSIBLE);
+
+   (void)unlink(rctPath);
+   handle = persComRctOpen(rctPath, 1);
+   x_fail_unless(handle >= 0, "Failed to create the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctIndex/res_1", &config) >= 0, "Failed to write resource 1");
+   config.max_size = 5678;
+   x_fail_unless(persComRctWrite(handle, "rctIndex/res_2", &config) >= 0, "Failed to write resource 2");
+   (void)persComRctClose(handle);
+
+   // index build
+   handle = persComRctOpen(rctPath, 0);
+   x_fail_unless(handle >= 0, "Failed to open the resource configuration table");
+   ret = rct_index_create(idx, handle, rctPath);
+   x_fail_unless(ret == 0, "Failed to create the index");
+
+   memset(&readConfig, 0, sizeof(readConfig));
+   ret = rct_index_read(idx, "rctIndex/res_1", &readConfig);
+   x_fail_unless(ret == sizeof(PersistenceConfigurationKey_s), "Resource 1 not in index");
+   x_fail_unless(readConfig.max_size == 1234, "Wrong configuration of resource 1");
+   ret = rct_index_read(idx, "rctIndex/res_2", &readConfig);
+   x_fail_unless(ret == sizeof(PersistenceConfigurationKey_s), "Resource 2 not in index");
+   x_fail_unless(readConfig.max_size == 5678, "Wrong configuration of resource 2");
+   ret = rct_index_read(idx, "rctIndex/unknown", &readConfig);
+   x_fail_unless(ret == EPERS_NOKEYDATA, "Unknown resource found in index");
+
+   // failure paths, no index is created
+   x_fail_unless(rct_index_create(-1, handle, rctPath) < 0, "Index created for negative table index");
+   x_fail_unless(rct_index_create(PrctDbTableSize, handle, rctPath) < 0, "Index created for invalid table index");
+   x_fail_unless(rct_index_create(idx - 1, -1, rctPath) < 0, "Index created for invalid handle");
+   x_fail_unless(rct_index_create(idx - 1, handle, "/tmp/pcl_test_rct_index_not_existing.itz") < 0, "Index created for missing file");
+   x_fail_unless(rct_index_read(idx - 1, "rctIndex/res_1", &readConfig) == EPERS_NOPRCTABLE, "Index available after failed creation");
+   (void)persComRctClose(handle);
+
+   // modification detection, unmodified table
+   usleep((RctIndexCheckInterval + 100) * 1000);
+   ret = rct_index_check_modified(&modified);
+   x_fail_unless(ret == 0, "Unmodified table reported as modified");
+   x_fail_unless(modified == NULL, "Modified list allocated for unmodified table");
+
+   // modified table, the index is dropped
+   handle = persComRctOpen(rctPath, 0);
+   x_fail_unless(handle >= 0, "Failed to open the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctIndex/res_3", &config) >= 0, "Failed to write resource 3");
+   (void)persComRctClose(handle);
+
+   usleep((RctIndexCheckInterval + 100) * 1000);
+   ret = rct_index_check_modified(&modified);
+   x_fail_unless(ret == 1, "Modified table not detected");
+   x_fail_unless((modified != NULL) && (modified[0] == idx), "Wrong modified table");
+   free(modified);
+   x_fail_unless(rct_index_read(idx, "rctIndex/res_1", &readConfig) == EPERS_NOPRCTABLE, "Index of modified table not dropped");
+
+   rct_index_destroy_all();
+   (void)unlink(rctPath);
+}
+END_TEST
+
+
+
+START_TEST(test_WriteCacheFlush)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the write-behind cache flush, keys which could not be written must stay in the cache");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0;
+   unsigned char buffer[READ_SIZE] = {0};
+   const char* dbPath      = "/tmp/pcl_test_write_cache";
+   const char* dbPathWrong = "/tmp/pcl_test_write_cache_missing/not_existing";
+   PersistenceInfo_s info;
+
+   memset(&info, 0, sizeof(info));
+   info.configKey.storage = PersistenceStorage_local;
+   info.configKey.policy  = PersistencePolicy_wc;
+
+   // large interval, the cache is flushed by the test only
+   setenv("PERS_CLIENT_WRITE_CACHE_INTERVAL", "100000", 1);
+   (void)mkdir(dbPath, 0755);
+
+   x_fail_unless(write_cache_init() == 1, "Write cache not enabled");
+
+   // successful flush, the cache is empty afterwards
+   x_fail_unless(write_cache_set(&info, dbPath, "wcKey_a", (const unsigned char*)"value_a", strlen("value_a")) == strlen("value_a"), "Failed to cache key a");
+   x_fail_unless(write_cache_set(&info, dbPath, "wcKey_b", (const unsigned char*)"value_b", strlen("value_b")) == strlen("value_b"), "Failed to cache key b");
+   x_fail_unless(write_cache_set(&info, dbPath, "wcKey_a", (const unsigned char*)"value_aa", strlen("value_aa")) == strlen("value_aa"), "Failed to cache key a again");
+
+   ret = write_cache_flush();
+   x_fail_unless(ret == 2, "Wrong number of keys written");
+   x_fail_unless(write_cache_get(&info, dbPath, "wcKey_a", buffer, READ_SIZE) == -1, "Key still in the cache after flush");
+   x_fail_unless(write_cache_flush() == 0, "Empty cache flushed keys");
+
+   // failed flush, the key stays in the cache and the error is reported
+   x_fail_unless(write_cache_set(&info, dbPathWrong, "wcKey_c", (const unsigned char*)"value_c", strlen("value_c")) == strlen("value_c"), "Failed to cache key c");
+   x_fail_unless(write_cache_set(&info, dbPath, "wcKey_d", (const unsigned char*)"value_d", strlen("value_d")) == strlen("value_d"), "Failed to cache key d");
+
+   ret = write_cache_flush();
+   x_fail_unless(ret == EPERS_SETDTAFAILED, "Failed write not reported");
+   x_fail_unless(write_cache_get(&info, dbPath, "wcKey_d", buffer, READ_SIZE) == -1, "Written key still in the cache");
+
+   memset(buffer, 0, READ_SIZE);
+   ret = write_cache_get(&info, dbPathWrong, "wcKey_c", buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_c"), "Failed key not kept in the cache");
+   x_fail_unless(strncmp((char*)buffer, "value_c", ret) == 0, "Wrong data of the kept key");
+
+   // the kept key is tried again with the next flush
+   x_fail_unless(write_cache_flush() == EPERS_SETDTAFAILED, "Failed write not reported again");
+   x_fail_unless(write_cache_remove(&info, dbPathWrong, "wcKey_c") == 1, "Kept key not removed");
+   x_fail_unless(write_cache_flush() == 0, "Cache not empty");
+
+   // deinit writes back the cached keys and drops the keys which could not be written
+   x_fail_unless(write_cache_set(&info, dbPath, "wcKey_e", (const unsigned char*)"value_e", strlen("value_e")) == strlen("value_e"), "Failed to cache key e");
+   x_fail_unless(write_cache_set(&info, dbPathWrong, "wcKey_f", (const unsigned char*)"value_f", strlen("value_f")) == strlen("value_f"), "Failed to cache key f");
+
+   write_cache_deinit();
+
+   memset(buffer, 0, READ_SIZE);
+   ret = persistence_get_data((char*)dbPath, "wcKey_e", "wcKey_e", &info, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("value_e"), "Cached key not written back by deinit");
+   x_fail_unless(strncmp((char*)buffer, "value_e", ret) == 0, "Wrong data written back by deinit");
+
+   x_fail_unless(write_cache_init() == 1, "Write cache not enabled again");
+   x_fail_unless(write_cache_get(&info, dbPathWrong, "wcKey_f", buffer, READ_SIZE) == -1, "Dropped key back in the cache");
+   x_fail_unless(write_cache_flush() == 0, "Cache not empty after init");
+
+   write_cache_deinit();
+   database_close_all();
+}
+END_TEST
+
+
+
+START_TEST(test_CustomCache)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the read cache for custom plugins: cache policies, TTL, truncated data and invalidation");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int ret = 0, fd = -1, idxNone = -1, idxImmutable = -1, idxTtl = -1;
+   unsigned int generation = 0;
+   unsigned char buffer[READ_SIZE] = {0};
+   const char* cfgPath = "/tmp/pcl_test_custom_cache.cfg";
+   const char* cfg = "cacheNone libnone.so od sync none\n"
+                     "cacheImmutable libimmutable.so od sync immutable\n"
+                     "cacheTtl libttl.so od sync ttl:200\n";
+
+   fd = open(cfgPath, O_CREAT|O_TRUNC|O_WRONLY, 0644);
+   x_fail_unless(fd != -1, "Failed to create the plugin configuration");
+   x_fail_unless(write(fd, cfg, strlen(cfg)) == strlen(cfg), "Failed to write the plugin configuration");
+   close(fd);
+
+   setenv("PERS_CLIENT_LIB_CUSTOM_LOAD", cfgPath, 1);
+   x_fail_unless(get_custom_libraries() >= 0, "Failed to read the plugin configuration");
+   idxNone      = custom_client_name_to_id("cacheNone", 0);
+   idxImmutable = custom_client_name_to_id("cacheImmutable", 0);
+   idxTtl       = custom_client_name_to_id("cacheTtl", 0);
+   x_fail_unless((idxNone >= 0) && (idxImmutable >= 0) && (idxTtl >= 0), "Plugins not registered");
+   x_fail_unless(custom_cache_init(get_num_custom_libraries()) == 0, "Failed to create the caches");
+
+   // no cache policy, nothing is cached
+   generation = custom_cache_generation(idxNone);
+   custom_cache_add_data(idxNone, "/none", generation, (const unsigned char*)"value", 5, READ_SIZE);
+   x_fail_unless(custom_cache_get_data(idxNone, "/none", buffer, READ_SIZE) == -1, "Data cached without cache policy");
+
+   // immutable, complete data
+   generation = custom_cache_generation(idxImmutable);
+   custom_cache_add_data(idxImmutable, "/complete", generation, (const unsigned char*)"value", 5, READ_SIZE);
+   ret = custom_cache_get_data(idxImmutable, "/complete", buffer, READ_SIZE);
+   x_fail_unless(ret == 5, "Complete data not cached");
+   x_fail_unless(strncmp((char*)buffer, "value", ret) == 0, "Wrong cached data");
+   x_fail_unless(custom_cache_get_size(idxImmutable, "/complete") == 5, "Size of complete data not known");
+
+   // possibly truncated data, the buffer has been filled completely
+   custom_cache_add_data(idxImmutable, "/truncated", generation, (const unsigned char*)"abcdefgh", 8, 8);
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/truncated", buffer, 4) == 4, "Smaller read not served");
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/truncated", buffer, READ_SIZE) == -1, "Larger read served by truncated data");
+   custom_cache_add_size(idxImmutable, "/truncated", generation, 8);
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/truncated", buffer, READ_SIZE) == 8, "Data not complete after size is known");
+
+   // invalidation, data read before the invalidation is not added
+   custom_cache_remove(idxImmutable, "/complete");
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/complete", buffer, READ_SIZE) == -1, "Removed data still cached");
+   custom_cache_add_data(idxImmutable, "/complete", generation, (const unsigned char*)"old", 3, READ_SIZE);
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/complete", buffer, READ_SIZE) == -1, "Data of an old generation cached");
+   custom_cache_add_size(idxImmutable, "/complete", generation, 3);
+   x_fail_unless(custom_cache_get_size(idxImmutable, "/complete") == -1, "Size of an old generation cached");
+
+   generation = custom_cache_generation(idxImmutable);
+   custom_cache_add_data(idxImmutable, "/complete", generation, (const unsigned char*)"new", 3, READ_SIZE);
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/complete", buffer, READ_SIZE) == 3, "Data of the current generation not cached");
+
+   custom_cache_clear(idxImmutable);
+   x_fail_unless(custom_cache_get_data(idxImmutable, "/truncated", buffer, 4) == -1, "Data cached after clear");
+
+   // time to live
+   generation = custom_cache_generation(idxTtl);
+   custom_cache_add_data(idxTtl, "/ttl", generation, (const unsigned char*)"value", 5, READ_SIZE);
+   custom_cache_add_size(idxTtl, "/ttl", generation, 5);
+   x_fail_unless(custom_cache_get_data(idxTtl, "/ttl", buffer, READ_SIZE) == 5, "Data not cached within the TTL");
+   usleep(300 * 1000);
+   x_fail_unless(custom_cache_get_data(idxTtl, "/ttl", buffer, READ_SIZE) == -1, "Data cached after the TTL expired");
+   x_fail_unless(custom_cache_get_size(idxTtl, "/ttl") == -1, "Size cached after the TTL expired");
+
+   (void)custom_cache_init(0);
+   (void)unlink(cfgPath);
+}
+END_TEST
+
+
+
+START_TEST(test_RctHash)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the compiled resource configuration table, including a compiled table not matching the table");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int handle = -1;
+   const int idx = PrctDbTableSize - 1;
+   const char* rctPath  = "/tmp/pcl_test_rct_hash.itz";
+   const char* hashPath = "/tmp/pcl_test_rct_hash.itz" PERS_RCT_HASH_EXT;
+   PersistenceConfigurationKey_s config, readConfig;
+
+   memset(&config, 0, sizeof(config));
+   config.policy     = PersistencePolicy_wc;
+   config.storage    = PersistenceStorage_local;
+   config.type       = PersistenceResourceType_key;
+   config.permission = PersistencePermission_ReadWrite;
+   config.max_size   = 4321;
+   strncpy(config.reponsible, "rctHashTest", PERS_RCT_MAX_LENGTH_RESPONSIBLE);
+
+   (void)unlink(rctPath);
+   (void)unlink(hashPath);
+   handle = persComRctOpen(rctPath, 1);
+   x_fail_unless(handle >= 0, "Failed to create the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctHash/res_1", &config) >= 0, "Failed to write resource 1");
+   config.max_size = 8765;
+   x_fail_unless(persComRctWrite(handle, "rctHash/res_2", &config) >= 0, "Failed to write resource 2");
+   (void)persComRctClose(handle);
+
+   // compiler round trip
+   x_fail_unless(system(PERS_RCT_COMPILER " -i /tmp/pcl_test_rct_hash.itz") == 0, "Failed to compile the resource configuration table");
+   x_fail_unless(rct_hash_load(idx, rctPath) == 1, "Compiled table not loaded");
+
+   memset(&readConfig, 0, sizeof(readConfig));
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_2", &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 2 not found");
+   x_fail_unless(memcmp(&readConfig, &config, sizeof(config)) == 0, "Wrong configuration of resource 2");
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_1", &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 1 not found");
+   x_fail_unless(readConfig.max_size == 4321, "Wrong configuration of resource 1");
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_unknown", &readConfig) == EPERS_NOKEYDATA, "Unknown resource found");
+
+   rct_hash_unload_all();
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_1", &readConfig) == EPERS_NOPRCTABLE, "Compiled table used after unload");
+
+   // the table is changed after it has been compiled, the compiled table is outdated
+   handle = persComRctOpen(rctPath, 0);
+   x_fail_unless(handle >= 0, "Failed to open the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctHash/res_3", &config) >= 0, "Failed to write resource 3");
+   (void)persComRctClose(handle);
+
+   x_fail_unless(rct_hash_load(idx, rctPath) == 0, "Outdated compiled table loaded");
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_1", &readConfig) == EPERS_NOPRCTABLE, "Outdated compiled table used");
+   rct_hash_unload_all();
+
+   // compiled again, the table is used again
+   x_fail_unless(system(PERS_RCT_COMPILER " -i /tmp/pcl_test_rct_hash.itz") == 0, "Failed to compile the resource configuration table again");
+   x_fail_unless(rct_hash_load(idx, rctPath) == 1, "Compiled table not loaded again");
+   x_fail_unless(rct_hash_read(idx, "rctHash/res_3", &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 3 not found");
+   rct_hash_unload_all();
+
+   (void)unlink(rctPath);
+   (void)unlink(hashPath);
+}
+END_TEST
+
+
+
+START_TEST(test_RctHashModified)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of a compiled resource configuration table whose table is rewritten after a lookup");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int handle = -1;
+   const int idx = PrctDbTableSize - 1;
+   const char* rctPath  = "/tmp/pcl_test_rct_hash_mod.itz";
+   const char* hashPath = "/tmp/pcl_test_rct_hash_mod.itz" PERS_RCT_HASH_EXT;
+   struct timeval times[2];
+   PersistenceConfigurationKey_s config, readConfig;
+
+   memset(&config, 0, sizeof(config));
+   config.policy     = PersistencePolicy_wc;
+   config.storage    = PersistenceStorage_local;
+   config.type       = PersistenceResourceType_key;
+   config.permission = PersistencePermission_ReadWrite;
+   config.max_size   = 1111;
+   strncpy(config.reponsible, "rctHashModTest", PERS_RCT_MAX_LENGTH_RESPONSIBLE);
+
+   (void)unlink(rctPath);
+   (void)unlink(hashPath);
+   handle = persComRctOpen(rctPath, 1);
+   x_fail_unless(handle >= 0, "Failed to create the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctHashMod/res_1", &config) >= 0, "Failed to write resource 1");
+   (void)persComRctClose(handle);
+
+   x_fail_unless(system(PERS_RCT_COMPILER " -i /tmp/pcl_test_rct_hash_mod.itz") == 0, "Failed to compile the resource configuration table");
+   x_fail_unless(rct_hash_load(idx, rctPath) == 1, "Compiled table not loaded");
+   x_fail_unless(rct_hash_read(idx, "rctHashMod/res_1", &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 1 not found");
+   x_fail_unless(readConfig.max_size == 1111, "Wrong configuration of resource 1");
+   x_fail_unless(rct_hash_check_modified(idx) == 0, "Table reported as modified");
+
+   // rewrite the table, the modification time is moved forward in case the test runs within one second
+   handle = persComRctOpen(rctPath, 0);
+   x_fail_unless(handle >= 0, "Failed to open the resource configuration table");
+   config.max_size = 2222;
+   x_fail_unless(persComRctWrite(handle, "rctHashMod/res_1", &config) >= 0, "Failed to rewrite resource 1");
+   (void)persComRctClose(handle);
+   gettimeofday(&times[0], NULL);
+   times[0].tv_sec += 10;
+   times[1] = times[0];
+   x_fail_unless(utimes(rctPath, times) == 0, "Failed to set the modification time");
+
+   x_fail_unless(rct_hash_check_modified(idx) == 1, "Modified table not detected");
+   rct_hash_unload(idx);
+   x_fail_unless(rct_hash_is_loaded(idx) == -1, "Compiled table still loaded after the table has been modified");
+   x_fail_unless(rct_hash_read(idx, "rctHashMod/res_1", &readConfig) == EPERS_NOPRCTABLE, "Compiled table used after unload");
+
+   // the compiled table is validated again and not used, it has been compiled from the old table
+   x_fail_unless(rct_hash_load(idx, rctPath) == 0, "Outdated compiled table loaded");
+   rct_hash_unload(idx);
+
+   // compiled again, the new configuration is used
+   x_fail_unless(system(PERS_RCT_COMPILER " -i /tmp/pcl_test_rct_hash_mod.itz") == 0, "Failed to compile the resource configuration table again");
+   x_fail_unless(rct_hash_load(idx, rctPath) == 1, "Compiled table not loaded again");
+   x_fail_unless(rct_hash_read(idx, "rctHashMod/res_1", &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 1 not found again");
+   x_fail_unless(readConfig.max_size == 2222, "Old configuration used after the table has been modified");
+   rct_hash_unload_all();
+
+   (void)unlink(rctPath);
+   (void)unlink(hashPath);
+}
+END_TEST
+
+
+
+START_TEST(test_RctHashById)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the direct lookup with resource descriptors generated by persistence_rct_compiler");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int handle = -1, fd = -1, size = 0;
+   unsigned int hash = 0, slot = 0;
+   const int idx = PrctDbTableSize - 1;
+   const char* rctPath    = "/tmp/pcl_test_rct_by_id.itz";
+   const char* hashPath   = "/tmp/pcl_test_rct_by_id.itz" PERS_RCT_HASH_EXT;
+   const char* headerPath = "/tmp/pcl_test_rct_by_id.h";
+   // resource id with characters to be escaped in the generated header
+   const char* specialId  = "rctById/\"quoted\"\\path*/end";
+   char header[4096] = {0};
+   char* pos = NULL;
+   PersistenceConfigurationKey_s config, readConfig;
+
+   memset(&config, 0, sizeof(config));
+   config.policy     = PersistencePolicy_wc;
+   config.storage    = PersistenceStorage_local;
+   config.type       = PersistenceResourceType_key;
+   config.permission = PersistencePermission_ReadWrite;
+   config.max_size   = 2468;
+   strncpy(config.reponsible, "rctByIdTest", PERS_RCT_MAX_LENGTH_RESPONSIBLE);
+
+   (void)unlink(rctPath);
+   handle = persComRctOpen(rctPath, 1);
+   x_fail_unless(handle >= 0, "Failed to create the resource configuration table");
+   x_fail_unless(persComRctWrite(handle, "rctById/res_1", &config) >= 0, "Failed to write resource 1");
+   x_fail_unless(persComRctWrite(handle, specialId, &config) >= 0, "Failed to write the special resource");
+   (void)persComRctClose(handle);
+
+   x_fail_unless(system(PERS_RCT_COMPILER " -i /tmp/pcl_test_rct_by_id.itz -g /tmp/pcl_test_rct_by_id.h") == 0, "Failed to compile the resource configuration table");
+   x_fail_unless(rct_hash_load(idx, rctPath) == 1, "Compiled table not loaded");
+
+   fd = open(headerPath, O_RDONLY);
+   x_fail_unless(fd != -1, "Header not generated");
+   size = read(fd, header, sizeof(header)-1);
+   close(fd);
+   x_fail_unless(size > 0, "Failed to read the generated header");
+
+   // resource ids are escaped in the string literal and the comment
+   x_fail_unless(strstr(header, "{ \"rctById/\\\"quoted\\\"\\\\path*/end\", 0x") != NULL, "Resource id not escaped in the descriptor");
+   x_fail_unless(strstr(header, "/// resource \"rctById/\\\"quoted\\\"\\\\path*\\/end\"") != NULL, "Resource id not escaped in the comment");
+
+   // direct lookup with the generated descriptor
+   pos = strstr(header, "{ \"rctById/res_1\", ");
+   x_fail_unless(pos != NULL, "Descriptor of resource 1 not generated");
+   x_fail_unless(sscanf(pos, "{ \"rctById/res_1\", 0x%xu, %uu };", &hash, &slot) == 2, "Invalid descriptor of resource 1");
+   x_fail_unless(hash == pers_rct_hash(0, "rctById/res_1"), "Wrong hash in the descriptor");
+
+   memset(&readConfig, 0, sizeof(readConfig));
+   x_fail_unless(rct_hash_read_slot(idx, slot, hash, &readConfig) == sizeof(PersistenceConfigurationKey_s), "Resource 1 not found in its slot");
+   x_fail_unless(memcmp(&readConfig, &config, sizeof(config)) == 0, "Wrong configuration of resource 1");
+
+   // descriptor not generated from this table
+   x_fail_unless(rct_hash_read_slot(idx, slot, hash ^ 1, &readConfig) == EPERS_NOKEYDATA, "Slot used with a wrong hash");
+   x_fail_unless(rct_hash_read_slot(idx, 0xFFFFFFFF, hash, &readConfig) == EPERS_NOKEYDATA, "Invalid slot used");
+
+   rct_hash_unload_all();
+   x_fail_unless(rct_hash_read_slot(idx, slot, hash, &readConfig) == EPERS_NOPRCTABLE, "Slot read after unload");
+
+   (void)unlink(rctPath);
+   (void)unlink(hashPath);
+   (void)unlink(headerPath);
+}
+END_TEST
+
+
+
+/// default database paths used by the key filter test
+static const char* gFilterTestPath[] = { "/tmp/pcl_test_filter_1/", "/tmp/pcl_test_filter_2/", "/tmp/pcl_test_filter_3/" };
+/// number of failed default lookups of the key filter test threads
+static int gFilterTestErrors = 0;
+
+/// create the factory default databases of the key filter test
+static int filter_test_create_dbs(void)
+{
+   int i = 0, handle = -1, rval = 0;
+   char dbFile[128] = {0};
+
+   for(i=0; i<3; i++)
+   {
+      (void)mkdir(gFilterTestPath[i], 0777);
+      snprintf(dbFile, sizeof(dbFile), "%s%s", gFilterTestPath[i], gLocalFactoryDefault);
+      (void)unlink(dbFile);
+      handle = persComDbOpen(dbFile, 1);
+      if(   (handle < 0)
+         || (persComDbWriteKey(handle, "filterKnownKey", "known", 6) != 6) )
+      {
+         rval = -1;
+      }
+      (void)persComDbClose(handle);
+   }
+
+   return rval;
+}
+
+static void filter_test_remove_dbs(void)
+{
+   int i = 0;
+   char dbFile[128] = {0};
+
+   for(i=0; i<3; i++)
+   {
+      snprintf(dbFile, sizeof(dbFile), "%s%s", gFilterTestPath[i], gLocalFactoryDefault);
+      (void)unlink(dbFile);
+      (void)rmdir(gFilterTestPath[i]);
+   }
+}
+
+static void* filter_test_thread(void* arg)
+{
+   int i = 0;
+   unsigned char buffer[64] = {0};
+   (void)arg;
+
+   for(i=0; i<500; i++)
+   {
+      char* path = (char*)gFilterTestPath[i % 3];
+
+      memset(buffer, 0, sizeof(buffer));
+      if(   (pers_get_defaults(path, "filterKnownKey", NULL, buffer, sizeof(buffer), PersGetDefault_Data) != 6)
+         || (memcmp(buffer, "known", 6) != 0)
+         || (pers_get_defaults(path, "filterUnknownKey", NULL, buffer, sizeof(buffer), PersGetDefault_Data) != EPERS_NOKEY) )
+      {
+         __atomic_add_fetch(&gFilterTestErrors, 1, __ATOMIC_SEQ_CST);
+      }
+   }
+
+   return NULL;
+}
+
+START_TEST(test_DefaultFilter)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the default key filter while databases are closed by other threads");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int i = 0;
+   unsigned int numOpen = 0, openCount = 0, evictCount = 0;
+   unsigned char buffer[64] = {0};
+   pthread_t threads[4];
+
+   // only one open database, every lookup of another path closes a database and frees its filter
+   setenv("PERS_CLIENT_MAX_OPEN_DB", "1", 1);
+   unsetenv("PERS_CLIENT_DEFAULT_SNAPSHOT");
+
+   x_fail_unless(filter_test_create_dbs() == 0, "Failed to create the factory default databases");
+
+   // known and unknown keys, the unknown key is answered by the filter on the second lookup
+   x_fail_unless(pers_get_defaults((char*)gFilterTestPath[0], "filterKnownKey", NULL, buffer, sizeof(buffer), PersGetDefault_Data) == 6, "Known key not found");
+   x_fail_unless(memcmp(buffer, "known", 6) == 0, "Wrong default data");
+   x_fail_unless(pers_get_defaults((char*)gFilterTestPath[0], "filterUnknownKey", NULL, buffer, sizeof(buffer), PersGetDefault_Data) == EPERS_NOKEY, "Unknown key found");
+   x_fail_unless(pers_get_defaults((char*)gFilterTestPath[0], "filterUnknownKey", NULL, buffer, sizeof(buffer), PersGetDefault_Data) == EPERS_NOKEY, "Unknown key found by the filter");
+
+   for(i=0; i<4; i++)
+   {
+      x_fail_unless(pthread_create(&threads[i], NULL, filter_test_thread, NULL) == 0, "Failed to create thread");
+   }
+   for(i=0; i<4; i++)
+   {
+      pthread_join(threads[i], NULL);
+   }
+   x_fail_unless(gFilterTestErrors == 0, "Wrong default lookups while databases are closed");
+
+   get_database_handle_stats(&numOpen, &openCount, &evictCount);
+   x_fail_unless(numOpen <= 1, "Max number of open databases exceeded");
+   x_fail_unless(evictCount > 0, "No database closed to stay below the max number of open databases");
+   x_fail_unless(openCount >= evictCount + numOpen, "Wrong database open count");
+
+   database_close_all();
+
+   get_database_handle_stats(&numOpen, &openCount, &evictCount);
+   x_fail_unless((numOpen == 0) && (openCount == 0) && (evictCount == 0), "Statistics not reset");
+
+   filter_test_remove_dbs();
+   unsetenv("PERS_CLIENT_MAX_OPEN_DB");
+}
+END_TEST
+
+
+
+START_TEST(test_DatabaseCloseAll)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of closing all databases while other threads use the databases");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int i = 0;
+   pthread_t threads[4];
+
+   unsetenv("PERS_CLIENT_DEFAULT_SNAPSHOT");
+
+   x_fail_unless(filter_test_create_dbs() == 0, "Failed to create the factory default databases");
+
+   for(i=0; i<4; i++)
+   {
+      x_fail_unless(pthread_create(&threads[i], NULL, filter_test_thread, NULL) == 0, "Failed to create thread");
+   }
+
+   // close_all waits for databases in use, the threads reopen the databases on the next lookup
+   for(i=0; i<200; i++)
+   {
+      database_close_all();
+   }
+
+   for(i=0; i<4; i++)
+   {
+      pthread_join(threads[i], NULL);
+   }
+   x_fail_unless(gFilterTestErrors == 0, "Wrong default lookups while all databases are closed");
+
+   database_close_all();
+
+   filter_test_remove_dbs();
+}
+END_TEST
+
+
+
+START_TEST(test_NotifyCoalesce)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the coalescing window of change notification signals");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int i = 0, timerFd = -1;
+   unsigned int numPending = 0, numCoalesced = 0;
+   struct pollfd pfd;
+   struct timespec start, end;
+   long elapsed = 0;
+
+   // the signals are not sent without a connection, only the coalescing is tested
+   setenv("PERS_CLIENT_NOTIFY_COALESCE_WINDOW", "200", 1);
+   timerFd = process_notify_coalesce_init();
+   x_fail_unless(timerFd != -1, "Coalescing not enabled");
+
+   // events of a resource within the window are merged
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for(i=0; i<5; i++)
+   {
+      process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_changed, "coalesce/key_1");
+   }
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_deleted, "coalesce/key_1");
+   process_send_notification_signal(NULL, 0xFF, 1, 3, pclNotifyStatus_changed, "coalesce/key_1");
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_changed, "coalesce/key_2");
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless(numPending == 3, "Wrong number of pending signals");
+   x_fail_unless(numCoalesced == 5, "Events within the window not merged");
+
+   // a create event sends the pending signal of the resource first and is not delayed
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_created, "coalesce/key_2");
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless(numPending == 2, "Pending signal not sent before the create event");
+
+   // the pending signals are sent when the window expires
+   pfd.fd = timerFd;
+   pfd.events = POLLIN;
+   x_fail_unless(poll(&pfd, 1, 2000) == 1, "Coalescing timer not expired");
+   clock_gettime(CLOCK_MONOTONIC, &end);
+   elapsed = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+   x_fail_unless(elapsed >= 190, "Coalescing timer expired before the window");
+
+   process_notify_coalesce_timeout(NULL);
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless(numPending == 0, "Pending signals not sent after the window");
+
+   // a new event after the window starts a new pending signal
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_changed, "coalesce/key_1");
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_changed, "coalesce/key_1");
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless((numPending == 1) && (numCoalesced == 6), "Event after the window not pending");
+
+   // all pending signals are sent at shutdown and coalescing is disabled
+   process_notify_coalesce_deinit(NULL);
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless(numPending == 0, "Pending signals not sent at shutdown");
+
+   process_send_notification_signal(NULL, 0xFF, 1, 2, pclNotifyStatus_changed, "coalesce/key_1");
+   get_notify_coalesce_stats(&numPending, &numCoalesced);
+   x_fail_unless(numPending == 0, "Signal delayed after shutdown");
+
+   unsetenv("PERS_CLIENT_NOTIFY_COALESCE_WINDOW");
+}
+END_TEST
+
+
+
+START_TEST(test_PluginRegistry)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of the plugin registry with more plugins than the former seven plugin slots");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int i = 0, j = 0, fd = -1;
+   int ids[20];
+   char name[32] = {0};
+   char libName[64] = {0};
+   char line[128] = {0};
+   const int numPlugins = sizeof(ids) / sizeof(ids[0]);
+   const char* cfgPath = "/tmp/pcl_test_plugin_registry.cfg";
+
+   fd = open(cfgPath, O_CREAT|O_TRUNC|O_WRONLY, 0644);
+   x_fail_unless(fd != -1, "Failed to create the plugin configuration");
+   for(i=0; i<numPlugins; i++)
+   {
+      int len = snprintf(line, sizeof(line), "plugin_%d libplugin_%d.so %s %s\n", i, i, (i % 2) ? "od" : "init", (i % 3) ? "sync" : "async");
+      x_fail_unless(write(fd, line, len) == len, "Failed to write the plugin configuration");
+   }
+   close(fd);
+
+   setenv("PERS_CLIENT_LIB_CUSTOM_LOAD", cfgPath, 1);
+   x_fail_unless(get_custom_libraries() >= 0, "Failed to read the plugin configuration");
+   x_fail_unless(get_num_custom_libraries() == numPlugins, "Not all plugins registered");
+
+   for(i=0; i<numPlugins; i++)
+   {
+      snprintf(name, sizeof(name), "plugin_%d", i);
+      snprintf(libName, sizeof(libName), "libplugin_%d.so", i);
+
+      ids[i] = custom_client_name_to_id(name, 0);
+      x_fail_unless(ids[i] >= 0, "Plugin not registered");
+      x_fail_unless(check_valid_idx(ids[i]) != -1, "Plugin not valid");
+      x_fail_unless(strcmp(get_custom_client_lib_name(ids[i]), libName) == 0, "Wrong library of the plugin");
+      x_fail_unless(getCustomLoadingType(ids[i]) == ((i % 2) ? LoadType_OnDemand : LoadType_PclInit), "Wrong loading type of the plugin");
+      x_fail_unless(getCustomInitType(ids[i]) == ((i % 3) ? Init_Synchronous : Init_Asynchronous), "Wrong init type of the plugin");
+
+      for(j=0; j<i; j++)
+      {
+         x_fail_unless(ids[j] != ids[i], "Two plugins with the same id");
+      }
+   }
+
+   // resource paths containing the plugin name, unknown plugins
+   x_fail_unless(custom_client_name_to_id("/Data/mnt-c/plugin_5/key", 1) == ids[5], "Plugin not found by substring");
+   x_fail_unless(custom_client_name_to_id("plugin_20", 0) == -1, "Unknown plugin found");
+
+   // a plugin read cache for each plugin
+   x_fail_unless(custom_cache_init(get_num_custom_libraries()) == 0, "Failed to create the caches");
+   for(i=0; i<numPlugins; i++)
+   {
+      x_fail_unless(check_valid_idx(ids[i]) != -1, "Plugin not valid after the cache creation");
+   }
+
+   unsetenv("PERS_CLIENT_LIB_CUSTOM_LOAD");
+   (void)unlink(cfgPath);
+}
+END_TEST
+
+
+
+START_TEST(test_KeyHandleReload)
+{
+   X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
+   X_TEST_REPORT_COMP_NAME("libpersistence_client_library");
+   X_TEST_REPORT_REFERENCE("NONE");
+   X_TEST_REPORT_DESCRIPTION("Test of a key handle whose context is resolved again after the resource configuration has been reloaded");
+   X_TEST_REPORT_TYPE(GOOD);
+
+   int handle = -1, ret = 0;
+   unsigned int generation = 0;
+   unsigned char buffer[READ_SIZE] = {0};
+   PersistenceKeyHandle_s persHandle;
+
+   handle = pclKeyHandleOpen(0xFF, "posHandle/last_position1", 0, 0);
+   x_fail_unless(handle >= 0, "Failed to open handle ==> /posHandle/last_position1");
+   ret = pclKeyHandleWriteData(handle, (unsigned char*)"reload test", strlen("reload test"));
+   x_fail_unless(ret == strlen("reload test"), "Failed to write data");
+
+   generation = db_context_generation();
+   x_fail_unless(get_key_handle_data(handle, &persHandle) == 0, "Failed to get the handle data");
+   x_fail_unless(persHandle.ctxGeneration == generation, "Wrong context generation of the handle");
+
+   // a reload of the resource configuration invalidates the resolved contexts
+   invalidate_db_context_cache();
+   x_fail_unless(db_context_generation() != generation, "Context generation not changed");
+
+   ret = pclKeyHandleReadData(handle, buffer, READ_SIZE);
+   x_fail_unless(ret == strlen("reload test"), "Failed to read data after the reload");
+   x_fail_unless(strncmp((char*)buffer, "reload test", strlen("reload test")) == 0, "Wrong data after the reload");
+
+   x_fail_unless(get_key_handle_data(handle, &persHandle) == 0, "Failed to get the handle data");
+   x_fail_unless(persHandle.ctxGeneration == db_context_generation(), "Handle context not resolved again");
+
+   ret = pclKeyHandleClose(handle);
+   x_fail_unless(ret != -1, "Failed to close handle!!");
+}
+END_TEST
+
+
+
 START_TEST(test_GetPath)
 {
    X_TEST_REPORT_TEST_NAME("persistence_client_library_test");
@@ -1353,13 +2473,50 @@ END_TEST
 
 START_TEST(test_Notifications)
 {
+   int ret = 0;
+
 	pclKeyRegisterNotifyOnChange(0x20, "address/home_address", 1, 1, myChangeCallback);
+
+	// only one callback per resource
+	ret = pclKeyRegisterNotifyOnChange(0x20, "address/home_address", 1, 1, myOtherChangeCallback);
+	x_fail_unless(ret == EPERS_NOTIFY_NOT_ALLOWED, "Second callback for the same resource not rejected");
+
+	// other resources can have their own callback
+	ret = pclKeyRegisterNotifyOnChange(0x20, "address/home_address", 2, 1, myOtherChangeCallback);
+	x_fail_unless(ret != EPERS_NOTIFY_NOT_ALLOWED, "Callback for other resource rejected");
+	pclKeyUnRegisterNotifyOnChange(0x20, "address/home_address", 2, 1, myOtherChangeCallback);
+
 	pclKeyUnRegisterNotifyOnChange(0x20, "address/home_address", 1, 1, myChangeCallback);
 }
 END_TEST
 
 
 
+START_TEST(test_NotificationsList)
+{
+   int ret = 0;
+   pclNotifyRegEntry_s entries[3] = {
+      {0x20, "address/home_address",  1, 1, myChangeCallback,      0},
+      {0x20, "address/home_address",  2, 1, myOtherChangeCallback, 0},
+      {0x20, "notify/does_not_exist", 1, 1, myChangeCallback,      0}
+   };
+
+   ret = pclKeyRegisterNotifyOnChangeList(entries, 3);
+   x_fail_unless(ret == 2, "Wrong number of registered notifications");
+   x_fail_unless(entries[0].result == 0, "Failed to register notification 1");
+   x_fail_unless(entries[1].result == 0, "Failed to register notification 2");
+   x_fail_unless(entries[2].result < 0,  "Registration of invalid resource not rejected");
+
+   ret = pclKeyUnRegisterNotifyOnChangeList(entries, 2);
+   x_fail_unless(ret == 2, "Wrong number of unregistered notifications");
+
+   ret = pclKeyRegisterNotifyOnChangeList(NULL, 3);
+   x_fail_unless(ret == EPERS_COMMON, "Invalid list not detected");
+}
+END_TEST
+
+
+
 static Suite * persistencyClientLib_suite()
 {
    Suite * s  = suite_create("Persistency client library");
@@ -1420,6 +2577,70 @@ static Suite * persistencyClientLib_suite()
    tcase_add_test(tc_ReadConfDefault, test_ReadConfDefault);
    tcase_set_timeout(tc_ReadConfDefault, 2);
 
+   TCase * tc_ReadDataBatch = tcase_create("ReadDataBatch");
+   tcase_add_test(tc_ReadDataBatch, test_ReadDataBatch);
+   tcase_set_timeout(tc_ReadDataBatch, 2);
+
+   TCase * tc_WriteDataBatch = tcase_create("WriteDataBatch");
+   tcase_add_test(tc_WriteDataBatch, test_WriteDataBatch);
+   tcase_set_timeout(tc_WriteDataBatch, 2);
+
+   TCase * tc_ReadDataAlloc = tcase_create("ReadDataAlloc");
+   tcase_add_test(tc_ReadDataAlloc, test_ReadDataAlloc);
+   tcase_set_timeout(tc_ReadDataAlloc, 2);
+
+   TCase * tc_DataById = tcase_create("DataById");
+   tcase_add_test(tc_DataById, test_DataById);
+   tcase_set_timeout(tc_DataById, 2);
+
+   TCase * tc_DefaultSnapshot = tcase_create("DefaultSnapshot");
+   tcase_add_test(tc_DefaultSnapshot, test_DefaultSnapshot);
+   tcase_set_timeout(tc_DefaultSnapshot, 2);
+
+   TCase * tc_RctIndex = tcase_create("RctIndex");
+   tcase_add_test(tc_RctIndex, test_RctIndex);
+   tcase_set_timeout(tc_RctIndex, 5);
+
+   TCase * tc_WriteCacheFlush = tcase_create("WriteCacheFlush");
+   tcase_add_test(tc_WriteCacheFlush, test_WriteCacheFlush);
+   tcase_set_timeout(tc_WriteCacheFlush, 5);
+
+   TCase * tc_CustomCache = tcase_create("CustomCache");
+   tcase_add_test(tc_CustomCache, test_CustomCache);
+   tcase_set_timeout(tc_CustomCache, 5);
+
+   TCase * tc_RctHash = tcase_create("RctHash");
+   tcase_add_test(tc_RctHash, test_RctHash);
+   tcase_set_timeout(tc_RctHash, 5);
+
+   TCase * tc_RctHashById = tcase_create("RctHashById");
+   tcase_add_test(tc_RctHashById, test_RctHashById);
+   tcase_set_timeout(tc_RctHashById, 5);
+
+   TCase * tc_DefaultFilter = tcase_create("DefaultFilter");
+   tcase_add_test(tc_DefaultFilter, test_DefaultFilter);
+   tcase_set_timeout(tc_DefaultFilter, 10);
+
+   TCase * tc_DatabaseCloseAll = tcase_create("DatabaseCloseAll");
+   tcase_add_test(tc_DatabaseCloseAll, test_DatabaseCloseAll);
+   tcase_set_timeout(tc_DatabaseCloseAll, 10);
+
+   TCase * tc_NotifyCoalesce = tcase_create("NotifyCoalesce");
+   tcase_add_test(tc_NotifyCoalesce, test_NotifyCoalesce);
+   tcase_set_timeout(tc_NotifyCoalesce, 5);
+
+   TCase * tc_PluginRegistry = tcase_create("PluginRegistry");
+   tcase_add_test(tc_PluginRegistry, test_PluginRegistry);
+   tcase_set_timeout(tc_PluginRegistry, 5);
+
+   TCase * tc_RctHashModified = tcase_create("RctHashModified");
+   tcase_add_test(tc_RctHashModified, test_RctHashModified);
+   tcase_set_timeout(tc_RctHashModified, 5);
+
+   TCase * tc_KeyHandleReload = tcase_create("KeyHandleReload");
+   tcase_add_test(tc_KeyHandleReload, test_KeyHandleReload);
+   tcase_set_timeout(tc_KeyHandleReload, 5);
+
    TCase * tc_GetPath = tcase_create("GetPath");
    tcase_add_test(tc_GetPath, test_GetPath);
    tcase_set_timeout(tc_GetPath, 2);
@@ -1438,6 +2659,7 @@ static Suite * persistencyClientLib_suite()
 
    TCase * tc_Notifications = tcase_create("Notifications");
    tcase_add_test(tc_Notifications, test_Notifications);
+   tcase_add_test(tc_Notifications, test_NotificationsList);
    tcase_set_timeout(tc_Notifications, 2);
 
    suite_add_tcase(s, tc_persSetData);
@@ -1470,6 +2692,18 @@ static Suite * persistencyClientLib_suite()
    suite_add_tcase(s, tc_ReadConfDefault);
    tcase_add_checked_fixture(tc_ReadConfDefault, data_setup, data_teardown);
 
+   suite_add_tcase(s, tc_ReadDataBatch);
+   tcase_add_checked_fixture(tc_ReadDataBatch, data_setup, data_teardown);
+
+   suite_add_tcase(s, tc_WriteDataBatch);
+   tcase_add_checked_fixture(tc_WriteDataBatch, data_setup, data_teardown);
+
+   suite_add_tcase(s, tc_ReadDataAlloc);
+   tcase_add_checked_fixture(tc_ReadDataAlloc, data_setup, data_teardown);
+
+   suite_add_tcase(s, tc_DataById);
+   tcase_add_checked_fixture(tc_DataById, data_setup, data_teardown);
+
    suite_add_tcase(s, tc_persDataFile);
    tcase_add_checked_fixture(tc_persDataFile, data_setupBlacklist, data_teardown);
 
@@ -1495,6 +2729,22 @@ static Suite * persistencyClientLib_suite()
 
    suite_add_tcase(s, tc_InitDeinit);
 
+   suite_add_tcase(s, tc_DefaultSnapshot);
+
+   suite_add_tcase(s, tc_RctIndex);
+   suite_add_tcase(s, tc_WriteCacheFlush);
+   suite_add_tcase(s, tc_CustomCache);
+   suite_add_tcase(s, tc_RctHash);
+   suite_add_tcase(s, tc_RctHashById);
+   suite_add_tcase(s, tc_DefaultFilter);
+   suite_add_tcase(s, tc_DatabaseCloseAll);
+   suite_add_tcase(s, tc_NotifyCoalesce);
+   suite_add_tcase(s, tc_PluginRegistry);
+   suite_add_tcase(s, tc_RctHashModified);
+
+   suite_add_tcase(s, tc_KeyHandleReload);
+   tcase_add_checked_fixture(tc_KeyHandleReload, data_setup, data_teardown);
+
    return s;
 }
 
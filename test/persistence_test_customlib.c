@@ -301,4 +301,27 @@ int plugin_sync(void)
 }
 
 
+int plugin_get_data_batch(plugin_batch_entry_s* entries, int num_entries)
+{
+   int i = 0;
+
+   for(i=0; i<num_entries; i++)
+   {
+      entries[i].result = snprintf(entries[i].buffer, entries[i].size, "Custom plugin -> plugin_get_data_batch: %s!", LIBIDENT);
+   }
+
+   return num_entries;
+}
+
 
+int plugin_set_data_batch(plugin_batch_entry_s* entries, int num_entries)
+{
+   int i = 0;
+
+   for(i=0; i<num_entries; i++)
+   {
+      entries[i].result = entries[i].size;
+   }
+
+   return num_entries;
+}